@@ -0,0 +1,371 @@
+// Clip.cpp - parse and unpack volumetric clips
+//
+// See Clip.h
+//
+
+#include "Clip.h"
+#include <string.h>
+
+#define GE35_NO_DATA	// just the strand type, the sketch or tool has the map
+#include "GE35mapping.h"
+
+// CubeSense header, little endian
+#define ECA_MAGIC		(0x734C)	// "Ls"
+#define ECA_TYPE		(0x02)		// 1 from CubeSense
+#define ECA_FRAMES		(0x05)
+#define ECA_LATTICE		(0x09)
+#define ECA_TITLE		(0x0C)
+
+// .kmc header, the frame count and title where a .eca has them
+#define KMC_MAGIC		(0x6D4B)	// "Km"
+#define KMC_VERSION		(0x02)
+#define KMC_STRANDS		(0x03)
+#define KMC_LEDS		(0x04)
+#define KMC_FRAMES		(0x05)
+#define KMC_TITLE		(0x0C)
+#define KMC_MAPHASH		(0x2C)
+
+// .kdc header, laid out as a .eca's
+#define KDC_MAGIC		(0x644B)	// "Kd"
+#define KDC_VERSION		(0x02)
+#define KDC_KEYS		(0x03)		// keyframe interval
+#define KDC_FRAMES		(0x05)
+#define KDC_LATTICE		(0x09)
+#define KDC_TITLE		(0x0C)
+
+// .ecb header, laid out as a .eca's
+#define ECB_MAGIC		(0x654B)	// "Ke"
+#define ECB_VERSION		(0x02)
+#define ECB_FRAMES		(0x05)
+#define ECB_LATTICE		(0x09)
+#define ECB_TITLE		(0x0C)
+#define ECB_PROGRAM		(0x2C)		// bytecode length
+
+// .kdc runs, the top two bits of a byte, n+1 in the low six
+#define KDC_SKIP		(0x00)		// leave n+1 voxels
+#define KDC_COPY		(0x40)		// n+1 voxels follow
+#define KDC_FILL		(0x80)		// one voxel follows, for n+1 voxels
+#define KDC_SKIP64		(0xC0)		// leave 64*(n+1) voxels
+#define KDC_RUN			(64)
+
+unsigned long clipGet32(const byte *p){
+    return (unsigned long) p[0] | ((unsigned long) p[1] << 8) |
+           ((unsigned long) p[2] << 16) | ((unsigned long) p[3] << 24);
+}
+
+void clipPut32(byte *p, unsigned long v){
+    p[0] = (byte) v;
+    p[1] = (byte) (v >> 8);
+    p[2] = (byte) (v >> 16);
+    p[3] = (byte) (v >> 24);
+}
+
+int clipParseHeader(const byte *hdr, unsigned long cbFile,
+                    byte rawX, byte rawY, byte rawZ, ClipInfo *info){
+    unsigned long frames = 0;
+
+    memset(info, 0, sizeof(*info));
+
+    if(cbFile >= CLIP_MAPPED_BASE && (hdr[0] | (hdr[1] << 8)) == KMC_MAGIC){
+        if(hdr[KMC_VERSION] != CLIP_MAPPED_VERSION)
+            return -1;
+        info->base = CLIP_MAPPED_BASE;
+        info->mapped = true;
+        info->strands = hdr[KMC_STRANDS];
+        info->leds = hdr[KMC_LEDS];
+        info->mapHash = clipGet32(hdr + KMC_MAPHASH);
+        frames = clipGet32(hdr + KMC_FRAMES);
+        memcpy(info->title, hdr + KMC_TITLE, CLIP_TITLE_LEN);
+        info->title[CLIP_TITLE_LEN] = 0;
+    } else if(cbFile >= CLIP_PACKED_BASE && (hdr[0] | (hdr[1] << 8)) == KDC_MAGIC){
+        if(hdr[KDC_VERSION] != CLIP_PACKED_VERSION || hdr[KDC_KEYS] == 0)
+            return -1;
+        info->packed = true;
+        info->keyInterval = hdr[KDC_KEYS];
+        frames = clipGet32(hdr + KDC_FRAMES);
+        info->base = CLIP_PACKED_BASE + 4ul * ((frames + info->keyInterval - 1) / info->keyInterval);
+        info->sizeX = hdr[KDC_LATTICE];
+        info->sizeY = hdr[KDC_LATTICE+1];
+        info->sizeZ = hdr[KDC_LATTICE+2];
+        memcpy(info->title, hdr + KDC_TITLE, CLIP_TITLE_LEN);
+        info->title[CLIP_TITLE_LEN] = 0;
+    } else if(cbFile >= CLIP_SCRIPT_BASE && (hdr[0] | (hdr[1] << 8)) == ECB_MAGIC){
+        if(hdr[ECB_VERSION] != CLIP_SCRIPT_VERSION)
+            return -1;
+        info->base = CLIP_SCRIPT_BASE;
+        info->script = true;
+        info->frames = clipGet32(hdr + ECB_FRAMES);
+        info->sizeX = hdr[ECB_LATTICE];
+        info->sizeY = hdr[ECB_LATTICE+1];
+        info->sizeZ = hdr[ECB_LATTICE+2];
+        memcpy(info->title, hdr + ECB_TITLE, CLIP_TITLE_LEN);
+        info->title[CLIP_TITLE_LEN] = 0;
+        info->frameSize = hdr[ECB_PROGRAM] | (hdr[ECB_PROGRAM+1] << 8);
+        return (info->frames > 0 && info->frameSize > 0 &&
+                cbFile >= info->base + info->frameSize) ? 0 : -1;
+    } else if(cbFile >= CLIP_ECA_BASE && (hdr[0] | (hdr[1] << 8)) == ECA_MAGIC){
+        info->base = CLIP_ECA_BASE;
+        frames = clipGet32(hdr + ECA_FRAMES);
+        info->sizeX = hdr[ECA_LATTICE];
+        info->sizeY = hdr[ECA_LATTICE+1];
+        info->sizeZ = hdr[ECA_LATTICE+2];
+        memcpy(info->title, hdr + ECA_TITLE, CLIP_TITLE_LEN);
+        info->title[CLIP_TITLE_LEN] = 0;
+    } else {
+        info->base = 0;
+        info->sizeX = rawX;
+        info->sizeY = rawY;
+        info->sizeZ = rawZ;
+    }
+
+    if(info->mapped)
+        info->frameSize = (unsigned long) info->leds * CLIP_MAPPED_ROW(info->strands);
+    else if(info->packed)
+        info->frameSize = CLIP_PACKED_MAX((unsigned long) info->sizeX * info->sizeY * info->sizeZ);
+    else
+        info->frameSize = 3ul * info->sizeX * info->sizeY * info->sizeZ;
+    if(info->frameSize == 0)
+        return -1;
+
+    // frames differ in size, the header has the count
+    if(info->packed){
+        info->frames = frames;
+        return (frames > 0 && cbFile > info->base && info->frameSize > CLIP_PACKED_PREFIX) ? 0 : -1;
+    }
+
+    // trust the file size over the header, a truncated copy still plays
+    info->frames = (cbFile - info->base) / info->frameSize;
+    if(frames && frames < info->frames)
+        info->frames = frames;
+
+    return (info->frames > 0) ? 0 : -1;
+}
+
+void clipDeinterleave(const byte *frame, const ClipInfo *info, int orient, byte *rgbOut){
+    const int sx = info->sizeX, sy = info->sizeY, sz = info->sizeZ;
+    const unsigned long plane = (unsigned long) sx * sy * sz;
+    const byte *r = frame;
+    const byte *g = frame + plane;
+    const byte *b = frame + 2*plane;
+
+    if(orient == CLIP_ORIENT_NONE){
+        for(unsigned long i=0; i<plane; i++){
+            *rgbOut++ = r[i];
+            *rgbOut++ = g[i];
+            *rgbOut++ = b[i];
+        }
+        return;
+    }
+
+    // CLIP_ORIENT_KELPER: mirror x and swap y/z (mirroring the new z)
+    for(int z=0; z<sz; z++){
+        for(int y=0; y<sy; y++){
+            for(int x=0; x<sx; x++){
+                unsigned long i = ((unsigned long)((sz-1-y)*sy + z))*sx + (sx-1-x);
+                *rgbOut++ = r[i];
+                *rgbOut++ = g[i];
+                *rgbOut++ = b[i];
+            }
+        }
+    }
+}
+
+unsigned long clipMapHash(const strand *strands, int count){
+    unsigned long h = 2166136261ul;		// FNV-1a, 32 bits
+    const unsigned long prime = 16777619ul;
+
+    h = ((h ^ (byte) count) * prime) & 0xFFFFFFFFul;
+    for(int s=0; s<count; s++){
+        int len = strands[s].len;
+        h = ((h ^ (byte) len) * prime) & 0xFFFFFFFFul;
+        for(int i=0; i<len; i++){
+            h = ((h ^ strands[s].x[i]) * prime) & 0xFFFFFFFFul;
+            h = ((h ^ strands[s].y[i]) * prime) & 0xFFFFFFFFul;
+        }
+    }
+    return h;
+}
+
+void clipMakeEcaHeader(byte *hdr, unsigned long frames,
+                       byte sizeX, byte sizeY, byte sizeZ, const char *title){
+    memset(hdr, 0, CLIP_HEADER_SIZE);
+    hdr[0] = (byte) ECA_MAGIC;
+    hdr[1] = (byte) (ECA_MAGIC >> 8);
+    hdr[ECA_TYPE] = 1;
+    clipPut32(hdr + ECA_FRAMES, frames);
+    hdr[ECA_LATTICE] = sizeX;
+    hdr[ECA_LATTICE+1] = sizeY;
+    hdr[ECA_LATTICE+2] = sizeZ;
+    if(title)
+        strncpy((char *) hdr + ECA_TITLE, title, CLIP_TITLE_LEN - 1);
+}
+
+void clipMakeMappedHeader(byte *hdr, unsigned long frames, unsigned long mapHash,
+                          byte strands, byte leds, const char *title){
+    memset(hdr, 0, CLIP_HEADER_SIZE);
+    hdr[0] = (byte) KMC_MAGIC;
+    hdr[1] = (byte) (KMC_MAGIC >> 8);
+    hdr[KMC_VERSION] = CLIP_MAPPED_VERSION;
+    hdr[KMC_STRANDS] = strands;
+    hdr[KMC_LEDS] = leds;
+    clipPut32(hdr + KMC_FRAMES, frames);
+    if(title)
+        strncpy((char *) hdr + KMC_TITLE, title, CLIP_TITLE_LEN - 1);
+    clipPut32(hdr + KMC_MAPHASH, mapHash);
+}
+
+void clipMapFrame(const byte *rgb, int width, const strand *strands,
+                  int count, int leds, byte *out){
+    // LED index major, the order GE35::sendImagePara() walks them
+    memset(out, 0, (unsigned long) leds * CLIP_MAPPED_ROW(count));
+    for(int i=0; i<leds; i++){
+        for(int s=0; s<count; s++){
+            unsigned int c = 0;
+            if(i < strands[s].len){
+                const byte *p = rgb + 3*(strands[s].y[i]*width + strands[s].x[i]);
+                c = CLIP_RGB12(p[0], p[1], p[2]);
+            }
+            if(s & 1){
+                out[1] |= (byte) (c << 4);
+                out[2] = (byte) (c >> 4);
+                out += 3;
+            } else {
+                out[0] = (byte) c;
+                out[1] = (byte) (c >> 8);
+            }
+        }
+        if(count & 1)
+            out += 2;
+    }
+}
+
+void clipMakePackedHeader(byte *hdr, unsigned long frames, byte keyInterval,
+                          byte sizeX, byte sizeY, byte sizeZ, const char *title){
+    memset(hdr, 0, CLIP_HEADER_SIZE);
+    hdr[0] = (byte) KDC_MAGIC;
+    hdr[1] = (byte) (KDC_MAGIC >> 8);
+    hdr[KDC_VERSION] = CLIP_PACKED_VERSION;
+    hdr[KDC_KEYS] = keyInterval;
+    clipPut32(hdr + KDC_FRAMES, frames);
+    hdr[KDC_LATTICE] = sizeX;
+    hdr[KDC_LATTICE+1] = sizeY;
+    hdr[KDC_LATTICE+2] = sizeZ;
+    if(title)
+        strncpy((char *) hdr + KDC_TITLE, title, CLIP_TITLE_LEN - 1);
+}
+
+void clipMakeScriptHeader(byte *hdr, unsigned long frames, unsigned int cbProgram,
+                          byte sizeX, byte sizeY, byte sizeZ, const char *title){
+    memset(hdr, 0, CLIP_SCRIPT_BASE);
+    hdr[0] = (byte) ECB_MAGIC;
+    hdr[1] = (byte) (ECB_MAGIC >> 8);
+    hdr[ECB_VERSION] = CLIP_SCRIPT_VERSION;
+    clipPut32(hdr + ECB_FRAMES, frames);
+    hdr[ECB_LATTICE] = sizeX;
+    hdr[ECB_LATTICE+1] = sizeY;
+    hdr[ECB_LATTICE+2] = sizeZ;
+    if(title)
+        strncpy((char *) hdr + ECB_TITLE, title, CLIP_TITLE_LEN - 1);
+    hdr[ECB_PROGRAM] = (byte) cbProgram;
+    hdr[ECB_PROGRAM+1] = (byte) (cbProgram >> 8);
+}
+
+static bool sameVoxel(const byte *a, const byte *b){
+    return a[0] == b[0] && a[1] == b[1] && a[2] == b[2];
+}
+
+unsigned long clipPackFrame(const byte *rgb, const byte *prev, unsigned int voxels, byte *out){
+    byte *p = out + CLIP_PACKED_PREFIX;
+    byte *copy = NULL;			// run being copied, if the last one was
+    unsigned int i = 0, skip = 0;
+
+    while(i < voxels){
+        const byte *v = rgb + 3*i;
+
+        if(prev && sameVoxel(v, prev + 3*i)){
+            skip++;				// written out when something changes
+            i++;
+            copy = NULL;
+            continue;
+        }
+        while(skip >= KDC_RUN){
+            unsigned int n = skip / KDC_RUN;
+            if(n > KDC_RUN)
+                n = KDC_RUN;
+            *p++ = KDC_SKIP64 | (n - 1);
+            skip -= n * KDC_RUN;
+        }
+        if(skip){
+            *p++ = KDC_SKIP | (skip - 1);
+            skip = 0;
+        }
+
+        unsigned int n = 1;
+        while(i + n < voxels && n < KDC_RUN && sameVoxel(v, rgb + 3*(i+n)))
+            n++;
+        if(n > 1){
+            *p++ = KDC_FILL | (n - 1);
+            *p++ = v[0];
+            *p++ = v[1];
+            *p++ = v[2];
+            copy = NULL;
+        } else {
+            if(!copy || (*copy & 0x3F) == KDC_RUN - 1){
+                copy = p++;
+                *copy = KDC_COPY;
+            } else {
+                (*copy)++;
+            }
+            *p++ = v[0];
+            *p++ = v[1];
+            *p++ = v[2];
+        }
+        i += n;
+    }
+    // voxels left unchanged at the end need nothing
+
+    unsigned long cb = p - out;
+    out[0] = (byte) (cb - CLIP_PACKED_PREFIX);
+    out[1] = (byte) ((cb - CLIP_PACKED_PREFIX) >> 8);
+    return cb;
+}
+
+int clipUnpackFrame(const byte *frame, byte *rgb, unsigned int voxels){
+    const byte *p = frame + CLIP_PACKED_PREFIX;
+    const byte *end = p + (frame[0] | (frame[1] << 8));
+    byte *d = rgb, *dEnd = rgb + 3ul*voxels;
+
+    while(p < end){
+        byte op = *p++;
+        unsigned int n = (op & 0x3F) + 1;
+
+        switch(op & 0xC0){
+        case KDC_SKIP64:
+            n *= KDC_RUN;
+            // fall through
+        case KDC_SKIP:
+            if(3ul*n > (unsigned long)(dEnd - d))
+                return -1;
+            d += 3*n;
+            break;
+        case KDC_COPY:
+            if(3ul*n > (unsigned long)(dEnd - d) || 3ul*n > (unsigned long)(end - p))
+                return -1;
+            memcpy(d, p, 3*n);
+            d += 3*n;
+            p += 3*n;
+            break;
+        case KDC_FILL:
+            if(3ul*n > (unsigned long)(dEnd - d) || end - p < 3)
+                return -1;
+            for(; n; n--){
+                *d++ = p[0];
+                *d++ = p[1];
+                *d++ = p[2];
+            }
+            p += 3;
+            break;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,133 @@
+// Clip.h - parse and unpack volumetric clips (see fileformats.txt)
+//
+// CubeSense .eca files have a header and store each frame as planar
+// R, G then B, each sizeX*sizeY*sizeZ bytes, starting at 0x100. The
+// raw888 files are the same frames with no header. This part has no
+// Arduino dependencies so it builds on the host as well.
+//
+// Pre-mapped .kmc clips (made by tools/mapclip) hold each frame in the
+// order GE35 sends it: for each LED index, a row with each strand's 4 bit
+// blue, green and red as they go on the wire (CLIP_RGB12), two strands
+// to three bytes. The even strand has the first byte and the low nibble
+// of the second, the odd one the high nibble and the third byte. LEDs
+// past the end of a shorter strand are 0. The header carries the
+// clipMapHash() of the mapping the clip was made for.
+//
+// Packed .kdc clips (made by tools/packclip) hold the frames as the
+// image, orientation applied, with a keyframe every keyInterval frames
+// and only what changed in between. Each frame is a 2 byte length and
+// runs of skipped, copied or filled voxels; clipUnpackFrame() applies
+// one to the image in a single pass. An index of the keyframes' file
+// offsets follows the header, so any frame is at most keyInterval-1
+// deltas from a place to start.
+//
+// Script .ecb clips (made by tools/ecsc) hold a compiled CubeSense .ecs
+// script instead of frames, the player renders each one with
+// ecsRender() (see Ecs.h).
+//
+
+#ifndef Clip_h
+#define Clip_h
+
+#include <stdint.h>
+typedef uint8_t byte;
+
+#define CLIP_ECA_BASE		(0x100)		// first frame in a .eca
+#define CLIP_MAPPED_BASE	(0x100)		// first frame in a .kmc
+#define CLIP_MAPPED_VERSION	(1)
+#define CLIP_PACKED_BASE	(0x100)		// keyframe index in a .kdc, the frames follow it
+#define CLIP_PACKED_VERSION	(1)
+#define CLIP_PACKED_PREFIX	(2)			// length before each .kdc frame
+#define CLIP_SCRIPT_BASE	(0x30)		// bytecode in a .ecb
+#define CLIP_SCRIPT_VERSION	(1)
+#define CLIP_HEADER_SIZE	(0x30)		// header bytes clipParseHeader() looks at
+#define CLIP_TITLE_LEN		(0x20)
+
+// an LED's color as GE35 sends it, 4 bits each of blue, green, red
+#define CLIP_RGB12(r,g,b)	((((b) >> 4) << 8) | (((g) >> 4) << 4) | ((r) >> 4))
+#define CLIP_MAPPED_ROW(strands)	((3*(strands)+1)/2)	// bytes per LED index
+// longest .kdc frame, prefix included: every voxel copied
+#define CLIP_PACKED_MAX(voxels)	(CLIP_PACKED_PREFIX + 3*(voxels) + ((voxels)+63)/64)
+
+// orientation
+#define CLIP_ORIENT_NONE	(0)			// voxel (x,y,z) comes from (x,y,z)
+#define CLIP_ORIENT_KELPER	(1)			// kelper.py's defaultXfm, (x,y,z) comes from (sx-1-x,z,sz-1-y)
+
+typedef struct {
+    unsigned long base;			// file offset of frame 0
+    unsigned long frames;		// complete frames in the file
+    unsigned long frameSize;	// 3*sizeX*sizeY*sizeZ, the most a .kdc frame can take,
+                                // or a .ecb's bytecode
+    byte sizeX;
+    byte sizeY;
+    byte sizeZ;
+    char title[CLIP_TITLE_LEN+1];
+    // pre-mapped clips only, the lattice size is 0
+    bool mapped;
+    byte strands;				// strands, and LEDs per strand, in each frame
+    byte leds;
+    unsigned long mapHash;		// clipMapHash() of the mapping it was made for
+    // packed clips only, the lattice is the image's
+    bool packed;
+    byte keyInterval;			// frames from one keyframe to the next
+    bool script;				// a .ecb, frames are rendered
+} ClipInfo;
+
+struct a_strand;				// GE35mapping.h
+
+// little endian, as the headers are
+unsigned long clipGet32(const byte *p);
+void clipPut32(byte *p, unsigned long v);
+
+// hdr holds the first min(cbFile, CLIP_HEADER_SIZE) bytes of the file.
+// Files without the CubeSense magic are taken as raw888 with the
+// given lattice size. Returns < 0 if the file can't be a clip.
+int clipParseHeader(const byte *hdr, unsigned long cbFile,
+                    byte rawX, byte rawY, byte rawZ, ClipInfo *info);
+
+// Unpack one planar frame into interleaved r,g,b triples, voxel
+// (x,y,z) at ((z*sizeY)+y)*sizeX+x. That is img[z*sizeY+y][x] when
+// img is sizeX wide. CLIP_ORIENT_KELPER needs sizeY == sizeZ.
+void clipDeinterleave(const byte *frame, const ClipInfo *info, int orient, byte *rgbOut);
+
+// Identifies a mapping: the strand count, each strand's length and the
+// x,y of its LEDs. The pins don't go into it.
+unsigned long clipMapHash(const struct a_strand *strands, int count);
+
+// Fill in the CLIP_HEADER_SIZE bytes at the start of a .eca, the rest up
+// to CLIP_ECA_BASE is zeros.
+void clipMakeEcaHeader(byte *hdr, unsigned long frames,
+                       byte sizeX, byte sizeY, byte sizeZ, const char *title);
+
+// Fill in the CLIP_HEADER_SIZE bytes at the start of a .kmc, the rest up
+// to CLIP_MAPPED_BASE is zeros.
+void clipMakeMappedHeader(byte *hdr, unsigned long frames, unsigned long mapHash,
+                          byte strands, byte leds, const char *title);
+
+// Pick out and quantize a frame for the given mapping: rgb is an image
+// (r,g,b triples) width pixels wide, out gets leds*CLIP_MAPPED_ROW(count)
+// bytes.
+void clipMapFrame(const byte *rgb, int width, const struct a_strand *strands,
+                  int count, int leds, byte *out);
+
+// Fill in the CLIP_HEADER_SIZE bytes at the start of a .kdc, the rest up
+// to CLIP_PACKED_BASE is zeros. The lattice is the size as played.
+void clipMakePackedHeader(byte *hdr, unsigned long frames, byte keyInterval,
+                          byte sizeX, byte sizeY, byte sizeZ, const char *title);
+
+// Fill in the CLIP_SCRIPT_BASE bytes at the start of a .ecb, cbProgram
+// bytes of bytecode follow.
+void clipMakeScriptHeader(byte *hdr, unsigned long frames, unsigned int cbProgram,
+                          byte sizeX, byte sizeY, byte sizeZ, const char *title);
+
+// Pack an image (r,g,b triples, voxels long) into out, which needs
+// CLIP_PACKED_MAX(voxels) bytes. prev is the image the frame follows, or
+// NULL for a keyframe. Returns the bytes used, prefix included.
+unsigned long clipPackFrame(const byte *rgb, const byte *prev, unsigned int voxels, byte *out);
+
+// Apply a packed frame (prefix first) to rgb, which holds the frame
+// before it unless this is a keyframe. Returns < 0 if the frame is
+// damaged, rgb may be partly written.
+int clipUnpackFrame(const byte *frame, byte *rgb, unsigned int voxels);
+
+#endif
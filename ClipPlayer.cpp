@@ -0,0 +1,307 @@
+// ClipPlayer.cpp - play .eca, raw888, .kmc, .kdc and .ecb clips from a USB thumb drive
+//
+// See ClipPlayer.h
+//
+
+#include <chipKITUSBHost.h>
+#include <chipKITUSBMSDHost.h>
+#include <chipKITMDDFS.h>
+
+#define GE35_NO_DATA	// don't instantiate the 'strand' structure
+#include "GE35.h"		// IMG_WIDTH, IMG_HEIGHT
+#include "ClipPlayer.h"
+#include "Ecs.h"
+
+#define CLIP_VOXELS		(IMG_WIDTH*IMG_HEIGHT)
+#define CLIP_MAPPED_FRAME_SIZE	(MAX_STRAND_LEN*CLIP_MAPPED_ROW(STRAND_COUNT))
+#define CLIP_PACKED_FRAME_SIZE	CLIP_PACKED_MAX(CLIP_VOXELS)	// a few bytes over 3*CLIP_VOXELS
+#define CLIP_BUFFER_SIZE	(CLIP_PACKED_FRAME_SIZE > CLIP_MAPPED_FRAME_SIZE ? CLIP_PACKED_FRAME_SIZE : CLIP_MAPPED_FRAME_SIZE)
+
+extern strand strands[];
+
+static bool mounted = false;
+static volatile bool pulled = false;	// set by the USB event handler
+static FSFILE *file = NULL;
+static FS_READAHEAD ra;
+static bool raActive;				// ra begun on file and not ended yet
+static byte ring[CLIP_READAHEAD_SECTORS*MEDIA_SECTOR_SIZE];
+static byte program[ECS_MAX_PROGRAM];	// a .ecb's bytecode
+static ClipInfo info;
+static int orientation;
+static unsigned long period;		// us per frame
+static unsigned long lastShown;		// micros() when the last frame went up
+static bool shownAny;
+static bool underrun;				// already counted for this frame
+
+// frame buffers, fill one while the other waits its turn
+static byte frames[2][CLIP_BUFFER_SIZE];
+static bool full[2];
+static int fillBuf;
+static int showBuf;
+static int heldBuf;					// .kmc frame being sent from its buffer, -1 if none
+static const byte *mappedFrame;		// .kmc frame clipTask() just made due
+static unsigned long fillPos;		// bytes read into frames[fillBuf]
+static unsigned long fillNeed;		// bytes frames[fillBuf] takes, a .kdc frame's known after its prefix
+static unsigned long nextFrame;		// frame going into frames[fillBuf]
+static unsigned long catchUp;		// .kdc deltas to apply unseen after a seek to a keyframe
+
+static ClipStats stats;
+
+static BOOL clipUSBEvent(uint8_t address, USB_EVENT event, void *data, DWORD size){
+    BOOL fRet = USBHost.DefaultEventHandler(address, event, data, size);
+
+    if(event == EVENT_VBUS_RELEASE_POWER){	// drive was pulled
+        pulled = true;		// this can run inside a read, clipTask() cleans up
+        return TRUE;
+    }
+    return fRet;
+}
+
+static bool mount(){
+    if(!mounted && USBMSDHost.SCSIMediaDetect() && MDDFS.Init())
+        mounted = true;
+    return mounted;
+}
+
+void clipBegin(){
+    USBHost.Begin(clipUSBEvent);
+}
+
+bool clipPlay(const char *name, float fps, int orient, unsigned long start){
+    byte hdr[CLIP_HEADER_SIZE];
+    long cbFile;
+    unsigned long pos;
+
+    clipStop();
+    if(!mount())
+        return false;
+    if((file = MDDFS.fopen(name, "r")) == NULL)
+        return false;
+
+    MDDFS.fseek(file, 0, SEEK_END);
+    cbFile = MDDFS.ftell(file);
+    MDDFS.rewind(file);
+    MDDFS.fread(hdr, 1, sizeof(hdr), file);
+
+    // raw888 clips are cubes as wide as the image
+    if(clipParseHeader(hdr, cbFile, IMG_WIDTH, IMG_WIDTH, IMG_HEIGHT/IMG_WIDTH, &info) < 0 ||
+       (info.mapped ?
+        (info.strands != STRAND_COUNT || info.leds != MAX_STRAND_LEN ||
+         info.mapHash != clipMapHash(strands, STRAND_COUNT)) :
+        (info.sizeX != IMG_WIDTH || info.sizeY * info.sizeZ != IMG_HEIGHT ||
+         (!info.packed && orient == CLIP_ORIENT_KELPER && info.sizeY != info.sizeZ)))){
+        Serial.print("clip doesn't fit the display: ");
+        Serial.println(name);
+        clipStop();
+        return false;
+    }
+
+    if(start >= info.frames)
+        start = 0;
+    catchUp = 0;
+    if(info.script){
+        // all of it now, its frames are rendered when they're due
+        MDDFS.fseek(file, info.base, SEEK_SET);
+        if(info.frameSize > sizeof(program) ||
+           MDDFS.fread(program, 1, info.frameSize, file) != info.frameSize){
+            clipStop();
+            return false;
+        }
+    } else {
+        // a .kdc starts at the keyframe before, from its index entry
+        pos = info.base + start * info.frameSize;
+        if(info.packed){
+            byte entry[4];
+            unsigned long key = start / info.keyInterval;
+
+            MDDFS.fseek(file, CLIP_PACKED_BASE + 4*key, SEEK_SET);
+            if(MDDFS.fread(entry, 1, sizeof(entry), file) != sizeof(entry)){
+                clipStop();
+                return false;
+            }
+            pos = clipGet32(entry);
+            catchUp = start - key * info.keyInterval;
+            start = key * info.keyInterval;
+        }
+        MDDFS.fseek(file, pos, SEEK_SET);
+        if(MDDFS.ReadAheadBegin(&ra, file, ring, CLIP_READAHEAD_SECTORS) != 0){
+            clipStop();
+            return false;
+        }
+        raActive = true;
+    }
+
+    orientation = orient;
+    period = (unsigned long)(1000000.0 / (fps > 0 ? fps : CLIP_DEFAULT_FPS));
+    full[0] = full[1] = false;
+    fillBuf = showBuf = 0;
+    heldBuf = -1;
+    mappedFrame = NULL;
+    fillPos = 0;
+    nextFrame = start;
+    shownAny = false;
+    underrun = false;
+
+    Serial.print("Playing ");
+    Serial.print(name);
+    Serial.print(" ");
+    Serial.print(info.title);
+    Serial.print(" frames=");
+    Serial.println(info.frames);
+    return true;
+}
+
+void clipStop(){
+    if(raActive){
+        MDDFS.ReadAheadEnd(&ra);
+        raActive = false;
+    }
+    if(file)
+        MDDFS.fclose(file);
+    file = NULL;
+    heldBuf = -1;
+    mappedFrame = NULL;
+}
+
+bool clipIsPlaying(){
+    return file != NULL;
+}
+
+bool clipIsMapped(){
+    return file != NULL && info.mapped;
+}
+
+const byte *clipMappedFrame(){
+    return mappedFrame;
+}
+
+// move what the read-ahead has into the free buffers, returns false on a read error
+static bool readAhead(){
+    unsigned long start = micros();
+
+    while(!full[fillBuf]){
+        if(fillPos == 0 && nextFrame >= info.frames){
+            MDDFS.ReadAheadEnd(&ra);				// loop the clip
+            raActive = false;
+            MDDFS.fseek(file, info.base, SEEK_SET);
+            if(MDDFS.ReadAheadBegin(&ra, file, ring, CLIP_READAHEAD_SECTORS) != 0)
+                return false;
+            raActive = true;
+            nextFrame = 0;
+        }
+        if(fillPos == 0)
+            fillNeed = info.packed ? CLIP_PACKED_PREFIX : info.frameSize;
+
+        size_t cb = MDDFS.ReadAheadRead(&ra, frames[fillBuf] + fillPos, fillNeed - fillPos);
+        if(cb == 0){
+            if(MDDFS.error() != CE_GOOD)
+                return false;
+            break;				// the next sectors are still on their way
+        }
+        fillPos += cb;
+
+        if(info.packed && fillPos == CLIP_PACKED_PREFIX && fillNeed == CLIP_PACKED_PREFIX){
+            fillNeed += frames[fillBuf][0] | (frames[fillBuf][1] << 8);
+            if(fillNeed > info.frameSize)
+                return false;		// not a frame we made
+        }
+        if(fillPos == fillNeed){
+            full[fillBuf] = true;
+            fillBuf ^= 1;
+            fillPos = 0;
+            nextFrame++;
+        }
+        if(micros() - start >= CLIP_READ_BUDGET)
+            break;
+    }
+    return true;
+}
+
+static bool failed(){
+    stats.readErrors++;
+    clipStop();
+    return false;
+}
+
+bool clipTask(byte *rgbOut){
+    USBHost.Tasks();
+    USBMSDHost.Tasks();
+
+    if(pulled){
+        pulled = false;
+        clipStop();
+        mounted = false;
+    }
+    mappedFrame = NULL;
+    if(heldBuf >= 0){			// sent since the last call, free to refill
+        full[heldBuf] = false;
+        heldBuf = -1;
+    }
+    if(!file)
+        return false;
+
+    if(!info.script){
+        if(!readAhead())
+            return failed();
+        MDDFS.ReadAheadTasks(&ra);		// keep the ring filling while both frames wait
+
+        // seeking in a .kdc, bring img up from the keyframe without showing it
+        while(catchUp > 0 && full[showBuf]){
+            if(clipUnpackFrame(frames[showBuf], rgbOut, CLIP_VOXELS) < 0)
+                return failed();
+            full[showBuf] = false;
+            showBuf ^= 1;
+            catchUp--;
+            if(!readAhead())
+                return failed();
+        }
+        if(catchUp > 0)
+            return false;
+    }
+
+    unsigned long now = micros();
+    if(shownAny && now - lastShown < period)
+        return false;
+
+    if(info.script){
+        // nothing to wait for, render it into a frame buffer as a .eca frame
+        if(ecsRender(program, info.frameSize, nextFrame, info.sizeX, info.sizeY, info.sizeZ,
+                     frames[0]) < 0)
+            return failed();
+        clipDeinterleave(frames[0], &info, orientation, rgbOut);
+        if(++nextFrame >= info.frames)
+            nextFrame = 0;
+    } else if(!full[showBuf]){
+        if(shownAny && !underrun){
+            stats.underruns++;		// hold the current frame
+            underrun = true;
+        }
+        return false;
+    } else if(info.mapped){
+        mappedFrame = frames[showBuf];	// sent straight from here
+        heldBuf = showBuf;
+    } else if(info.packed){
+        if(clipUnpackFrame(frames[showBuf], rgbOut, CLIP_VOXELS) < 0)	// onto the last frame
+            return failed();
+        full[showBuf] = false;
+    } else {
+        clipDeinterleave(frames[showBuf], &info, orientation, rgbOut);
+        full[showBuf] = false;
+    }
+    if(!info.script)
+        showBuf ^= 1;
+
+    // stay on the frame clock unless we fell a whole frame behind
+    if(shownAny && now - lastShown < 2*period)
+        lastShown += period;
+    else
+        lastShown = now;
+    shownAny = true;
+    underrun = false;
+    stats.framesShown++;
+    return true;
+}
+
+void clipGetStats(ClipStats *s){
+    *s = stats;
+}
@@ -0,0 +1,51 @@
+// ClipPlayer.h - play .eca, raw888, .kmc, .kdc and .ecb clips from a USB thumb drive
+//
+// The file is read ahead CLIP_READAHEAD_SECTORS at a time with
+// split-phase USB reads, so the transfers run while the frame is being
+// composed and sent. clipTask() moves what has arrived into a second
+// frame buffer while the current one is on display, within a time budget
+// per call, so a slow drive shows up as an underrun (the current frame is
+// held) and never stalls the output.
+//
+// A .kmc clip is already in LED order for this mapping (see Clip.h), so
+// its frames skip img: clipMappedFrame() hands each one to
+// GE35::sendMapped() as it was read from the file.
+//
+// A .kdc clip is packed (see Clip.h), each frame is applied to what is
+// in img already, so anything else drawn there stays until the next
+// keyframe. Playing one from a frame past the start begins at the
+// keyframe before it and runs the deltas up to it unseen.
+//
+// A .ecb clip is a compiled script (see Ecs.h), read whole when it
+// starts. Each frame is rendered with ecsRender() when it is due, then
+// goes to img as a .eca frame would, orientation and all.
+//
+// Needs the USB host and MDD file system libraries, and FSconfig.h,
+// usb_config.h and usb_config.c in the sketch folder.
+//
+
+#ifndef ClipPlayer_h
+#define ClipPlayer_h
+
+#include "Clip.h"
+
+#define CLIP_DEFAULT_FPS	(40.0)		// kelper.py's default
+#define CLIP_READ_BUDGET	(2000)		// us of copying per clipTask()
+#define CLIP_READAHEAD_SECTORS	(8)		// ring size, sectors read per USB transfer at most
+
+struct ClipStats {
+    unsigned long framesShown;
+    unsigned long underruns;		// frames that were due before they were read
+    unsigned long readErrors;		// and damaged .kdc frames or .ecb scripts
+};
+
+void clipBegin();					// start the USB host, call from setup()
+bool clipPlay(const char *name, float fps, int orient, unsigned long start);	// start frame
+void clipStop();
+bool clipIsPlaying();
+bool clipIsMapped();				// a .kmc is playing, img isn't shown
+bool clipTask(byte *rgbOut);		// true if a frame is due, in rgbOut (img) or clipMappedFrame()
+const byte *clipMappedFrame();		// .kmc frame made due by the last clipTask(), else NULL
+void clipGetStats(ClipStats *stats);
+
+#endif
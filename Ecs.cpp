@@ -0,0 +1,224 @@
+// Ecs.cpp - run CubeSense .ecs animation scripts compiled to bytecode
+//
+// See Ecs.h
+//
+
+#include "Ecs.h"
+#include <string.h>
+
+// sin of 0..90 degrees, 16.16
+static const int32_t sinTable[91] = {
+    0, 1144, 2287, 3430, 4572, 5712, 6850, 7987,
+    9121, 10252, 11380, 12505, 13626, 14742, 15855, 16962,
+    18064, 19161, 20252, 21336, 22415, 23486, 24550, 25607,
+    26656, 27697, 28729, 29753, 30767, 31772, 32768, 33754,
+    34729, 35693, 36647, 37590, 38521, 39441, 40348, 41243,
+    42126, 42995, 43852, 44695, 45525, 46341, 47143, 47930,
+    48703, 49461, 50203, 50931, 51643, 52339, 53020, 53684,
+    54332, 54963, 55578, 56175, 56756, 57319, 57865, 58393,
+    58903, 59396, 59870, 60326, 60764, 61183, 61584, 61966,
+    62328, 62672, 62997, 63303, 63589, 63856, 64104, 64332,
+    64540, 64729, 64898, 65048, 65177, 65287, 65376, 65446,
+    65496, 65526, 65536,
+};
+
+// sin of 0..90 degrees, between the table's entries in a straight line,
+// rounded so sin(90) is 1 however deg gets there
+static int32_t quarterSin(int32_t deg){
+    int i = deg >> 16;
+    if(i >= 90)
+        return sinTable[90];
+    return sinTable[i] + (int32_t)(((int64_t)(sinTable[i+1] - sinTable[i]) * (deg & 0xFFFF) + 0x8000) >> 16);
+}
+
+int32_t ecsSin(int32_t deg){
+    const int32_t d90 = 90 * ECS_ONE;
+    int32_t s;
+
+    deg %= 4 * d90;
+    if(deg < 0)
+        deg += 4 * d90;
+    if(deg < d90)
+        s = quarterSin(deg);
+    else if(deg < 2*d90)
+        s = quarterSin(2*d90 - deg);
+    else if(deg < 3*d90)
+        s = -quarterSin(deg - 2*d90);
+    else
+        s = -quarterSin(4*d90 - deg);
+    return s * 1000;
+}
+
+// fixed point to an integer, toward zero
+static int toInt(int32_t v){
+    return (int)(v / ECS_ONE);
+}
+
+static byte toColor(int32_t v){
+    int c = toInt(v);
+    return (c < 0) ? 0 : (c > 255) ? 255 : (byte) c;
+}
+
+static int16_t get16(const byte *p){
+    return (int16_t)(p[0] | (p[1] << 8));
+}
+
+int ecsRender(const byte *program, unsigned int cb, unsigned long frame,
+              byte sx, byte sy, byte sz, byte *out){
+    const unsigned long plane = (unsigned long) sx * sy * sz;
+    const int32_t fFrame = (int32_t)(frame << 16);
+    int32_t vars[ECS_VARS];
+    int32_t stack[ECS_STACK];
+    int sp = 0;						// stack[sp-1] is the top
+    const byte *pc = program, *end = program + cb;
+    long steps = 0;
+
+    memset(out, 0, 3*plane);
+    memset(vars, 0, sizeof(vars));
+
+// operands and stack use, checked as they go since the file could be anything
+#define NEED(bytes, pops, pushes) \
+    if(end - pc < (bytes) || sp < (pops) || sp - (pops) + (pushes) > ECS_STACK) return -1
+
+    while(pc < end){
+        if(++steps > ECS_MAX_STEPS)
+            return -1;
+
+        byte op = *pc++;
+        int32_t a, b;
+
+        switch(op){
+        case ECS_END:
+            return 0;
+        case ECS_PUSH:
+            NEED(4, 0, 1);
+            stack[sp++] = (int32_t)((uint32_t) pc[0] | ((uint32_t) pc[1] << 8) |
+                                    ((uint32_t) pc[2] << 16) | ((uint32_t) pc[3] << 24));
+            pc += 4;
+            break;
+        case ECS_PUSHI:
+            NEED(1, 0, 1);
+            stack[sp++] = (int32_t) *pc++ << 16;
+            break;
+        case ECS_LOAD:
+            NEED(1, 0, 1);
+            if(*pc >= ECS_VARS)
+                return -1;
+            stack[sp++] = vars[*pc++];
+            break;
+        case ECS_STORE:
+            NEED(1, 1, 0);
+            if(*pc >= ECS_VARS)
+                return -1;
+            vars[*pc++] = stack[--sp];
+            break;
+        case ECS_NEG:
+            NEED(0, 1, 1);
+            stack[sp-1] = (int32_t)(0u - (uint32_t) stack[sp-1]);
+            break;
+        case ECS_SIN:
+            NEED(0, 1, 1);
+            stack[sp-1] = ecsSin(stack[sp-1]);
+            break;
+        case ECS_COS:
+            NEED(0, 1, 1);
+            stack[sp-1] = ecsSin((int32_t)((uint32_t) stack[sp-1] + 90 * ECS_ONE));
+            break;
+        case ECS_ADD: case ECS_SUB: case ECS_MUL: case ECS_DIV: case ECS_MOD:
+        case ECS_LT: case ECS_LE: case ECS_GT: case ECS_GE: case ECS_EQ: case ECS_NE:
+            NEED(0, 2, 1);
+            b = stack[--sp];
+            a = stack[sp-1];
+            switch(op){
+            case ECS_ADD: a = (int32_t)((uint32_t) a + (uint32_t) b); break;	// wraps
+            case ECS_SUB: a = (int32_t)((uint32_t) a - (uint32_t) b); break;
+            case ECS_MUL: a = (int32_t)(((int64_t) a * b) >> 16); break;
+            case ECS_DIV: a = b ? (int32_t)((int64_t) a * ECS_ONE / b) : 0; break;
+            case ECS_MOD: a = b ? (int32_t)((int64_t) a % b) : 0; break;
+            case ECS_LT: a = (a < b) ? ECS_ONE : 0; break;
+            case ECS_LE: a = (a <= b) ? ECS_ONE : 0; break;
+            case ECS_GT: a = (a > b) ? ECS_ONE : 0; break;
+            case ECS_GE: a = (a >= b) ? ECS_ONE : 0; break;
+            case ECS_EQ: a = (a == b) ? ECS_ONE : 0; break;
+            case ECS_NE: a = (a != b) ? ECS_ONE : 0; break;
+            }
+            stack[sp-1] = a;
+            break;
+        case ECS_JMP:
+        case ECS_JZ:
+            NEED(2, op == ECS_JZ, 0);
+            a = get16(pc);
+            pc += 2;
+            if(op == ECS_JMP || stack[--sp] == 0){
+                if(a < program - pc || a > end - pc)
+                    return -1;
+                pc += a;
+            }
+            break;
+        case ECS_FRAME:
+            NEED(3, 2, 0);
+            b = stack[--sp];		// end
+            a = stack[--sp];		// first
+            if(pc[0] >= ECS_VARS)
+                return -1;
+            if(a <= fFrame && fFrame < b){
+                vars[pc[0]] = fFrame;
+                pc += 3;
+            } else {
+                a = get16(pc + 1);
+                pc += 3;
+                if(a < program - pc || a > end - pc)
+                    return -1;
+                pc += a;
+            }
+            break;
+        case ECS_POINT: {
+            NEED(0, 7, 0);
+            sp -= 7;
+            const int32_t *p = stack + sp;
+            int x = toInt(p[1]), y = toInt(p[2]), z = toInt(p[3]);
+            if(p[0] != fFrame || x < 0 || x >= sx || y < 0 || y >= sy || z < 0 || z >= sz)
+                break;
+            unsigned long i = ((unsigned long) z * sy + y) * sx + x;
+            out[i] = toColor(p[4]);
+            out[plane + i] = toColor(p[5]);
+            out[2*plane + i] = toColor(p[6]);
+            break;
+        }
+        case ECS_BOX: {
+            NEED(0, 11, 0);
+            sp -= 11;
+            const int32_t *p = stack + sp;
+            if(p[0] != fFrame)
+                break;
+            int lo[3], hi[3];
+            const byte size[3] = { sx, sy, sz };
+            for(int k=0; k<3; k++){
+                int c1 = toInt(p[1+k]), c2 = toInt(p[4+k]);
+                lo[k] = (c1 < c2) ? c1 : c2;
+                hi[k] = (c1 < c2) ? c2 : c1;
+                if(lo[k] < 0)
+                    lo[k] = 0;
+                if(hi[k] >= size[k])
+                    hi[k] = size[k] - 1;
+            }
+            byte r = toColor(p[7]), g = toColor(p[8]), bl = toColor(p[9]);
+            for(int z=lo[2]; z<=hi[2]; z++){
+                for(int y=lo[1]; y<=hi[1]; y++){
+                    for(int x=lo[0]; x<=hi[0]; x++){
+                        unsigned long i = ((unsigned long) z * sy + y) * sx + x;
+                        out[i] = r;
+                        out[plane + i] = g;
+                        out[2*plane + i] = bl;
+                    }
+                }
+            }
+            break;
+        }
+        default:
+            return -1;
+        }
+    }
+#undef NEED
+    return 0;
+}
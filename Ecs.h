@@ -0,0 +1,73 @@
+// Ecs.h - run CubeSense .ecs animation scripts compiled to bytecode
+//
+// tools/ecsc compiles a script (for loops, assignments, arithmetic,
+// mathsin/mathcos, drawpoint and drawbox) into a few hundred bytes of
+// bytecode for a small stack machine, stored in a .ecb clip (see
+// fileformats.txt). ecsRender() runs it for one frame and draws into a
+// frame laid out as a .eca's, so it plays like any other clip.
+//
+// Numbers are 16.16 fixed point, +-32767 and a bit. mathsin() and
+// mathcos() take degrees and return 1000 times the sine or cosine, from
+// a table. Draw coordinates and colors are cut to integers toward zero,
+// colors are clamped to 0..255 and voxels outside the lattice are
+// skipped. A draw only lands if its frame argument is the frame being
+// rendered, and the compiler turns a for loop over the frame variable
+// into ECS_FRAME, which runs its body once for that frame, so a frame
+// costs one pass of the script's inner loops.
+//
+// No Arduino dependencies, it builds on the host as well.
+//
+
+#ifndef Ecs_h
+#define Ecs_h
+
+#include <stdint.h>
+typedef uint8_t byte;
+
+#define ECS_VARS		(16)		// script variables
+#define ECS_STACK		(16)		// expression stack
+#define ECS_MAX_PROGRAM	(1024)		// bytecode the player has room for
+#define ECS_MAX_STEPS	(200000L)	// instructions per frame before giving up
+
+#define ECS_ONE			((int32_t) 0x10000)	// 1.0
+
+// opcodes, operands follow little endian
+enum {
+    ECS_END = 0,
+    ECS_PUSH,		// 4 byte fixed point constant
+    ECS_PUSHI,		// 1 byte integer constant
+    ECS_LOAD,		// 1 byte variable
+    ECS_STORE,		// 1 byte variable, pops
+    ECS_ADD,
+    ECS_SUB,
+    ECS_MUL,
+    ECS_DIV,		// x/0 is 0
+    ECS_MOD,
+    ECS_NEG,
+    ECS_LT,			// comparisons leave 1 or 0
+    ECS_LE,
+    ECS_GT,
+    ECS_GE,
+    ECS_EQ,
+    ECS_NE,
+    ECS_SIN,		// 1000*sin(degrees)
+    ECS_COS,
+    ECS_JMP,		// 2 byte signed offset from the next instruction
+    ECS_JZ,			// pops, jumps if 0
+    ECS_POINT,		// pops frame, x, y, z, r, g, b
+    ECS_BOX,		// pops frame, x1, y1, z1, x2, y2, z2, r, g, b, style
+    ECS_FRAME,		// 1 byte variable, 2 byte offset: pops first, end; if
+                    // first <= frame < end the variable is set to the frame
+                    // and the body that follows runs, else it is jumped
+};
+
+// Render frame number frame into out (3*sx*sy*sz bytes, planar as a .eca
+// frame), which is cleared first. Returns < 0 if the program is broken
+// or doesn't finish in ECS_MAX_STEPS.
+int ecsRender(const byte *program, unsigned int cb, unsigned long frame,
+              byte sx, byte sy, byte sz, byte *out);
+
+// 1000*sin(deg), both 16.16
+int32_t ecsSin(int32_t deg);
+
+#endif
@@ -42,6 +42,7 @@ Current performance w/ ISR:
 
 #define GE35_NO_DATA	// don't instantiate the 'strand' structure
 #include "GE35.h"		// includes configuration information (e.g. mapping)
+#include "Profiler.h"
 
 #define USE_ISR
 #if defined(__PIC32MX__) && defined(USE_ISR)
@@ -157,8 +158,10 @@ ISR(TIMER2_OVF_vect)
 #if defined(__PIC32MX__) && defined(USE_ISR)
 extern "C" {
 void __ISR(_TIMER_3_VECTOR,IPL3AUTO) timerISR(void){
+    PROF_BEGIN(tISR);
     mT3ClearIntFlag();  // Clear interrupt flag
     if(myGE35) myGE35->sendFrameISR();
+    PROF_END_ISR(tISR);
     // mT3ClearIntFlag();  // Clear interrupt flag
 }
 }
@@ -190,41 +193,17 @@ void GE35::sendSingleLED(byte address, int pin, byte r, byte g, byte b, byte i)
 }
 
 void GE35::makeFrame(byte index, byte r, byte g, byte b, byte i, byte *buffer){
-    // creates 26 byte version of 26bit payload
-    int bufferPos = 0;
-    int bitPos;
-    int data;
-
-    while (bufferPos < 26) {
-        switch (bufferPos) {
-        case 0:			// first 6 bits are INDEX of LED
-            bitPos = 6;
-            data = index;
-            break;
-        case 6:			// 8 bits for INTENSITY
-            bitPos = 8;
-            data = i;	
-            break;
-        case 14:		// 4 bits of BLUE
-            bitPos = 4;
-            data = b>>4;
-            break;
-        case 18:		// 4 bits of GREEN
-            bitPos = 4;
-            data = g>>4;
-            break;
-        case 22:		// 4 bits of RED
-            bitPos = 4;
-            data = r>>4;
-            break;
-        default:
-            break;
-        } 
-        
-        buffer[bufferPos] = ( (data & (1 << (bitPos - 1))) != 0) ? 1:0;
-        bitPos--;
-        bufferPos++;
-    }
+    // 4 bits each of BLUE, GREEN and RED, packed the way sendMapped() gets them
+    makePayload(index, i, ((b>>4)<<8) | ((g>>4)<<4) | (r>>4), buffer);
+}
+
+void GE35::makePayload(byte index, byte i, uint16_t bgr, byte *buffer){
+    // creates 26 byte version of 26bit payload, MSB first:
+    // 6 bits INDEX of LED, 8 bits INTENSITY, then the 12 bits of color
+    uint32_t data = ((uint32_t)(index & 0x3f) << 20) | ((uint32_t)i << 12) | (bgr & 0xfff);
+
+    for(int bit=25; bit>=0; bit--)
+        *buffer++ = (data >> bit) & 1;
 }
 
 void GE35::displayTimeSince(unsigned long then, char * desc){
@@ -250,6 +229,32 @@ void GE35::sendImagePara(){
     displayTimeSince(sendIMGParaEntry, "sendIMGPara");
 }
 
+void GE35::sendMapped(const byte *frame){
+    // same walk as sendImagePara(), but the colors come in LED order so
+    // there's no strands[].x/y lookup into out[] and nothing to quantize
+    byte buffer[26];
+
+    for(byte i=0; i < MAX_STRAND_LEN; i++, frame += (3*STRAND_COUNT+1)/2){
+        const byte *p = frame;	// two strands' colors in three bytes
+        PROF_BEGIN(tCompose);
+        clearPortMasks();
+        for(byte s=0; s<STRAND_COUNT; s++){
+            uint16_t bgr;
+            if(s & 1){
+                bgr = (p[1] >> 4) | (p[2] << 4);
+                p += 3;
+            } else
+                bgr = p[0] | ((p[1] & 0x0f) << 8);
+            if(i < strands[s].len){
+                makePayload(i, imgBright, bgr, buffer);
+                deferredSendFrame(strands[s].pin, buffer);
+            }
+        }
+        PROF_END(PROF_COMPOSE, tCompose);
+        sendFrame();
+    }
+}
+
 void GE35::setGlobalIntensity(byte val){
     byte buffer[26];
     makeFrame(0xff, 0x80,0x80,0x00, val, buffer);
@@ -335,10 +340,10 @@ void GE35::composeAndSendFrame(){
     
     byte buffer[26];
 
+    PROF_BEGIN(tCompose);
     clearPortMasks();	// keep track of pins we actually xmit on
 
     // Accumulate bit streams for ALL strands in portAframe[], portCframe[], etc...
-    unsigned long composeLoop = millis();
     for (byte s=0; s<STRAND_COUNT; s++){
         int index = row[s];
         if (index != -1){
@@ -351,20 +356,14 @@ void GE35::composeAndSendFrame(){
                 DUMPRGB(pix->r,pix->g,pix->b);
             }
                 
-            // unsigned long makeFrameTime = millis();
             makeFrame(index, pix->r, pix->g, pix->b, imgBright, buffer);
-            // displayTimeSince(makeFrameTime,"makeFrame");
-            // unsigned long defferedSendFrameTime = millis();
             deferredSendFrame(strands[s].pin, buffer);
-            // displayTimeSince(defferedSendFrameTime, "defferedSendFrame");
         }
     }
-    // displayTimeSince(composeLoop,"composeLoop");
-    unsigned long sendFrameTime = millis();
+    PROF_END(PROF_COMPOSE, tCompose);	// see Profiler.h, /stats over OSC
 
     // sends accumulated bitstreams out at max serial rate
     sendFrame();
-    // displayTimeSince(sendFrameTime, "sendFrame");
 }
 
 #define sliceSet(s) *s |= pinmask;
@@ -397,7 +396,9 @@ void GE35::deferredSendFrame(byte pin, byte *bitbuffer){
 void GE35::sendFrame(){
 
 #ifdef USE_ISR
+    PROF_BEGIN(tIdle);
     while(sendFrameFlag);
+    PROF_END(PROF_IDLE, tIdle);
 #endif
 
     sendISRPingPong = sendFramePingPong;        // send current buffer
@@ -83,6 +83,9 @@ public:
     void sendImage(){ sendImagePara(); };
     void sendImagePara();
     void sendImageSerial();
+    // xmit a frame already in LED order, a row of STRAND_COUNT packed 12 bit
+    // colors for each LED index in turn, as a .kmc clip stores them (Clip.h)
+    void sendMapped(const byte *frame);
     void sendSingleLED(byte address, int pin, byte r, byte g, byte b, byte i);
 
     // util
@@ -93,6 +96,7 @@ public:
 
 private:
     void makeFrame(byte index, byte r, byte g, byte b, byte i, byte *buffer);
+    void makePayload(byte index, byte i, uint16_t bgr, byte *buffer);
     void displayTimeSince(unsigned long then, char * desc);
     void setGlobalIntensity(byte val);
 	// Low Level I/O
@@ -0,0 +1,167 @@
+// OSCPool.cpp - fixed size storage for OSC messages and datagram buffers
+//
+// See OSCPool.h
+//
+
+#include "OSCPool.h"
+#include <string.h>
+
+static OSCInMessage poolMessages[OSC_POOL_MESSAGES];
+static uint32_t poolBuffers[OSC_POOL_BUFFERS][OSC_POOL_BUFFER_SIZE/4];	// word aligned
+
+static uint32_t messagesUsed = 0;	// one bit per slot
+static uint32_t buffersUsed = 0;
+static OSCPoolStats stats;
+
+// both pools track their slots in a 32 bit mask
+#if OSC_POOL_MESSAGES > 32 || OSC_POOL_BUFFERS > 32
+#error "OSC pools are limited to 32 entries"
+#endif
+
+static int allocSlot(uint32_t *used, int cSlots, int *inUse, int *highWater){
+    for(int i=0; i<cSlots; i++){
+        if(!(*used & (1ul<<i))){
+            *used |= (1ul<<i);
+            if(++(*inUse) > *highWater)
+                *highWater = *inUse;
+            return i;
+        }
+    }
+    stats.allocFailed++;
+    return -1;
+}
+
+static void freeSlot(uint32_t *used, int i, int *inUse){
+    if(*used & (1ul<<i)){
+        *used &= ~(1ul<<i);
+        (*inUse)--;
+    }
+}
+
+OSCInMessage *OSCPool::allocMessage(){
+    int i = allocSlot(&messagesUsed, OSC_POOL_MESSAGES,
+                      &stats.messagesInUse, &stats.messagesHighWater);
+    return (i < 0) ? NULL : &poolMessages[i];
+}
+
+void OSCPool::freeMessage(OSCInMessage *msg){
+    if(msg)
+        freeSlot(&messagesUsed, msg - poolMessages, &stats.messagesInUse);
+}
+
+byte *OSCPool::allocBuffer(){
+    int i = allocSlot(&buffersUsed, OSC_POOL_BUFFERS,
+                      &stats.buffersInUse, &stats.buffersHighWater);
+    return (i < 0) ? NULL : (byte *) poolBuffers[i];
+}
+
+void OSCPool::freeBuffer(byte *buf){
+    if(buf)
+        freeSlot(&buffersUsed, (uint32_t *) buf - poolBuffers[0], &stats.buffersInUse);
+}
+
+void OSCPool::getStats(OSCPoolStats *s){
+    *s = stats;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// OSCInMessage
+///////////////////////////////////////////////////////////////////////////////
+
+// OSC strings are NUL terminated and padded to 4 bytes
+static int paddedStringSize(byte *p, int cbMax){
+    byte *end = (byte *) memchr(p, 0, cbMax);
+    if(!end)
+        return -1;
+    int cb = (end - p + 4) & ~3;
+    return (cb <= cbMax) ? cb : -1;
+}
+
+// OSC is big endian, the PIC32 is not
+static uint32_t getBE32(byte *p){
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+}
+
+int OSCInMessage::decode(byte *data, int len){
+    int pos, cb;
+
+    _cArgs = 0;
+    _address = (char *) data;
+    _tags = (char *) "";
+
+    if(len < 4 || (cb = paddedStringSize(data, len)) < 0)
+        return -1;
+    pos = cb;
+
+    // a message with no type tags has no arguments
+    if(pos == len)
+        return 0;
+    if(data[pos] != ',' || (cb = paddedStringSize(data+pos, len-pos)) < 0)
+        return -1;
+    _tags = (char *) data + pos + 1;
+    pos += cb;
+
+    for(char *t=_tags; *t; t++){
+        if(_cArgs >= OSC_MAX_ARGS)
+            return -1;
+        switch(*t){
+        case 'i':
+        case 'f':
+            cb = 4;
+            _arg[_cArgs] = data + pos;
+            _cbArg[_cArgs] = 4;
+            break;
+        case 's':
+            if((cb = paddedStringSize(data+pos, len-pos)) < 0)
+                return -1;
+            _arg[_cArgs] = data + pos;
+            _cbArg[_cArgs] = strlen((char *) data + pos);
+            break;
+        case 'b': {
+            if(len-pos < 4)
+                return -1;
+            // checked unsigned before it's padded, it can be anything
+            uint32_t cbBlob = getBE32(data+pos);
+            if(cbBlob > (uint32_t)(len-pos-4))
+                return -1;
+            _cbArg[_cArgs] = cbBlob;
+            _arg[_cArgs] = data + pos + 4;
+            cb = 4 + ((cbBlob + 3) & ~3);
+            break;
+        }
+        default:
+            return -1;		// nothing we handle sends anything else
+        }
+        if(cb < 0 || cb > len-pos)
+            return -1;
+        pos += cb;
+        _cArgs++;
+    }
+    return 0;
+}
+
+int32_t OSCInMessage::getArgInt32(int i){
+    if(i >= _cArgs)
+        return 0;
+    if(_tags[i] == 'f')
+        return (int32_t) getArgFloat(i);
+    return (int32_t) getBE32(_arg[i]);
+}
+
+float OSCInMessage::getArgFloat(int i){
+    union { uint32_t u; float f; } v;
+    if(i >= _cArgs)
+        return 0.0;
+    v.u = getBE32(_arg[i]);
+    if(_tags[i] == 'i')
+        return (float)(int32_t) v.u;
+    return v.f;
+}
+
+byte *OSCInMessage::getArgData(int i){
+    return (i < _cArgs) ? _arg[i] : NULL;
+}
+
+int OSCInMessage::getArgSize(int i){
+    return (i < _cArgs) ? _cbArg[i] : 0;
+}
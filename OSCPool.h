@@ -0,0 +1,73 @@
+// OSCPool.h - fixed size storage for OSC messages and datagram buffers
+//
+// Everything the OSC path needs comes out of static pools sized at
+// compile time, so receiving and sending OSC never touches the heap.
+// Messages are decoded in place: an OSCInMessage only points into the
+// pool buffer holding the datagram, so the buffer must stay allocated
+// for as long as the message is in use.
+//
+// OSCPool::getStats() reports how much of each pool is in use and the
+// most that has ever been in use at once, to size the pools from a real
+// show instead of guessing.
+//
+
+#ifndef OSCPool_h
+#define OSCPool_h
+
+#if ARDUINO>=100
+#include <Arduino.h>	// Arduino 1.0
+#else
+#include <Wprogram.h>	// Pre 1.0
+#endif
+
+#include <stdint.h>
+typedef uint8_t byte;
+
+// pool sizes
+#define OSC_POOL_MESSAGES		(2)		// decoded messages alive at once
+#define OSC_POOL_BUFFERS		(2)		// datagram buffers (one receive, one spare for encoding)
+#define OSC_POOL_BUFFER_SIZE	(4096)	// must hold the biggest /screen datagram we accept
+#define OSC_MAX_ARGS			(8)		// /setyx is the widest message at 6
+
+// a received OSC message, decoded in place
+class OSCInMessage {
+public:
+    int decode(byte *data, int len);	// < 0 if the datagram is not a valid OSC message
+
+    char *getOSCAddress(){ return _address; }
+    int getArgsNum(){ return _cArgs; }
+    char getTypeTag(int i){ return (i < _cArgs) ? _tags[i] : 0; }
+
+    int32_t getArgInt32(int i);			// 'f' arguments are converted
+    float getArgFloat(int i);			// 'i' arguments are converted
+    byte *getArgData(int i);			// start of a blob's or string's bytes
+    int getArgSize(int i);				// size of a blob or string, 4 for i/f
+
+private:
+    char *_address;
+    char *_tags;						// type tags without the leading ','
+    int _cArgs;
+    byte *_arg[OSC_MAX_ARGS];
+    int _cbArg[OSC_MAX_ARGS];
+};
+
+struct OSCPoolStats {
+    int messagesInUse;
+    int messagesHighWater;
+    int buffersInUse;
+    int buffersHighWater;
+    int allocFailed;					// requests that found the pool empty
+};
+
+class OSCPool {
+public:
+    static OSCInMessage *allocMessage();
+    static void freeMessage(OSCInMessage *msg);
+
+    static byte *allocBuffer();			// OSC_POOL_BUFFER_SIZE bytes
+    static void freeBuffer(byte *buf);
+
+    static void getStats(OSCPoolStats *stats);
+};
+
+#endif
@@ -0,0 +1,159 @@
+// Profiler.cpp - per stage timing of the frame pipeline
+//
+// See Profiler.h
+//
+
+#include "Profiler.h"
+
+#ifdef PROF_ENABLE
+
+#include <string.h>
+
+struct profStage {
+    uint32_t pending;				// cycles so far this frame
+    uint32_t min;
+    uint32_t max;
+    uint32_t count;					// samples in the histogram
+    uint64_t sum;
+    uint16_t hist[PROF_BUCKETS];
+};
+
+static profStage stages[PROF_STAGES];
+static volatile uint32_t isrCycles = 0;	// only written by the ISR
+static uint32_t isrSeen = 0;
+static uint32_t frameStart = 0;
+static bool started = false;
+
+static const char *stageNames[PROF_STAGES] = {
+    "net", "decode", "dispatch", "prep", "compose", "isr", "idle", "frame"
+};
+
+// 4 buckets per power of two: 0..3 are exact, then the top 3 bits select the bucket
+static int bucketOf(uint32_t v){
+    if(v < 4)
+        return v;
+    int o = 31 - __builtin_clz(v);
+    int b = 4*(o-1) + ((v >> (o-2)) & 3);
+    return (b < PROF_BUCKETS) ? b : PROF_BUCKETS-1;
+}
+
+// smallest value that lands in bucket b
+static uint32_t bucketBase(int b){
+    if(b < 4)
+        return b;
+    return (uint32_t)(4 + (b & 3)) << (b/4 - 1);
+}
+
+static void record(profStage *s, uint32_t v){
+    if(v < s->min) s->min = v;
+    if(v > s->max) s->max = v;
+
+    // decay so old frames fade out
+    if(s->count >= PROF_WINDOW){
+        for(int i=0; i<PROF_BUCKETS; i++)
+            s->hist[i] >>= 1;
+        s->count >>= 1;
+        s->sum >>= 1;
+    }
+    s->hist[bucketOf(v)]++;
+    s->count++;
+    s->sum += v;
+}
+
+void profAdd(int stage, uint32_t cycles){
+    stages[stage].pending += cycles;
+}
+
+void profISR(uint32_t cycles){
+    isrCycles += cycles;
+}
+
+void profFrame(){
+    uint32_t now = _CP0_GET_COUNT();
+    uint32_t isr = isrCycles;
+
+    stages[PROF_ISR].pending = isr - isrSeen;
+    isrSeen = isr;
+    stages[PROF_FRAME].pending = now - frameStart;
+
+    if(started){
+        for(int i=0; i<PROF_STAGES; i++)
+            record(&stages[i], stages[i].pending);
+    } else {
+        profReset();	// first call only starts the clock
+        started = true;
+    }
+    for(int i=0; i<PROF_STAGES; i++)
+        stages[i].pending = 0;
+    frameStart = now;
+}
+
+void profReset(){
+    for(int i=0; i<PROF_STAGES; i++){
+        uint32_t pending = stages[i].pending;
+        memset(&stages[i], 0, sizeof(stages[i]));
+        stages[i].pending = pending;
+        stages[i].min = 0xFFFFFFFF;
+    }
+}
+
+// upper end of the bucket holding the pct'th percentile, never above max
+static uint32_t percentile(profStage *s, int pct){
+    uint32_t want = (s->count * pct + 99) / 100;
+    uint32_t seen = 0;
+    for(int b=0; b<PROF_BUCKETS-1; b++){
+        seen += s->hist[b];
+        if(seen >= want && seen)
+            return min(bucketBase(b+1) - 1, s->max);
+    }
+    return s->max;
+}
+
+// OSC is big endian
+static byte *putInt(byte *p, uint32_t v){
+    *p++ = v >> 24;
+    *p++ = v >> 16;
+    *p++ = v >> 8;
+    *p++ = v;
+    return p;
+}
+
+// NUL terminated and padded to 4 bytes
+static byte *putString(byte *p, const char *s){
+    int cb = strlen(s);
+    memcpy(p, s, cb);
+    memset(p + cb, 0, 4 - (cb & 3));
+    return p + ((cb + 4) & ~3);
+}
+
+// returns the bundle size, or 0 if cbMax is too small
+int profEncodeStats(byte *buf, int cbMax){
+    // "#bundle", timetag, then per stage: size, "/stats/<name>", ",iiiiiii", 7 ints
+    if(cbMax < 16 + PROF_STAGES * (4 + 20 + 12 + 7*4))
+        return 0;
+
+    byte *p = putString(buf, "#bundle");
+    p = putInt(p, 0);
+    p = putInt(p, 1);		// timetag 1 means "immediately"
+
+    for(int i=0; i<PROF_STAGES; i++){
+        profStage *s = &stages[i];
+        char addr[20] = "/stats/";
+        byte *size = p;
+
+        strcat(addr, stageNames[i]);
+        p = putString(p + 4, addr);
+        p = putString(p, ",iiiiiii");
+        p = putInt(p, s->count);
+        p = putInt(p, s->count ? s->min / PROF_CYCLES_PER_US : 0);
+        p = putInt(p, s->count ? (uint32_t)(s->sum / s->count) / PROF_CYCLES_PER_US : 0);
+        p = putInt(p, s->max / PROF_CYCLES_PER_US);
+        p = putInt(p, percentile(s, 50) / PROF_CYCLES_PER_US);
+        p = putInt(p, percentile(s, 90) / PROF_CYCLES_PER_US);
+        p = putInt(p, percentile(s, 99) / PROF_CYCLES_PER_US);
+        putInt(size, p - size - 4);
+    }
+    return p - buf;
+}
+
+#endif
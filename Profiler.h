@@ -0,0 +1,77 @@
+// Profiler.h - per stage timing of the frame pipeline
+//
+// Each stage (network receive, OSC decode, prepOutBuffer, compose, ...)
+// adds the core timer cycles it used to a per frame total, and
+// profFrame() commits the totals as one sample per stage, so the stats
+// show how each frame's time was split. Samples go into fixed size log
+// histograms (4 buckets per power of two) that are halved every
+// PROF_WINDOW samples, which keeps avg and percentiles rolling. Min and
+// max run from the last profReset().
+//
+// The ISR stage is the time spent inside the timer 3 handler (not the
+// interrupt entry/exit), and it is also counted in whatever stage it
+// interrupted. Idle is the time sendFrame() spins waiting for the ISR
+// to finish shifting out the previous frame.
+//
+// Comment out PROF_ENABLE to compile the profiler out. It is PIC32 only.
+//
+
+#ifndef Profiler_h
+#define Profiler_h
+
+#if ARDUINO>=100
+#include <Arduino.h>	// Arduino 1.0
+#else
+#include <Wprogram.h>	// Pre 1.0
+#endif
+
+#include <stdint.h>
+typedef uint8_t byte;
+
+#ifdef __PIC32MX__
+#define PROF_ENABLE
+#endif
+
+enum {
+    PROF_NET = 0,		// DNETcK periodic tasks and reading datagrams
+    PROF_DECODE,		// OSC decode
+    PROF_DISPATCH,		// OSC handlers, /screen copies
+    PROF_PREP,			// prepOutBuffer
+    PROF_COMPOSE,		// composeAndSendFrame, building the bit streams
+    PROF_ISR,			// timer 3 ISR shifting bits out
+    PROF_IDLE,			// waiting on the ISR in sendFrame
+    PROF_FRAME,			// whole frame, profFrame() to profFrame()
+    PROF_STAGES
+};
+
+#define PROF_WINDOW		(1024)		// samples before the histograms decay
+#define PROF_BUCKETS	(96)		// up to 2^24 cycles, ~0.4s at 40MHz
+
+#ifdef PROF_ENABLE
+
+#include <p32xxxx.h>
+
+#define PROF_CYCLES_PER_US	(F_CPU/2000000)	// core timer runs at half the CPU clock
+
+#define PROF_BEGIN(t)		uint32_t t = _CP0_GET_COUNT()
+#define PROF_END(stage, t)	profAdd(stage, _CP0_GET_COUNT() - (t))
+#define PROF_END_ISR(t)		profISR(_CP0_GET_COUNT() - (t))
+
+void profAdd(int stage, uint32_t cycles);	// add to this frame's total for stage
+void profISR(uint32_t cycles);				// only called from the ISR
+void profFrame();							// commit this frame's totals
+void profReset();
+int profEncodeStats(byte *buf, int cbMax);	// OSC bundle of /stats/<stage> messages
+
+#else
+
+#define PROF_BEGIN(t)
+#define PROF_END(stage, t)
+#define PROF_END_ISR(t)
+#define profFrame()
+#define profReset()
+#define profEncodeStats(buf, cbMax)	(0)
+
+#endif
+
+#endif
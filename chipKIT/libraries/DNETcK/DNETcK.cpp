@@ -286,6 +286,37 @@ void DNETcK::periodicTasks(void)
     EthernetPeriodicTasks();
 }
 
+/***	void DNETcK::setPeriodicTasksBudget(unsigned long usBudget)
+**
+**	Synopsis:   
+**      Limits how much work each call to periodicTasks() does.
+**
+**	Parameters:
+**      usBudget    The time in microseconds periodicTasks() may spend on incoming frames,
+**                  0 (the default) to run the whole stack on every call
+**
+**	Return Values:
+**      None
+**
+**	Errors:
+**      None
+**
+**  Notes:
+**
+**      With a budget set, the stack housekeeping (DHCP, TCP timers, IGMP and the stack
+**      applications) only runs when it is due, and no new frames are taken once the
+**      budget is used up; they wait in the MAC receive buffers for the next call.
+**      At least one frame is processed per call. This keeps the time periodicTasks()
+**      takes short and predictable, which matters when it is called between time
+**      critical output. Size the receive buffers with setMACBuffers() so the frames
+**      that arrive between calls fit.
+**      
+*/
+void DNETcK::setPeriodicTasksBudget(unsigned long usBudget)
+{
+    EthernetSetPeriodicTasksBudget(usBudget);
+}
+
 /***	unsigned long DNETcK::setDefaultBlockTime(unsigned long msDefaultBlockTimeT)
 **
 **	Synopsis:   
@@ -613,6 +644,165 @@ bool DNETcK::isARPIpMacResolved(const IPv4& ip, MAC * pMAC, unsigned long msBloc
     }
 }
 
+/***	bool DNETcK::setMACBuffers(int cTxBuffers, int cRxBuffers, int cbRxBuffer)
+**
+**	Synopsis:   
+**      Sets how many transmit and receive buffers the Ethernet MAC uses
+**      and how big the receive buffers are.
+**
+**	Parameters:
+**      cTxBuffers  The number of transmit buffers, each holds one full frame
+**      cRxBuffers  The number of receive buffers
+**      cbRxBuffer  The size of each receive buffer, rounded up to a multiple of 16, 64 - 1536
+**
+**	Return Values:
+**      true    if the configuration will be used by begin()
+**      false   if it does not fit in the MAC buffer pool, or begin() has already been called
+**
+**	Errors:
+**      None
+**
+**  Notes:
+**
+**      Must be called before begin(). All buffers come out of one fixed pool, by default
+**      2 transmit buffers and 8 receive buffers of 1536 bytes. Smaller receive buffers
+**      buy more of them: frames that do not fit in one receive buffer are copied into a
+**      1536 byte frame buffer taken from the same pool, small datagrams are used in place.
+**      Many small buffers absorb a burst of small datagrams that arrives while the sketch
+**      is busy and not calling periodicTasks(). Use getMACBufferStats() to see how close
+**      to running out the configuration gets.
+**      
+*/
+bool DNETcK::setMACBuffers(int cTxBuffers, int cRxBuffers, int cbRxBuffer)
+{
+    if(_fBegun)
+    {
+        return(false);
+    }
+
+    return(EthernetSetMACBuffers(cTxBuffers, cRxBuffers, cbRxBuffer));
+}
+
+/***	void DNETcK::getMACBufferStats(MACBufferStats * pStats)
+**
+**	Synopsis:   
+**      Returns the Ethernet MAC buffer statistics
+**
+**	Parameters:
+**      pStats    A pointer to a MACBufferStats structure to receive the statistics
+**
+**	Return Values:
+**      None
+**
+**	Errors:
+**      None
+**
+**  Notes:
+**
+**      The receive conditions are checked every time the stack looks for a new frame,
+**      so cRxNoBuffer and cRxOverflow count how often the condition was seen, not how many
+**      frames were lost. The statistics are cleared by begin().
+**      
+*/
+void DNETcK::getMACBufferStats(MACBufferStats * pStats)
+{
+    EthernetGetMACBufferStats(pStats);
+}
+
+/***	void DNETcK::getARPCacheStats(ARPCacheStats * pStats)
+**
+**	Synopsis:   
+**      Returns the ARP cache statistics
+**
+**	Parameters:
+**      pStats    A pointer to an ARPCacheStats structure to receive the statistics
+**
+**	Return Values:
+**      None
+**
+**	Errors:
+**      None
+**
+**  Notes:
+**
+**      Every check for a resolved MAC address counts as a hit or a miss, so
+**      isEndPointResolved() polling for an ARP reply adds a miss per call.
+**      Hosts are learned from ARP replies and from ARP requests and IP packets
+**      sent to us, so peers that talk to us first are usually hits.
+**      The statistics are cleared by begin().
+**      
+*/
+void DNETcK::getARPCacheStats(ARPCacheStats * pStats)
+{
+    EthernetGetARPCacheStats(pStats);
+}
+
+/***	bool DNETcK::joinMulticastGroup(const IPv4& ip)
+**
+**	Synopsis:   
+**      Joins an IPv4 multicast group so UdpServers and UdpClients
+**      listening on the local port receive datagrams sent to the group.
+**
+**	Parameters:
+**      ip    The multicast group address, 224.0.0.0 - 239.255.255.255
+**
+**	Return Values:
+**      true    if the group is joined
+**      false   if the IP is not a multicast address, too many groups are joined,
+**              or the stack has not been initialized
+**
+**	Errors:
+**      None
+**
+**  Notes:
+**
+**      IGMP membership reports are sent from periodicTasks() once the
+**      stack has an IP address, so a join made while DHCP is still running is
+**      reported as soon as the lease is bound. The maximum number of groups is
+**      MAX_IGMP_GROUPS in TCPIPConfig.h.
+**      
+*/
+bool DNETcK::joinMulticastGroup(const IPv4& ip)
+{
+    if(!_fBegun)
+    {
+        return(false);
+    }
+
+    return(EthernetJoinMulticastGroup(ip.rgbIP));
+}
+
+/***	bool DNETcK::leaveMulticastGroup(const IPv4& ip)
+**
+**	Synopsis:   
+**      Leaves a multicast group joined with joinMulticastGroup
+**
+**	Parameters:
+**      ip    The multicast group address
+**
+**	Return Values:
+**      true    if the group was joined and has now been left
+**      false   if the group was not joined
+**
+**	Errors:
+**      None
+**
+**  Notes:
+**
+**      Datagrams for the group are filtered out by the MAC immediately,
+**      the IGMP leave message is sent from periodicTasks().
+**      
+*/
+bool DNETcK::leaveMulticastGroup(const IPv4& ip)
+{
+    if(!_fBegun)
+    {
+        return(false);
+    }
+
+    return(EthernetLeaveMulticastGroup(ip.rgbIP));
+}
+
 /***	void DNETcK::terminateDNS(void)
 **
 **	Synopsis:   
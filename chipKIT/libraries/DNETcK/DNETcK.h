@@ -42,6 +42,25 @@
 #define bool BOOL
 #endif
 
+// Ethernet MAC buffer statistics, see DNETcK::getMACBufferStats()
+typedef struct
+{
+    int cRxNoBuffer;        // times the MAC was found to have run out of receive buffers
+    int cRxOverflow;        // times the MAC was found to have dropped frames
+    int cRxMaxBacklog;      // most receive buffers holding unprocessed frames at once
+    int cRxGathered;        // frames larger than one receive buffer
+    int cTxNoBuffer;        // times a send had to wait for a free transmit buffer
+} MACBufferStats;
+
+// ARP cache statistics, see DNETcK::getARPCacheStats()
+typedef struct
+{
+    unsigned long cHits;        // MAC addresses found in the cache
+    unsigned long cMisses;      // ARP requests sent for hosts not in the cache
+    unsigned long cLearned;     // hosts added to the cache
+    unsigned long cEvicted;     // hosts dropped to make room for another
+} ARPCacheStats;
+
 #ifdef __cplusplus
 
 #include "WProgram.h"	
@@ -68,6 +87,13 @@ typedef struct
     unsigned short  port;
 } IPEndPoint;
 
+// one piece of a datagram written with UdpClient::writeDatagram(const DatagramPiece *, int)
+typedef struct
+{
+    const byte *    pb;         // bytes to send, may be NULL if cb is 0
+    unsigned int    cb;         // number of bytes
+} DatagramPiece;
+
 // everything is static so this class does NOT have to be instantiated
 // you call things directly as DNETcK::begin();
 class DNETcK {
@@ -208,6 +234,7 @@ public:
     static bool isInitialzied(unsigned long msBlockMax, STATUS * pStatus);
     
     static void periodicTasks(void);
+    static void setPeriodicTasksBudget(unsigned long usBudget);
 
     static unsigned long secondsSinceEpoch(void);  
     static unsigned long secondsSinceEpoch(STATUS * pStatus);  
@@ -223,6 +250,13 @@ public:
     static bool isARPIpMacResolved(const IPv4& ip, MAC * pMAC);
     static bool isARPIpMacResolved(const IPv4& ip, MAC * pMAC, unsigned long msBlockMax);
 
+    static bool setMACBuffers(int cTxBuffers, int cRxBuffers, int cbRxBuffer);
+    static void getMACBufferStats(MACBufferStats * pStats);
+    static void getARPCacheStats(ARPCacheStats * pStats);
+
+    static bool joinMulticastGroup(const IPv4& ip);
+    static bool leaveMulticastGroup(const IPv4& ip);
+
     static bool isDNSResolved(const char * szHostName, IPv4 * pIP);
     static bool isDNSResolved(const char * szHostName, IPv4 * pIP, unsigned long msBlockMax);
     static bool isDNSResolved(const char * szHostName, IPv4 * pIP, STATUS * pStatus);
@@ -298,6 +332,9 @@ public:
  
     int readByte(void);
     size_t readStream(byte *rgbRead, size_t cbReadMax);
+
+    size_t peekStreamSpans(const byte ** ppSpan1, size_t * pcbSpan1, const byte ** ppSpan2, size_t * pcbSpan2);
+    size_t consumeStream(size_t cbConsume);
  
     int writeByte(byte bData);                      
     int writeByte(byte bData, DNETcK::STATUS * pStatus);
@@ -438,6 +475,7 @@ public:
 
     size_t readDatagram(byte *rgbRead, size_t cbReadMax);
     long int writeDatagram(const byte *rgbWrite, size_t cbWrite);
+    long int writeDatagram(const DatagramPiece *rgPieces, int cPieces);
  
     bool getRemoteEndPoint(IPEndPoint *pRemoteEP);
     bool getLocalEndPoint(IPEndPoint *pLocalEP);
@@ -592,6 +592,91 @@ size_t TcpClient::readStream(byte *rgbRead, size_t cbReadMax)
     return(0);
 }
 
+/***	size_t TcpClient::peekStreamSpans(const byte ** ppSpan1, size_t * pcbSpan1, const byte ** ppSpan2, size_t * pcbSpan2)
+**
+**	Synopsis:   
+**      Returns pointers to the bytes in the socket buffer without copying or removing them
+**
+**	Parameters:
+**      ppSpan1     A pointer to receive the first run of bytes, NULL if none
+**
+**      pcbSpan1    A pointer to receive the number of bytes in the first run
+**
+**      ppSpan2     A pointer to receive the second run of bytes, NULL if the data does not wrap
+**
+**      pcbSpan2    A pointer to receive the number of bytes in the second run
+**
+**	Return Values:
+**      The total number of bytes in both runs. 0 if there are none, or the socket buffer
+**      cannot be read in place; use peekStream()/readStream() then.
+**
+**	Errors:
+**      No bytes to read, or a connection error.
+**
+**  Notes:
+**
+**      The socket buffer is circular, so the available bytes may be split in two: the 
+**      first run ends at the end of the buffer and the second starts at its beginning.
+**      A reader can parse a header in place and copy the payload once to where it is
+**      needed, then remove what it used with consumeStream(). The pointers are only
+**      valid until consumeStream() or any call that runs the stack, including available().
+**
+*/
+size_t TcpClient::peekStreamSpans(const byte ** ppSpan1, size_t * pcbSpan1, const byte ** ppSpan2, size_t * pcbSpan2)
+{
+    byte * pSpan1 = NULL;
+    byte * pSpan2 = NULL;
+    unsigned short cbSpan1 = 0;
+    unsigned short cbSpan2 = 0;
+    size_t cbReady = 0;
+
+    // this will run the stack tasks
+    if(available() > 0)
+    {
+        cbReady = TCPGetRxSpans(_hTCP, &pSpan1, &cbSpan1, &pSpan2, &cbSpan2);
+    }
+
+    *ppSpan1 = pSpan1;
+    *pcbSpan1 = cbSpan1;
+    *ppSpan2 = pSpan2;
+    *pcbSpan2 = cbSpan2;
+
+    return(cbReady);
+}
+
+/***	size_t TcpClient::consumeStream(size_t cbConsume)
+**
+**	Synopsis:   
+**      Removes bytes from the socket buffer without copying them
+**
+**	Parameters:
+**      cbConsume   The number of bytes to remove
+**
+**	Return Values:
+**      The actual number of bytes removed
+**
+**	Errors:
+**      None
+**
+**  Notes:
+**
+**      Used with peekStreamSpans() once the bytes have been used in place.
+**      This does not run the stack tasks, so spans returned before the call
+**      for bytes beyond cbConsume are still valid.
+**
+*/
+size_t TcpClient::consumeStream(size_t cbConsume)
+{
+    if(_hTCP < INVALID_SOCKET)
+    {
+        // the socket buffer is never bigger than an unsigned short
+        cbConsume = cbConsume < 0xFFFF ? cbConsume : 0xFFFF;
+        return(TCPGetArray(_hTCP, NULL, cbConsume));
+    }
+
+    return(0);
+}
+
 /***	void TcpClient::writeStream(uint8_t bData)
 **
 **	Synopsis:   
@@ -713,6 +713,77 @@ long int UdpClient::writeDatagram(const byte *rgbWrite, size_t cbWrite)
     EthernetPeriodicTasks();
 }
 
+/***	int UdpClient::writeDatagram(const DatagramPiece *rgPieces, int cPieces)
+**
+**
+**	Synopsis:   
+**      Gathers the pieces into one datagram and sends it to the instances remote endpoint
+**
+**	Parameters:
+**      rgPieces    An array of pieces, sent in order, that together compose the datagram
+**
+**      cPieces     The number of pieces in rgPieces
+**
+**	Return Values:
+**      The number of bytes actually written. 0 is returned if no bytes were written or an error occured.
+**      If the datagram does not fit in the output buffer, minus the space available is returned.
+**
+**	Errors:
+**
+**  Notes:
+**
+**      Each piece is copied straight into the MAC transmit buffer, so a message
+**      made of a fixed header and a few changing argument bytes can be sent
+**      without first being assembled in a heap or stack buffer. Pieces that
+**      never change (an OSC address and type tags for example) can be built once
+**      and reused for every send; only the pieces holding the arguments need to be updated.
+**
+*/
+long int UdpClient::writeDatagram(const DatagramPiece *rgPieces, int cPieces)
+{
+    int cbMax = 0;
+    int cbWrite = 0;
+    int i = 0;
+
+    for(i = 0; i < cPieces; i++)
+    {
+        cbWrite += rgPieces[i].cb;
+    }
+
+    // isDNETcK::EndPointResolved will call periodic tasks
+    if(isEndPointResolved(DNETcK::msImmediate))
+    {
+        cbMax = (int) ((unsigned int) UDPIsPutReady(_hUDP));
+
+        if(cbMax >= cbWrite)
+        {
+            // UDPIsPutReady made our socket active, so the pieces land in order in one datagram
+            cbMax = 0;
+            for(i = 0; i < cPieces; i++)
+            {
+                if(rgPieces[i].cb > 0)
+                {
+                    cbMax += UDPPutArray(rgPieces[i].pb, rgPieces[i].cb);
+                }
+            }
+            UDPFlush();
+            return(cbMax);
+        }
+
+        // our output buffer is not big enough
+        else
+        {
+            return(-cbMax);
+        }      
+    }
+
+    // endpoint not resolved
+    else
+    {
+        return(0);
+    }
+}
+
 /***	bool UdpClient::getRemoteEndPoint(IPEndPoint *pRemoteEP)
 **
 **	Synopsis:   
@@ -0,0 +1,331 @@
+/******************************************************************************
+ *
+ * FileName:        ARPCacheTest.c
+ * Dependencies:    ARPCache.c, ARP.c, HostStack.c
+ * Processor:       Host (Linux)
+ * Compiler:        gcc
+ *
+ * Checks the ARP cache: least recently used replacement, expiry a fixed
+ * time after an entry was confirmed, the RFC 826 merge rule (through
+ * ARPProcess() as well as ARPCacheUpdate()), addresses that share a hash
+ * bucket, and that a miss is counted once per ARP request however often
+ * ARPIsResolved() is polled.
+ *
+*****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "HostStack.h"
+
+static unsigned long failures;
+
+#define CHECK(cond)     Check ((cond), #cond, __LINE__)
+
+static void Check (int ok, const char * what, int line)
+{
+    if (!ok && failures++ < 20)
+        printf ("FAIL line %d: %s\n", line, what);
+}
+
+static IP_ADDR Ip (BYTE a, BYTE b, BYTE c, BYTE d)
+{
+    IP_ADDR ip;
+
+    ip.v[0] = a; ip.v[1] = b; ip.v[2] = c; ip.v[3] = d;
+    return ip;
+}
+
+static MAC_ADDR Mac (BYTE n)
+{
+    MAC_ADDR mac = { { 0x02, 0x00, 0x00, 0x00, 0x00, n } };
+
+    return mac;
+}
+
+// TRUE if ip is cached with a MAC address ending in n
+static BOOL Cached (IP_ADDR ip, BYTE n, DWORD dwNow)
+{
+    MAC_ADDR mac;
+
+    return ARPCacheLookup (ip, &mac, dwNow) && mac.v[5] == n;
+}
+
+static ARP_CACHE_STATS Stats (void)
+{
+    ARP_CACHE_STATS stats;
+
+    ARPCacheGetStats (&stats);
+    return stats;
+}
+
+static void TestLRU (void)
+{
+    MAC_ADDR mac;
+    BYTE k;
+
+    ARPCacheInit (1000000ul);
+    for (k = 0; k < ARP_CACHE_ENTRIES; k++)
+    {
+        mac = Mac (k + 1);
+        CHECK (ARPCacheUpdate (Ip (10, 0, 0, k + 1), &mac, 100 + k, TRUE));
+    }
+    CHECK (Stats ().learned == ARP_CACHE_ENTRIES && Stats ().evicted == 0);
+
+    // use the oldest, so the second oldest is the one to go
+    CHECK (Cached (Ip (10, 0, 0, 1), 1, 200));
+    mac = Mac (99);
+    CHECK (ARPCacheUpdate (Ip (10, 0, 0, 99), &mac, 201, TRUE));
+    CHECK (!Cached (Ip (10, 0, 0, 2), 2, 202));
+    CHECK (Cached (Ip (10, 0, 0, 1), 1, 203));
+    CHECK (Cached (Ip (10, 0, 0, 99), 99, 204));
+    CHECK (Stats ().evicted == 1);
+
+    // a refresh from the network is not a use
+    mac = Mac (3);
+    CHECK (ARPCacheUpdate (Ip (10, 0, 0, 3), &mac, 300, FALSE));
+    mac = Mac (98);
+    CHECK (ARPCacheUpdate (Ip (10, 0, 0, 98), &mac, 301, TRUE));
+    CHECK (!Cached (Ip (10, 0, 0, 3), 3, 302));
+    CHECK (Stats ().evicted == 2);
+
+    // the Tick wraps between the uses: 0xFFFFFFF0 is older than 0x10
+    ARPCacheInit (1000000ul);
+    for (k = 0; k < ARP_CACHE_ENTRIES; k++)
+    {
+        mac = Mac (k + 1);
+        ARPCacheUpdate (Ip (10, 0, 0, k + 1), &mac, 0xFFFFFF00ul + k, TRUE);
+    }
+    for (k = 1; k < ARP_CACHE_ENTRIES; k++)
+        CHECK (Cached (Ip (10, 0, 0, k + 1), k + 1, 0x10 + k));
+    mac = Mac (97);
+    ARPCacheUpdate (Ip (10, 0, 0, 97), &mac, 0x20, TRUE);
+    CHECK (!Cached (Ip (10, 0, 0, 1), 1, 0x21));
+    for (k = 1; k < ARP_CACHE_ENTRIES; k++)
+        CHECK (Cached (Ip (10, 0, 0, k + 1), k + 1, 0x30));
+}
+
+static void TestAging (void)
+{
+    MAC_ADDR mac = Mac (1);
+
+    ARPCacheInit (100);
+
+    // lookups don't extend the life of an entry
+    ARPCacheUpdate (Ip (10, 0, 0, 1), &mac, 1000, TRUE);
+    CHECK (Cached (Ip (10, 0, 0, 1), 1, 1050));
+    CHECK (Cached (Ip (10, 0, 0, 1), 1, 1099));
+    CHECK (!Cached (Ip (10, 0, 0, 1), 1, 1100));
+
+    // an expired entry is gone, so a refresh alone doesn't bring it back
+    CHECK (!ARPCacheUpdate (Ip (10, 0, 0, 1), &mac, 1101, FALSE));
+    CHECK (!Cached (Ip (10, 0, 0, 1), 1, 1102));
+
+    // a refresh before it expires restarts the time
+    ARPCacheUpdate (Ip (10, 0, 0, 2), &mac, 2000, TRUE);
+    CHECK (ARPCacheUpdate (Ip (10, 0, 0, 2), &mac, 2090, FALSE));
+    CHECK (Cached (Ip (10, 0, 0, 2), 1, 2150));
+    CHECK (Cached (Ip (10, 0, 0, 2), 1, 2189));
+    CHECK (!Cached (Ip (10, 0, 0, 2), 1, 2190));
+
+    // across the Tick wrapping
+    ARPCacheUpdate (Ip (10, 0, 0, 3), &mac, 0xFFFFFFC0ul, TRUE);
+    CHECK (Cached (Ip (10, 0, 0, 3), 1, 0x10));
+    CHECK (Cached (Ip (10, 0, 0, 3), 1, 0x23));
+    CHECK (!Cached (Ip (10, 0, 0, 3), 1, 0x24));
+}
+
+static void TestMerge (void)
+{
+    MAC_ADDR mac = Mac (1);
+
+    ARPCacheInit (1000000ul);
+
+    // traffic that isn't for us only refreshes what is already known
+    CHECK (!ARPCacheUpdate (Ip (10, 0, 0, 1), &mac, 1, FALSE));
+    CHECK (!Cached (Ip (10, 0, 0, 1), 1, 2));
+    CHECK (Stats ().learned == 0);
+
+    CHECK (ARPCacheUpdate (Ip (10, 0, 0, 1), &mac, 3, TRUE));
+    mac = Mac (2);
+    CHECK (ARPCacheUpdate (Ip (10, 0, 0, 1), &mac, 4, FALSE));
+    CHECK (Cached (Ip (10, 0, 0, 1), 2, 5));
+    CHECK (Stats ().learned == 1);
+
+    // 0.0.0.0 (an ARP probe's sender) is never learned
+    CHECK (!ARPCacheUpdate (Ip (0, 0, 0, 0), &mac, 6, TRUE));
+}
+
+// an ARP packet as it comes off the wire
+static void ReceiveARP (WORD operation, IP_ADDR sender, BYTE senderMac, IP_ADDR target)
+{
+    ARP_PACKET packet;
+
+    memset (&packet, 0, sizeof (packet));
+    packet.HardwareType = swaps (HW_ETHERNET);
+    packet.Protocol = swaps (ARP_IP);
+    packet.MACAddrLen = sizeof (MAC_ADDR);
+    packet.ProtocolLen = sizeof (IP_ADDR);
+    packet.Operation = swaps (operation);
+    packet.SenderMACAddr = Mac (senderMac);
+    packet.SenderIPAddr = sender;
+    packet.TargetIPAddr = target;
+
+    HostStackReceive (&packet, sizeof (packet));
+    CHECK (ARPProcess ());
+}
+
+static void SetUpAppConfig (void)
+{
+    memset (&AppConfig, 0, sizeof (AppConfig));
+    AppConfig.MyIPAddr = Ip (192, 168, 1, 10);
+    AppConfig.MyMask = Ip (255, 255, 255, 0);
+    AppConfig.MyGateway = Ip (192, 168, 1, 1);
+    AppConfig.MyMACAddr = Mac (10);
+}
+
+static void TestMergeARPProcess (void)
+{
+    IP_ADDR me;
+    DWORD frames;
+
+    SetUpAppConfig ();
+    me = AppConfig.MyIPAddr;
+    ARPInit ();
+    hostTick = 1000;
+
+    // gratuitous ARP and a request for another host: not added
+    ReceiveARP (ARP_OPERATION_REQ, Ip (192, 168, 1, 20), 20, Ip (192, 168, 1, 20));
+    ReceiveARP (ARP_OPERATION_REQ, Ip (192, 168, 1, 21), 21, Ip (192, 168, 1, 30));
+    CHECK (!Cached (Ip (192, 168, 1, 20), 20, hostTick));
+    CHECK (!Cached (Ip (192, 168, 1, 21), 21, hostTick));
+
+    // a request for us is added, and answered
+    frames = hostTxFrames;
+    ReceiveARP (ARP_OPERATION_REQ, Ip (192, 168, 1, 22), 22, me);
+    CHECK (Cached (Ip (192, 168, 1, 22), 22, hostTick));
+    CHECK (hostTxFrames == frames + 1 && hostTxRemote.v[5] == 22);
+
+    // a reply is added, and a later gratuitous ARP updates it
+    ReceiveARP (ARP_OPERATION_RESP, Ip (192, 168, 1, 23), 23, me);
+    CHECK (Cached (Ip (192, 168, 1, 23), 23, hostTick));
+    ReceiveARP (ARP_OPERATION_REQ, Ip (192, 168, 1, 23), 24, Ip (192, 168, 1, 23));
+    CHECK (Cached (Ip (192, 168, 1, 23), 24, hostTick));
+
+    // a host off our subnet is only learned from a reply
+    ReceiveARP (ARP_OPERATION_REQ, Ip (10, 1, 1, 1), 31, Ip (10, 1, 1, 1));
+    CHECK (!Cached (Ip (10, 1, 1, 1), 31, hostTick));
+    ReceiveARP (ARP_OPERATION_RESP, Ip (10, 1, 1, 2), 32, me);
+    CHECK (Cached (Ip (10, 1, 1, 2), 32, hostTick));
+
+    // nor do we learn our own address back
+    ReceiveARP (ARP_OPERATION_RESP, me, 40, me);
+    CHECK (!Cached (me, 40, hostTick));
+}
+
+static void TestCollisions (void)
+{
+    // the hash is (v[3] ^ v[2]) & (ARP_CACHE_BUCKETS - 1): all of these are 0
+    static const BYTE low[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+    MAC_ADDR mac;
+    BYTE k;
+
+    ARPCacheInit (1000000ul);
+    for (k = 0; k < ARP_CACHE_ENTRIES; k++)
+    {
+        mac = Mac (low[k]);
+        ARPCacheUpdate (Ip (10, 0, low[k], low[k]), &mac, 10 + k, TRUE);
+    }
+    for (k = 0; k < ARP_CACHE_ENTRIES; k++)
+        CHECK (Cached (Ip (10, 0, low[k], low[k]), low[k], 100 + k));
+
+    // an address in the same bucket that isn't there
+    CHECK (!Cached (Ip (10, 0, 0, ARP_CACHE_BUCKETS), ARP_CACHE_BUCKETS, 200));
+
+    // unlink from the middle, the head (last in) and the tail (first in)
+    ARPCacheRemove (Ip (10, 0, low[3], low[3]));
+    ARPCacheRemove (Ip (10, 0, low[ARP_CACHE_ENTRIES - 1], low[ARP_CACHE_ENTRIES - 1]));
+    ARPCacheRemove (Ip (10, 0, low[0], low[0]));
+    for (k = 0; k < ARP_CACHE_ENTRIES; k++)
+        CHECK (Cached (Ip (10, 0, low[k], low[k]), low[k], 300)
+               == (k != 3 && k != 0 && k != ARP_CACHE_ENTRIES - 1));
+
+    // fill the freed slots, then evict from the chain
+    for (k = 0; k < ARP_CACHE_ENTRIES; k++)
+    {
+        mac = Mac (low[k]);
+        ARPCacheUpdate (Ip (10, 0, low[k], low[k]), &mac, 400, TRUE);
+    }
+    for (k = 0; k < ARP_CACHE_ENTRIES; k++)
+        CHECK (Cached (Ip (10, 0, low[k], low[k]), low[k], 500 + (k == 5 ? 0 : 10)));
+    mac = Mac (low[ARP_CACHE_ENTRIES]);
+    ARPCacheUpdate (Ip (10, 0, low[ARP_CACHE_ENTRIES], low[ARP_CACHE_ENTRIES]), &mac, 600, TRUE);
+    for (k = 0; k <= ARP_CACHE_ENTRIES; k++)
+        CHECK (Cached (Ip (10, 0, low[k], low[k]), low[k], 700) == (k != 5));
+}
+
+static void TestMissCount (void)
+{
+    IP_ADDR peer = Ip (192, 168, 1, 50);
+    IP_ADDR offNet = Ip (8, 8, 8, 8);
+    MAC_ADDR mac;
+    DWORD frames;
+    int poll;
+
+    SetUpAppConfig ();
+    ARPInit ();
+    hostTick = 5000;
+
+    // EthernetIsARPIpMacResolved() polls until the reply comes in
+    frames = hostTxFrames;
+    ARPResolve (&peer);
+    CHECK (hostTxFrames == frames + 1);
+    for (poll = 0; poll < 1000; poll++)
+        CHECK (!ARPIsResolved (&peer, &mac));
+    CHECK (Stats ().misses == 1 && Stats ().hits == 0);
+
+    ReceiveARP (ARP_OPERATION_RESP, peer, 50, AppConfig.MyIPAddr);
+    CHECK (ARPIsResolved (&peer, &mac) && mac.v[5] == 50);
+    CHECK (Stats ().misses == 1 && Stats ().hits == 1);
+
+    // asking again for a cached address is no miss
+    ARPResolve (&peer);
+    CHECK (ARPIsResolved (&peer, &mac));
+    CHECK (Stats ().misses == 1 && Stats ().hits == 2);
+
+    // a retransmitted request is another miss
+    ARPResolve (&offNet);
+    ARPResolve (&offNet);
+    for (poll = 0; poll < 100; poll++)
+        CHECK (!ARPIsResolved (&offNet, &mac));
+    CHECK (Stats ().misses == 3);
+
+    // off the subnet it is the gateway that is resolved and cached
+    ReceiveARP (ARP_OPERATION_RESP, AppConfig.MyGateway, 1, AppConfig.MyIPAddr);
+    CHECK (ARPIsResolved (&offNet, &mac) && mac.v[5] == 1);
+    ARPResolve (&offNet);
+    CHECK (Stats ().misses == 3);
+
+    // and it is missed again once it has expired
+    hostTick += ARP_CACHE_TIMEOUT;
+    ARPResolve (&peer);
+    CHECK (!ARPIsResolved (&peer, &mac));
+    CHECK (Stats ().misses == 4);
+}
+
+int main (void)
+{
+    TestLRU ();
+    TestAging ();
+    TestMerge ();
+    TestMergeARPProcess ();
+    TestCollisions ();
+    TestMissCount ();
+
+    if (failures)
+    {
+        printf ("ARPCacheTest: %lu failures\n", failures);
+        return 1;
+    }
+    printf ("ARPCacheTest: ok\n");
+    return 0;
+}
@@ -0,0 +1,230 @@
+/******************************************************************************
+ *
+ * FileName:        ChecksumTest.c
+ * Dependencies:    Helpers.c
+ * Processor:       Host (Linux)
+ * Compiler:        gcc
+ *
+ * Checks CalcIPChecksum() against a plain byte at a time sum (RFC 1071)
+ * over every start alignment and every length up to a couple of frames,
+ * then at the lengths where the 32-bit accumulator carries; and checks
+ * CalcIPChecksumUpdate() against summing the header again.
+ *
+ *   ChecksumTest            run the checks, exit 1 on the first mismatch
+ *   ChecksumTest bench      time both sums over frame sized buffers
+ *
+*****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "TCPIP Stack/TCPIP.h"
+
+#define MAX_LEN     65535u
+#define MAX_OFFSET  8u
+
+// room for the longest buffer at every offset, DWORD aligned
+static DWORD bufferSpace[(MAX_LEN + MAX_OFFSET + 3u) / 4u];
+static BYTE * const buffer = (BYTE *) bufferSpace;
+
+static unsigned long failures;
+
+
+/*****************************************************************************
+  The one's complement sum a byte at a time, the way RFC 1071 writes it.
+  Words are taken in memory order, so the result is in the same byte
+  order as CalcIPChecksum()'s on a little endian machine.
+  ***************************************************************************/
+static WORD ReferenceChecksum (const BYTE * p, DWORD count)
+{
+    DWORD sum = 0;
+    DWORD i;
+
+    for (i = 0; i + 1 < count; i += 2)
+        sum += (DWORD) p[i] | ((DWORD) p[i + 1] << 8);
+    if (count & 1)
+        sum += p[count - 1];
+
+    while (sum >> 16)
+        sum = (sum & 0xFFFFul) + (sum >> 16);
+
+    return (WORD) ~sum;
+}
+
+static void Check (unsigned offset, WORD len, const char * what)
+{
+    WORD got = CalcIPChecksum (buffer + offset, len);
+    WORD want = ReferenceChecksum (buffer + offset, len);
+
+    if (got != want && failures++ < 10)
+        printf ("FAIL %s: offset %u len %u: 0x%04X, want 0x%04X\n",
+                what, offset, len, got, want);
+}
+
+static void FillRandom (DWORD count)
+{
+    DWORD i;
+
+    for (i = 0; i < count; i++)
+        buffer[i] = (BYTE) rand ();
+}
+
+static void TestAlignments (void)
+{
+    unsigned offset;
+    WORD len;
+
+    // every alignment of the pointer against every length that reaches
+    // each path: odd byte, leading WORD, the 16 byte loop, the DWORD tail
+    FillRandom (MAX_LEN + MAX_OFFSET);
+    for (offset = 0; offset < MAX_OFFSET; offset++)
+        for (len = 0; len <= 3100u; len++)
+            Check (offset, len, "random");
+}
+
+static void TestCarries (void)
+{
+    static const WORD lengths[] = { 65535u, 65534u, 65533u, 65532u, 65531u,
+                                    65520u, 40001u, 32768u, 16385u, 1500u };
+    unsigned offset;
+    unsigned i;
+
+    // all ones: every DWORD add carries out of the accumulator, and a long
+    // buffer carries out of 16 bits tens of thousands of times
+    memset (buffer, 0xFF, MAX_LEN + MAX_OFFSET);
+    for (offset = 0; offset < MAX_OFFSET; offset++)
+        for (i = 0; i < sizeof (lengths) / sizeof (lengths[0]); i++)
+            Check (offset, lengths[i], "0xFF");
+
+    // alternating 0xFFFF and 0x0001 words: the sum lands on 0x10000 over
+    // and over, so the end-around carry has to be folded more than once
+    for (i = 0; i < MAX_LEN + MAX_OFFSET; i += 4)
+    {
+        buffer[i] = 0xFF; buffer[i + 1] = 0xFF;
+        buffer[i + 2] = 0x01; buffer[i + 3] = 0x00;
+    }
+    for (offset = 0; offset < MAX_OFFSET; offset++)
+        for (i = 0; i < sizeof (lengths) / sizeof (lengths[0]); i++)
+            Check (offset, lengths[i], "0xFFFF,0x0001");
+
+    // zeros sum to zero, which complements to 0xFFFF
+    memset (buffer, 0x00, MAX_LEN + MAX_OFFSET);
+    for (offset = 0; offset < MAX_OFFSET; offset++)
+        for (i = 0; i < sizeof (lengths) / sizeof (lengths[0]); i++)
+            Check (offset, lengths[i], "zero");
+
+    // random with the long lengths
+    FillRandom (MAX_LEN + MAX_OFFSET);
+    for (offset = 0; offset < MAX_OFFSET; offset++)
+        for (i = 0; i < sizeof (lengths) / sizeof (lengths[0]); i++)
+            Check (offset, lengths[i], "random long");
+}
+
+static void TestUpdate (void)
+{
+    BYTE header[20];
+    WORD_VAL field;
+    WORD checksum;
+    WORD oldVal, newVal;
+    unsigned trial;
+    unsigned at;
+
+    for (trial = 0; trial < 200000u; trial++)
+    {
+        memcpy (header, buffer + (trial % 4096u), sizeof (header));
+        header[10] = header[11] = 0;
+        if (trial < 4)
+            memset (header, trial & 1 ? 0xFF : 0x00, sizeof (header));
+        checksum = CalcIPChecksum (header, sizeof (header));
+        memcpy (&header[10], &checksum, 2);
+
+        // rewrite one word the checksum covers, not the checksum itself
+        at = 2 * (rand () % 9);
+        if (at >= 10)
+            at += 2;
+        memcpy (&oldVal, &header[at], 2);
+        newVal = (WORD) rand ();
+        if (trial & 8)
+            newVal = trial & 16 ? 0x0000 : 0xFFFF;
+        memcpy (&header[at], &newVal, 2);
+
+        checksum = CalcIPChecksumUpdate (checksum, oldVal, newVal);
+        memcpy (&header[10], &checksum, 2);
+
+        // a header with a good checksum in it sums to zero, in either
+        // of one's complement's two forms
+        field.Val = CalcIPChecksum (header, sizeof (header));
+        if (field.Val != 0x0000 && field.Val != 0xFFFF && failures++ < 10)
+            printf ("FAIL update: trial %u word %u 0x%04X -> 0x%04X: header sums to 0x%04X\n",
+                    trial, at, oldVal, newVal, field.Val);
+    }
+}
+
+static double Seconds (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void Bench (void)
+{
+    static const WORD lengths[] = { 20, 64, 576, 1460, 8192 };
+    volatile WORD sink = 0;
+    unsigned offset;
+    unsigned i;
+    DWORD total;
+    DWORD n;
+    double t0, tFast, tRef;
+
+    FillRandom (MAX_LEN + MAX_OFFSET);
+    printf ("%6s %6s %12s %12s %7s\n", "len", "offset", "MB/s", "ref MB/s", "ratio");
+    for (i = 0; i < sizeof (lengths) / sizeof (lengths[0]); i++)
+    {
+        for (offset = 0; offset < 2; offset++)
+        {
+            total = 256u * 1024u * 1024u;
+            n = total / lengths[i];
+
+            t0 = Seconds ();
+            for (total = 0; total < n; total++)
+                sink += CalcIPChecksum (buffer + offset, lengths[i]);
+            tFast = Seconds () - t0;
+
+            t0 = Seconds ();
+            for (total = 0; total < n; total++)
+                sink += ReferenceChecksum (buffer + offset, lengths[i]);
+            tRef = Seconds () - t0;
+
+            printf ("%6u %6u %12.0f %12.0f %6.1fx\n", lengths[i], offset,
+                    (double) n * lengths[i] / tFast / 1e6,
+                    (double) n * lengths[i] / tRef / 1e6, tRef / tFast);
+        }
+    }
+    (void) sink;
+}
+
+int main (int argc, char ** argv)
+{
+    srand (1);
+
+    if (argc > 1 && !strcmp (argv[1], "bench"))
+    {
+        Bench ();
+        return 0;
+    }
+
+    TestAlignments ();
+    TestCarries ();
+    TestUpdate ();
+
+    if (failures)
+    {
+        printf ("ChecksumTest: %lu failures\n", failures);
+        return 1;
+    }
+    printf ("ChecksumTest: ok\n");
+    return 0;
+}
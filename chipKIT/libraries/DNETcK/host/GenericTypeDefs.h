@@ -0,0 +1,117 @@
+/******************************************************************************
+ *
+ * FileName:        GenericTypeDefs.h
+ * Processor:       Host (Linux)
+ * Compiler:        gcc
+ *
+ * The Microchip types the TCP/IP stack uses, for the host build.  On the
+ * PIC32 this header comes with the compiler; the sizes and the layout of
+ * the _VAL unions here match it (both are little endian).
+ *
+*****************************************************************************/
+
+#ifndef __GENERIC_TYPE_DEFS_H_
+#define __GENERIC_TYPE_DEFS_H_
+
+#include <stdint.h>
+
+typedef enum _BOOL { FALSE = 0, TRUE } BOOL;    // Undefined size
+
+typedef uint8_t         BYTE;       // 8-bit unsigned
+typedef uint16_t        WORD;       // 16-bit unsigned
+typedef uint32_t        DWORD;      // 32-bit unsigned
+typedef uint64_t        QWORD;      // 64-bit unsigned
+typedef int8_t          CHAR;       // 8-bit signed
+typedef int16_t         SHORT;      // 16-bit signed
+typedef int32_t         LONG;       // 32-bit signed
+typedef int64_t         LONGLONG;   // 64-bit signed
+typedef void            VOID;
+
+typedef signed int      INT;
+typedef int8_t          INT8;
+typedef int16_t         INT16;
+typedef int32_t         INT32;
+typedef int64_t         INT64;
+typedef unsigned int    UINT;
+typedef uint8_t         UINT8;
+typedef uint16_t        UINT16;
+typedef uint32_t        UINT32;
+typedef uint64_t        UINT64;
+
+typedef union
+{
+    BYTE Val;
+    struct
+    {
+        unsigned char b0:1, b1:1, b2:1, b3:1, b4:1, b5:1, b6:1, b7:1;
+    } bits;
+} BYTE_VAL, BYTE_BITS;
+
+typedef union
+{
+    WORD Val;
+    BYTE v[2];
+    struct
+    {
+        BYTE LB;
+        BYTE HB;
+    } byte;
+    struct
+    {
+        unsigned short b0:1, b1:1, b2:1, b3:1, b4:1, b5:1, b6:1, b7:1,
+                       b8:1, b9:1, b10:1, b11:1, b12:1, b13:1, b14:1, b15:1;
+    } bits;
+} WORD_VAL, WORD_BITS;
+
+typedef union
+{
+    DWORD Val;
+    WORD w[2];
+    BYTE v[4];
+    struct
+    {
+        WORD LW;
+        WORD HW;
+    } word;
+    struct
+    {
+        BYTE LB;
+        BYTE HB;
+        BYTE UB;
+        BYTE MB;
+    } byte;
+    struct
+    {
+        WORD_VAL low;
+        WORD_VAL high;
+    } wordUnion;
+    struct
+    {
+        unsigned int b0:1, b1:1, b2:1, b3:1, b4:1, b5:1, b6:1, b7:1,
+                     b8:1, b9:1, b10:1, b11:1, b12:1, b13:1, b14:1, b15:1,
+                     b16:1, b17:1, b18:1, b19:1, b20:1, b21:1, b22:1, b23:1,
+                     b24:1, b25:1, b26:1, b27:1, b28:1, b29:1, b30:1, b31:1;
+    } bits;
+} DWORD_VAL;
+
+typedef union
+{
+    QWORD Val;
+    DWORD d[2];
+    WORD w[4];
+    BYTE v[8];
+    struct
+    {
+        DWORD LD;
+        DWORD HD;
+    } dword;
+    struct
+    {
+        WORD LW;
+        WORD HW;
+        WORD UW;
+        WORD MW;
+    } word;
+} QWORD_VAL;
+
+#endif
@@ -0,0 +1,188 @@
+/******************************************************************************
+ *
+ * FileName:        HostStack.c
+ * Dependencies:    TCPIP.h
+ * Processor:       Host (Linux)
+ * Compiler:        gcc
+ *
+ * Stand-ins for the Tick timer, AppConfig and the MAC driver, so modules
+ * like ARP.c can be run on their own.  The MAC holds one received frame,
+ * which the test fills with HostStackReceive(), and keeps the last frame
+ * sent.  Ethernet headers are left out on both sides.
+ *
+ * IP, DNS and the MAC's checksum and copy engine are only there so TCP.c
+ * links; the TCP tests put bytes in the socket FIFOs themselves.
+ *
+*****************************************************************************/
+
+#include <string.h>
+#include "HostStack.h"
+
+APP_CONFIG AppConfig;
+
+DWORD hostTick;
+
+BYTE hostRxFrame[HOST_FRAME_SIZE];
+WORD hostRxPos;
+static WORD hostRxLen;
+
+BYTE hostTxFrame[HOST_FRAME_SIZE];
+MAC_ADDR hostTxRemote;
+BYTE hostTxType;
+WORD hostTxLen;
+DWORD hostTxFrames;
+static PTR_BASE hostTxPos;
+
+
+DWORD TickGet (void)
+{
+    return hostTick;
+}
+
+DWORD TickGetDiv256 (void)
+{
+    return hostTick >> 8;
+}
+
+DWORD TickGetDiv64K (void)
+{
+    return hostTick >> 16;
+}
+
+unsigned long millis (void)
+{
+    return hostTick / (TICK_SECOND / 1000);
+}
+
+void HostStackReceive (const void * payload, WORD len)
+{
+    if (len > sizeof (hostRxFrame))
+        len = sizeof (hostRxFrame);
+    memcpy (hostRxFrame, payload, len);
+    hostRxLen = len;
+    hostRxPos = 0;
+}
+
+WORD MACGetArray (BYTE * val, WORD len)
+{
+    if (len > hostRxLen - hostRxPos)
+        len = hostRxLen - hostRxPos;
+    if (val)
+        memcpy (val, hostRxFrame + hostRxPos, len);
+    hostRxPos += len;
+    return len;
+}
+
+void MACDiscardRx (void)
+{
+    hostRxLen = hostRxPos = 0;
+}
+
+BOOL MACIsTxReady (void)
+{
+    return TRUE;
+}
+
+PTR_BASE MACGetTxBaseAddr (void)
+{
+    return 0;
+}
+
+PTR_BASE MACSetWritePtr (PTR_BASE address)
+{
+    PTR_BASE old = hostTxPos;
+
+    hostTxPos = address;
+    return old;
+}
+
+void MACPutHeader (MAC_ADDR * remote, BYTE type, WORD dataLen)
+{
+    hostTxRemote = *remote;
+    hostTxType = type;
+    hostTxLen = 0;
+    hostTxPos = 0;
+}
+
+void MACPutArray (BYTE * val, WORD len)
+{
+    if (hostTxPos + len <= sizeof (hostTxFrame))
+        memcpy (hostTxFrame + hostTxPos, val, len);
+    hostTxPos += len;
+    if (hostTxPos > hostTxLen)
+        hostTxLen = hostTxPos;
+}
+
+void MACFlush (void)
+{
+    hostTxFrames++;
+}
+
+BYTE MACGet (void)
+{
+    BYTE b = 0;
+
+    MACGetArray (&b, 1);
+    return b;
+}
+
+PTR_BASE MACSetReadPtr (PTR_BASE address)
+{
+    PTR_BASE old = hostRxPos;
+
+    hostRxPos = address;
+    return old;
+}
+
+WORD MACGetFreeRxSize (void)
+{
+    return HOST_FRAME_SIZE;
+}
+
+void MACMemCopyAsync (PTR_BASE destAddr, PTR_BASE sourceAddr, WORD len)
+{
+}
+
+BOOL MACIsMemCopyDone (void)
+{
+    return TRUE;
+}
+
+WORD MACCalcRxBufferChecksum (WORD len)
+{
+    return 0;
+}
+
+WORD CalcIPBufferChecksum (WORD len)
+{
+    return 0;
+}
+
+WORD IPPutHeader (NODE_INFO * remote, BYTE protocol, WORD len)
+{
+    MACPutHeader (&remote->MACAddr, MAC_IP, len);
+    return 0;
+}
+
+void IPSetRxBuffer (WORD Offset)
+{
+}
+
+BOOL DNSBeginUsage (void)
+{
+    return TRUE;
+}
+
+void DNSResolve (BYTE * HostName, BYTE Type)
+{
+}
+
+BOOL DNSIsResolved (IP_ADDR * HostIP)
+{
+    return FALSE;
+}
+
+BOOL DNSEndUsage (void)
+{
+    return TRUE;
+}
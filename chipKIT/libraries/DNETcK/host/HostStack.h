@@ -0,0 +1,33 @@
+/******************************************************************************
+ *
+ * FileName:        HostStack.h
+ * Dependencies:    TCPIP.h
+ * Processor:       Host (Linux)
+ * Compiler:        gcc
+ *
+ * What the host tests see of HostStack.c: the Tick count they set by
+ * hand, the frame the stack reads next and the last frame it sent.
+ *
+*****************************************************************************/
+
+#ifndef _HOST_STACK_H
+#define _HOST_STACK_H
+
+#include "TCPIP Stack/TCPIP.h"
+
+#define HOST_FRAME_SIZE     1536
+
+extern DWORD hostTick;                          // what TickGet() returns
+
+extern BYTE hostRxFrame[HOST_FRAME_SIZE];       // payload MACGetArray() reads
+extern WORD hostRxPos;                          // read position in it
+
+extern BYTE hostTxFrame[HOST_FRAME_SIZE];       // payload of the last frame sent
+extern MAC_ADDR hostTxRemote;                   // and where it went
+extern BYTE hostTxType;
+extern WORD hostTxLen;
+extern DWORD hostTxFrames;                      // MACFlush() calls
+
+void HostStackReceive(const void * payload, WORD len);
+
+#endif
@@ -0,0 +1,26 @@
+/******************************************************************************
+ *
+ * FileName:        Print.h
+ * Processor:       Host (Linux)
+ * Compiler:        g++
+ *
+ * The chipKIT core's Print, down to the write() methods TcpClient and
+ * UdpClient implement.
+ *
+*****************************************************************************/
+
+#ifndef Print_h
+#define Print_h
+
+#include "WProgram.h"
+
+class Print
+{
+public:
+    virtual void write(uint8_t) = 0;
+    virtual void write(const char *str) { while(*str) write((uint8_t) *str++); }
+    virtual void write(const uint8_t *buffer, size_t size) { while(size--) write(*buffer++); }
+    virtual ~Print() {}
+};
+
+#endif
@@ -0,0 +1,310 @@
+/******************************************************************************
+ *
+ * FileName:        RxChecksumTest.c
+ * Dependencies:    Helpers.c
+ * Processor:       Host (Linux)
+ * Compiler:        gcc
+ *
+ * Checks MACRxHwChecksumAdjust(), which MACCalcRxBufferChecksum() uses to
+ * get a UDP or TCP checksum from the sum the PIC32 MAC makes as a frame
+ * comes in.  The frames below are whole Ethernet frames as the MAC stores
+ * them, FCS included.  The MAC's sum is played by a plain byte pair sum
+ * over the span it covers, and the result has to be CalcIPChecksum() of
+ * the segment:
+ *
+ *   - for each recorded frame, with the span starting at odd and even
+ *     offsets before the segment, ending at the IP payload, after the
+ *     Ethernet padding and after the FCS, at every buffer alignment;
+ *   - then for every segment start and length inside those frames;
+ *   - for a segment that sums to 0xFFFF, which subtraction leaves as 0;
+ *   - and the check UDPProcess() and TCPProcess() make against the
+ *     pseudo header passes for the frames and fails for a damaged one.
+ *
+*****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "TCPIP Stack/TCPIP.h"
+
+#define ETH_HEADER  14u
+#define ETH_FCS     4u
+
+typedef struct
+{
+    const char * name;
+    const BYTE * frame;
+    WORD len;
+} RECORDED_FRAME;
+
+// a DNS answer, UDP with an odd length
+static const BYTE dnsAnswer[] = {
+    0x00, 0x04, 0x5A, 0x1B, 0x2C, 0x3D, 0x00, 0x22, 0x33, 0x44, 0x55, 0xAA,
+    0x08, 0x00, 0x45, 0x00, 0x00, 0x49, 0x1C, 0x46, 0x40, 0x00, 0x40, 0x11,
+    0x9A, 0xDA, 0xC0, 0xA8, 0x01, 0x01, 0xC0, 0xA8, 0x01, 0x32, 0x00, 0x35,
+    0xC0, 0x00, 0x00, 0x35, 0x37, 0xB9, 0x1A, 0x2B, 0x81, 0x80, 0x00, 0x01,
+    0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x07, 0x65, 0x78, 0x61, 0x6D, 0x70,
+    0x6C, 0x65, 0x03, 0x63, 0x6F, 0x6D, 0x00, 0x00, 0x01, 0x00, 0x01, 0xC0,
+    0x0C, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x01, 0x2C, 0x00, 0x04, 0x5D,
+    0xB8, 0xD8, 0x22, 0xE0, 0xBF, 0xBF, 0x30,
+};
+
+// a SYN-ACK with an MSS option, padded to the 60 byte minimum
+static const BYTE synAck[] = {
+    0x00, 0x04, 0x5A, 0x1B, 0x2C, 0x3D, 0x00, 0x22, 0x33, 0x44, 0x55, 0xAA,
+    0x08, 0x00, 0x45, 0x00, 0x00, 0x2C, 0x00, 0x00, 0x40, 0x00, 0x40, 0x06,
+    0x43, 0x17, 0x5D, 0xB8, 0xD8, 0x22, 0xC0, 0xA8, 0x01, 0x32, 0x00, 0x50,
+    0x04, 0x01, 0x3A, 0x5F, 0x1C, 0x20, 0x00, 0x00, 0x1F, 0x41, 0x60, 0x12,
+    0x16, 0xD0, 0x0F, 0x80, 0x00, 0x00, 0x02, 0x04, 0x05, 0xB4, 0x00, 0x00,
+    0x7F, 0x48, 0x6B, 0x5E,
+};
+
+// HTTP data, TCP with an odd length
+static const BYTE httpData[] = {
+    0x00, 0x04, 0x5A, 0x1B, 0x2C, 0x3D, 0x00, 0x22, 0x33, 0x44, 0x55, 0xAA,
+    0x08, 0x00, 0x45, 0x00, 0x00, 0xA2, 0x5C, 0x21, 0x40, 0x00, 0x40, 0x06,
+    0xE6, 0x7F, 0x5D, 0xB8, 0xD8, 0x22, 0xC0, 0xA8, 0x01, 0x32, 0x00, 0x50,
+    0x04, 0x01, 0x3A, 0x5F, 0x1C, 0x21, 0x00, 0x00, 0x1F, 0x7A, 0x50, 0x18,
+    0x16, 0xD0, 0x4D, 0x6C, 0x00, 0x00, 0x48, 0x54, 0x54, 0x50, 0x2F, 0x31,
+    0x2E, 0x31, 0x20, 0x32, 0x30, 0x30, 0x20, 0x4F, 0x4B, 0x0D, 0x0A, 0x43,
+    0x6F, 0x6E, 0x74, 0x65, 0x6E, 0x74, 0x2D, 0x54, 0x79, 0x70, 0x65, 0x3A,
+    0x20, 0x74, 0x65, 0x78, 0x74, 0x2F, 0x70, 0x6C, 0x61, 0x69, 0x6E, 0x0D,
+    0x0A, 0x43, 0x6F, 0x6E, 0x74, 0x65, 0x6E, 0x74, 0x2D, 0x4C, 0x65, 0x6E,
+    0x67, 0x74, 0x68, 0x3A, 0x20, 0x35, 0x38, 0x0D, 0x0A, 0x0D, 0x0A, 0x6B,
+    0x65, 0x6C, 0x70, 0x3A, 0x20, 0x38, 0x78, 0x38, 0x78, 0x38, 0x2C, 0x20,
+    0x63, 0x6C, 0x69, 0x70, 0x20, 0x43, 0x55, 0x42, 0x45, 0x53, 0x2E, 0x65,
+    0x63, 0x61, 0x20, 0x70, 0x6C, 0x61, 0x79, 0x69, 0x6E, 0x67, 0x2C, 0x20,
+    0x66, 0x72, 0x61, 0x6D, 0x65, 0x20, 0x31, 0x34, 0x30, 0x32, 0x20, 0x6F,
+    0x66, 0x20, 0x32, 0x30, 0x34, 0x38, 0x0D, 0x0A, 0x23, 0x17, 0x70, 0x92,
+};
+
+// an OSC message from kelper.py, UDP padded to the minimum
+static const BYTE oscShort[] = {
+    0x00, 0x04, 0x5A, 0x1B, 0x2C, 0x3D, 0x00, 0x22, 0x33, 0x44, 0x55, 0xAA,
+    0x08, 0x00, 0x45, 0x00, 0x00, 0x28, 0x0B, 0x0E, 0x40, 0x00, 0x40, 0x11,
+    0xAC, 0x20, 0xC0, 0xA8, 0x01, 0x14, 0xC0, 0xA8, 0x01, 0x32, 0xC3, 0xCB,
+    0x27, 0x0F, 0x00, 0x14, 0x59, 0x14, 0x2F, 0x63, 0x6C, 0x69, 0x70, 0x00,
+    0x00, 0x00, 0x2C, 0x73, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x33, 0xF4, 0x47, 0x5F,
+};
+
+// UDP behind an IP header with a router alert option
+static const BYTE oscOption[] = {
+    0x00, 0x04, 0x5A, 0x1B, 0x2C, 0x3D, 0x00, 0x22, 0x33, 0x44, 0x55, 0xAA,
+    0x08, 0x00, 0x46, 0x00, 0x00, 0x38, 0x0B, 0x0F, 0x40, 0x00, 0x40, 0x11,
+    0x17, 0x0B, 0xC0, 0xA8, 0x01, 0x14, 0xC0, 0xA8, 0x01, 0x32, 0x94, 0x04,
+    0x00, 0x00, 0xC3, 0xCB, 0x27, 0x0F, 0x00, 0x20, 0xB9, 0xCF, 0x2F, 0x63,
+    0x6C, 0x69, 0x70, 0x00, 0x00, 0x00, 0x2C, 0x73, 0x00, 0x00, 0x43, 0x55,
+    0x42, 0x45, 0x53, 0x2E, 0x65, 0x63, 0x61, 0x00, 0x00, 0x00, 0x93, 0xE1,
+    0x6E, 0x5D,
+};
+
+static const RECORDED_FRAME recorded[] = {
+    { "dnsAnswer", dnsAnswer, sizeof (dnsAnswer) },
+    { "synAck", synAck, sizeof (synAck) },
+    { "httpData", httpData, sizeof (httpData) },
+    { "oscShort", oscShort, sizeof (oscShort) },
+    { "oscOption", oscOption, sizeof (oscOption) },
+};
+
+#define RECORDED    (sizeof (recorded) / sizeof (recorded[0]))
+
+// room for the largest frame at any alignment
+static DWORD bufferSpace[64];
+static BYTE * const buffer = (BYTE *) bufferSpace;
+
+static unsigned long failures;
+static unsigned long checks;
+
+
+/*****************************************************************************
+  What the MAC hands over: the one's complement sum of [p, p+count), a byte
+  pair at a time from p, not complemented.
+  ***************************************************************************/
+static WORD HardwareSum (const BYTE * p, WORD count)
+{
+    DWORD sum = 0;
+    WORD i;
+
+    for (i = 0; i + 1 < count; i += 2)
+        sum += (DWORD) p[i] | ((DWORD) p[i + 1] << 8);
+    if (count & 1)
+        sum += p[count - 1];
+
+    while (sum >> 16)
+        sum = (sum & 0xFFFFul) + (sum >> 16);
+
+    return (WORD) sum;
+}
+
+static BOOL AllZero (const BYTE * p, WORD count)
+{
+    while (count--)
+        if (*p++)
+            return FALSE;
+    return TRUE;
+}
+
+// the hardware route agrees with summing the segment, for the span given;
+// a span that sums to 0xFFFF may come from the MAC as either form of zero
+static WORD Check (BYTE * pStart, BYTE * pEnd, BYTE * pSeg, WORD len, const char * what)
+{
+    WORD hwSum = HardwareSum (pStart, pEnd - pStart);
+    WORD want = CalcIPChecksum (pSeg, len);
+    WORD got;
+
+    for (;;)
+    {
+        got = MACRxHwChecksumAdjust (hwSum, pStart, pEnd, pSeg, len);
+        checks++;
+        if (got != want && failures++ < 10)
+            printf ("FAIL %s: span %u bytes, segment at %u, %u bytes, sum 0x%04X: 0x%04X, want 0x%04X\n",
+                    what, (unsigned) (pEnd - pStart), (unsigned) (pSeg - pStart), len, hwSum, got, want);
+        if (hwSum != 0xFFFF)
+            return got;
+        hwSum = 0x0000;
+    }
+}
+
+// what UDPProcess() and TCPProcess() compare the segment's checksum with
+static WORD PseudoHeaderSum (const BYTE * ip)
+{
+    BYTE pseudo[12];
+    WORD len = ((WORD) ip[2] << 8 | ip[3]) - (ip[0] & 0x0F) * 4u;
+
+    memcpy (pseudo, ip + 12, 8);
+    pseudo[8] = 0;
+    pseudo[9] = ip[9];
+    pseudo[10] = len >> 8;
+    pseudo[11] = len & 0xFF;
+    return ~CalcIPChecksum (pseudo, sizeof (pseudo));
+}
+
+static void TestRecorded (void)
+{
+    unsigned f;
+    unsigned align;
+    unsigned start;
+    unsigned end;
+    BYTE * frame;
+    BYTE * ip;
+    BYTE * pSeg;
+    WORD len;
+    BYTE * ends[3];
+    WORD got;
+
+    for (f = 0; f < RECORDED; f++)
+    {
+        for (align = 0; align < 4; align++)
+        {
+            frame = buffer + align;
+            memcpy (frame, recorded[f].frame, recorded[f].len);
+            ip = frame + ETH_HEADER;
+            pSeg = ip + (ip[0] & 0x0F) * 4u;
+            len = ((WORD) ip[2] << 8 | ip[3]) - (pSeg - ip);
+
+            // the end of the IP datagram, the end of the Ethernet padding
+            // (where the driver stops), and the end of the FCS
+            ends[0] = pSeg + len;
+            ends[1] = frame + recorded[f].len - ETH_FCS;
+            ends[2] = frame + recorded[f].len;
+
+            // the MAC's sum starting anywhere from the type field to the
+            // segment itself, so the segment sits at odd and even offsets
+            for (start = ETH_HEADER - 2; start <= (unsigned) (pSeg - frame); start++)
+            {
+                for (end = 0; end < 3; end++)
+                {
+                    got = Check (frame + start, ends[end], pSeg, len, recorded[f].name);
+                    if (got != PseudoHeaderSum (ip) && failures++ < 10)
+                        printf ("FAIL %s: 0x%04X doesn't match the pseudo header's 0x%04X\n",
+                                recorded[f].name, got, PseudoHeaderSum (ip));
+                }
+            }
+        }
+    }
+}
+
+static void TestEverySegment (void)
+{
+    unsigned f;
+    BYTE * pStart;
+    BYTE * pEnd;
+    BYTE * pSeg;
+    WORD len;
+
+    // every start and length, odd and even, inside the driver's span
+    for (f = 0; f < RECORDED; f++)
+    {
+        memcpy (buffer + 1, recorded[f].frame, recorded[f].len);
+        pStart = buffer + 1 + ETH_HEADER;
+        pEnd = buffer + 1 + recorded[f].len - ETH_FCS;
+        for (pSeg = pStart; pSeg < pEnd; pSeg++)
+            for (len = 1; pSeg + len <= pEnd; len++)
+                if (!AllZero (pSeg, len))
+                    Check (pStart, pEnd, pSeg, len, recorded[f].name);
+    }
+}
+
+static void TestNegativeZero (void)
+{
+    // 0x3412 + 0xCBED is 0xFFFF, so the segment's checksum is 0x0000; with
+    // nothing else in the span and the MAC giving its sum as 0x0000, the
+    // result has to be folded back from +0
+    static const BYTE span[] = { 0x45, 0x00, 0x01, 0x02, 0x12, 0x34, 0xED, 0xCB, 0x00, 0x00, 0x07 };
+    unsigned align;
+    unsigned head;
+    unsigned tail;
+    BYTE * pStart;
+
+    for (align = 0; align < 4; align++)
+    {
+        for (head = 0; head <= 4; head++)
+        {
+            for (tail = 0; tail <= sizeof (span) - 8; tail++)
+            {
+                pStart = buffer + align;
+                memcpy (pStart, span + 4 - head, head + 4 + tail);
+                Check (pStart, pStart + head + 4 + tail, pStart + head, 4, "negative zero");
+            }
+        }
+    }
+    if (CalcIPChecksum ((BYTE *) span + 4, 4) != 0x0000 && failures++ < 10)
+        printf ("FAIL negative zero: the segment doesn't sum to 0xFFFF\n");
+}
+
+static void TestCorrupted (void)
+{
+    const RECORDED_FRAME * r = &recorded[2];
+    BYTE * ip;
+    BYTE * pSeg;
+    WORD len;
+    WORD got;
+
+    // one payload bit flipped on the wire: the MAC sums what arrived, and
+    // the result no longer matches the pseudo header
+    memcpy (buffer, r->frame, r->len);
+    ip = buffer + ETH_HEADER;
+    pSeg = ip + (ip[0] & 0x0F) * 4u;
+    len = ((WORD) ip[2] << 8 | ip[3]) - (pSeg - ip);
+    pSeg[len - 7] ^= 0x04;
+
+    got = Check (ip, buffer + r->len - ETH_FCS, pSeg, len, "corrupted");
+    if (got == PseudoHeaderSum (ip) && failures++ < 10)
+        printf ("FAIL corrupted: 0x%04X passes the pseudo header check\n", got);
+}
+
+int main (void)
+{
+    TestRecorded ();
+    TestEverySegment ();
+    TestNegativeZero ();
+    TestCorrupted ();
+
+    if (failures)
+    {
+        printf ("RxChecksumTest: %lu failures\n", failures);
+        return 1;
+    }
+    printf ("RxChecksumTest: ok, %lu spans\n", checks);
+    return 0;
+}
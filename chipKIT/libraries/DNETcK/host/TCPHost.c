@@ -0,0 +1,55 @@
+/******************************************************************************
+ *
+ * FileName:        TCPHost.c
+ * Dependencies:    TCP.c
+ * Processor:       Host (Linux)
+ * Compiler:        gcc
+ *
+ * TCP.c itself, plus a back door for the tests: a socket can be put in
+ * the established state and bytes dropped into its RX FIFO as TCPProcess()
+ * would, at any position in the FIFO, without a connection to set it up.
+ *
+*****************************************************************************/
+
+#include "../utility/TCP.c"
+#include "TCPHost.h"
+
+TCP_SOCKET TCPHostOpen(void)
+{
+    TCP_SOCKET hTCP = 0;
+
+    TCPInit();
+    SyncTCBStub(hTCP);
+    MyTCBStub.smState = TCP_ESTABLISHED;
+    return hTCP;
+}
+
+WORD TCPHostRxFIFOSize(TCP_SOCKET hTCP)
+{
+    SyncTCBStub(hTCP);
+    return MyTCBStub.bufferEnd - MyTCBStub.bufferRxStart + 1;
+}
+
+void TCPHostEmptyRxFIFOAt(TCP_SOCKET hTCP, WORD wOffset)
+{
+    SyncTCBStub(hTCP);
+    MyTCBStub.rxHead = MyTCBStub.bufferRxStart + wOffset;
+    MyTCBStub.rxTail = MyTCBStub.rxHead;
+}
+
+WORD TCPHostReceive(TCP_SOCKET hTCP, const BYTE* data, WORD len)
+{
+    WORD i;
+
+    if(len > TCPGetRxFIFOFree(hTCP))
+        len = TCPGetRxFIFOFree(hTCP);
+
+    SyncTCBStub(hTCP);
+    for(i = 0; i < len; i++)
+    {
+        *(BYTE*)MyTCBStub.rxHead = data[i];
+        if(++MyTCBStub.rxHead > MyTCBStub.bufferEnd)
+            MyTCBStub.rxHead = MyTCBStub.bufferRxStart;
+    }
+    return len;
+}
@@ -0,0 +1,36 @@
+/******************************************************************************
+ *
+ * FileName:        TCPHost.h
+ * Dependencies:    TCPIP.h
+ * Processor:       Host (Linux)
+ * Compiler:        gcc
+ *
+ * The test back door into TCP.c, see TCPHost.c.  Plain C types, so it
+ * can be included next to DNETcKAPI.h as well as TCPIP.h.
+ *
+*****************************************************************************/
+
+#ifndef _TCP_HOST_H
+#define _TCP_HOST_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// TCPInit() and mark socket 0 as connected
+unsigned char TCPHostOpen(void);
+
+// bytes in the RX FIFO, one more than it can hold
+unsigned short TCPHostRxFIFOSize(unsigned char hTCP);
+
+// empty the RX FIFO with both pointers wOffset bytes into it
+void TCPHostEmptyRxFIFOAt(unsigned char hTCP, unsigned short wOffset);
+
+// add bytes at the head of the RX FIFO, as if they had arrived
+unsigned short TCPHostReceive(unsigned char hTCP, const unsigned char* data, unsigned short len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
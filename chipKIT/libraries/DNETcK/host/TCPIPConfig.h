@@ -0,0 +1,23 @@
+/******************************************************************************
+ *
+ * FileName:        TCPIPConfig.h
+ * Dependencies:    ../utility/TCPIPConfig.h
+ * Processor:       Host (Linux)
+ * Compiler:        gcc
+ *
+ * The library's configuration, with more TCP socket RAM.  PTR_BASE is 8
+ * bytes on a 64-bit host, so a TCB is 56 bytes instead of 44, and the ten
+ * sockets that exactly fill TCP_PIC_RAM_SIZE on the PIC32 would not fit
+ * (TCPInit() would hang on its allocation check).
+ *
+*****************************************************************************/
+
+#ifndef __HOST_TCPIPCONFIG_H
+#define __HOST_TCPIPCONFIG_H
+
+#include "../utility/TCPIPConfig.h"
+
+#undef TCP_PIC_RAM_SIZE
+#define TCP_PIC_RAM_SIZE        (20480ul + 10ul*16ul)
+
+#endif
@@ -0,0 +1,226 @@
+/******************************************************************************
+ *
+ * FileName:        TCPSpansTest.cpp
+ * Dependencies:    TCPHost.c (TCP.c), TcpClient.cpp, HostStack.c
+ * Processor:       Host (Linux)
+ * Compiler:        g++
+ *
+ * Checks TCPGetRxSpans() with the data at every position in the RX FIFO,
+ * wrapped and not, then again after removing part of it and after removing
+ * past the wrap; and TcpClient::peekStreamSpans() and consumeStream() on
+ * top of it.  The spans are compared with the bytes that went in.
+ *
+*****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "DNETcK.h"
+#include "DNETcKAPI.h"
+#include "TCPHost.h"
+
+static unsigned long failures;
+
+#define CHECK(cond)     Check ((cond), #cond, __LINE__)
+
+static void Check (bool ok, const char * what, int line)
+{
+    if (!ok && failures++ < 20)
+        printf ("FAIL line %d: %s\n", line, what);
+}
+
+// the socket TcpClient::connect() is handed
+static byte hSocket = INVALID_SOCKET;
+
+// what the rest of DNETcK would do for TcpClient
+unsigned long DNETcK::_msDefaultTimeout = 0;
+
+bool DNETcK::getMyIP (IPv4 * pIP)
+{
+    memset (pIP, 0, sizeof (*pIP));
+    return true;
+}
+
+extern "C" {
+
+void EthernetPeriodicTasks (void)
+{
+}
+
+byte TcpClientConnectByName (const char * szHostName, unsigned short port)
+{
+    return hSocket;
+}
+
+byte TcpClientConnectByEndPoint (const byte * pIP, unsigned short port)
+{
+    return hSocket;
+}
+
+}
+
+static byte pattern[4096];
+
+// the spans hold pattern[first..first+len), with the FIFO of fifoSize
+// bytes wrapping after the first span
+static void CheckSpans (const byte * pSpan1, size_t cbSpan1, const byte * pSpan2, size_t cbSpan2,
+                        size_t total, size_t first, size_t len, size_t fifoSize, int line)
+{
+    bool ok = total == len && cbSpan1 + cbSpan2 == len;
+
+    if (len == 0)
+        ok = ok && pSpan1 == NULL && pSpan2 == NULL;
+    else if (pSpan2 == NULL)
+        ok = ok && pSpan1 != NULL && cbSpan2 == 0 && !memcmp (pSpan1, pattern + first, len);
+    else
+        ok = ok && pSpan1 != NULL && cbSpan1 > 0 && cbSpan2 > 0
+                && pSpan2 == pSpan1 + cbSpan1 - fifoSize
+                && !memcmp (pSpan1, pattern + first, cbSpan1)
+                && !memcmp (pSpan2, pattern + first + cbSpan1, cbSpan2);
+
+    if (!ok && failures++ < 20)
+        printf ("FAIL line %d: %zu bytes from %zu: spans %zu + %zu, total %zu\n",
+                line, len, first, cbSpan1, cbSpan2, total);
+}
+
+static size_t GetSpans (byte hTCP, size_t first, size_t len, size_t fifoSize, int line,
+                        byte ** ppSpan1, unsigned short * pcbSpan1)
+{
+    byte * pSpan2;
+    unsigned short cbSpan2;
+    size_t total;
+
+    total = TCPGetRxSpans (hTCP, ppSpan1, pcbSpan1, &pSpan2, &cbSpan2);
+    CheckSpans (*ppSpan1, *pcbSpan1, pSpan2, cbSpan2, total, first, len, fifoSize, line);
+    return total;
+}
+
+static void TestRxSpans (void)
+{
+    byte hTCP = TCPHostOpen ();
+    size_t fifoSize = TCPHostRxFIFOSize (hTCP);
+    size_t lengths[] = { 0, 1, 2, 3, 10, fifoSize / 2, fifoSize - 2, fifoSize - 1 };
+    byte * pSpan1;
+    unsigned short cbSpan1;
+    size_t offset;
+    size_t len;
+    size_t cut;
+    unsigned i;
+    byte copy[4096];
+
+    CHECK (fifoSize > 10 && fifoSize < sizeof (pattern));
+
+    for (offset = 0; offset < fifoSize; offset++)
+    {
+        for (i = 0; i < sizeof (lengths) / sizeof (lengths[0]); i++)
+        {
+            len = lengths[i];
+            TCPHostEmptyRxFIFOAt (hTCP, offset);
+            CHECK (TCPHostReceive (hTCP, pattern, len) == len);
+
+            // all of it: two spans once it runs past the end of the FIFO
+            GetSpans (hTCP, 0, len, fifoSize, __LINE__, &pSpan1, &cbSpan1);
+            CHECK (len == 0 || cbSpan1 == (len < fifoSize - offset ? len : fifoSize - offset));
+
+            // remove a third of it
+            cut = len / 3;
+            CHECK (TCPGetArray (hTCP, NULL, cut) == cut);
+            GetSpans (hTCP, cut, len - cut, fifoSize, __LINE__, &pSpan1, &cbSpan1);
+
+            // remove up to one byte past the wrap, if there is one
+            if (cbSpan1 < len - cut)
+            {
+                CHECK (TCPGetArray (hTCP, NULL, cbSpan1 + 1) == cbSpan1 + 1u);
+                cut += cbSpan1 + 1;
+                GetSpans (hTCP, cut, len - cut, fifoSize, __LINE__, &pSpan1, &cbSpan1);
+            }
+
+            // and the rest still reads back through the copying path
+            CHECK (TCPGetArray (hTCP, copy, sizeof (copy)) == len - cut);
+            CHECK (!memcmp (copy, pattern + cut, len - cut));
+            GetSpans (hTCP, 0, 0, fifoSize, __LINE__, &pSpan1, &cbSpan1);
+        }
+    }
+}
+
+static size_t PeekSpans (TcpClient & client, size_t first, size_t len, size_t fifoSize, int line,
+                         size_t * pcbSpan1)
+{
+    const byte * pSpan1;
+    const byte * pSpan2;
+    size_t cbSpan2;
+    size_t total;
+
+    total = client.peekStreamSpans (&pSpan1, pcbSpan1, &pSpan2, &cbSpan2);
+    CheckSpans (pSpan1, *pcbSpan1, pSpan2, cbSpan2, total, first, len, fifoSize, line);
+    return total;
+}
+
+static void TestTcpClient (void)
+{
+    IPv4 ip = { { 192, 168, 1, 2 } };
+    size_t fifoSize;
+    size_t cbSpan1;
+    byte b[64];
+
+    // not connected: nothing, not even the FIFO of whatever socket is 0
+    {
+        TcpClient client;
+
+        hSocket = INVALID_SOCKET;
+        CHECK (!client.connect (ip, 80));
+        PeekSpans (client, 0, 0, 1, __LINE__, &cbSpan1);
+        CHECK (client.consumeStream (10) == 0);
+    }
+
+    TcpClient client;
+
+    hSocket = TCPHostOpen ();
+    fifoSize = TCPHostRxFIFOSize (hSocket);
+    CHECK (client.connect (ip, 80));
+
+    // 30 bytes, 10 before the end of the FIFO and 20 after
+    TCPHostEmptyRxFIFOAt (hSocket, fifoSize - 10);
+    TCPHostReceive (hSocket, pattern, 30);
+    CHECK (client.available () == 30);
+    PeekSpans (client, 0, 30, fifoSize, __LINE__, &cbSpan1);
+    CHECK (cbSpan1 == 10);
+
+    // a partial consume leaves the rest in place
+    CHECK (client.consumeStream (4) == 4);
+    PeekSpans (client, 4, 26, fifoSize, __LINE__, &cbSpan1);
+    CHECK (cbSpan1 == 6);
+
+    // consuming across the wrap leaves one span
+    CHECK (client.consumeStream (8) == 8);
+    PeekSpans (client, 12, 18, fifoSize, __LINE__, &cbSpan1);
+    CHECK (cbSpan1 == 18);
+    CHECK (client.peekStream (b, sizeof (b)) == 18 && !memcmp (b, pattern + 12, 18));
+
+    // more arrives behind it, still one span
+    TCPHostReceive (hSocket, pattern + 30, 20);
+    PeekSpans (client, 12, 38, fifoSize, __LINE__, &cbSpan1);
+
+    // consuming more than there is removes what there is
+    CHECK (client.consumeStream (1000) == 38);
+    PeekSpans (client, 0, 0, fifoSize, __LINE__, &cbSpan1);
+    CHECK (client.available () == 0);
+}
+
+int main (void)
+{
+    size_t i;
+
+    for (i = 0; i < sizeof (pattern); i++)
+        pattern[i] = (byte) (i * 7 + i / 251);
+
+    TestRxSpans ();
+    TestTcpClient ();
+
+    if (failures)
+    {
+        printf ("TCPSpansTest: %lu failures\n", failures);
+        return 1;
+    }
+    printf ("TCPSpansTest: ok\n");
+    return 0;
+}
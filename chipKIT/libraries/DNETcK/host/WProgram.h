@@ -0,0 +1,23 @@
+/******************************************************************************
+ *
+ * FileName:        WProgram.h
+ * Processor:       Host (Linux)
+ * Compiler:        g++
+ *
+ * The little of the chipKIT core the DNETcK classes use, for the host
+ * build.  millis() is in HostStack.c.
+ *
+*****************************************************************************/
+
+#ifndef WProgram_h
+#define WProgram_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+typedef uint8_t byte;
+
+extern "C" unsigned long millis(void);
+
+#endif
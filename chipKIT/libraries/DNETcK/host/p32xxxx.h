@@ -0,0 +1,45 @@
+/******************************************************************************
+ *
+ * FileName:        p32xxxx.h
+ * Processor:       Host (Linux)
+ * Compiler:        gcc
+ *
+ * Stand-ins for the few PIC32 registers the stack touches outside the MAC
+ * driver (the watchdog, and the ADC and Timer1 that GenerateRandomDWORD()
+ * samples).  They are plain variables here, except that Timer1 moves on
+ * each time it is touched, or GenerateRandomDWORD() would wait forever for
+ * its second of entropy.
+ *
+*****************************************************************************/
+
+#ifndef _P32XXXX_H
+#define _P32XXXX_H
+
+#include <stdint.h>
+
+#define HOST_SFR(name)  static volatile unsigned int name __attribute__((unused))
+
+HOST_SFR(AD1CON1);
+HOST_SFR(AD1CON2);
+HOST_SFR(AD1CON3);
+HOST_SFR(T1CON);
+HOST_SFR(PR1);
+HOST_SFR(IFS1CLR);
+HOST_SFR(WDTCONSET);
+
+// the conversion is always done, so GenerateRandomDWORD() doesn't wait
+static volatile struct { unsigned int AD1IF:1; } IFS1bits __attribute__((unused)) = { 1 };
+
+static inline volatile unsigned int * HostTMR1(void)
+{
+    static volatile unsigned int tmr1;
+
+    tmr1 += 0xF000;
+    return &tmr1;
+}
+#define TMR1    (*HostTMR1())
+
+#define _IFS1_AD1IF_MASK        0x00000002
+#define _WDTCON_WDTCLR_MASK     0x00000001
+
+#endif
@@ -0,0 +1,17 @@
+/******************************************************************************
+ *
+ * FileName:        plib.h
+ * Processor:       Host (Linux)
+ * Compiler:        gcc
+ *
+ * Nothing the host build needs from the peripheral library; this only
+ * satisfies Compiler.h.
+ *
+*****************************************************************************/
+
+#ifndef _PLIB_H
+#define _PLIB_H
+
+#include "p32xxxx.h"
+
+#endif
@@ -75,9 +75,6 @@
 #define ARP_IP                  (0x0800u)	// ARP IP packet type as defined by IEEE 802.3
 #endif
 
-#ifdef STACK_CLIENT_MODE
-static NODE_INFO Cache;						// Cache for one ARP response
-#endif
 
 #ifdef STACK_USE_ZEROCONF_LINK_LOCAL
 #define MAX_REG_APPS            2           // MAX num allowed registrations of Modules/Apps
@@ -354,7 +351,7 @@ static BOOL ARPPut(ARP_PACKET* packet)
 	
   Description:
   	Initializes the ARP module.  Call this function once at boot to 
-  	invalidate the cached lookup.
+  	invalidate the cached lookups.
 
   Precondition:
 	None
@@ -372,14 +369,7 @@ static BOOL ARPPut(ARP_PACKET* packet)
 #ifdef STACK_CLIENT_MODE
 void ARPInit(void)
 {
-    Cache.MACAddr.v[0] = 0xff;
-    Cache.MACAddr.v[1] = 0xff;
-    Cache.MACAddr.v[2] = 0xff;
-    Cache.MACAddr.v[3] = 0xff;
-    Cache.MACAddr.v[4] = 0xff;
-    Cache.MACAddr.v[5] = 0xff;
-
-	Cache.IPAddr.Val = 0x0;
+	ARPCacheInit(ARP_CACHE_TIMEOUT);
 }
 #endif
 
@@ -443,6 +433,18 @@ BOOL ARPProcess(void)
 
 			// Handle incoming ARP responses
 #ifdef STACK_CLIENT_MODE
+			// Learn the sender.  Replies and requests for us add it to the 
+			// cache, anything else from our subnet (gratuitous ARPs, requests 
+			// for other hosts) only refreshes an entry we already have.
+			if(packet.SenderIPAddr.Val != AppConfig.MyIPAddr.Val)
+			{
+				BOOL bCreate = (packet.Operation == ARP_OPERATION_RESP) ||
+							   (packet.Operation == ARP_OPERATION_REQ && packet.TargetIPAddr.Val == AppConfig.MyIPAddr.Val);
+
+				if(bCreate || ((packet.SenderIPAddr.Val ^ AppConfig.MyIPAddr.Val) & AppConfig.MyMask.Val) == 0u)
+					ARPCacheUpdate(packet.SenderIPAddr, &packet.SenderMACAddr, TickGet(), bCreate);
+			}
+
 			if(packet.Operation == ARP_OPERATION_RESP)
 			{
                 #if defined(STACK_USE_AUTO_IP)
@@ -450,8 +452,6 @@ BOOL ARPProcess(void)
                     if (AutoIPConfigIsInProgress(i))
                         AutoIPConflict(i);
                 #endif
-				Cache.MACAddr = packet.SenderMACAddr;
-				Cache.IPAddr = packet.SenderIPAddr;
 				return TRUE;
 			}
 #endif
@@ -565,15 +565,16 @@ void ARPResolve(IP_ADDR* IPAddr)
     {
 		// "Resolve" the IP to MAC address mapping for
 		// IP multicast address range from 224.0.0.0 to 239.255.255.255
+		MAC_ADDR MulticastMAC;
 
-		Cache.MACAddr.v[0] = 0x01;
-		Cache.MACAddr.v[1] = 0x00;
-		Cache.MACAddr.v[2] = 0x5E;
-		Cache.MACAddr.v[3] = 0x7f & IPAddr->v[1];
-		Cache.MACAddr.v[4] = IPAddr->v[2];
-		Cache.MACAddr.v[5] = IPAddr->v[3];
+		MulticastMAC.v[0] = 0x01;
+		MulticastMAC.v[1] = 0x00;
+		MulticastMAC.v[2] = 0x5E;
+		MulticastMAC.v[3] = 0x7f & IPAddr->v[1];
+		MulticastMAC.v[4] = IPAddr->v[2];
+		MulticastMAC.v[5] = IPAddr->v[3];
 
-		Cache.IPAddr.Val = IPAddr->Val;
+		ARPCacheUpdate(*IPAddr, &MulticastMAC, TickGet(), TRUE);
 
 		return;
 	}
@@ -595,6 +596,9 @@ void ARPResolve(IP_ADDR* IPAddr)
 	packet.SenderIPAddr			= AppConfig.MyIPAddr;
 #endif
 
+	// Count the miss once here rather than in every ARPIsResolved() poll
+	ARPCacheRequest(packet.TargetIPAddr, TickGet());
+
     ARPPut(&packet);
 }
 #endif
@@ -639,13 +643,50 @@ void ARPResolve(IP_ADDR* IPAddr)
 #ifdef STACK_CLIENT_MODE
 BOOL ARPIsResolved(IP_ADDR* IPAddr, MAC_ADDR* MACAddr)
 {
-    if((Cache.IPAddr.Val == IPAddr->Val) || 
-	  ((Cache.IPAddr.Val == AppConfig.MyGateway.Val) && ((AppConfig.MyIPAddr.Val ^ IPAddr->Val) & AppConfig.MyMask.Val)))
-    {
-        *MACAddr = Cache.MACAddr;
-        return TRUE;
-    }
-    return FALSE;
+	// Off our subnet everything goes through the gateway, see ARPResolve()
+    if((AppConfig.MyIPAddr.Val ^ IPAddr->Val) & AppConfig.MyMask.Val)
+		return ARPCacheLookup(AppConfig.MyGateway, MACAddr, TickGet());
+
+	return ARPCacheLookup(*IPAddr, MACAddr, TickGet());
+}
+#endif
+
+/*****************************************************************************
+  Function:
+	void ARPLearn(NODE_INFO* remote, IP_ADDR* localIP)
+
+  Summary:
+	Learns the MAC address of the sender of an IP packet.
+
+  Description:
+  	Refreshes the ARP cache entry of the sender of a received IP packet, 
+  	and adds one if the packet was sent to us, so that replying to a 
+  	new peer does not have to wait for an ARP exchange.
+
+  Precondition:
+	IPGetHeader() returned TRUE for the packet.
+
+  Parameters:
+	remote - Sender of the packet
+	localIP - Destination address of the packet
+
+  Returns:
+  	None
+
+  Remarks:
+  	Senders off our subnet are ignored; their packets carry the MAC 
+  	address of whichever router forwarded them.
+  ***************************************************************************/
+#ifdef STACK_CLIENT_MODE
+void ARPLearn(NODE_INFO* remote, IP_ADDR* localIP)
+{
+	if(AppConfig.MyIPAddr.Val == 0x00000000ul)
+		return;
+
+	if((remote->IPAddr.Val ^ AppConfig.MyIPAddr.Val) & AppConfig.MyMask.Val)
+		return;
+
+	ARPCacheUpdate(remote->IPAddr, &remote->MACAddr, TickGet(), localIP->Val == AppConfig.MyIPAddr.Val);
 }
 #endif
 
@@ -0,0 +1,361 @@
+/*********************************************************************
+ *
+ *  ARP Cache Table
+ *  Module for Microchip TCP/IP Stack
+ *   -Keeps the most recently used IP to MAC address mappings
+ *	 -Reference: RFC 826, RFC 1122 section 2.3.2
+ *
+ *********************************************************************
+ * FileName:        ARPCache.c
+ * Dependencies:    None (the caller supplies the time)
+ * Processor:       PIC32
+ * Compiler:        Microchip C32 v1.05 or higher
+ *
+ * ARP_CACHE_ENTRIES mappings are kept.  Lookups go through a small
+ * hash table indexed by the low address bits, so the cost of a lookup
+ * does not grow with the table.  When the table is full the least
+ * recently used entry is replaced; that scan only happens when a new
+ * mapping is learned.
+ *
+ * An entry expires dwTimeout Ticks after it was last confirmed from
+ * the network, no matter how often it is used, so a peer that changes
+ * its MAC address (a replaced board, a DHCP lease moving) is found
+ * again with a new ARP request.
+ *
+ * Nothing in here touches the MAC, AppConfig or the Tick timer, so
+ * the table can be exercised on its own.
+ ********************************************************************/
+#define __ARPCACHE_C
+
+#include "TCPIP Stack/TCPIP.h"
+
+#if defined(STACK_CLIENT_MODE)
+
+typedef struct
+{
+	IP_ADDR		IPAddr;			// 0 when the slot is unused
+	MAC_ADDR	MACAddr;
+	BYTE		vNext;			// next slot in the same hash bucket
+	DWORD		dwUpdated;		// Tick the mapping was last confirmed
+	DWORD		dwUsed;			// Tick the mapping was last looked up
+} ARP_CACHE_ENTRY;
+
+static ARP_CACHE_ENTRY ARPCache[ARP_CACHE_ENTRIES];
+static BYTE ARPCacheBucket[ARP_CACHE_BUCKETS];
+static ARP_CACHE_STATS ARPCacheStats;
+static DWORD ARPCacheTimeout;
+
+#define ARPCacheHash(a)		(((a).v[3] ^ (a).v[2]) & (ARP_CACHE_BUCKETS - 1u))
+
+static BYTE ARPCacheFind(IP_ADDR IPAddr);
+static void ARPCacheUnlink(BYTE i);
+
+/*****************************************************************************
+  Function:
+	void ARPCacheInit(DWORD dwTimeout)
+
+  Summary:
+	Empties the ARP cache.
+
+  Description:
+	Invalidates all entries and clears the statistics.
+
+  Precondition:
+	None
+
+  Parameters:
+	dwTimeout - Ticks an entry stays valid after it was last confirmed
+
+  Returns:
+  	None
+  ***************************************************************************/
+void ARPCacheInit(DWORD dwTimeout)
+{
+	BYTE i;
+
+	for(i = 0; i < ARP_CACHE_ENTRIES; i++)
+	{
+		ARPCache[i].IPAddr.Val = 0;
+		ARPCache[i].vNext = ARP_CACHE_INVALID;
+	}
+
+	for(i = 0; i < ARP_CACHE_BUCKETS; i++)
+		ARPCacheBucket[i] = ARP_CACHE_INVALID;
+
+	memset((void*)&ARPCacheStats, 0x00, sizeof(ARPCacheStats));
+	ARPCacheTimeout = dwTimeout;
+}
+
+/*****************************************************************************
+  Function:
+	BOOL ARPCacheLookup(IP_ADDR IPAddr, MAC_ADDR* MACAddr, DWORD dwNow)
+
+  Summary:
+	Looks up the MAC address for an IP address.
+
+  Description:
+	Returns the cached MAC address of IPAddr and marks the entry as 
+	the most recently used.  An expired entry is removed and reported 
+	as a miss.
+
+  Precondition:
+	ARPCacheInit() is already called.
+
+  Parameters:
+	IPAddr - IP address to look up, in network byte order
+	MACAddr - Buffer to receive the MAC address
+	dwNow - The current Tick
+
+  Return Values:
+  	TRUE - The address was found, MACAddr is filled in
+  	FALSE - The address is not in the table
+
+  Remarks:
+	A failed lookup is not counted as a miss here; callers poll this 
+	until the ARP reply comes in.  See ARPCacheRequest().
+  ***************************************************************************/
+BOOL ARPCacheLookup(IP_ADDR IPAddr, MAC_ADDR* MACAddr, DWORD dwNow)
+{
+	BYTE i;
+
+	i = ARPCacheFind(IPAddr);
+	if(i != ARP_CACHE_INVALID && (DWORD)(dwNow - ARPCache[i].dwUpdated) >= ARPCacheTimeout)
+	{
+		ARPCacheUnlink(i);
+		i = ARP_CACHE_INVALID;
+	}
+
+	if(i == ARP_CACHE_INVALID)
+		return FALSE;
+
+	ARPCache[i].dwUsed = dwNow;
+	*MACAddr = ARPCache[i].MACAddr;
+	ARPCacheStats.hits++;
+	return TRUE;
+}
+
+/*****************************************************************************
+  Function:
+	BOOL ARPCacheUpdate(IP_ADDR IPAddr, MAC_ADDR* MACAddr, DWORD dwNow, 
+						BOOL bCreate)
+
+  Summary:
+	Records an IP to MAC address mapping seen on the network.
+
+  Description:
+	If IPAddr is already in the table its MAC address is replaced and 
+	its age is reset.  Otherwise, if bCreate is set, a new entry is made, 
+	replacing the least recently used one if the table is full.
+
+  Precondition:
+	ARPCacheInit() is already called.
+
+  Parameters:
+	IPAddr - IP address, in network byte order
+	MACAddr - MAC address that IPAddr is at
+	dwNow - The current Tick
+	bCreate - TRUE to add IPAddr if it is not already in the table
+
+  Return Values:
+  	TRUE - The table holds the mapping
+  	FALSE - IPAddr was not in the table and bCreate was not set
+
+  Remarks:
+	This follows the RFC 826 merge rule: any traffic from a host 
+	refreshes what we already know about it, but only traffic meant 
+	for us adds new hosts, so broadcasts from the rest of the network 
+	do not push out the peers we are talking to.
+  ***************************************************************************/
+BOOL ARPCacheUpdate(IP_ADDR IPAddr, MAC_ADDR* MACAddr, DWORD dwNow, BOOL bCreate)
+{
+	BYTE i;
+	BYTE vBucket;
+
+	if(IPAddr.Val == 0x00000000ul)
+		return FALSE;
+
+	i = ARPCacheFind(IPAddr);
+	if(i == ARP_CACHE_INVALID)
+	{
+		if(!bCreate)
+			return FALSE;
+
+		// Take a free slot, or the one least recently used
+		i = 0;
+		for(vBucket = 0; vBucket < ARP_CACHE_ENTRIES; vBucket++)
+		{
+			if(ARPCache[vBucket].IPAddr.Val == 0x00000000ul)
+			{
+				i = vBucket;
+				break;
+			}
+			if((LONG)(ARPCache[vBucket].dwUsed - ARPCache[i].dwUsed) < 0)
+				i = vBucket;
+		}
+
+		if(ARPCache[i].IPAddr.Val != 0x00000000ul)
+		{
+			ARPCacheUnlink(i);
+			ARPCacheStats.evicted++;
+		}
+
+		vBucket = ARPCacheHash(IPAddr);
+		ARPCache[i].IPAddr.Val = IPAddr.Val;
+		ARPCache[i].vNext = ARPCacheBucket[vBucket];
+		ARPCacheBucket[vBucket] = i;
+		ARPCache[i].dwUsed = dwNow;
+		ARPCacheStats.learned++;
+	}
+
+	ARPCache[i].MACAddr = *MACAddr;
+	ARPCache[i].dwUpdated = dwNow;
+	return TRUE;
+}
+
+/*****************************************************************************
+  Function:
+	void ARPCacheRemove(IP_ADDR IPAddr)
+
+  Summary:
+	Forgets the mapping for an IP address.
+
+  Description:
+	Forgets the mapping for an IP address, if there is one.
+
+  Precondition:
+	ARPCacheInit() is already called.
+
+  Parameters:
+	IPAddr - IP address, in network byte order
+
+  Returns:
+  	None
+  ***************************************************************************/
+void ARPCacheRemove(IP_ADDR IPAddr)
+{
+	BYTE i;
+
+	i = ARPCacheFind(IPAddr);
+	if(i != ARP_CACHE_INVALID)
+		ARPCacheUnlink(i);
+}
+
+/*****************************************************************************
+  Function:
+	void ARPCacheRequest(IP_ADDR IPAddr, DWORD dwNow)
+
+  Summary:
+	Counts a miss for an address an ARP request is being sent for.
+
+  Description:
+	Counts a miss if IPAddr is not in the table or has expired, so the 
+	miss count is the number of ARP requests the table could not save, 
+	not the number of ARPCacheLookup() polls made while a reply is on 
+	its way.
+
+  Precondition:
+	ARPCacheInit() is already called.
+
+  Parameters:
+	IPAddr - IP address being resolved, in network byte order
+	dwNow - The current Tick
+
+  Returns:
+  	None
+  ***************************************************************************/
+void ARPCacheRequest(IP_ADDR IPAddr, DWORD dwNow)
+{
+	BYTE i;
+
+	i = ARPCacheFind(IPAddr);
+	if(i == ARP_CACHE_INVALID || (DWORD)(dwNow - ARPCache[i].dwUpdated) >= ARPCacheTimeout)
+		ARPCacheStats.misses++;
+}
+
+/*****************************************************************************
+  Function:
+	void ARPCacheGetStats(ARP_CACHE_STATS* pStats)
+
+  Summary:
+	Returns the ARP cache statistics.
+
+  Description:
+	Copies the hit, miss, learn and eviction counters.
+
+  Precondition:
+	ARPCacheInit() is already called.
+
+  Parameters:
+	pStats - Buffer to receive the statistics
+
+  Returns:
+  	None
+  ***************************************************************************/
+void ARPCacheGetStats(ARP_CACHE_STATS* pStats)
+{
+	*pStats = ARPCacheStats;
+}
+
+/*****************************************************************************
+  Function:
+	static BYTE ARPCacheFind(IP_ADDR IPAddr)
+
+  Description:
+	Walks the hash bucket of IPAddr.
+
+  Precondition:
+	None
+
+  Parameters:
+	IPAddr - IP address, in network byte order
+
+  Returns:
+  	The slot holding IPAddr, or ARP_CACHE_INVALID
+  ***************************************************************************/
+static BYTE ARPCacheFind(IP_ADDR IPAddr)
+{
+	BYTE i;
+
+	for(i = ARPCacheBucket[ARPCacheHash(IPAddr)]; i != ARP_CACHE_INVALID; i = ARPCache[i].vNext)
+	{
+		if(ARPCache[i].IPAddr.Val == IPAddr.Val)
+			break;
+	}
+
+	return i;
+}
+
+/*****************************************************************************
+  Function:
+	static void ARPCacheUnlink(BYTE i)
+
+  Description:
+	Removes a slot from its hash bucket and marks it unused.
+
+  Precondition:
+	Slot i is in use.
+
+  Parameters:
+	i - The slot to free
+
+  Returns:
+  	None
+  ***************************************************************************/
+static void ARPCacheUnlink(BYTE i)
+{
+	BYTE *pLink;
+
+	for(pLink = &ARPCacheBucket[ARPCacheHash(ARPCache[i].IPAddr)]; *pLink != ARP_CACHE_INVALID; pLink = &ARPCache[*pLink].vNext)
+	{
+		if(*pLink == i)
+		{
+			*pLink = ARPCache[i].vNext;
+			break;
+		}
+	}
+
+	ARPCache[i].IPAddr.Val = 0x00000000ul;
+	ARPCache[i].vNext = ARP_CACHE_INVALID;
+}
+
+#endif //#if defined(STACK_CLIENT_MODE)
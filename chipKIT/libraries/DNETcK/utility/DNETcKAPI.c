@@ -215,6 +215,7 @@ static STATUS statusDNS = DNSUninitialized;
 static IP_ADDR DNSLastResolvedHostIP;
 static bool fIsEthernetEngineStopped = TRUE;
 static bool fDatagramPartiallyRead = FALSE;
+static DWORD tickPeriodicBudget = 0;
 
 /****************************************************************************
 // ChipKIT Client APIs
@@ -853,10 +854,14 @@ bool EthernetIsDNSResolved(const char * szHostName, byte * pIP, unsigned long ms
 	implicitly so that it is called at the right time to execution the stack
 	functions. But this routine is made available to the sketch so that the
 	sketch can keep the stack alive while the sketch is idle.
+
+    If a budget was set with EthernetSetPeriodicTasksBudget only the work
+    that is due is done, see StackTaskScheduled.
   ***************************************************************************/
 void EthernetPeriodicTasks(void)
 {
     static bool fInPeriodicTasks = FALSE;
+    bool fRunApplications = TRUE;
 
     // do not recursively execute this function.
     if(fInPeriodicTasks  || fIsEthernetEngineStopped)
@@ -865,22 +870,44 @@ void EthernetPeriodicTasks(void)
     }
     fInPeriodicTasks = TRUE;
 
-   	// This task performs normal stack task including checking
-   	// for incoming packet, type of packet and calling
-    // appropriate stack entity to process it.
-    StackTask();
+    if(tickPeriodicBudget == 0)
+    {
+   	    // This task performs normal stack task including checking
+   	    // for incoming packet, type of packet and calling
+        // appropriate stack entity to process it.
+        StackTask();
+
+        // an annoying thing is that the MAL will not hold on to the
+        // UDP buffer for another iteration of StackTask, so we must
+        // buffer the UDP data so we don't lose it.
+	    // ChipKITUDPUpdateBufferCache();
+        UpdateUDPCache();
+    }
+    else
+    {
+        StackTaskScheduled(TickGet() + tickPeriodicBudget);
 
-    // an annoying thing is that the MAL will not hold on to the
-    // UDP buffer for another iteration of StackTask, so we must
-    // buffer the UDP data so we don't lose it.
-	// ChipKITUDPUpdateBufferCache();
-    UpdateUDPCache();
+        // StackTask only stops early on a datagram with data in it, if there is
+        // none there is nothing to cache, and the applications that read UDP
+        // sockets (DHCP is in StackTask, DNS, NBNS, SNTP) only need their timers
+        if(UDPRxCount != 0)
+        {
+            UpdateUDPCache();
+        }
+        else
+        {
+            fRunApplications = StackSchedIsDue(STACK_SCHED_APPS);
+        }
+    }
 
     // This tasks invokes each of the core stack application tasks
-    StackApplications();
+    if(fRunApplications)
+    {
+        StackApplications();
+    }
 
     // keep the DNS resolving, try to get it to resolve and release the DNS engine
-    if(statusDNS == DNSResolving  ||  statusDNS == DNSIsBusy)
+    if(fRunApplications && (statusDNS == DNSResolving  ||  statusDNS == DNSIsBusy))
     {
         EthernetIsDNSResolved(szDNSNameResolving, NULL, 0, NULL);
     }
@@ -888,6 +915,38 @@ void EthernetPeriodicTasks(void)
     fInPeriodicTasks = FALSE;
 }
 
+/****************************************************************************
+  Function:
+    void EthernetSetPeriodicTasksBudget(unsigned long usBudget)
+
+  Description:
+    Sets how long each call to EthernetPeriodicTasks may spend processing frames
+
+  Precondition:
+    None
+
+  Parameters:
+    usBudget - the budget in microseconds, 0 to run the whole stack on every call
+
+  Returns:
+    None
+
+  Remarks:
+    The budget is rounded up to whole Ticks. It bounds frame processing only,
+    at least one frame is always processed and due timed tasks always run.
+  ***************************************************************************/
+void EthernetSetPeriodicTasksBudget(unsigned long usBudget)
+{
+    if(usBudget == 0)
+    {
+        tickPeriodicBudget = 0;
+    }
+    else
+    {
+        tickPeriodicBudget = (DWORD) (((QWORD) usBudget * TICK_SECOND + 999999ull) / 1000000ull);
+    }
+}
+
 /****************************************************************************
   Function:
     void EthernetRequestARPIpMacResolution(const byte * pIP)
@@ -912,8 +971,8 @@ void EthernetRequestARPIpMacResolution(const byte * pIP)
     {
         IP_ADDR ip = *(IP_ADDR *) pIP;
 
-        // if it is not the broadcast IP
-        if(ip.Val != 0xFFFFFFFF)
+        // if it is not the broadcast IP or a multicast group
+        if(ip.Val != 0xFFFFFFFF && (ip.v[0] & 0xF0) != 0xE0)
         {
             ARPResolve(&ip);
         }
@@ -962,6 +1021,18 @@ bool EthernetIsARPIpMacResolved(const byte * pIP, byte * pMAC, unsigned long msB
         return(TRUE);
     }
 
+    // multicast groups map directly onto 01-00-5E-xx-xx-xx, no ARP needed
+    if((ip.v[0] & 0xF0) == 0xE0)
+    {
+        pMAC[0] = 0x01;
+        pMAC[1] = 0x00;
+        pMAC[2] = 0x5E;
+        pMAC[3] = ip.v[1] & 0x7F;
+        pMAC[4] = ip.v[2];
+        pMAC[5] = ip.v[3];
+        return(TRUE);
+    }
+
     // resolve the IP address to get a MAC
     while(!ARPIsResolved(&ip, (MAC_ADDR *) pMAC))
     {
@@ -976,6 +1047,166 @@ bool EthernetIsARPIpMacResolved(const byte * pIP, byte * pMAC, unsigned long msB
     return(TRUE);
 }
 
+/****************************************************************************
+  Function:
+    bool EthernetSetMACBuffers(int cTxBuffers, int cRxBuffers, int cbRxBuffer)
+
+  Description:
+    Sets how the MAC buffer pool is split into transmit and receive buffers
+
+  Precondition:
+    Must be called before EthernetBegin
+ 
+  Parameters:
+    cTxBuffers - number of transmit buffers (and descriptors)
+    cRxBuffers - number of receive buffers (and descriptors)
+    cbRxBuffer - size of each receive buffer
+
+  Returns:
+    TRUE if the configuration fits in the pool, FALSE if it was rejected
+    and the previous configuration is still in effect
+
+  Remarks:  
+    See MACSetBufferConfig
+  ***************************************************************************/
+bool EthernetSetMACBuffers(int cTxBuffers, int cRxBuffers, int cbRxBuffer)
+{
+    if(!fIsEthernetEngineStopped)
+    {
+        return(FALSE);
+    }
+
+    return(MACSetBufferConfig(cTxBuffers, cRxBuffers, cbRxBuffer));
+}
+
+/****************************************************************************
+  Function:
+    void EthernetGetMACBufferStats(MACBufferStats * pStats)
+
+  Description:
+    Returns the MAC buffer run time statistics
+
+  Precondition:
+ 
+  Parameters:
+    pStats - a pointer to the structure to receive the statistics
+
+  Returns:
+    None
+
+  Remarks:  
+    The statistics are cleared by EthernetBegin
+  ***************************************************************************/
+void EthernetGetMACBufferStats(MACBufferStats * pStats)
+{
+    MAC_BUFFER_STATS macStats;
+
+    MACGetBufferStats(&macStats);
+    pStats->cRxNoBuffer = macStats.rxNoBuffer;
+    pStats->cRxOverflow = macStats.rxOverflow;
+    pStats->cRxMaxBacklog = macStats.rxMaxBacklog;
+    pStats->cRxGathered = macStats.rxGathered;
+    pStats->cTxNoBuffer = macStats.txNotReady;
+}
+
+/****************************************************************************
+  Function:
+    void EthernetGetARPCacheStats(ARPCacheStats * pStats)
+
+  Description:
+    Returns the ARP cache hit and miss counters
+
+  Precondition:
+ 
+  Parameters:
+    pStats - a pointer to the structure to receive the statistics
+
+  Returns:
+    None
+
+  Remarks:  
+    The statistics are cleared by EthernetBegin
+  ***************************************************************************/
+void EthernetGetARPCacheStats(ARPCacheStats * pStats)
+{
+    ARP_CACHE_STATS arpStats;
+
+    ARPCacheGetStats(&arpStats);
+    pStats->cHits = arpStats.hits;
+    pStats->cMisses = arpStats.misses;
+    pStats->cLearned = arpStats.learned;
+    pStats->cEvicted = arpStats.evicted;
+}
+
+/****************************************************************************
+  Function:
+    bool EthernetJoinMulticastGroup(const byte * pIP)
+
+  Description:
+    Joins an IPv4 multicast group so datagrams sent to the group are received
+
+  Precondition:
+    EthernetBegin has been called
+ 
+  Parameters:
+    pIP - a pointer to the IPv4 group address, 224.0.0.0 - 239.255.255.255
+
+  Returns:
+    TRUE if the group was joined, FALSE if it is not a multicast
+    address, there is no room for another group, or IGMP is not
+    enabled in the stack
+
+  Remarks:  
+    Membership reports are sent from EthernetPeriodicTasks
+  ***************************************************************************/
+bool EthernetJoinMulticastGroup(const byte * pIP)
+{
+#if defined(STACK_USE_IGMP)
+    if(pIP == NULL)
+    {
+        return(FALSE);
+    }
+
+    return(IGMPJoinGroup(*(IP_ADDR *) pIP));
+#else
+    return(FALSE);
+#endif
+}
+
+/****************************************************************************
+  Function:
+    bool EthernetLeaveMulticastGroup(const byte * pIP)
+
+  Description:
+    Leaves an IPv4 multicast group previously joined with EthernetJoinMulticastGroup
+
+  Precondition:
+    EthernetBegin has been called
+ 
+  Parameters:
+    pIP - a pointer to the IPv4 group address
+
+  Returns:
+    TRUE if the group was left, FALSE if it was not joined
+
+  Remarks:  
+    The leave message is sent from EthernetPeriodicTasks, datagrams
+    for the group are filtered out by the MAC immediately.
+  ***************************************************************************/
+bool EthernetLeaveMulticastGroup(const byte * pIP)
+{
+#if defined(STACK_USE_IGMP)
+    if(pIP == NULL)
+    {
+        return(FALSE);
+    }
+
+    return(IGMPLeaveGroup(*(IP_ADDR *) pIP));
+#else
+    return(FALSE);
+#endif
+}
+
 /****************************************************************************
   Function:
     void EthernetDNSTerminate(void)
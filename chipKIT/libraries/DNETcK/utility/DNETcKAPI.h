@@ -63,6 +63,7 @@ extern "C"
     unsigned short TCPIsGetReady(byte hTCP);
     void TCPDiscard(byte hTCP);
     unsigned short TCPGetArray(byte hTCP, byte * rgbRead, unsigned short rgbMax);
+    unsigned short TCPGetRxSpans(byte hTCP, byte ** ppSpan1, unsigned short * pcbSpan1, byte ** ppSpan2, unsigned short * pcbSpan2);
     bool TCPGet(byte hTCP, byte * bData);
 
     byte TCPPeek(byte hTCP, unsigned short index);
@@ -107,12 +108,20 @@ extern "C"
     void EthernetBegin(const byte *rgbMac, const byte *rgbIP, const byte *rgbGateWay, const byte *rgbSubNet, const byte *rgbDNS1, const byte *rgbDNS2);
     void EthernetEnd(void);
     void EthernetPeriodicTasks(void);
+    void EthernetSetPeriodicTasksBudget(unsigned long usBudget);
 
     void EthernetGetMACandIPs(byte *rgbMac, byte *rgbIP, byte *rgbGateWay, byte *rgbSubNet, byte *rgbDNS1, byte *rgbDNS2);
 
     void EthernetRequestARPIpMacResolution(const byte * pIP);
     bool EthernetIsARPIpMacResolved(const byte * pIP, byte * pMAC, unsigned long msBlockMax);
 
+    bool EthernetSetMACBuffers(int cTxBuffers, int cRxBuffers, int cbRxBuffer);
+    void EthernetGetMACBufferStats(MACBufferStats * pStats);
+    void EthernetGetARPCacheStats(ARPCacheStats * pStats);
+
+    bool EthernetJoinMulticastGroup(const byte * pIP);
+    bool EthernetLeaveMulticastGroup(const byte * pIP);
+
     void EthernetDNSTerminate(void);
 
     // TcpClient
@@ -56,6 +56,21 @@
 #define ETHER_IP    (0x00u)
 #define ETHER_ARP   (0x06u)
 
+#if defined(MAC_USE_RX_HW_CHECKSUM)
+	// offset in the frame where the MAC starts its RX payload checksum (programmed into ETHPMO)
+	#ifndef MAC_RX_HW_CHECKSUM_START
+		#define MAC_RX_HW_CHECKSUM_START	(sizeof(ETHER_HEADER))
+	#endif
+	// bytes at the end of rxBytes not covered by the checksum (the FCS)
+	#ifndef MAC_RX_HW_CHECKSUM_TRAILER
+		#define MAC_RX_HW_CHECKSUM_TRAILER	(4u)
+	#endif
+	// number of hardware results cross checked against software before they are trusted
+	#ifndef MAC_RX_HW_CHECKSUM_VERIFY
+		#define MAC_RX_HW_CHECKSUM_VERIFY	(16)
+	#endif
+#endif
+
 
 #define	LINK_REFRESH_MS	100		// refresh link status time, ms
 
@@ -74,17 +89,35 @@ static int		_LinkReconfigure(void);						// link reconfiguration
 static void*    _MacAllocCallback( size_t nitems, size_t size, void* param );
 
 
+// buffer pool shared by the TX buffers, the RX frame buffer and the RX buffers; carved up in MACInit()
+#define	EMAC_BUFFER_POOL_SIZE	(EMAC_TX_DESCRIPTORS*sizeof(sEthTxDcpt)+EMAC_RX_DESCRIPTORS*EMAC_RX_BUFF_SIZE)
+#define	EMAC_RX_MIN_BUFF_SIZE	64								// smallest RX buffer MACSetBufferConfig() accepts
+#define	EMAC_RX_MAX_FRAGS	((EMAC_RX_BUFF_SIZE+EMAC_RX_MIN_BUFF_SIZE-1)/EMAC_RX_MIN_BUFF_SIZE)	// most RX buffers a frame can span
+
+static unsigned int		_MacBufferPool[(EMAC_BUFFER_POOL_SIZE+sizeof(int)-1)/sizeof(int)];
+
+// buffer configuration; set by MACSetBufferConfig() and kept across MACInit()
+static int			_TxDcptCount=EMAC_TX_DESCRIPTORS;			// number of TX descriptors and buffers
+static int			_RxDcptCount=EMAC_RX_DESCRIPTORS;			// number of RX descriptors and buffers
+static int			_RxBuffSize=EMAC_RX_BUFF_SIZE;				// size of each RX buffer
+
 // TX buffers
-static volatile sEthTxDcpt	_TxDescriptors[EMAC_TX_DESCRIPTORS];			// the statically allocated TX buffers
+static volatile sEthTxDcpt*	_TxDescriptors=0;					// the TX buffers, from the pool
 static volatile sEthTxDcpt*	_pTxCurrDcpt=0;						// the current TX buffer
 static int			_TxLastDcptIx=0;					// the last TX descriptor used
 static unsigned short int	_TxCurrSize=0;						// the current TX buffer size
 
 
 // RX buffers
-static unsigned char		_RxBuffers[EMAC_RX_DESCRIPTORS][EMAC_RX_BUFF_SIZE];	// rx buffers for incoming data
+static unsigned char*		_RxBuffers=0;						// rx buffers for incoming data, _RxDcptCount of _RxBuffSize bytes
+static unsigned char*		_pRxFrameBuff=0;					// frames spanning several rx buffers are gathered here
 static unsigned char*		_pRxCurrBuff=0;						// the current RX buffer
 static unsigned short int	_RxCurrSize=0;						// the current RX buffer size
+#if defined(MAC_USE_RX_HW_CHECKSUM)
+static WORD			_RxCurrHwSum=0;						// the MAC payload checksum of the current RX buffer
+static int			_RxHwSumVerify=MAC_RX_HW_CHECKSUM_VERIFY;		// hardware results still to be checked against software
+static int			_RxHwSumUsable=1;					// cleared if the hardware result ever disagrees
+#endif
 
 
 
@@ -109,6 +142,11 @@ static int			_linkNegotiation;					// if an auto-negotiation is in effect
 /*static*/ int			_stackMgrInGetHdr=0;
 /*static*/ int			_stackMgrRxDiscarded=0;
 /*static*/ int			_stackMgrTxNotReady=0;
+/*static*/ int			_stackMgrRxHwSumMismatch=0;
+/*static*/ int			_stackMgrRxNoBuffer=0;
+/*static*/ int			_stackMgrRxOverflow=0;
+/*static*/ int			_stackMgrRxMaxBacklog=0;
+/*static*/ int			_stackMgrRxGathered=0;
 
 
 /*
@@ -139,11 +177,13 @@ static int			_linkNegotiation;					// if an auto-negotiation is in effect
   ***************************************************************************/
 void InitMACStaticMemory(void)
 {
-    memset(_TxDescriptors, 0, sizeof(_TxDescriptors));
+    memset(_MacBufferPool, 0, sizeof(_MacBufferPool));
+    _TxDescriptors=0;
     _pTxCurrDcpt=0;						
     _TxLastDcptIx=0;					
     _TxCurrSize=0;						
-    memset(_RxBuffers, 0, sizeof(_RxBuffers));	
+    _RxBuffers=0;
+    _pRxFrameBuff=0;
     _pRxCurrBuff=0;						
     _RxCurrSize=0;						
     memset(_HttpSSlBuffer, 0, sizeof(_HttpSSlBuffer));
@@ -158,6 +198,16 @@ void InitMACStaticMemory(void)
     _stackMgrInGetHdr=0;
     _stackMgrRxDiscarded=0;
     _stackMgrTxNotReady=0;
+    _stackMgrRxHwSumMismatch=0;
+    _stackMgrRxNoBuffer=0;
+    _stackMgrRxOverflow=0;
+    _stackMgrRxMaxBacklog=0;
+    _stackMgrRxGathered=0;
+#if defined(MAC_USE_RX_HW_CHECKSUM)
+    _RxCurrHwSum=0;
+    _RxHwSumVerify=MAC_RX_HW_CHECKSUM_VERIFY;
+    _RxHwSumUsable=1;
+#endif
 }
 
 /****************************************************************************
@@ -190,14 +240,26 @@ void MACInit(void)
 	BYTE		unsetMACAddr[6] =   {0x00, 0x00, 0x00, 0x00, 0x00, 0x00};		// not set MAC address
 
     int		initFail=0;
+    unsigned char*	pPool;
 
     InitMACStaticMemory();
 
 	_stackMgrRxBadPkts=_stackMgrRxOkPkts=_stackMgrInGetHdr=_stackMgrRxDiscarded=0;
 	_CurrWrPtr=_CurrRdPtr=0;
 
+	// carve the pool: TX buffers, the frame buffer if rx buffers are smaller than a frame, then the rx buffers
+	pPool=(unsigned char*)_MacBufferPool;
+	_TxDescriptors=(volatile sEthTxDcpt*)pPool;
+	pPool+=_TxDcptCount*sizeof(sEthTxDcpt);
+	if(_RxBuffSize<EMAC_RX_BUFF_SIZE)
+	{
+		_pRxFrameBuff=pPool;
+		pPool+=EMAC_RX_BUFF_SIZE;
+	}
+	_RxBuffers=pPool;
+
 	// set the TX/RX pointers
-	for(ix=0; ix<sizeof(_TxDescriptors)/sizeof(*_TxDescriptors); ix++)
+	for(ix=0; ix<_TxDcptCount; ix++)
 	{
 		_TxDescriptors[ix].txBusy=0;
 	}
@@ -260,7 +322,12 @@ void MACInit(void)
 		// let the auto-negotiation (if any) take place
 		// continue the initialization
 		EthRxFiltersClr(ETH_FILT_ALL_FILTERS);
+#if defined(STACK_USE_IGMP)
+		// multicast is only accepted through the hash table, IGMP programs it with the joined groups
+		EthRxFiltersSet(ETH_FILT_CRC_ERR_REJECT|ETH_FILT_RUNT_REJECT|ETH_FILT_ME_UCAST_ACCEPT|ETH_FILT_BCAST_ACCEPT);
+#else
 		EthRxFiltersSet(ETH_FILT_CRC_ERR_REJECT|ETH_FILT_RUNT_REJECT|ETH_FILT_ME_UCAST_ACCEPT|ETH_FILT_MCAST_ACCEPT|ETH_FILT_BCAST_ACCEPT);
+#endif
 
 		
 		// set the MAC address
@@ -278,22 +345,27 @@ void MACInit(void)
 			EthMACSetAddress(SysMACAddr.addr);                
         }
 				
-		if(EthDescriptorsPoolAdd(EMAC_TX_DESCRIPTORS, ETH_DCPT_TYPE_TX, _MacAllocCallback, 0)!=EMAC_TX_DESCRIPTORS)
+		if(EthDescriptorsPoolAdd(_TxDcptCount, ETH_DCPT_TYPE_TX, _MacAllocCallback, 0)!=_TxDcptCount)
 		{
 			initFail++;
 		}
 
-		if(EthDescriptorsPoolAdd(EMAC_RX_DESCRIPTORS, ETH_DCPT_TYPE_RX, _MacAllocCallback, 0)!=EMAC_RX_DESCRIPTORS)
+		if(EthDescriptorsPoolAdd(_RxDcptCount, ETH_DCPT_TYPE_RX, _MacAllocCallback, 0)!=_RxDcptCount)
 		{
 			initFail++;
 		}
 
-		EthRxSetBufferSize(EMAC_RX_BUFF_SIZE);
+		EthRxSetBufferSize(_RxBuffSize);
+
+#if defined(MAC_USE_RX_HW_CHECKSUM)
+		// start the RX payload checksum at the IP header; the pattern match filter is not used
+		ETHPMO=MAC_RX_HW_CHECKSUM_START;
+#endif
 
 		// set the RX buffers as permanent receive buffers
-		for(ix=0, ethRes=ETH_RES_OK; ix<EMAC_RX_DESCRIPTORS && ethRes==ETH_RES_OK; ix++)
+		for(ix=0, ethRes=ETH_RES_OK; ix<_RxDcptCount && ethRes==ETH_RES_OK; ix++)
 		{
-			void* pRxBuff=_RxBuffers[ix];
+			void* pRxBuff=_RxBuffers+ix*_RxBuffSize;
 			ethRes=EthRxBuffersAppend(&pRxBuff, 1, ETH_BUFF_FLAG_RX_STICKY);
 		}
 
@@ -470,7 +542,7 @@ BOOL MACIsTxReady(void)
 
 	if(_pTxCurrDcpt==0)
 	{
-		for(ix=_TxLastDcptIx+1; ix<sizeof(_TxDescriptors)/sizeof(*_TxDescriptors); ix++)
+		for(ix=_TxLastDcptIx+1; ix<_TxDcptCount; ix++)
 		{			
 			if(_TxDescriptors[ix].txBusy==0)
 			{	// found a non busy descriptor
@@ -624,7 +696,10 @@ void MACDiscardRx(void)
 {
 	if(_pRxCurrBuff)
 	{	// an already existing packet
-		EthRxAcknowledgeBuffer(_pRxCurrBuff, 0, 0);
+		if(_pRxCurrBuff!=_pRxFrameBuff)
+		{	// gathered frames gave their rx buffers back in MACGetHeader()
+			EthRxAcknowledgeBuffer(_pRxCurrBuff, 0, 0);
+		}
 		_pRxCurrBuff=0;
 		_RxCurrSize=0;
 
@@ -660,8 +735,12 @@ void MACDiscardRx(void)
 BOOL MACGetHeader(MAC_ADDR *remote, BYTE* type)
 {
 	void*			pNewPkt;
+	void*			pFrags[EMAC_RX_MAX_FRAGS];
+	int			nFrags;
 	const sEthRxPktStat*	pRxPktStat;
 	eEthRes			res;
+	eEthEvents		rxEvents;
+	int			backlog;
 
 	_stackMgrInGetHdr++;
 
@@ -696,17 +775,60 @@ BOOL MACGetHeader(MAC_ADDR *remote, BYTE* type)
 
 
 	MACDiscardRx();		// discard/acknowledge the old RX buffer, if any
-	
-	res=EthRxGetBuffer(&pNewPkt, &pRxPktStat);
+
+	// note if the MAC ran out of rx buffers or dropped frames since the last call
+	rxEvents=EthEventsGet()&(ETH_EV_RXBUFNA|ETH_EV_RXOVFLOW);
+	if(rxEvents)
+	{
+		if(rxEvents&ETH_EV_RXBUFNA)
+		{
+			_stackMgrRxNoBuffer++;
+		}
+		if(rxEvents&ETH_EV_RXOVFLOW)
+		{
+			_stackMgrRxOverflow++;
+		}
+		EthEventsClr(rxEvents);
+	}
+
+	backlog=EthDescriptorsGetRxUnack();
+	if(backlog>_stackMgrRxMaxBacklog)
+	{
+		_stackMgrRxMaxBacklog=backlog;
+	}
+
+	pFrags[0]=0;
+	nFrags=sizeof(pFrags)/sizeof(*pFrags);
+	res=EthRxGetPacket(pFrags, &nFrags, &pRxPktStat);
+	pNewPkt=(res==ETH_RES_OK)?pFrags[0]:0;
 	
 	if(res==ETH_RES_OK)
 	{	// available packet; minimum check
 
-		if(pRxPktStat->rxOk && !pRxPktStat->runtPkt && !pRxPktStat->crcError)
+		if(pRxPktStat->rxOk && !pRxPktStat->runtPkt && !pRxPktStat->crcError && (nFrags==1 || (_pRxFrameBuff && pRxPktStat->rxBytes<=EMAC_RX_BUFF_SIZE)))
 		{	// valid packet;
 			WORD_VAL newType;
 			_RxCurrSize=pRxPktStat->rxBytes;
-			_pRxCurrBuff=pNewPkt;
+			if(nFrags==1)
+			{	// fits in one rx buffer, use it in place
+				_pRxCurrBuff=pNewPkt;
+			}
+			else
+			{	// gather the pieces into the frame buffer and give the rx buffers straight back
+				int ix, left, chunk;
+				for(ix=0, left=_RxCurrSize; ix<nFrags && left>0; ix++, left-=chunk)
+				{
+					chunk=left<_RxBuffSize?left:_RxBuffSize;
+					memcpy(_pRxFrameBuff+ix*_RxBuffSize, pFrags[ix], chunk);
+				}
+				EthRxAcknowledgePacket(pNewPkt, 0, 0);
+				pNewPkt=_pRxFrameBuff;
+				_pRxCurrBuff=_pRxFrameBuff;
+				_stackMgrRxGathered++;
+			}
+#if defined(MAC_USE_RX_HW_CHECKSUM)
+			_RxCurrHwSum=pRxPktStat->pktChecksum;
+#endif
 			_CurrRdPtr=_pRxCurrBuff+sizeof(ETHER_HEADER);	// skip the packet header
 			// set the packet type
 			memcpy(remote, &((ETHER_HEADER*)pNewPkt)->SourceMACAddr, sizeof(*remote));
@@ -723,7 +845,7 @@ BOOL MACGetHeader(MAC_ADDR *remote, BYTE* type)
 
 	if(_pRxCurrBuff==0 && pNewPkt)
 	{	// failed packet, discard
-		EthRxAcknowledgeBuffer(pNewPkt, 0, 0);
+		EthRxAcknowledgePacket(pNewPkt, 0, 0);
 		_stackMgrRxBadPkts++;
 	}
 		
@@ -850,9 +972,91 @@ WORD MACGetArray(BYTE *address, WORD len)
  *****************************************************************************/
 WORD MACGetFreeRxSize(void)
 {
-	int avlblRxBuffs=sizeof(_RxBuffers)/sizeof(*_RxBuffers)-EthDescriptorsGetRxUnack();	// avlbl=allBuffs-unAck
+	int avlblRxBuffs=_RxDcptCount-EthDescriptorsGetRxUnack();	// avlbl=allBuffs-unAck
 
-	return avlblRxBuffs*(sizeof(_RxBuffers[0])/sizeof(*_RxBuffers[0]));	// avlbl* sizeof(buffer)
+	return avlblRxBuffs*_RxBuffSize;	// avlbl* sizeof(buffer)
+}
+
+
+/******************************************************************************
+ * Function:        BOOL MACSetBufferConfig(int txDcpts, int rxDcpts, int rxBuffSize)
+ *
+ * PreCondition:    MACInit() has not been called yet, or will be called
+ *                  again before the new configuration is used.
+ *
+ * Input:           txDcpts    - number of TX descriptors and TX buffers
+ *                  rxDcpts    - number of RX descriptors and RX buffers
+ *                  rxBuffSize - size of each RX buffer, rounded up to a multiple of 16
+ *
+ * Output:          TRUE if the configuration fits in the buffer pool and will be
+ *                  used by the next MACInit(), FALSE if it was rejected.
+ *
+ * Side Effects:    None
+ *
+ * Overview:        All buffers come out of one pool of EMAC_BUFFER_POOL_SIZE
+ *                  bytes, the default EMAC_TX_DESCRIPTORS and EMAC_RX_DESCRIPTORS
+ *                  configuration.  RX buffers smaller than EMAC_RX_BUFF_SIZE
+ *                  trade one full size frame buffer for many small ones:
+ *                  frames that fit one RX buffer are used in place, larger
+ *                  frames are gathered into the frame buffer and their RX
+ *                  buffers returned to the MAC immediately.  Many small
+ *                  buffers ride out bursts of small datagrams much better
+ *                  than a few full size ones.
+ *
+ * Note:            None
+ *****************************************************************************/
+BOOL MACSetBufferConfig(int txDcpts, int rxDcpts, int rxBuffSize)
+{
+	int	poolNeeded;
+
+	rxBuffSize=(rxBuffSize+15)&~15;
+	if(txDcpts<1 || rxDcpts<2 || rxBuffSize<EMAC_RX_MIN_BUFF_SIZE || rxBuffSize>EMAC_RX_BUFF_SIZE)
+	{
+		return FALSE;
+	}
+
+	poolNeeded=txDcpts*sizeof(sEthTxDcpt)+rxDcpts*rxBuffSize;
+	if(rxBuffSize<EMAC_RX_BUFF_SIZE)
+	{
+		poolNeeded+=EMAC_RX_BUFF_SIZE;
+	}
+	if(poolNeeded>sizeof(_MacBufferPool))
+	{
+		return FALSE;
+	}
+
+	_TxDcptCount=txDcpts;
+	_RxDcptCount=rxDcpts;
+	_RxBuffSize=rxBuffSize;
+	return TRUE;
+}
+
+
+/******************************************************************************
+ * Function:        void MACGetBufferStats(MAC_BUFFER_STATS* pStats)
+ *
+ * PreCondition:    None
+ *
+ * Input:           pStats - receives the counters
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Returns the buffer related run time statistics.  The RX
+ *                  buffer conditions are sampled each time MACGetHeader() is
+ *                  called, so they count calls that found the condition, not
+ *                  the number of frames lost.
+ *
+ * Note:            The counters are cleared by MACInit().
+ *****************************************************************************/
+void MACGetBufferStats(MAC_BUFFER_STATS* pStats)
+{
+	pStats->rxNoBuffer=_stackMgrRxNoBuffer;
+	pStats->rxOverflow=_stackMgrRxOverflow;
+	pStats->rxMaxBacklog=_stackMgrRxMaxBacklog;
+	pStats->rxGathered=_stackMgrRxGathered;
+	pStats->txNotReady=_stackMgrTxNotReady;
 }
 
 
@@ -962,7 +1166,8 @@ BOOL MACIsMemCopyDone(void)
  * Overview:        This function performs a checksum calculation of the buffer
  *                  pointed by the current value of the read pointer.
  *
- * Note:            None
+ * Note:            The read pointer does not have to be WORD aligned,
+ *                  CalcIPChecksum() handles odd addresses.
  *****************************************************************************/
 WORD CalcIPBufferChecksum(WORD len)
 {
@@ -993,6 +1198,64 @@ WORD MACCalcRxChecksum(WORD offset, WORD len)
 	return CalcIPChecksum(_pRxCurrBuff+sizeof(ETHER_HEADER)+offset, len);
 }
 
+#if defined(MAC_USE_RX_HW_CHECKSUM)
+/******************************************************************************
+ * Function:        WORD MACCalcRxBufferChecksum(WORD len)
+ *
+ * PreCondition:    A packet has been obtained by calling MACGetHeader() and
+ *                  the read pointer is set to the start of the checksum data.
+ *
+ * Input:           len: Total number of bytes to calculate the checksum over.
+ *
+ * Output:          16-bit checksum as defined by RFC 793
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Returns the same result as CalcIPBufferChecksum(), but
+ *                  derives it from the payload checksum the MAC computed while
+ *                  receiving the frame instead of reading the data again.
+ *
+ * Note:            The first MAC_RX_HW_CHECKSUM_VERIFY results are also
+ *                  computed in software.  If the two ever disagree the
+ *                  hardware checksum is not used again and
+ *                  _stackMgrRxHwSumMismatch is incremented.
+ *****************************************************************************/
+WORD MACCalcRxBufferChecksum(WORD len)
+{
+	unsigned char*	pStart;
+	unsigned char*	pEnd;
+	WORD		hwChecksum;
+	WORD		swChecksum;
+
+	pStart=_pRxCurrBuff+MAC_RX_HW_CHECKSUM_START;
+	pEnd=_pRxCurrBuff+_RxCurrSize-MAC_RX_HW_CHECKSUM_TRAILER;
+
+	if(!_RxHwSumUsable || _CurrRdPtr<pStart || _CurrRdPtr+len>pEnd)
+	{	// not usable for this frame
+		return CalcIPChecksum(_CurrRdPtr, len);
+	}
+
+	hwChecksum=MACRxHwChecksumAdjust(_RxCurrHwSum, pStart, pEnd, _CurrRdPtr, len);
+
+	if(_RxHwSumVerify)
+	{
+		swChecksum=CalcIPChecksum(_CurrRdPtr, len);
+		if(swChecksum!=hwChecksum)
+		{
+			_RxHwSumUsable=0;
+			_stackMgrRxHwSumMismatch++;
+		}
+		else
+		{
+			_RxHwSumVerify--;
+		}
+		return swChecksum;
+	}
+
+	return hwChecksum;
+}
+#endif	// defined(MAC_USE_RX_HW_CHECKSUM)
+
 /******************************************************************************
  * Function:        void SetRXHashTableEntry(MAC_ADDR DestMACAddr)
  *
@@ -1034,7 +1297,7 @@ WORD MACCalcRxChecksum(WORD offset, WORD len)
  *                  This will allow you to then readd the necessary destination 
  *                  addresses.
  *****************************************************************************/
-#if defined(STACK_USE_ZEROCONF_MDNS_SD)
+#if defined(STACK_USE_ZEROCONF_MDNS_SD) || defined(STACK_USE_IGMP)
 void SetRXHashTableEntry(MAC_ADDR DestMACAddr)
 {
       volatile unsigned int*    pHTSet;
@@ -1143,7 +1143,7 @@ DWORD swapl(DWORD v)
 	summed).  This checksum is defined in RFC 793.
 
   Precondition:
-	buffer is WORD aligned (even memory address) on 16- and 32-bit PICs.
+	None
 
   Parameters:
 	buffer - pointer to the data to be checksummed
@@ -1153,42 +1153,216 @@ DWORD swapl(DWORD v)
 	The calculated checksum.
 	
   Internal:
-	This function could be improved to do 32-bit sums on PIC32 platforms.
+	The data is summed a DWORD at a time into a 32-bit accumulator, with 
+	carries out of the accumulator counted separately and folded in once at 
+	the end (2^32 is congruent to 1 in one's complement arithmetic).  The 
+	main loop is unrolled to 16 bytes per iteration.
+	
+	The buffer does not need to be aligned.  A leading odd byte is summed 
+	on its own and the remainder is summed from the next (even) address, 
+	which yields a byte swapped result that is swapped back at the end 
+	(RFC 1071, section 2(B)).  A leading WORD brings the pointer up to a 
+	DWORD boundary so PIC32 never issues an unaligned load.
   ***************************************************************************/
 WORD CalcIPChecksum(BYTE* buffer, WORD count)
 {
-	WORD i;
-	WORD *val;
-	union
+	DWORD *val;
+	DWORD sum;
+	DWORD carry;
+	DWORD w;
+	BYTE odd;
+	WORD_VAL result;
+
+	sum = 0x00000000ul;
+	carry = 0x00000000ul;
+
+	// Sum a leading odd addressed byte as the high byte of a word
+	odd = ((PTR_BASE)buffer) & 0x1;
+	if(odd && count)
 	{
-		WORD w[2];
-		DWORD dw;
-	} sum;
+		sum = ((DWORD)*buffer++) << 8;
+		count--;
+	}
 
-	i = count >> 1;
-	val = (WORD*)buffer;
+	// Sum a leading WORD to get to a DWORD boundary
+	if((((PTR_BASE)buffer) & 0x2) && count >= 2u)
+	{
+		sum += (DWORD)*(WORD*)buffer;
+		buffer += 2;
+		count -= 2;
+	}
 
-	// Calculate the sum of all words
-	sum.dw = 0x00000000ul;
-	while(i--)
-		sum.dw += (DWORD)*val++;
+	// Calculate the sum of all DWORDs, 16 bytes at a time
+	val = (DWORD*)buffer;
+	while(count >= 16u)
+	{
+		w = val[0];	sum += w;	carry += (sum < w);
+		w = val[1];	sum += w;	carry += (sum < w);
+		w = val[2];	sum += w;	carry += (sum < w);
+		w = val[3];	sum += w;	carry += (sum < w);
+		val += 4;
+		count -= 16;
+	}
+	while(count >= 4u)
+	{
+		w = *val++;	sum += w;	carry += (sum < w);
+		count -= 4;
+	}
+	buffer = (BYTE*)val;
 
-	// Add in the sum of the remaining byte, if present
-	if(count & 0x1)
-		sum.dw += (DWORD)*(BYTE*)val;
+	// Add in the remaining WORD and byte, if present
+	if(count >= 2u)
+	{
+		w = (DWORD)*(WORD*)buffer;	sum += w;	carry += (sum < w);
+		buffer += 2;
+		count -= 2;
+	}
+	if(count)
+	{
+		w = (DWORD)*buffer;	sum += w;	carry += (sum < w);
+	}
 
-	// Do an end-around carry (one's complement arrithmatic)
-	sum.dw = sum.w[0] + sum.w[1];
+	// Do the end-around carries (one's complement arrithmatic), first 
+	// folding in the carries out of the 32-bit accumulator
+	sum = (sum >> 16) + (sum & 0xFFFFul) + carry;
+	sum = (sum >> 16) + (sum & 0xFFFFul);
+	sum = (sum >> 16) + (sum & 0xFFFFul);
+	result.Val = (WORD)sum;
 
-	// Do another end-around carry in case if the prior add 
-	// caused a carry out
-	sum.w[0] += sum.w[1];
+	// Undo the byte swap caused by starting at an odd address
+	if(odd)
+		result.Val = (((WORD)result.v[0]) << 8) | result.v[1];
 
 	// Return the resulting checksum
-	return ~sum.w[0];
+	return ~result.Val;
+}
+
+
+/*****************************************************************************
+  Function:
+	WORD CalcIPChecksumUpdate(WORD checksum, WORD oldVal, WORD newVal)
+
+  Summary:
+	Updates an IP checksum after a field it covers is rewritten.
+
+  Description:
+	Incrementally updates a checksum when one 16-bit word of the data it 
+	covers changes, without summing the data again (RFC 1624, eqn. 3):
+	HC' = ~(~HC + ~m + m').  Use this for header rewrites such as changing 
+	a TTL, port or length field.  For a 32-bit field (e.g. an IP address) 
+	call it once per half.
+
+  Precondition:
+	None
+
+  Parameters:
+	checksum - the checksum currently stored in the header
+	oldVal   - the word being replaced, in the same byte order as the data
+	newVal   - the new value of the word
+
+  Returns:
+	The updated checksum.
+  ***************************************************************************/
+WORD CalcIPChecksumUpdate(WORD checksum, WORD oldVal, WORD newVal)
+{
+	DWORD sum;
+
+	sum = (DWORD)(WORD)~checksum + (DWORD)(WORD)~oldVal + (DWORD)newVal;
+	sum = (sum >> 16) + (sum & 0xFFFFul);
+	sum = (sum >> 16) + (sum & 0xFFFFul);
+
+	return ~(WORD)sum;
 }
 
 
+#if defined(MAC_USE_RX_HW_CHECKSUM)
+/*****************************************************************************
+  Function:
+	WORD MACRxHwChecksumAdjust(WORD hwSum, BYTE* pStart, BYTE* pEnd, 
+								BYTE* pSeg, WORD len)
+
+  Summary:
+	Derives a segment's IP checksum from a sum over a larger span.
+
+  Description:
+	Turns the one's complement sum a MAC computed over the bytes it 
+	received, [pStart, pEnd), into the checksum of the segment [pSeg, 
+	pSeg+len) inside it, by subtracting the bytes in front of and behind 
+	the segment.  In practice those are the IP header (which sums to 
+	0xFFFF when valid) and any Ethernet padding, so only a few bytes are 
+	read instead of the whole payload.  The PIC32 MAC driver uses it in 
+	MACCalcRxBufferChecksum().
+
+  Precondition:
+	pStart <= pSeg and pSeg+len <= pEnd
+
+  Parameters:
+	hwSum  - one's complement sum of [pStart, pEnd), not complemented, 
+			 in the same byte order as CalcIPChecksum() works in
+	pStart - first byte covered by hwSum
+	pEnd   - one past the last byte covered by hwSum
+	pSeg   - first byte of the segment to checksum
+	len    - length of the segment
+
+  Returns:
+	The checksum CalcIPChecksum(pSeg, len) would return, for any segment 
+	that is not all zeros.
+
+  Internal:
+	Depends only on its arguments, so it is checked on the host against 
+	recorded frames (host/RxChecksumTest.c).  The tail is byte swapped if 
+	it starts at an odd offset from pStart, and so is the result if the 
+	segment does.  Subtraction can leave the negative zero 0x0000 where 
+	summing the segment gives 0xFFFF; a sum of data that is not all zero 
+	is never +0, so it is folded back.
+  ***************************************************************************/
+WORD MACRxHwChecksumAdjust(WORD hwSum, BYTE* pStart, BYTE* pEnd, BYTE* pSeg, WORD len)
+{
+	DWORD sum;
+	WORD_VAL part;
+	BYTE* pTail;
+
+	sum = hwSum;
+
+	// subtract (add the complement of) the head, it starts at an even offset from pStart
+	if(pSeg != pStart)
+	{
+		sum += CalcIPChecksum(pStart, pSeg-pStart);
+	}
+
+	// subtract the tail, byte swapped if it starts at an odd offset from pStart
+	pTail = pSeg+len;
+	if(pTail != pEnd)
+	{
+		part.Val = CalcIPChecksum(pTail, pEnd-pTail);
+		if((pTail-pStart) & 0x1)
+		{
+			part.Val = (((WORD)part.v[0]) << 8) | part.v[1];
+		}
+		sum += part.Val;
+	}
+
+	sum = (sum >> 16) + (sum & 0xFFFFul);
+	sum = (sum >> 16) + (sum & 0xFFFFul);
+	part.Val = (WORD)sum;
+
+	// the segment itself is byte swapped relative to pStart if it starts at an odd offset
+	if((pSeg-pStart) & 0x1)
+	{
+		part.Val = (((WORD)part.v[0]) << 8) | part.v[1];
+	}
+
+	// a sum of data that is not all zero is never +0
+	if(part.Val == 0x0000u)
+	{
+		part.Val = 0xFFFF;
+	}
+
+	return ~part.Val;
+}
+#endif
+
+
 /*****************************************************************************
   Function:
 	WORD CalcIPBufferChecksum(WORD len)
@@ -0,0 +1,519 @@
+/*********************************************************************
+ *
+ *  Internet Group Management Protocol (IGMP) Host
+ *  Module for Microchip TCP/IP Stack
+ *   -Joins and leaves IPv4 multicast groups
+ *   -Answers membership queries so snooping switches keep
+ *    forwarding group traffic to this port
+ *	 -Reference: RFC 2236
+ *
+ *********************************************************************
+ * FileName:        IGMP.c
+ * Dependencies:    IP, MAC (hash table filter)
+ * Processor:       PIC32
+ * Compiler:        Microchip C32 v1.05 or higher
+ *
+ * Only the host side of IGMPv2 is implemented.  Reports are sent
+ * with TTL 1 and the IP Router Alert option as required by RFC 2236.
+ * Queries from IGMPv1 routers (Max Resp Time of 0) are answered with
+ * v2 reports after a 10 second maximum delay, which v1 routers
+ * ignore but snooping switches still honor.
+ *
+ * Group membership is also programmed into the MAC receive hash
+ * table so unrelated multicast traffic is dropped by the hardware
+ * instead of being copied into the RX buffers.
+ ********************************************************************/
+#define __IGMP_C
+
+#include "TCPIP Stack/TCPIP.h"
+
+#if defined(STACK_USE_IGMP)
+
+// Max Resp Time (in 1/10 second units) assumed for IGMPv1 queries
+#define IGMP_V1_MAX_RESP_TIME	(100u)
+
+// IP header used on all IGMP messages: a standard 20 byte header
+// followed by the 4 byte Router Alert option (RFC 2113)
+typedef struct
+{
+	IP_HEADER	Header;
+	BYTE		RouterAlert[4];
+} IGMP_IP_HEADER;
+
+// IGMPv2 message
+typedef struct
+{
+	BYTE	vType;
+	BYTE	vMaxRespTime;
+	WORD	wChecksum;
+	IP_ADDR	GroupAddress;
+} IGMP_PACKET;
+
+// Per group state
+typedef struct
+{
+	IP_ADDR		GroupAddress;		// Class D group address
+	DWORD		ReportTime;			// Tick at which the pending report is due
+	BYTE		vReportCount;		// Number of reports still to be sent
+	unsigned char bInUse:1;			// Slot holds a group
+	unsigned char bLeavePending:1;	// Leave message must be sent, then the slot freed
+} IGMP_GROUP;
+
+static IGMP_GROUP IGMPGroups[MAX_IGMP_GROUPS];
+
+// Identification field for transmitted IGMP datagrams
+static WORD wIGMPIdentifier;
+
+static void IGMPUpdateFilter(void);
+static void IGMPGetGroupMAC(IP_ADDR group, MAC_ADDR *mac);
+static BOOL IGMPSend(BYTE type, IP_ADDR group, IP_ADDR dest);
+static IGMP_GROUP* IGMPFindGroup(IP_ADDR group);
+
+/*********************************************************************
+ * Function:        void IGMPInit(void)
+ *
+ * PreCondition:    MACInit() is already called.
+ *
+ * Input:           None
+ *
+ * Output:          All groups are forgotten and the MAC hash table
+ *					is reprogrammed with only the all-hosts group.
+ *
+ * Side Effects:    None
+ *
+ * Overview:        None
+ *
+ * Note:            No leave messages are sent for groups that were
+ *					joined before this call.
+ ********************************************************************/
+void IGMPInit(void)
+{
+	memset((void*)IGMPGroups, 0x00, sizeof(IGMPGroups));
+	wIGMPIdentifier = LFSRRand();
+	IGMPUpdateFilter();
+}
+
+/*********************************************************************
+ * Function:        BOOL IGMPJoinGroup(IP_ADDR group)
+ *
+ * PreCondition:    IGMPInit() is already called.
+ *
+ * Input:           group: Multicast group address to join
+ *
+ * Output:          TRUE if the group is (or already was) joined
+ *					FALSE if the address is not a class D address
+ *					or MAX_IGMP_GROUPS groups are already joined
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Adds the group MAC to the hash table filter and
+ *					schedules IGMP_ROBUSTNESS unsolicited membership
+ *					reports which are sent from IGMPTask().
+ *
+ * Note:            The all-hosts group 224.0.0.1 is always a member
+ *					and never reported.
+ ********************************************************************/
+BOOL IGMPJoinGroup(IP_ADDR group)
+{
+	IGMP_GROUP *g;
+	BYTE i;
+
+	if(!IGMPIsMulticastAddr(group))
+		return FALSE;
+
+	// 224.0.0.1 is implicitly joined
+	if(group.Val == 0x010000E0ul)
+		return TRUE;
+
+	g = IGMPFindGroup(group);
+	if(g == NULL)
+	{
+		for(i = 0; i < MAX_IGMP_GROUPS; i++)
+		{
+			if(!IGMPGroups[i].bInUse)
+			{
+				g = &IGMPGroups[i];
+				break;
+			}
+		}
+		if(g == NULL)
+			return FALSE;
+	}
+
+	g->GroupAddress.Val = group.Val;
+	g->bInUse = 1;
+	g->bLeavePending = 0;
+	g->vReportCount = IGMP_ROBUSTNESS;
+	g->ReportTime = TickGet();
+
+	IGMPUpdateFilter();
+	StackSchedDueIn(STACK_SCHED_IGMP, 0);
+	return TRUE;
+}
+
+/*********************************************************************
+ * Function:        BOOL IGMPLeaveGroup(IP_ADDR group)
+ *
+ * PreCondition:    IGMPInit() is already called.
+ *
+ * Input:           group: Multicast group address to leave
+ *
+ * Output:          TRUE if the group was joined and is now left
+ *					FALSE if the group was not joined
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Removes the group from the hash table filter
+ *					right away and schedules a Leave Group message
+ *					to 224.0.0.2 which is sent from IGMPTask().
+ *
+ * Note:            None
+ ********************************************************************/
+BOOL IGMPLeaveGroup(IP_ADDR group)
+{
+	IGMP_GROUP *g;
+
+	g = IGMPFindGroup(group);
+	if(g == NULL)
+		return FALSE;
+
+	g->bLeavePending = 1;
+	g->vReportCount = 0;
+
+	IGMPUpdateFilter();
+	StackSchedDueIn(STACK_SCHED_IGMP, 0);
+	return TRUE;
+}
+
+/*********************************************************************
+ * Function:        BOOL IGMPIsMember(IP_ADDR group)
+ *
+ * PreCondition:    IGMPInit() is already called.
+ *
+ * Input:           group: Multicast group address
+ *
+ * Output:          TRUE if the group is currently joined
+ *
+ * Side Effects:    None
+ *
+ * Overview:        None
+ *
+ * Note:            None
+ ********************************************************************/
+BOOL IGMPIsMember(IP_ADDR group)
+{
+	if(group.Val == 0x010000E0ul)
+		return TRUE;
+
+	return IGMPFindGroup(group) != NULL;
+}
+
+/*********************************************************************
+ * Function:        void IGMPProcess(NODE_INFO *remote, IP_ADDR *localIP, WORD len)
+ *
+ * PreCondition:    IPGetHeader() returned an IGMP datagram.
+ *
+ * Input:           remote: Sender of the datagram
+ *					localIP: Destination address of the datagram
+ *					len: Count of IGMP header and payload bytes
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Membership queries schedule a report for each
+ *					matching group after a random delay bounded by
+ *					the query's Max Resp Time.  Reports from other
+ *					hosts for a group we have a report pending for
+ *					suppress our own report.
+ *
+ * Note:            None
+ ********************************************************************/
+void IGMPProcess(NODE_INFO *remote, IP_ADDR *localIP, WORD len)
+{
+	IGMP_PACKET	packet;
+	DWORD		maxDelay;
+	DWORD		delay;
+	DWORD		now;
+	BYTE		i;
+
+	if(len < sizeof(IGMP_PACKET))
+		return;
+
+	// Validate the checksum over the whole IGMP message
+	IPSetRxBuffer(0);
+	if(CalcIPBufferChecksum(len))
+		return;
+
+	IPSetRxBuffer(0);
+	MACGetArray((BYTE*)&packet, sizeof(packet));
+
+	switch(packet.vType)
+	{
+		case IGMP_MEMBERSHIP_QUERY:
+			// Max Resp Time is in 1/10 second units; 0 means a v1 query
+			maxDelay = packet.vMaxRespTime ? packet.vMaxRespTime : IGMP_V1_MAX_RESP_TIME;
+			maxDelay = (DWORD)((QWORD)maxDelay * TICK_SECOND / 10ull);
+			now = TickGet();
+
+			for(i = 0; i < MAX_IGMP_GROUPS; i++)
+			{
+				IGMP_GROUP *g = &IGMPGroups[i];
+
+				if(!g->bInUse || g->bLeavePending)
+					continue;
+
+				// Group specific query for some other group
+				if(packet.GroupAddress.Val != 0x00000000ul && packet.GroupAddress.Val != g->GroupAddress.Val)
+					continue;
+
+				delay = maxDelay ? ((((DWORD)LFSRRand()) << 16) | LFSRRand()) % maxDelay : 0;
+
+				// Keep an already pending report if it is due sooner
+				if(g->vReportCount && (LONG)((now + delay) - g->ReportTime) >= 0)
+					continue;
+
+				g->vReportCount = 1;
+				g->ReportTime = now + delay;
+			}
+			break;
+
+		case IGMP_V1_MEMBERSHIP_REPORT:
+		case IGMP_V2_MEMBERSHIP_REPORT:
+			// Another member reported, our report would be redundant
+			for(i = 0; i < MAX_IGMP_GROUPS; i++)
+			{
+				IGMP_GROUP *g = &IGMPGroups[i];
+
+				if(g->bInUse && !g->bLeavePending && g->GroupAddress.Val == packet.GroupAddress.Val)
+					g->vReportCount = 0;
+			}
+			break;
+
+		default:
+			break;
+	}
+}
+
+/*********************************************************************
+ * Function:        void IGMPTask(void)
+ *
+ * PreCondition:    IGMPInit() is already called.
+ *
+ * Input:           None
+ *
+ * Output:          Sends any reports and leave messages that are due.
+ *
+ * Side Effects:    None
+ *
+ * Overview:        At most one message is sent per group per call;
+ *					if the TX buffer is busy the message stays
+ *					pending until the next call.
+ *
+ * Note:            Nothing is sent until this node has an IP
+ *					address, so joins made before DHCP completes
+ *					are reported once the lease is bound.
+ ********************************************************************/
+void IGMPTask(void)
+{
+	IP_ADDR allRouters;
+	BYTE i;
+
+	if(AppConfig.MyIPAddr.Val == 0x00000000ul)
+		return;
+
+	allRouters.Val = 0x020000E0ul;	// 224.0.0.2
+
+	for(i = 0; i < MAX_IGMP_GROUPS; i++)
+	{
+		IGMP_GROUP *g = &IGMPGroups[i];
+
+		if(!g->bInUse)
+			continue;
+
+		if(g->bLeavePending)
+		{
+			if(IGMPSend(IGMP_LEAVE_GROUP, g->GroupAddress, allRouters))
+			{
+				g->bInUse = 0;
+				g->bLeavePending = 0;
+			}
+			continue;
+		}
+
+		if(g->vReportCount == 0u)
+			continue;
+
+		if((LONG)(TickGet() - g->ReportTime) < 0)
+			continue;
+
+		if(IGMPSend(IGMP_V2_MEMBERSHIP_REPORT, g->GroupAddress, g->GroupAddress))
+		{
+			g->vReportCount--;
+			g->ReportTime = TickGet() + IGMP_UNSOLICITED_REPORT_INTERVAL;
+		}
+	}
+}
+
+/*********************************************************************
+ * Function:        static IGMP_GROUP* IGMPFindGroup(IP_ADDR group)
+ *
+ * PreCondition:    None
+ *
+ * Input:           group: Multicast group address
+ *
+ * Output:          The slot holding the joined group, or NULL
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Slots with a leave pending are not returned.
+ *
+ * Note:            None
+ ********************************************************************/
+static IGMP_GROUP* IGMPFindGroup(IP_ADDR group)
+{
+	BYTE i;
+
+	for(i = 0; i < MAX_IGMP_GROUPS; i++)
+	{
+		if(IGMPGroups[i].bInUse && !IGMPGroups[i].bLeavePending && IGMPGroups[i].GroupAddress.Val == group.Val)
+			return &IGMPGroups[i];
+	}
+
+	return NULL;
+}
+
+/*********************************************************************
+ * Function:        static void IGMPGetGroupMAC(IP_ADDR group, MAC_ADDR *mac)
+ *
+ * PreCondition:    None
+ *
+ * Input:           group: Multicast group address
+ *					mac: Receives the Ethernet group address
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Maps the low 23 bits of the group address onto
+ *					01-00-5E-00-00-00 (RFC 1112).
+ *
+ * Note:            None
+ ********************************************************************/
+static void IGMPGetGroupMAC(IP_ADDR group, MAC_ADDR *mac)
+{
+	mac->v[0] = 0x01;
+	mac->v[1] = 0x00;
+	mac->v[2] = 0x5E;
+	mac->v[3] = group.v[1] & 0x7F;
+	mac->v[4] = group.v[2];
+	mac->v[5] = group.v[3];
+}
+
+/*********************************************************************
+ * Function:        static void IGMPUpdateFilter(void)
+ *
+ * PreCondition:    MACInit() is already called.
+ *
+ * Input:           None
+ *
+ * Output:          None
+ *
+ * Side Effects:    Multicast frames may be dropped while the table
+ *					is being rebuilt.
+ *
+ * Overview:        The hash table cannot have single entries removed
+ *					so it is cleared and rebuilt from the all-hosts
+ *					group plus every joined group.
+ *
+ * Note:            None
+ ********************************************************************/
+static void IGMPUpdateFilter(void)
+{
+	MAC_ADDR	mac;
+	IP_ADDR		allHosts;
+	BYTE		i;
+
+	memset((void*)&mac, 0x00, sizeof(mac));
+	SetRXHashTableEntry(mac);
+
+	allHosts.Val = 0x010000E0ul;	// 224.0.0.1
+	IGMPGetGroupMAC(allHosts, &mac);
+	SetRXHashTableEntry(mac);
+
+	for(i = 0; i < MAX_IGMP_GROUPS; i++)
+	{
+		if(IGMPGroups[i].bInUse && !IGMPGroups[i].bLeavePending)
+		{
+			IGMPGetGroupMAC(IGMPGroups[i].GroupAddress, &mac);
+			SetRXHashTableEntry(mac);
+		}
+	}
+}
+
+/*********************************************************************
+ * Function:        static BOOL IGMPSend(BYTE type, IP_ADDR group, IP_ADDR dest)
+ *
+ * PreCondition:    None
+ *
+ * Input:           type: IGMP message type
+ *					group: Group Address field of the message
+ *					dest: IP destination of the datagram
+ *
+ * Output:          TRUE if the message was transmitted
+ *					FALSE if the TX buffer was busy
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Builds the IP header here rather than with
+ *					IPPutHeader() since IGMP needs TTL 1 and the
+ *					Router Alert option.
+ *
+ * Note:            None
+ ********************************************************************/
+static BOOL IGMPSend(BYTE type, IP_ADDR group, IP_ADDR dest)
+{
+	IGMP_IP_HEADER	ip;
+	IGMP_PACKET		packet;
+	MAC_ADDR		mac;
+
+	if(!IPIsTxReady())
+		return FALSE;
+
+	packet.vType			= type;
+	packet.vMaxRespTime		= 0;
+	packet.wChecksum		= 0;
+	packet.GroupAddress.Val	= group.Val;
+	packet.wChecksum		= CalcIPChecksum((BYTE*)&packet, sizeof(packet));
+
+	ip.Header.VersionIHL		= 0x40 | (sizeof(IGMP_IP_HEADER) >> 2);
+	ip.Header.TypeOfService		= 0x00;
+	ip.Header.TotalLength		= swaps(sizeof(IGMP_IP_HEADER) + sizeof(IGMP_PACKET));
+	ip.Header.Identification	= swaps(++wIGMPIdentifier);
+	ip.Header.FragmentInfo		= 0;
+	ip.Header.TimeToLive		= 1;
+	ip.Header.Protocol			= IP_PROT_IGMP;
+	ip.Header.HeaderChecksum	= 0;
+	ip.Header.SourceAddress		= AppConfig.MyIPAddr;
+	ip.Header.DestAddress.Val	= dest.Val;
+	ip.RouterAlert[0]			= 0x94;
+	ip.RouterAlert[1]			= 0x04;
+	ip.RouterAlert[2]			= 0x00;
+	ip.RouterAlert[3]			= 0x00;
+	ip.Header.HeaderChecksum	= CalcIPChecksum((BYTE*)&ip, sizeof(ip));
+
+	IGMPGetGroupMAC(dest, &mac);
+
+	// Position the write pointer for the MACPutHeader operation
+	// NOTE: do not put this before the IPIsTxReady() call for WF compatbility
+	MACSetWritePtr(BASE_TX_ADDR + sizeof(ETHER_HEADER));
+
+	MACPutHeader(&mac, MAC_IP, sizeof(ip) + sizeof(packet));
+	MACPutArray((BYTE*)&ip, sizeof(ip));
+	MACPutArray((BYTE*)&packet, sizeof(packet));
+	MACFlush();
+
+	return TRUE;
+}
+
+#endif //#if defined(STACK_USE_IGMP)
@@ -92,6 +92,20 @@ static SM_STACK smStack;
 
 NODE_INFO remoteNode;
 
+// Next Tick each housekeeping task is due when run from StackTaskScheduled()
+static DWORD StackSchedDue[STACK_SCHED_COUNT];
+
+// Default servicing interval for each housekeeping task, in Ticks
+static const DWORD StackSchedInterval[STACK_SCHED_COUNT] =
+{
+	STACK_SCHED_DHCP_INTERVAL,
+	STACK_SCHED_TCP_INTERVAL,
+	STACK_SCHED_IGMP_INTERVAL,
+	STACK_SCHED_APPS_INTERVAL
+};
+
+static void StackTaskRun(BOOL bScheduled, DWORD dwDeadline);
+
 
 
 /*********************************************************************
@@ -111,8 +125,14 @@ NODE_INFO remoteNode;
  ********************************************************************/
 void StackInit(void)
 {
+    BYTE i;
+
     smStack                     = SM_STACK_IDLE;
 
+	// Everything is due on the first scheduled pass
+	for(i = 0; i < STACK_SCHED_COUNT; i++)
+		StackSchedDue[i] = TickGet();
+
 #if defined(STACK_USE_IP_GLEANING) || defined(STACK_USE_DHCP_CLIENT)
     /*
      * If DHCP or IP Gleaning is enabled,
@@ -133,6 +153,10 @@ void StackInit(void)
 
     ARPInit();
 
+#if defined(STACK_USE_IGMP)
+    IGMPInit();
+#endif
+
 #if defined(STACK_USE_UDP)
     UDPInit();
 #endif
@@ -207,11 +231,129 @@ void StackInit(void)
  *
  ********************************************************************/
 void StackTask(void)
+{
+	StackTaskRun(FALSE, 0);
+}
+
+/*****************************************************************************
+  Function:
+	void StackTaskScheduled(DWORD dwDeadline)
+
+  Summary:
+	Runs the part of StackTask() that is due, within a time budget.
+
+  Description:
+	Like StackTask(), but the timed housekeeping tasks (DHCP, TCPTick, IGMP) 
+	only run when their deadline has passed or they have asked to be serviced 
+	with StackSchedDueIn(), and no further frames are taken from the MAC once 
+	the Tick count passes dwDeadline.  Frames left behind stay in the MAC 
+	receive buffers until the next call.
+
+  Precondition:
+	StackInit() is already called.
+
+  Parameters:
+	dwDeadline - TickGet() value after which to stop processing frames
+
+  Returns:
+  	None
+  	
+  Remarks:
+	At least one frame is processed per call, so the stack always makes 
+	progress even with a budget that is too small.  Timed tasks are cheap
+	compared to frame processing and are not interrupted by the deadline.
+  ***************************************************************************/
+void StackTaskScheduled(DWORD dwDeadline)
+{
+	StackTaskRun(TRUE, dwDeadline);
+}
+
+/*****************************************************************************
+  Function:
+	void StackSchedDueIn(STACK_SCHED_TASK task, DWORD dwTicks)
+
+  Summary:
+	Declares when a housekeeping task next needs servicing.
+
+  Description:
+	Brings the deadline of task forward to dwTicks from now.  A deadline 
+	that is already sooner is left alone.  Modules call this when something 
+	happens that their task has to act on before its regular interval 
+	expires, with dwTicks 0 to be run on the next scheduled pass.
+
+  Precondition:
+	None
+
+  Parameters:
+	task - the housekeeping task
+	dwTicks - Ticks from now the task needs to run
+
+  Returns:
+  	None
+  ***************************************************************************/
+void StackSchedDueIn(STACK_SCHED_TASK task, DWORD dwTicks)
+{
+	DWORD dwDue = TickGet() + dwTicks;
+
+	if((LONG)(dwDue - StackSchedDue[task]) < 0)
+		StackSchedDue[task] = dwDue;
+}
+
+/*****************************************************************************
+  Function:
+	BOOL StackSchedIsDue(STACK_SCHED_TASK task)
+
+  Summary:
+	Determines if a housekeeping task is due, and rearms it if so.
+
+  Description:
+	Returns TRUE if the deadline of task has passed.  The next deadline is 
+	then set to the default interval of the task, so the caller is expected 
+	to service the task when TRUE is returned.
+
+  Precondition:
+	None
+
+  Parameters:
+	task - the housekeeping task
+
+  Returns:
+  	TRUE if the task should be serviced now, FALSE otherwise
+  ***************************************************************************/
+BOOL StackSchedIsDue(STACK_SCHED_TASK task)
+{
+	DWORD dwNow = TickGet();
+
+	if((LONG)(dwNow - StackSchedDue[task]) < 0)
+		return FALSE;
+
+	StackSchedDue[task] = dwNow + StackSchedInterval[task];
+	return TRUE;
+}
+
+/*********************************************************************
+ * Function:        static void StackTaskRun(BOOL bScheduled, DWORD dwDeadline)
+ *
+ * PreCondition:    StackInit() is already called.
+ *
+ * Input:           bScheduled - TRUE to only run due timed tasks 
+ *                               and stop taking frames at dwDeadline
+ *                  dwDeadline - see StackTaskScheduled()
+ *
+ * Output:          Stack FSM is executed.
+ *
+ * Side Effects:    None
+ *
+ * Note:            Common body of StackTask() and StackTaskScheduled()
+ *
+ ********************************************************************/
+static void StackTaskRun(BOOL bScheduled, DWORD dwDeadline)
 {
     WORD dataCount;
     IP_ADDR tempLocalIP;
 	BYTE cFrameType;
 	BYTE cIPFrameType;
+	BOOL bFirstFrame = TRUE;
 
    
     #if defined( WF_CS_TRIS )
@@ -228,7 +370,12 @@ void StackTask(void)
 	// if it is not enabled. But in case some one wants to disable
 	// DHCP module at run-time, remember to not clear our IP
 	// address if link is removed.
-	if(AppConfig.Flags.bIsDHCPEnabled)
+	// While the lease is being negotiated, or a datagram is waiting that 
+	// may be a reply, DHCP has to run every pass
+	if(bScheduled && AppConfig.Flags.bIsDHCPEnabled && (!DHCPIsBound(0) || UDPRxCount != 0u))
+		StackSchedDueIn(STACK_SCHED_DHCP, 0);
+
+	if(AppConfig.Flags.bIsDHCPEnabled && (!bScheduled || StackSchedIsDue(STACK_SCHED_DHCP)))
 	{
 		static BOOL bLastLinkState = FALSE;
 		BOOL bCurrentLinkState;
@@ -263,7 +410,8 @@ void StackTask(void)
 
 	#if defined(STACK_USE_TCP)
 	// Perform all TCP time related tasks (retransmit, send acknowledge, close connection, etc)
-	TCPTick();
+	if(!bScheduled || StackSchedIsDue(STACK_SCHED_TCP))
+		TCPTick();
 	#endif
 
 
@@ -271,6 +419,12 @@ void StackTask(void)
 	UDPTask();
 	#endif
 
+	#if defined(STACK_USE_IGMP)
+	// Send any pending membership reports and leave messages
+	if(!bScheduled || StackSchedIsDue(STACK_SCHED_IGMP))
+		IGMPTask();
+	#endif
+
 	// Process as many incomming packets as we can
 	while(1)
 	{
@@ -286,6 +440,12 @@ void StackTask(void)
 			UDPDiscard();
 		#endif
 
+		// Out of time, leave the rest of the frames in the MAC for 
+		// the next pass
+		if(bScheduled && !bFirstFrame && (LONG)(TickGet() - dwDeadline) >= 0)
+			break;
+		bFirstFrame = FALSE;
+
 		// Fetch a packet (throws old one away, if not thrown away 
 		// yet)
 		if(!MACGetHeader(&remoteNode.MACAddr, &cFrameType))
@@ -312,6 +472,9 @@ void StackTask(void)
 				if(!IPGetHeader(&tempLocalIP, &remoteNode, &cIPFrameType, &dataCount))
 					break;
 
+				// Remember who sent it so replies do not need an ARP request
+				ARPLearn(&remoteNode, &tempLocalIP);
+
 				#if defined(STACK_USE_ICMP_SERVER) || defined(STACK_USE_ICMP_CLIENT)
 				if(cIPFrameType == IP_PROT_ICMP)
 				{
@@ -346,6 +509,14 @@ void StackTask(void)
 				}
 				#endif
 				
+				#if defined(STACK_USE_IGMP)
+				if(cIPFrameType == IP_PROT_IGMP)
+				{
+					IGMPProcess(&remoteNode, &tempLocalIP, dataCount);
+					break;
+				}
+				#endif
+
 				#if defined(STACK_USE_TCP)
 				if(cIPFrameType == IP_PROT_TCP)
 				{
@@ -210,6 +210,17 @@ static WORD NextPort __attribute__((persistent));	// Tracking variable for next
 // Determines the number of defined TCP sockets
 #define TCP_SOCKET_COUNT	(sizeof(TCPSocketInitializer)/sizeof(TCPSocketInitializer[0]))
 
+// Sockets are chained in buckets by their remoteHash so FindMatchingSocket() 
+// does not have to visit every socket.  Connected sockets hash their remote 
+// address and ports, listening sockets use their local port.  remoteHash must 
+// only be changed through TCPSetRemoteHash() to keep the chains intact.
+#if !defined(TCP_HASH_BUCKETS)
+	#define TCP_HASH_BUCKETS	(16u)	// Must be a power of 2
+#endif
+#define TCPHashBucket(w)		(((w) ^ ((w) >> 8)) & (TCP_HASH_BUCKETS - 1u))
+static TCP_SOCKET TCPHashHead[TCP_HASH_BUCKETS];		// First socket in each bucket
+static TCP_SOCKET TCPHashNext[TCP_SOCKET_COUNT];		// Next socket in the same bucket
+
 
 #if defined(HI_TECH_C)
 	// The initializer forces this large array out of the bss section 
@@ -243,7 +254,20 @@ static WORD NextPort __attribute__((persistent));	// Tracking variable for next
 	#endif
 #endif
 
-static TCB MyTCB;									// Currently loaded TCB
+// When every socket lives in PIC RAM, the TCBs are used in place instead 
+// of being copied in and out of MyTCB by SyncTCB().  Socket memory is then 
+// allocated on DWORD boundaries so the TCBs are aligned.  Define 
+// TCP_NO_DIRECT_TCB to always use the copy.
+#if (TCP_ETH_RAM_SIZE == 0) && (TCP_SPI_RAM_SIZE == 0) && !defined(TCP_NO_DIRECT_TCB)
+	#define TCP_DIRECT_TCB
+#endif
+
+#if defined(TCP_DIRECT_TCB)
+	static TCB *pMyTCB = NULL;						// Currently selected TCB
+	#define MyTCB		(*pMyTCB)
+#else
+	static TCB MyTCB;								// Currently loaded TCB
+#endif
 static TCP_SOCKET hCurrentTCP = INVALID_SOCKET;		// Current TCP socket
 static TCP_SOCKET hLastTCB = INVALID_SOCKET;
 
@@ -276,6 +300,7 @@ static BOOL FindMatchingSocket(TCP_HEADER* h, NODE_INFO* remote);
 static void SwapTCPHeader(TCP_HEADER* header);
 static void CloseSocket(void);
 static void SyncTCB(void);
+static void TCPSetRemoteHash(WORD wHash);
 
 // Indicates if this packet is a retransmission (no reset) or a new packet (reset required)
 #define SENDTCP_RESET_TIMERS	0x01
@@ -322,6 +347,18 @@ static void SyncTCB(void);
 
 
 
+#if defined(TCP_DIRECT_TCB)
+// Points MyTCB at the TCB of the current socket, which sits just 
+// before its TX FIFO.
+static void SyncTCB(void)
+{	
+	if(hLastTCB == hCurrentTCP)
+		return;
+
+	hLastTCB = hCurrentTCP;
+	pMyTCB = (TCB*)(MyTCBStub.bufferTxStart - sizeof(TCB));
+}
+#else
 // Flushes MyTCB cache and loads up the specified TCB.
 // Does nothing on cache hit.
 static void SyncTCB(void)
@@ -339,6 +376,27 @@ static void SyncTCB(void)
 	hLastTCB = hCurrentTCP;
 	TCPRAMCopy((PTR_BASE)&MyTCB, TCP_PIC_RAM, MyTCBStub.bufferTxStart - sizeof(MyTCB), MyTCBStub.vMemoryMedium, sizeof(MyTCB));
 }
+#endif
+
+// Changes the remoteHash of the current socket and moves it to the 
+// matching hash bucket.
+static void TCPSetRemoteHash(WORD wHash)
+{
+	TCP_SOCKET *pLink;
+
+	for(pLink = &TCPHashHead[TCPHashBucket(MyTCBStub.remoteHash.Val)]; *pLink != INVALID_SOCKET; pLink = &TCPHashNext[*pLink])
+	{
+		if(*pLink == hCurrentTCP)
+		{
+			*pLink = TCPHashNext[hCurrentTCP];
+			break;
+		}
+	}
+
+	MyTCBStub.remoteHash.Val = wHash;
+	TCPHashNext[hCurrentTCP] = TCPHashHead[TCPHashBucket(wHash)];
+	TCPHashHead[TCPHashBucket(wHash)] = hCurrentTCP;
+}
 
 
 /*****************************************************************************
@@ -377,10 +435,19 @@ void TCPInit(void)
     // clear out module level statics
     hCurrentTCP = INVALID_SOCKET;
     hLastTCB = INVALID_SOCKET;
+#if defined(TCP_DIRECT_TCB)
+    pMyTCB = NULL;
+#else
     memset(&MyTCB, 0, sizeof(MyTCB));	
+#endif
     memset(TCBStubs, 0, sizeof(TCBStubs));
+    memset(TCPHashHead, INVALID_SOCKET, sizeof(TCPHashHead));
     memset(SYNQueue, 0, sizeof(SYNQueue));
+#if defined(TCP_OPTIMIZE_FOR_SIZE)
+    // otherwise MyTCBStub is TCBStubs[hCurrentTCP], and hCurrentTCP is
+    // INVALID_SOCKET here
     memset(&MyTCBStub, 0, sizeof(MyTCBStub));	
+#endif
 
 	#if TCP_ETH_RAM_SIZE > 0
 	WORD wCurrentETHAddress = TCP_ETH_RAM_BASE_ADDRESS;
@@ -435,6 +502,10 @@ void TCPInit(void)
 			case TCP_PIC_RAM:
 				ptrBaseAddress = ptrCurrentPICAddress;
 				ptrCurrentPICAddress += sizeof(TCB) + wTXSize+1 + wRXSize+1;
+				#if defined(TCP_DIRECT_TCB)
+				// Keep the next TCB aligned, it is accessed in place
+				ptrCurrentPICAddress = (ptrCurrentPICAddress + 3u) & ~((PTR_BASE)3u);
+				#endif
 				// Do a sanity check to ensure that we aren't going to use memory that hasn't been allocated to us.
 				// If your code locks up right here, it means you've incorrectly allocated your TCP socket buffers in TCPIPConfig.h.  See the TCP memory allocation section.  More RAM needs to be allocated to the base memory mediums, or the individual sockets TX and RX FIFOS and socket quantiy needs to be shrunken.
 				while(ptrCurrentPICAddress > TCP_PIC_RAM_BASE_ADDRESS + TCP_PIC_RAM_SIZE);
@@ -621,7 +692,7 @@ TCP_SOCKET TCPOpen(DWORD dwRemoteHost, BYTE vRemoteHostType, WORD wPort, BYTE vS
 			MyTCB.localPort.Val = wPort;
 			MyTCBStub.Flags.bServer = TRUE;
 			MyTCBStub.smState = TCP_LISTEN;
-			MyTCBStub.remoteHash.Val = wPort;
+			TCPSetRemoteHash(wPort);
 			#if defined(STACK_USE_SSL_SERVER)
 			MyTCB.localSSLPort.Val = 0;
 			#endif
@@ -659,7 +730,7 @@ TCP_SOCKET TCPOpen(DWORD dwRemoteHost, BYTE vRemoteHostType, WORD wPort, BYTE vS
 						// dwRemoteHost is a literal IP address.  This 
 						// doesn't need DNS and can skip directly to the 
 						// Gateway ARPing step.
-						MyTCBStub.remoteHash.Val = (((DWORD_VAL*)&dwRemoteHost)->w[1]+((DWORD_VAL*)&dwRemoteHost)->w[0] + wPort) ^ MyTCB.localPort.Val;
+						TCPSetRemoteHash((((DWORD_VAL*)&dwRemoteHost)->w[1]+((DWORD_VAL*)&dwRemoteHost)->w[0] + wPort) ^ MyTCB.localPort.Val);
 						MyTCB.remote.niRemoteMACIP.IPAddr.Val = dwRemoteHost;
 						MyTCB.retryCount = 0;
 						MyTCB.retryInterval = (TICK_SECOND/4)/256;
@@ -667,7 +738,7 @@ TCP_SOCKET TCPOpen(DWORD dwRemoteHost, BYTE vRemoteHostType, WORD wPort, BYTE vS
 						break;
 		
 					case TCP_OPEN_NODE_INFO:
-						MyTCBStub.remoteHash.Val = (((NODE_INFO*)(PTR_BASE)dwRemoteHost)->IPAddr.w[1]+((NODE_INFO*)(PTR_BASE)dwRemoteHost)->IPAddr.w[0] + wPort) ^ MyTCB.localPort.Val;
+						TCPSetRemoteHash((((NODE_INFO*)(PTR_BASE)dwRemoteHost)->IPAddr.w[1]+((NODE_INFO*)(PTR_BASE)dwRemoteHost)->IPAddr.w[0] + wPort) ^ MyTCB.localPort.Val);
 						memcpy((void*)(BYTE*)&MyTCB.remote, (void*)(BYTE*)(PTR_BASE)dwRemoteHost, sizeof(NODE_INFO));
 						MyTCBStub.smState = TCP_SYN_SENT;
 						SendTCP(SYN, SENDTCP_RESET_TIMERS);
@@ -1690,6 +1761,77 @@ WORD TCPGetArray(TCP_SOCKET hTCP, BYTE* buffer, WORD len)
 }
 
 
+/*****************************************************************************
+  Function:
+	WORD TCPGetRxSpans(TCP_SOCKET hTCP, BYTE** ppSpan1, WORD* pwSpan1Len, 
+						BYTE** ppSpan2, WORD* pwSpan2Len)
+
+  Description:
+	Returns pointers to the data waiting in a TCP socket's receive FIFO 
+	without copying or removing it.  Because the FIFO is circular the data 
+	may be split in two contiguous spans: the first from the read pointer 
+	to the end of the FIFO and the second from the start of the FIFO.
+
+  Precondition:
+	TCP is initialized.
+
+  Parameters:
+	hTCP - The socket from which data is to be read.
+	ppSpan1 - Receives a pointer to the first span, or NULL if none.
+	pwSpan1Len - Receives the number of bytes in the first span.
+	ppSpan2 - Receives a pointer to the second span, or NULL if the data 
+		does not wrap.
+	pwSpan2Len - Receives the number of bytes in the second span.
+
+  Returns:
+	The total number of bytes in both spans.  This is the same as 
+	TCPIsGetReady() for sockets in PIC RAM, and 0 for sockets in Ethernet 
+	or SPI RAM, which cannot be addressed directly; use TCPGetArray() for 
+	those.
+
+  Remarks:
+	The spans stay valid until data is removed from the FIFO or the stack 
+	runs.  Remove the bytes that were used with TCPGetArray(hTCP, NULL, len), 
+	which also takes care of the window update.
+  ***************************************************************************/
+WORD TCPGetRxSpans(TCP_SOCKET hTCP, BYTE** ppSpan1, WORD* pwSpan1Len, BYTE** ppSpan2, WORD* pwSpan2Len)
+{
+	WORD wGetReadyCount;
+	WORD wRightLen;
+
+	*ppSpan1 = NULL;
+	*ppSpan2 = NULL;
+	*pwSpan1Len = 0;
+	*pwSpan2Len = 0;
+
+	wGetReadyCount = TCPIsGetReady(hTCP);
+	if(wGetReadyCount == 0u)
+		return 0x0000u;
+
+	SyncTCBStub(hTCP);
+
+	if(MyTCBStub.vMemoryMedium != TCP_PIC_RAM)
+		return 0x0000u;
+
+	// Bytes between the read pointer and the end of the FIFO
+	wRightLen = MyTCBStub.bufferEnd - MyTCBStub.rxTail + 1;
+
+	*ppSpan1 = (BYTE*)MyTCBStub.rxTail;
+	if(wGetReadyCount <= wRightLen)
+	{
+		*pwSpan1Len = wGetReadyCount;
+	}
+	else
+	{
+		*pwSpan1Len = wRightLen;
+		*ppSpan2 = (BYTE*)MyTCBStub.bufferRxStart;
+		*pwSpan2Len = wGetReadyCount - wRightLen;
+	}
+
+	return wGetReadyCount;
+}
+
+
 /*****************************************************************************
   Function:
 	WORD TCPGetRxFIFOFree(TCP_SOCKET hTCP)
@@ -2382,7 +2524,7 @@ void TCPTick(void)
 						memcpy((void*)&MyTCB.remote.niRemoteMACIP, (void*)&SYNQueue[w].niSourceAddress, sizeof(NODE_INFO));
 						MyTCB.remotePort.Val = SYNQueue[w].wSourcePort;
 						MyTCB.RemoteSEQ = SYNQueue[w].dwSourceSEQ + 1;
-						MyTCBStub.remoteHash.Val = (MyTCB.remote.niRemoteMACIP.IPAddr.w[1] + MyTCB.remote.niRemoteMACIP.IPAddr.w[0] + MyTCB.remotePort.Val) ^ MyTCB.localPort.Val;
+						TCPSetRemoteHash((MyTCB.remote.niRemoteMACIP.IPAddr.w[1] + MyTCB.remote.niRemoteMACIP.IPAddr.w[0] + MyTCB.remotePort.Val) ^ MyTCB.localPort.Val);
 						vFlags = SYN | ACK;
 						MyTCBStub.smState = TCP_SYN_RECEIVED;
 						
@@ -2484,7 +2626,7 @@ void TCPTick(void)
 					{
 						MyTCB.remote.niRemoteMACIP.IPAddr.Val = ipResolvedDNSIP.Val;
 						MyTCBStub.smState = TCP_GATEWAY_SEND_ARP;
-						MyTCBStub.remoteHash.Val = (MyTCB.remote.niRemoteMACIP.IPAddr.w[1]+MyTCB.remote.niRemoteMACIP.IPAddr.w[0] + MyTCB.remotePort.Val) ^ MyTCB.localPort.Val;
+						TCPSetRemoteHash((MyTCB.remote.niRemoteMACIP.IPAddr.w[1]+MyTCB.remote.niRemoteMACIP.IPAddr.w[0] + MyTCB.remotePort.Val) ^ MyTCB.localPort.Val);
 						MyTCB.retryCount = 0;
 						MyTCB.retryInterval = (TICK_SECOND/4)/256;
 					}
@@ -2760,7 +2902,7 @@ BOOL TCPProcess(NODE_INFO* remote, IP_ADDR* localIP, WORD len)
 
 	// Now calculate TCP packet checksum in NIC RAM - should match
 	// pesudo header checksum
-	checksum2.Val = CalcIPBufferChecksum(len);
+	checksum2.Val = MACCalcRxBufferChecksum(len);
 
 	// Compare checksums.
 	if(checksum1.Val != checksum2.Val)
@@ -3150,30 +3292,16 @@ static BOOL FindMatchingSocket(TCP_HEADER* h, NODE_INFO* remote)
 	partialMatch = INVALID_SOCKET;
 	hash = (remote->IPAddr.w[1]+remote->IPAddr.w[0] + h->SourcePort) ^ h->DestPort;
 
-	// Loop through all sockets looking for a socket that is expecting this 
-	// packet or can handle it.
-	for(hTCP = 0; hTCP < TCP_SOCKET_COUNT; hTCP++ )
+	// Look for a connected socket that is expecting this packet among 
+	// the sockets with the same remote hash
+	for(hTCP = TCPHashHead[TCPHashBucket(hash)]; hTCP != INVALID_SOCKET; hTCP = TCPHashNext[hTCP])
 	{
 		SyncTCBStub(hTCP);
 
-		if(MyTCBStub.smState == TCP_CLOSED)
+		if(MyTCBStub.smState == TCP_CLOSED || MyTCBStub.smState == TCP_LISTEN)
 		{
 			continue;
 		}
-		else if(MyTCBStub.smState == TCP_LISTEN)
-		{// For listening ports, check if this is the correct port
-			if(MyTCBStub.remoteHash.Val == h->DestPort)
-				partialMatch = hTCP;
-			
-			#if defined(STACK_USE_SSL_SERVER)
-			// Check the SSL port as well for SSL Servers
-			// 0 is defined as an invalid port number
-			if(MyTCBStub.sslTxHead == h->DestPort)
-				partialMatch = hTCP;
-			#endif
-			
-			continue;
-		}
 		else if(MyTCBStub.remoteHash.Val != hash)
 		{// Ignore if the hash doesn't match
 			continue;
@@ -3188,6 +3316,31 @@ static BOOL FindMatchingSocket(TCP_HEADER* h, NODE_INFO* remote)
 		}
 	}
 
+	// Otherwise look for a listening socket on the destination port.  
+	// Like the old linear scan, the highest numbered one wins.
+	for(hTCP = TCPHashHead[TCPHashBucket(h->DestPort)]; hTCP != INVALID_SOCKET; hTCP = TCPHashNext[hTCP])
+	{
+		SyncTCBStub(hTCP);
+
+		if(MyTCBStub.smState == TCP_LISTEN && MyTCBStub.remoteHash.Val == h->DestPort)
+		{
+			if(partialMatch == INVALID_SOCKET || hTCP > partialMatch)
+				partialMatch = hTCP;
+		}
+	}
+
+	#if defined(STACK_USE_SSL_SERVER)
+	// Check the SSL port as well for SSL Servers.  These are not hashed 
+	// by their SSL port.  0 is defined as an invalid port number
+	for(hTCP = 0; hTCP < TCP_SOCKET_COUNT; hTCP++)
+	{
+		SyncTCBStub(hTCP);
+
+		if(MyTCBStub.smState == TCP_LISTEN && MyTCBStub.sslTxHead == h->DestPort)
+			partialMatch = hTCP;
+	}
+	#endif
+
 
 	// If there is a partial match, then a listening socket is currently 
 	// available.  Set up the extended TCB with the info needed 
@@ -3214,7 +3367,7 @@ static BOOL FindMatchingSocket(TCP_HEADER* h, NODE_INFO* remote)
 		// and add to the SYN queue.
 		if(partialMatch != INVALID_SOCKET)
 		{
-			MyTCBStub.remoteHash.Val = hash;
+			TCPSetRemoteHash(hash);
 		
 			memcpy((void*)&MyTCB.remote, (void*)remote, sizeof(NODE_INFO));
 			MyTCB.remotePort.Val = h->SourcePort;
@@ -3356,7 +3509,7 @@ static void CloseSocket(void)
 {
 	SyncTCB();
 
-	MyTCBStub.remoteHash.Val = MyTCB.localPort.Val;
+	TCPSetRemoteHash(MyTCB.localPort.Val);
 	MyTCBStub.txHead = MyTCBStub.bufferTxStart;
 	MyTCBStub.txTail = MyTCBStub.bufferTxStart;
 	MyTCBStub.rxHead = MyTCBStub.bufferRxStart;
@@ -3381,7 +3534,7 @@ static void CloseSocket(void)
 		MyTCBStub.sslStubID = SSL_INVALID_ID;
 
 		// Swap the SSL port and local port back to proper values
-		MyTCBStub.remoteHash.Val = MyTCB.localSSLPort.Val;
+		TCPSetRemoteHash(MyTCB.localSSLPort.Val);
 		MyTCB.localSSLPort.Val = MyTCB.localPort.Val;
 		MyTCB.localPort.Val = MyTCBStub.remoteHash.Val;
 	}
@@ -4809,7 +4962,7 @@ BOOL TCPStartSSLServer(TCP_SOCKET hTCP)
 		return FALSE;
 
 	// Swap the localPort and localSSLPort
-	MyTCBStub.remoteHash.Val = MyTCB.localPort.Val;
+	TCPSetRemoteHash(MyTCB.localPort.Val);
 	MyTCB.localPort.Val = MyTCB.localSSLPort.Val;
 	MyTCB.localSSLPort.Val = MyTCBStub.remoteHash.Val;	
 
@@ -57,8 +57,10 @@
 
 #ifdef STACK_CLIENT_MODE
 	void ARPInit(void);
+	void ARPLearn(NODE_INFO* remote, IP_ADDR* localIP);
 #else
 	#define ARPInit()
+	#define ARPLearn(a,b)
 #endif
 
 #define ARP_OPERATION_REQ       0x0001u		// Operation code indicating an ARP Request
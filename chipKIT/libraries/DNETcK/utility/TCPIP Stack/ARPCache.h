@@ -0,0 +1,47 @@
+/*********************************************************************
+ *
+ *                  ARP Cache Defs for Microchip TCP/IP Stack
+ *
+ *********************************************************************
+ * FileName:        ARPCache.h
+ * Dependencies:    StackTsk.h
+ * Processor:       PIC32
+ * Compiler:        Microchip C32 v1.05 or higher
+ *
+ * IP to MAC address table used by ARP.c.  The table only stores and
+ * ages entries; the caller supplies the current Tick so the logic
+ * does not depend on the timer hardware.
+ *
+ ********************************************************************/
+#ifndef __ARP_CACHE_H
+#define __ARP_CACHE_H
+
+// Number of hash buckets, must be a power of 2
+#if !defined(ARP_CACHE_BUCKETS)
+	#define ARP_CACHE_BUCKETS		(16u)
+#endif
+
+// Marks an unused slot or the end of a hash chain
+#define ARP_CACHE_INVALID			(0xFFu)
+
+#if (ARP_CACHE_ENTRIES <= 0 || ARP_CACHE_ENTRIES >= ARP_CACHE_INVALID)
+#error Invalid ARP_CACHE_ENTRIES value specified
+#endif
+
+// ARP cache run time statistics
+typedef struct
+{
+	DWORD hits;			// lookups answered from the table
+	DWORD misses;		// ARP requests for addresses not in the table, or expired
+	DWORD learned;		// entries created
+	DWORD evicted;		// entries replaced to make room for a new one
+} ARP_CACHE_STATS;
+
+void ARPCacheInit(DWORD dwTimeout);
+BOOL ARPCacheLookup(IP_ADDR IPAddr, MAC_ADDR* MACAddr, DWORD dwNow);
+BOOL ARPCacheUpdate(IP_ADDR IPAddr, MAC_ADDR* MACAddr, DWORD dwNow, BOOL bCreate);
+void ARPCacheRemove(IP_ADDR IPAddr);
+void ARPCacheRequest(IP_ADDR IPAddr, DWORD dwNow);
+void ARPCacheGetStats(ARP_CACHE_STATS* pStats);
+
+#endif
@@ -106,6 +106,8 @@ WORD    swaps(WORD v);
 DWORD   swapl(DWORD v);
 
 WORD    CalcIPChecksum(BYTE* buffer, WORD len);
+WORD    CalcIPChecksumUpdate(WORD checksum, WORD oldVal, WORD newVal);
+WORD    MACRxHwChecksumAdjust(WORD hwSum, BYTE* pStart, BYTE* pEnd, BYTE* pSeg, WORD len);
 WORD    CalcIPBufferChecksum(WORD len);
 
 #if defined(__18CXX)
@@ -0,0 +1,44 @@
+/*********************************************************************
+ *
+ *                  IGMP Module Defs for Microchip TCP/IP Stack
+ *
+ *********************************************************************
+ * FileName:        IGMP.h
+ * Dependencies:    StackTsk.h
+ *                  IP.h
+ *                  MAC.h
+ * Processor:       PIC32
+ * Compiler:        Microchip C32 v1.05 or higher
+ *
+ * Host side Internet Group Management Protocol, version 2 (RFC 2236).
+ * Only group membership is implemented; this node never acts as a
+ * querier.
+ *
+ ********************************************************************/
+#ifndef __IGMP_H
+#define __IGMP_H
+
+// IGMP message types
+#define IGMP_MEMBERSHIP_QUERY		(0x11u)
+#define IGMP_V1_MEMBERSHIP_REPORT	(0x12u)
+#define IGMP_V2_MEMBERSHIP_REPORT	(0x16u)
+#define IGMP_LEAVE_GROUP			(0x17u)
+
+// Number of unsolicited reports sent after a join (RFC 2236 Robustness Variable)
+#define IGMP_ROBUSTNESS				(2u)
+
+// Time between the unsolicited reports sent after a join
+#define IGMP_UNSOLICITED_REPORT_INTERVAL	(TICK_SECOND)
+
+// Returns TRUE if the address is in the class D (224.0.0.0/4) range
+#define IGMPIsMulticastAddr(a)		(((a).v[0] & 0xF0u) == 0xE0u)
+
+void IGMPInit(void);
+void IGMPTask(void);
+void IGMPProcess(NODE_INFO *remote, IP_ADDR *localIP, WORD len);
+
+BOOL IGMPJoinGroup(IP_ADDR group);
+BOOL IGMPLeaveGroup(IP_ADDR group);
+BOOL IGMPIsMember(IP_ADDR group);
+
+#endif
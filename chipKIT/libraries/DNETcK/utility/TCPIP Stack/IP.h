@@ -56,6 +56,7 @@
 
 
 #define IP_PROT_ICMP    (1u)
+#define IP_PROT_IGMP    (2u)
 #define IP_PROT_TCP     (6u)
 #define IP_PROT_UDP     (17u)
 
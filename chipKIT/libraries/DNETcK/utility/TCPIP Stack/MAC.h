@@ -168,6 +168,14 @@ typedef struct  __attribute__((aligned(2), packed))
 WORD	MACCalcRxChecksum(WORD offset, WORD len);
 WORD 	CalcIPBufferChecksum(WORD len);
 
+// Checksum of the received packet from the read pointer, using the MAC's
+// receive checksum where the hardware has one
+#if defined(MAC_USE_RX_HW_CHECKSUM) && defined(__PIC32MX__) && defined(_ETH) && !defined(ENC100_INTERFACE_MODE) && !defined(ENC_CS_TRIS) && !defined(WF_CS_TRIS)
+	WORD	MACCalcRxBufferChecksum(WORD len);
+#else
+	#define MACCalcRxBufferChecksum(len)	CalcIPBufferChecksum(len)
+#endif
+
 void	MACPowerDown(void);
 void	MACEDPowerDown(void);
 void 	MACPowerUp(void);
@@ -317,6 +325,19 @@ void MACFlush(void);
 	PTR_BASE MACGetTxBaseAddr(void);
 	PTR_BASE MACGetHttpBaseAddr(void);
 	PTR_BASE MACGetSslBaseAddr(void);
+
+	// buffer run time statistics, see MACGetBufferStats()
+	typedef struct
+	{
+		int		rxNoBuffer;		// MACGetHeader() calls that found the MAC had run out of RX buffers
+		int		rxOverflow;		// MACGetHeader() calls that found the RX FIFO had overflowed
+		int		rxMaxBacklog;	// most RX buffers holding unprocessed frames at once
+		int		rxGathered;		// frames that spanned several RX buffers
+		int		txNotReady;		// MACIsTxReady() calls that found no free TX buffer
+	} MAC_BUFFER_STATS;
+
+	BOOL MACSetBufferConfig(int txDcpts, int rxDcpts, int rxBuffSize);
+	void MACGetBufferStats(MAC_BUFFER_STATS* pStats);
 #endif
 
 	
@@ -140,8 +140,36 @@ typedef struct __attribute__((__packed__))
 #endif
 
 
+// Housekeeping tasks that StackTaskScheduled() runs on deadlines
+typedef enum
+{
+	STACK_SCHED_DHCP = 0u,		// DHCPTask() and link state tracking
+	STACK_SCHED_TCP,			// TCPTick()
+	STACK_SCHED_IGMP,			// IGMPTask()
+	STACK_SCHED_APPS,			// StackApplications(), run by the caller
+	STACK_SCHED_COUNT
+} STACK_SCHED_TASK;
+
+// Regular servicing interval of each task when nothing asks for it sooner.
+// TCP has to beat its 40ms auto transmit and 100ms delayed ACK timers.
+#if !defined(STACK_SCHED_DHCP_INTERVAL)
+	#define STACK_SCHED_DHCP_INTERVAL	(TICK_SECOND/4)
+#endif
+#if !defined(STACK_SCHED_TCP_INTERVAL)
+	#define STACK_SCHED_TCP_INTERVAL	(TICK_SECOND/50)
+#endif
+#if !defined(STACK_SCHED_IGMP_INTERVAL)
+	#define STACK_SCHED_IGMP_INTERVAL	(TICK_SECOND/10)
+#endif
+#if !defined(STACK_SCHED_APPS_INTERVAL)
+	#define STACK_SCHED_APPS_INTERVAL	(TICK_SECOND/10)
+#endif
+
 void StackInit(void);
 void StackTask(void);
+void StackTaskScheduled(DWORD dwDeadline);
+void StackSchedDueIn(STACK_SCHED_TASK task, DWORD dwTicks);
+BOOL StackSchedIsDue(STACK_SCHED_TASK task);
 void StackApplications(void);
 
 #endif
@@ -215,6 +215,7 @@ WORD TCPIsGetReady(TCP_SOCKET hTCP);
 WORD TCPGetRxFIFOFree(TCP_SOCKET hTCP);
 BOOL TCPGet(TCP_SOCKET hTCP, BYTE* byte);
 WORD TCPGetArray(TCP_SOCKET hTCP, BYTE* buffer, WORD count);
+WORD TCPGetRxSpans(TCP_SOCKET hTCP, BYTE** ppSpan1, WORD* pwSpan1Len, BYTE** ppSpan2, WORD* pwSpan2Len);
 BYTE TCPPeek(TCP_SOCKET hTCP, WORD wStart);
 WORD TCPPeekArray(TCP_SOCKET hTCP, BYTE *vBuffer, WORD wLen, WORD wStart);
 WORD TCPFindEx(TCP_SOCKET hTCP, BYTE cFind, WORD wStart, WORD wSearchLen, BOOL bTextCompare);
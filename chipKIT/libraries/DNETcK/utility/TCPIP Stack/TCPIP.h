@@ -221,7 +221,7 @@
 		#if defined(__18CXX) && !defined(HI_TECH_C)
 			#pragma udata TCPSocketMemory
 		#endif
-		static BYTE TCPBufferInPIC[TCP_PIC_RAM_SIZE] __attribute__((far));
+		static BYTE TCPBufferInPIC[TCP_PIC_RAM_SIZE] __attribute__((far, aligned(4)));
 		#if defined(__18CXX) && !defined(HI_TECH_C)
 			#pragma udata
 		#endif
@@ -295,6 +295,7 @@
 #include "TCPIP Stack/MAC.h"
 #include "TCPIP Stack/IP.h"
 #include "TCPIP Stack/ARP.h"
+#include "TCPIP Stack/ARPCache.h"
 
 #if defined(STACK_USE_BIGINT)
 	#include "TCPIP Stack/BigInt.h"
@@ -385,6 +386,10 @@
 	#include "TCPIP Stack/ICMP.h"
 #endif
 
+#if defined(STACK_USE_IGMP)
+	#include "TCPIP Stack/IGMP.h"
+#endif
+
 #if defined(STACK_USE_ANNOUNCE)
 	#include "TCPIP Stack/Announce.h"
 #endif
@@ -97,6 +97,7 @@
 //#define STACK_USE_BERKELEY_API			// Berekely Sockets APIs are available
 //#define STACK_USE_ZEROCONF_LINK_LOCAL	// Zeroconf IPv4 Link-Local Addressing
 //#define STACK_USE_ZEROCONF_MDNS_SD		// Zeroconf mDNS and mDNS service discovery
+#define STACK_USE_IGMP					// IGMPv2 host side multicast group membership (join/leave reports and MAC hash filtering)
 
 
 // =======================================================================
@@ -205,12 +206,14 @@
 
 #define EMAC_TX_DESCRIPTORS		2		// number of the TX descriptors to be created
 #define EMAC_RX_DESCRIPTORS		8		// number of the RX descriptors and RX buffers to be created
+										// these defaults also size the MAC buffer pool; a sketch can split the
+										// pool differently with DNETcK::setMACBuffers() before DNETcK::begin()
 
 #define	EMAC_RX_BUFF_SIZE		1536	// size of a RX buffer. should be multiple of 16
 										// this is the size of all receive buffers processed by the ETHC
 										// The size should be enough to accomodate any network received packet
-										// If the packets are larger, they will have to take multiple RX buffers
-										// The current implementation does not handle this situation right now and the packet is discarded.
+										// If smaller RX buffers are configured at run time, packets that take
+										// multiple RX buffers are gathered into one buffer of this size.
 
 
 // =======================================================================
@@ -318,6 +321,21 @@
  */
 #define MAX_UDP_SOCKETS     (10u)
 #define UDP_USE_TX_CHECKSUM		// This slows UDP TX performance by nearly 50%, except when using the ENCX24J600 or PIC32MX6XX/7XX, which have a super fast DMA and incurs virtually no speed pentalty.
+#define MAC_USE_RX_HW_CHECKSUM	// PIC32MX6XX/7XX only: validate received UDP and TCP checksums from the MAC's payload checksum instead of reading the packet again.  Comment out to always validate in software.
+
+/* ARP Cache Configuration
+ *   Define how many IP to MAC address mappings are remembered and for
+ *   how long an entry is trusted after it was last seen on the network.
+ */
+#define ARP_CACHE_ENTRIES	(8u)
+#define ARP_CACHE_TIMEOUT	(5ull*TICK_MINUTE)
+
+/* IGMP Group Configuration
+ *   Define the maximum number of multicast groups that can be joined
+ *   at once.  The all-hosts group (224.0.0.1) is always accepted and
+ *   does not count against this number.
+ */
+#define MAX_IGMP_GROUPS     (4u)
 
 
 /* Berkeley API Sockets Configuration
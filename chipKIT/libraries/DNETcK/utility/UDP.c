@@ -128,6 +128,17 @@ static struct
 // Indicates which socket has currently received data for this loop
 static UDP_SOCKET SocketWithRxData = INVALID_UDP_SOCKET;
 
+// Open sockets are chained in buckets by local port so FindMatchingSocket() 
+// only looks at the sockets that can take a segment.  The remote address and 
+// port are not part of the key because DHCP, NBNS and FindMatchingSocket() 
+// itself rebind them in place.
+#if !defined(UDP_HASH_BUCKETS)
+	#define UDP_HASH_BUCKETS	(8u)	// Must be a power of 2
+#endif
+#define UDPHashBucket(port)		(((port) ^ ((port) >> 8)) & (UDP_HASH_BUCKETS - 1u))
+static UDP_SOCKET UDPHashHead[UDP_HASH_BUCKETS];	// First socket in each bucket
+static UDP_SOCKET UDPHashNext[MAX_UDP_SOCKETS];		// Next socket in the same bucket
+
 /****************************************************************************
   Section:
 	Function Prototypes
@@ -178,6 +189,7 @@ void UDPInit(void)
     UDPRxCount = 0;	
     wPutOffset = 0;
     wGetOffset = 0;
+    memset(UDPHashHead, INVALID_UDP_SOCKET, sizeof(UDPHashHead));
 
     for ( s = 0; s < MAX_UDP_SOCKETS; s++ )
     {
@@ -280,6 +292,9 @@ UDP_SOCKET UDPOpen(UDP_PORT localPort,
 	            p->localPort    = NextPort++;
 			}
 
+			UDPHashNext[s] = UDPHashHead[UDPHashBucket(p->localPort)];
+			UDPHashHead[UDPHashBucket(p->localPort)] = s;
+
             // If remoteNode is supplied, remember it.
             if(remoteNode)
             {
@@ -336,9 +351,24 @@ UDP_SOCKET UDPOpen(UDP_PORT localPort,
   ***************************************************************************/
 void UDPClose(UDP_SOCKET s)
 {
+	UDP_SOCKET *pLink;
+
 	if(s >= MAX_UDP_SOCKETS)
 		return;
 
+	// Take it out of its local port bucket
+	if(UDPSocketInfo[s].localPort != INVALID_UDP_PORT)
+	{
+		for(pLink = &UDPHashHead[UDPHashBucket(UDPSocketInfo[s].localPort)]; *pLink != INVALID_UDP_SOCKET; pLink = &UDPHashNext[*pLink])
+		{
+			if(*pLink == s)
+			{
+				*pLink = UDPHashNext[s];
+				break;
+			}
+		}
+	}
+
 	UDPSocketInfo[s].localPort = INVALID_UDP_PORT;
 	UDPSocketInfo[s].remoteNode.IPAddr.Val = 0x00000000;
 }
@@ -964,7 +994,7 @@ BOOL UDPProcess(NODE_INFO *remoteNode, IP_ADDR *localIP, WORD len)
 	
 	    // Now calculate UDP packet checksum in NIC RAM -- should match pseudoHeader
 	    IPSetRxBuffer(0);
-	    checksums.w[1] = CalcIPBufferChecksum(len);
+	    checksums.w[1] = MACCalcRxBufferChecksum(len);
 	
 	    if(checksums.w[0] != checksums.w[1])
 	    {
@@ -1040,9 +1070,11 @@ static UDP_SOCKET FindMatchingSocket(UDP_HEADER *h,
 
 	partialMatch = INVALID_UDP_SOCKET;
 
-	p = UDPSocketInfo;
-    for(s = 0; s < MAX_UDP_SOCKETS; s++)
+	// Only the sockets in the bucket of the destination port can match
+    for(s = UDPHashHead[UDPHashBucket(h->DestinationPort)]; s != INVALID_UDP_SOCKET; s = UDPHashNext[s])
 	{
+		p = &UDPSocketInfo[s];
+
 		// This packet is said to be matching with current socket:
 		// 1. If its destination port matches with our local port and
 		// 2. Packet source IP address matches with previously saved socket remote IP address and
@@ -1057,9 +1089,11 @@ static UDP_SOCKET FindMatchingSocket(UDP_HEADER *h,
 				}
 			}
 
-			partialMatch = s;
+			// Like the old linear scan, the highest numbered socket on 
+			// the port takes segments from new remote nodes
+			if(partialMatch == INVALID_UDP_SOCKET || s > partialMatch)
+				partialMatch = s;
 		}
-		p++;
 	}
 
 	if(partialMatch != INVALID_UDP_SOCKET)
@@ -60,6 +60,48 @@
 #ifdef USE_INTERNAL_FLASH
     #include    "MDD File System/Internal Flash.h"
 #endif
+#ifdef USE_FILE_IMAGE_INTERFACE
+    #include    "MDD File System/File Image.h"
+#endif
+
+// The number of sectors cached for the FAT, and for everything else (file
+// data and directories).  Define these in FSconfig.h to change them; 0 turns
+// that pool off.  Each sector takes MEDIA_SECTOR_SIZE bytes of RAM.
+#ifndef FS_FAT_CACHE_SECTORS
+    #define FS_FAT_CACHE_SECTORS    2
+#endif
+#ifndef FS_DATA_CACHE_SECTORS
+    #define FS_DATA_CACHE_SECTORS   4
+#endif
+
+// The number of contiguous cluster runs remembered for each file opened
+// read only, so FSfseek doesn't walk the FAT from the start of the file.
+// Define this in FSconfig.h to change it; 0 turns the map off.  Each run
+// takes 8 bytes in every FSFILE.
+#ifndef FS_EXTENT_MAP_SIZE
+    #define FS_EXTENT_MAP_SIZE      8
+#endif
+
+// The number of runs of free clusters kept for allocating new clusters.  A
+// run list that has been used up is refilled by scanning on through the FAT
+// from where the last scan stopped.  Define this in FSconfig.h to change it;
+// 0 turns the list off, and every new cluster is searched for entry by entry
+// from the file's current one as before.  Each run takes 8 bytes of RAM.
+#ifndef FS_FREE_RUNS
+    #define FS_FREE_RUNS            8
+#endif
+
+// The number of slots in the directory name index.  The first time a file is
+// looked up by name in a directory, every name in it is hashed into the index,
+// so later lookups in that directory read only the sector holding the entry.
+// Up to four directories share the slots.  Creating, renaming or removing
+// anything throws the index away.  A directory with more names than 3/4 of
+// the slots is searched entry by entry as before.
+// Define this in FSconfig.h to change it; 0 turns the index off.  Each slot
+// takes 4 bytes of RAM.
+#ifndef FS_DIR_INDEX_SIZE
+    #define FS_DIR_INDEX_SIZE       256
+#endif
 
 
 /*******************************************************************/
@@ -184,6 +226,7 @@ typedef struct
     unsigned    write :1;           // Indicates a file was opened in a mode that allows writes
     unsigned    read :1;            // Indicates a file was opened in a mode that allows reads
     unsigned    FileWriteEOF :1;    // Indicates the current position in a file is at the end of the file
+    unsigned    preallocated :1;    // Indicates FSfpreallocate may have linked clusters past the end of the file
 }FILEFLAGS;
 
 
@@ -230,6 +273,16 @@ typedef enum{
 
 
 
+// Summary: A run of contiguous clusters in a file
+// Description: The FS_EXTENT structure is one entry of a file's extent map.  The run starts at cluster, which is cluster number
+//              index of the file (counting from 0), and ends where the next entry's index starts.
+typedef struct
+{
+    DWORD           cluster;        // First cluster of the run
+    DWORD           index;          // Position of that cluster in the file's cluster chain
+} FS_EXTENT;
+
+
 // Summary: Contains file information and is used to indicate which file to access.
 // Description: The FSFILE structure is used to hold file information for an open file as it's being modified or accessed.  A pointer to 
 //              an open file's FSFILE structure will be passeed to any library function that will modify that file.
@@ -251,6 +304,11 @@ typedef struct
     WORD            attributes;     // The file attributes
     DWORD           dirclus;        // The base cluster of the file's directory
     DWORD           dirccls;        // The current cluster of the file's directory
+#if FS_EXTENT_MAP_SIZE > 0
+    WORD            extents;        // Number of runs in extent
+    DWORD           mapped;         // Number of the file's clusters that extent covers
+    FS_EXTENT       extent[FS_EXTENT_MAP_SIZE];  // The start of the file's cluster chain, as runs
+#endif
 } FSFILE;
 
 /* Summary: Possible results of the FSGetDiskProperties() function.
@@ -313,6 +371,35 @@ typedef struct
     unsigned char   initialized;                    // Check to determine if the structure was initialized by FindFirst (Internal use only)
 } SearchRec;
 
+// Summary: Counters for one pool of the sector cache.
+// Description: The FS_CACHE_STATS structure is loaded by the FSGetCacheStats function.
+typedef struct
+{
+    DWORD   hits;           // Sector reads and writes satisfied from the cache
+    DWORD   misses;         // Sector reads that had to go to the media
+    DWORD   writeBacks;     // Dirty sectors written to the media on eviction or flush
+} FS_CACHE_STATS;
+
+// Summary: State of a read-ahead stream.
+// Description: An FS_READAHEAD structure is set up by FSReadAheadBegin and used by the other
+//              FSReadAhead functions.  Its members are for internal use only.
+typedef struct
+{
+    FSFILE *        file;           // File being read
+    BYTE *          ring;           // ringSectors sectors of buffer space
+    WORD            ringSectors;    // Size of the ring in sectors
+    WORD            head;           // Ring slot holding the next data to hand out
+    WORD            filled;         // Sectors ready to hand out, starting at head
+    WORD            inFlight;       // Sectors being read into the slots after those
+    WORD            offset;         // Bytes already handed out from the head slot
+    WORD            sec;            // Sector within ccls of the next sector to request
+    DWORD           ccls;           // Cluster of the next sector to request
+    DWORD           sector;         // First sector of the read in flight
+    DWORD           toRequest;      // File sectors not requested yet
+    DWORD           seek;           // File position of the next byte handed out
+    BYTE            error;          // CE_GOOD, or the error that stopped the read-ahead
+} FS_READAHEAD;
+
 
 /***************************************************************************
 * Prototypes                                                               *
@@ -702,7 +789,9 @@ size_t FSfread(void *ptr, size_t size, size_t n, FSFILE *stream);
     to the file and the position will be set to the first byte of that
     cluster.
   Remarks:
-    None                                                               
+    In a file opened read only the cluster is found with the file's
+    extent map (see FS_EXTENT_MAP_SIZE), so the FAT is only read for the
+    part of the file that hasn't been seeked into before.                                                               
   **********************************************************************/
 
 int FSfseek(FSFILE *stream, long offset, int whence);
@@ -934,6 +1023,35 @@ int FSremove (const char * fileName);
 
 size_t FSfwrite(const void *ptr, size_t size, size_t n, FSFILE *stream);
 
+
+/*********************************************************************************
+  Function:
+    int FSfpreallocate (FSFILE * stream, DWORD size)
+  Summary:
+    Reserve clusters for a file that is going to be written
+  Conditions:
+    File opened in WRITE, APPEND, WRITE+, APPEND+, READ+ mode
+  Input:
+    stream -  Pointer to file structure
+    size -    Number of bytes the file is expected to grow to
+  Return Values:
+    0 -   The file's cluster chain covers size bytes
+    EOF - The clusters could not be reserved
+  Side Effects:
+    The FSerrno variable will be changed.
+  Description:
+    Links enough free clusters onto the end of the file's cluster chain to hold
+    size bytes, as contiguous as the free space allows, without changing the
+    file size or position.  FSfwrite then writes into these clusters instead of
+    allocating one at a time, and FSfclose frees any that weren't written to.
+    If the disk fills up, the clusters that were reserved are kept and FSerrno
+    is set to CE_DISK_FULL.
+  Remarks:
+    None.
+  *********************************************************************************/
+
+int FSfpreallocate (FSFILE * stream, DWORD size);
+
 #endif
 
 #ifdef ALLOW_DIRS
@@ -1536,4 +1654,169 @@ void FSGetDiskProperties(FS_DISK_PROPERTIES* properties);
 #endif
 
 
+/*************************************************************************
+  Function:
+    int FSCacheFlush (void)
+  Summary:
+    Write every dirty sector in the sector cache to the media
+  Conditions:
+    FSInit performed
+  Input:
+    None
+  Return Values:
+    0 -   All dirty sectors were written
+    EOF - A sector could not be written
+  Side Effects:
+    The FSerrno variable will be changed.
+  Description:
+    Sectors written by FSfwrite are kept in the sector cache and only
+    written to the media when they are evicted or the cache is flushed.
+    FSfclose flushes the cache, so this only needs to be called to make
+    the data of a file that stays open safe against the media being
+    removed.
+  Remarks:
+    All other writes (directories, formatting) go straight through to the
+    media.
+  *************************************************************************/
+
+int FSCacheFlush (void);
+
+
+/*************************************************************************
+  Function:
+    void FSGetCacheStats (FS_CACHE_STATS * fatStats, FS_CACHE_STATS * dataStats)
+  Summary:
+    Get the sector cache hit/miss counters
+  Conditions:
+    None
+  Input:
+    fatStats -   Loaded with the counters for the FAT sector pool
+    dataStats -  Loaded with the counters for the data/directory sector pool
+  Return Values:
+    None
+  Side Effects:
+    None
+  Description:
+    Either pointer may be NULL.  Use these to size FS_FAT_CACHE_SECTORS
+    and FS_DATA_CACHE_SECTORS for an application.
+  Remarks:
+    None
+  *************************************************************************/
+
+void FSGetCacheStats (FS_CACHE_STATS * fatStats, FS_CACHE_STATS * dataStats);
+
+
+/*************************************************************************
+  Function:
+    int FSReadAheadBegin (FS_READAHEAD * ra, FSFILE * stream, BYTE * ring, WORD ringSectors)
+  Summary:
+    Start reading a file sequentially in the background
+  Conditions:
+    File opened in a read mode
+  Input:
+    ra -           Read-ahead state, set up by this function
+    stream -       The file to read, from its current position
+    ring -         Buffer of ringSectors * MEDIA_SECTOR_SIZE bytes
+    ringSectors -  Number of sectors to keep in flight or waiting
+  Return Values:
+    0 -   The read-ahead was started
+    EOF - The file can't be read
+  Side Effects:
+    The FSerrno variable will be changed.
+  Description:
+    Starts reading the file into the ring, as many consecutive sectors per
+    media read as the ring and the cluster chain allow.  With a media
+    driver that has split-phase reads (MDD_SectorReadStart and
+    MDD_SectorReadIsComplete in FSconfig.h) the reads run while the
+    application does other work; FSReadAheadRead and FSReadAheadTasks
+    collect them and start the next one without waiting.  Other drivers
+    read each run when it is started.
+  Remarks:
+    Only one read-ahead can have a read in flight at a time.  Any other
+    file system call waits for that read to finish first.  Don't use the
+    file with FSfread or FSfseek until FSReadAheadEnd is called.
+  *************************************************************************/
+
+int FSReadAheadBegin (FS_READAHEAD * ra, FSFILE * stream, BYTE * ring, WORD ringSectors);
+
+
+/*************************************************************************
+  Function:
+    size_t FSReadAheadRead (FS_READAHEAD * ra, void * ptr, size_t len)
+  Summary:
+    Take data that has already been read ahead
+  Conditions:
+    FSReadAheadBegin performed
+  Input:
+    ra -   Read-ahead state
+    ptr -  Destination buffer
+    len -  Most bytes to copy
+  Return:
+    size_t - number of bytes copied, which may be 0 if nothing has arrived yet
+  Side Effects:
+    The FSerrno variable will be changed.
+  Description:
+    Copies up to len bytes that are already in the ring and starts the
+    next read into the space that frees up.  Never waits for the media.
+    FSerrno is CE_EOF at the end of the file, or an error code once the
+    read-ahead has stopped and everything read before the error has been
+    handed out.
+  Remarks:
+    None
+  *************************************************************************/
+
+size_t FSReadAheadRead (FS_READAHEAD * ra, void * ptr, size_t len);
+
+
+/*************************************************************************
+  Function:
+    void FSReadAheadTasks (FS_READAHEAD * ra)
+  Summary:
+    Keep a read-ahead going
+  Conditions:
+    FSReadAheadBegin performed
+  Input:
+    ra -  Read-ahead state
+  Return Values:
+    None
+  Side Effects:
+    None
+  Description:
+    Collects a finished read and starts the next one if there is room in
+    the ring.  Call it from the main loop when FSReadAheadRead isn't being
+    called, so the ring fills while the data isn't needed yet.
+  Remarks:
+    None
+  *************************************************************************/
+
+void FSReadAheadTasks (FS_READAHEAD * ra);
+
+
+/*************************************************************************
+  Function:
+    int FSReadAheadEnd (FS_READAHEAD * ra)
+  Summary:
+    Stop a read-ahead
+  Conditions:
+    FSReadAheadBegin performed
+  Input:
+    ra -  Read-ahead state
+  Return Values:
+    0 -   The file was positioned after the last byte handed out
+    EOF - The file could not be positioned
+  Side Effects:
+    The FSerrno variable will be changed.
+  Description:
+    Waits for a read in flight to finish, then seeks the file to the
+    position after the last byte FSReadAheadRead handed out, so FSfread
+    carries on from there.  The read-ahead is stopped after that; ending
+    it again, or ending one that was never begun (ra zero filled), does
+    nothing and returns 0.
+  Remarks:
+    None
+  *************************************************************************/
+
+int FSReadAheadEnd (FS_READAHEAD * ra);
+
+
 #endif
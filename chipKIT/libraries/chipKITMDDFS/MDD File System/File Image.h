@@ -0,0 +1,67 @@
+/******************************************************************************
+ *
+ *               Microchip Memory Disk Drive File System
+ *
+ ******************************************************************************
+ * FileName:        File Image.h
+ * Dependencies:    GenericTypeDefs.h
+ *					FSconfig.h
+ *					FSDefs.h
+ * Processor:       Host (Linux)
+ * Compiler:        gcc
+ *
+ * Physical layer that keeps the "media" in a disk image file, so FSIO.cpp
+ * can be built and run on a PC.  See host/Makefile.
+ *
+*****************************************************************************/
+
+#ifndef _FILE_IMAGE_H_
+#define _FILE_IMAGE_H_
+
+#include "GenericTypeDefs.h"
+#include "FSconfig.h"
+#include "MDD File System/FSDefs.h"
+
+
+// Summary: Counters kept by the file image driver
+// Description: The MDD_FILEIMG_STATS structure is loaded by MDD_FILEIMG_GetStats.  A call that
+//              moves several sectors counts once in reads or writes.
+typedef struct
+{
+    DWORD   reads;          // Read calls that reached the image
+    DWORD   sectorsRead;    // Sectors those calls read
+    DWORD   writes;         // Write calls that reached the image
+    DWORD   sectorsWritten; // Sectors those calls wrote
+    DWORD   polls;          // MDD_FILEIMG_SectorReadIsComplete calls
+} MDD_FILEIMG_STATS;
+
+
+// Attach an image: sectors == 0 opens an existing file, anything else
+// creates (or truncates) one that many sectors long.  Returns TRUE on success.
+BYTE MDD_FILEIMG_Open(const char * path, DWORD sectors, BYTE readOnly);
+void MDD_FILEIMG_Close(void);
+
+void MDD_FILEIMG_InitIO(void);
+BYTE MDD_FILEIMG_MediaDetect(void);
+MEDIA_INFORMATION * MDD_FILEIMG_MediaInitialize(void);
+BYTE MDD_FILEIMG_ShutdownMedia(void);
+BYTE MDD_FILEIMG_SectorRead(DWORD sector_addr, BYTE* buffer);
+BYTE MDD_FILEIMG_SectorWrite(DWORD sector_addr, BYTE* buffer, BYTE allowWriteToZero);
+BYTE MDD_FILEIMG_SectorReadMulti(DWORD sector_addr, DWORD sectorCount, BYTE* buffer);
+BYTE MDD_FILEIMG_SectorWriteMulti(DWORD sector_addr, DWORD sectorCount, BYTE* buffer, BYTE allowWriteToZero);
+BYTE MDD_FILEIMG_SectorReadStart(DWORD sector_addr, WORD sectorCount, BYTE* buffer);
+BYTE MDD_FILEIMG_SectorReadIsComplete(BYTE* success);
+BYTE MDD_FILEIMG_WriteProtectState(void);
+DWORD MDD_FILEIMG_ReadCapacity(void);
+
+// Split-phase reads finish after this many polls (0, the default, finishes
+// them at the first), so code that overlaps reads sees them in flight.
+void MDD_FILEIMG_SetReadLatency(WORD polls);
+
+// Called with each write as it reaches the image (NULL for none), so a
+// test can see which sectors were written and in what order.
+void MDD_FILEIMG_SetWriteHook(void (*hook)(DWORD sector_addr, DWORD sectorCount));
+void MDD_FILEIMG_GetStats(MDD_FILEIMG_STATS * stats);
+void MDD_FILEIMG_ClearStats(void);
+
+#endif
@@ -109,6 +109,11 @@ size_t ChipKITMDDFS::fwrite(const void *ptr, size_t size, size_t n, FSFILE *stre
     return(FSfwrite(ptr, size, n, stream));
 }
 
+int ChipKITMDDFS::fpreallocate(FSFILE *stream, unsigned long size)
+{
+    return(FSfpreallocate(stream, size));
+}
+
 int ChipKITMDDFS::chdir(char * path)
 {
     return(FSchdir(path));
@@ -159,6 +164,36 @@ void ChipKITMDDFS::GetDiskProperties(FS_DISK_PROPERTIES* properties)
    FSGetDiskProperties(properties);
 }
 
+int ChipKITMDDFS::CacheFlush(void)
+{
+    return(FSCacheFlush());
+}
+
+void ChipKITMDDFS::GetCacheStats(FS_CACHE_STATS * fatStats, FS_CACHE_STATS * dataStats)
+{
+    FSGetCacheStats(fatStats, dataStats);
+}
+
+int ChipKITMDDFS::ReadAheadBegin(FS_READAHEAD * ra, FSFILE * stream, unsigned char * ring, unsigned int ringSectors)
+{
+    return(FSReadAheadBegin(ra, stream, ring, ringSectors));
+}
+
+size_t ChipKITMDDFS::ReadAheadRead(FS_READAHEAD * ra, void * ptr, size_t len)
+{
+    return(FSReadAheadRead(ra, ptr, len));
+}
+
+void ChipKITMDDFS::ReadAheadTasks(FS_READAHEAD * ra)
+{
+    FSReadAheadTasks(ra);
+}
+
+int ChipKITMDDFS::ReadAheadEnd(FS_READAHEAD * ra)
+{
+    return(FSReadAheadEnd(ra));
+}
+
 //******************************************************************************
 //******************************************************************************
 // Instantiate the ChipKITMDDFS Class
@@ -73,6 +73,7 @@
         int rename(const char * fileName, FSFILE * fo);
         int remove(const char * fileName);
         size_t fwrite(const void *ptr, size_t size, size_t n, FSFILE *stream);
+        int fpreallocate(FSFILE *stream, unsigned long size);
         int chdir(char * path);
         char * getcwd(char * path, int numbchars);
         int mkdir(char * path);
@@ -83,6 +84,12 @@
         int error(void);
         int CreateMBR(unsigned long firstSector, unsigned long numSectors);
         void GetDiskProperties(FS_DISK_PROPERTIES* properties);
+        int CacheFlush(void);
+        void GetCacheStats(FS_CACHE_STATS * fatStats, FS_CACHE_STATS * dataStats);
+        int ReadAheadBegin(FS_READAHEAD * ra, FSFILE * stream, unsigned char * ring, unsigned int ringSectors);
+        size_t ReadAheadRead(FS_READAHEAD * ra, void * ptr, size_t len);
+        void ReadAheadTasks(FS_READAHEAD * ra);
+        int ReadAheadEnd(FS_READAHEAD * ra);
     };
 
 // pre-instantiated class for sketches
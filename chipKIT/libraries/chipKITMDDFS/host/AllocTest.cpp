@@ -0,0 +1,387 @@
+/******************************************************************************
+ *
+ *               Microchip Memory Disk Drive File System
+ *
+ ******************************************************************************
+ * FileName:        AllocTest.cpp
+ * Dependencies:    TestImage.cpp, libmddfs.a
+ * Processor:       Host (Linux)
+ * Compiler:        gcc
+ *
+ * Checks cluster allocation on a FAT32 image full of holes: new files
+ * fill the holes without two files sharing a cluster, FSfpreallocate gets
+ * a big file one run, FSfclose gives back what wasn't written, and a
+ * write that fills the disk returns what it did write and keeps it.
+ *
+ *   AllocTest           run the checks
+ *   AllocTest bench     count the media reads for writing 300 files of
+ *                       48000 bytes on a fragmented FAT16 image, then
+ *                       on a fragmented FAT32 one
+ *
+ * AllocTest0 is the same built with FS_FREE_RUNS 0, which searches the
+ * FAT entry by entry for every cluster as FATfindEmptyCluster() used to:
+ * its bench is the baseline for AllocTest's.
+ *
+*****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "TestImage.h"
+
+#define IMAGE           "AllocTest.img"
+#define MAX_CLUSTERS    16384
+
+static BYTE buffer[3ul * 1024ul * 1024ul];
+static DWORD clusters[MAX_CLUSTERS];
+static DWORD allClusters[MAX_CLUSTERS * 4];
+static DWORD allCount;
+
+static DWORD ClusterSize (void)
+{
+    return gDiskData.SecPerClus * MEDIA_SECTOR_SIZE;
+}
+
+static DWORD FreeClusters (void)
+{
+    FS_DISK_PROPERTIES properties;
+
+    properties.new_request = TRUE;
+    do
+    {
+        FSGetDiskProperties (&properties);
+    } while (properties.properties_status == FS_GET_PROPERTIES_STILL_WORKING);
+    CHECK (properties.properties_status == FS_GET_PROPERTIES_NO_ERRORS);
+
+    return properties.results.free_clusters;
+}
+
+// The file's clusters in chain order, from seeking to the start of each
+static DWORD FileClusters (const char * name, DWORD * list)
+{
+    FSFILE * fo = FSfopen (name, FS_READ);
+    DWORD count;
+    DWORD n;
+
+    CHECK (fo != NULL);
+    if (fo == NULL)
+        return 0;
+    count = (fo->size + ClusterSize () - 1) / ClusterSize ();
+    if (count == 0)
+        count = 1;
+    CHECK (count <= MAX_CLUSTERS);
+    for (n = 0; n < count && n < MAX_CLUSTERS; n++)
+    {
+        CHECK (FSfseek (fo, n * ClusterSize (), SEEK_SET) == 0);
+        list[n] = fo->ccls;
+    }
+    FSfclose (fo);
+    return n;
+}
+
+static DWORD Runs (const DWORD * list, DWORD count)
+{
+    DWORD runs = (count != 0);
+    DWORD i;
+
+    for (i = 1; i < count; i++)
+        if (list[i] != list[i - 1] + 1)
+            runs++;
+    return runs;
+}
+
+// Add a file's clusters to the set that mustn't overlap
+static void Claim (const char * name)
+{
+    DWORD count = FileClusters (name, clusters);
+
+    CHECK (allCount + count <= sizeof (allClusters) / sizeof (allClusters[0]));
+    if (allCount + count <= sizeof (allClusters) / sizeof (allClusters[0]))
+    {
+        memcpy (allClusters + allCount, clusters, count * sizeof (DWORD));
+        allCount += count;
+    }
+}
+
+static int CompareDWORD (const void * a, const void * b)
+{
+    DWORD x = *(const DWORD *) a;
+    DWORD y = *(const DWORD *) b;
+
+    return (x > y) - (x < y);
+}
+
+static void CheckNoneShared (void)
+{
+    DWORD i;
+
+    qsort (allClusters, allCount, sizeof (DWORD), CompareDWORD);
+    for (i = 1; i < allCount; i++)
+        CHECK (allClusters[i] != allClusters[i - 1]);
+    allCount = 0;
+}
+
+// n files of 1 to 6 clusters, then every other one removed
+static void MakeHoles (const char * dir, unsigned n)
+{
+    char name[13];
+    unsigned i;
+
+    CHECK (FSmkdir ((char *) dir) == 0);
+    CHECK (FSchdir ((char *) dir) == 0);
+    for (i = 0; i < n; i++)
+    {
+        sprintf (name, "H%05u.DAT", i);
+        CHECK (TestWriteFile (name, i, (1 + i % 6) * ClusterSize () - i % 7, 4096));
+    }
+    for (i = 0; i < n; i += 2)
+    {
+        sprintf (name, "H%05u.DAT", i);
+        CHECK (FSremove (name) == 0);
+    }
+    CHECK (FSchdir ((char *) "\\") == 0);
+}
+
+static void TestHoles (void)
+{
+    char name[13];
+    unsigned i;
+    DWORD size;
+
+    MakeHoles ("HOLES", 400);
+
+    // new files, written in pieces, go into the holes
+    for (i = 0; i < 40; i++)
+    {
+        sprintf (name, "F%02u.DAT", i);
+        size = 1000 + i * 2777;
+        CHECK (TestWriteFile (name, 100 + i, size, 1000 + i * 100));
+    }
+
+    // nothing shared, with each other or what was left around the holes
+    CHECK (FSchdir ((char *) "HOLES") == 0);
+    for (i = 1; i < 400; i += 2)
+    {
+        sprintf (name, "H%05u.DAT", i);
+        CHECK (TestFileMatches (name, i, (1 + i % 6) * ClusterSize () - i % 7));
+        Claim (name);
+    }
+    CHECK (FSchdir ((char *) "\\") == 0);
+    for (i = 0; i < 40; i++)
+    {
+        sprintf (name, "F%02u.DAT", i);
+        CHECK (TestFileMatches (name, 100 + i, 1000 + i * 2777));
+        Claim (name);
+    }
+    CheckNoneShared ();
+}
+
+static void TestPreallocate (void)
+{
+    FSFILE * fo;
+    DWORD size = sizeof (buffer);
+    DWORD count;
+    DWORD free0;
+    DWORD written;
+
+    // a 3 MB file reserved up front is one run, holes or not
+    fo = FSfopen ("PRE.DAT", FS_WRITE);
+    CHECK (fo != NULL);
+    if (fo == NULL)
+        return;
+    CHECK (FSfpreallocate (fo, size) == 0);
+    CHECK (fo->size == 0 && FSftell (fo) == 0);
+    TestFill (buffer, 200, 0, size);
+    CHECK (FSfwrite (buffer, 1, size, fo) == size);
+    CHECK (FSfclose (fo) == 0);
+    CHECK (TestFileMatches ("PRE.DAT", 200, size));
+    count = FileClusters ("PRE.DAT", clusters);
+    CHECK (count == size / ClusterSize ());
+    CHECK (Runs (clusters, count) == 1);
+
+    // reserve 1 MB, write a little over 100 KB, and FSfclose gives the
+    // rest back: the free count drops by just what the file holds
+    free0 = FreeClusters ();
+    written = 100000;
+    fo = FSfopen ("PART.DAT", FS_WRITE);
+    CHECK (fo != NULL);
+    if (fo == NULL)
+        return;
+    CHECK (FSfpreallocate (fo, 1024ul * 1024ul) == 0);
+    TestFill (buffer, 201, 0, written);
+    CHECK (FSfwrite (buffer, 1, written, fo) == written);
+    CHECK (FSfclose (fo) == 0);
+    CHECK (TestFileMatches ("PART.DAT", 201, written));
+    CHECK (FreeClusters () == free0 - (written + ClusterSize () - 1) / ClusterSize ());
+
+    // the same ending on a cluster, and reserving less than is written
+    free0 = FreeClusters ();
+    written = 40 * ClusterSize ();
+    fo = FSfopen ("EVEN.DAT", FS_WRITE);
+    CHECK (fo != NULL);
+    if (fo == NULL)
+        return;
+    CHECK (FSfpreallocate (fo, written / 2) == 0);
+    TestFill (buffer, 202, 0, written);
+    CHECK (FSfwrite (buffer, 1, written, fo) == written);
+    CHECK (FSfclose (fo) == 0);
+    CHECK (TestFileMatches ("EVEN.DAT", 202, written));
+    CHECK (FreeClusters () == free0 - written / ClusterSize ());
+
+    // and none of it overlaps
+    Claim ("PRE.DAT");
+    Claim ("PART.DAT");
+    Claim ("EVEN.DAT");
+    Claim ("F00.DAT");
+    Claim ("F39.DAT");
+    CheckNoneShared ();
+}
+
+static void TestDiskFull (void)
+{
+    FSFILE * hog;
+    FSFILE * fo;
+    DWORD free0;
+    DWORD left = 10;
+    DWORD want;
+    DWORD got;
+
+    // reserve all but a few clusters with FSfpreallocate, which only
+    // writes the FAT
+    free0 = FreeClusters ();
+    hog = FSfopen ("HOG.DAT", FS_WRITE);
+    CHECK (hog != NULL);
+    if (hog == NULL)
+        return;
+    CHECK (FSfpreallocate (hog, (free0 - left) * ClusterSize ()) == 0);
+    CHECK (FSfclose (hog) == 0);
+    CHECK (FreeClusters () == free0 - 1);
+
+    hog = FSfopen ("HOG.DAT", FS_APPEND);
+    CHECK (hog != NULL);
+    if (hog == NULL)
+        return;
+    CHECK (FSfpreallocate (hog, (free0 - left) * ClusterSize ()) == 0);
+    CHECK (FreeClusters () == left);
+
+    // the disk fills part way through one FSfwrite (a new file's first
+    // cluster is taken by its first write): it returns what it wrote, and
+    // the file keeps it
+    fo = FSfopen ("FULL.DAT", FS_WRITE);
+    CHECK (fo != NULL);
+    if (fo == NULL)
+        return;
+    want = (left + 5) * ClusterSize ();
+    TestFill (buffer, 300, 0, want);
+    got = FSfwrite (buffer, 1, want, fo);
+    CHECK (FSerror () == CE_DISK_FULL);
+    CHECK (got == left * ClusterSize ());
+    CHECK (fo->size == got && FSftell (fo) == (long) got);
+
+    // a reservation that can't be met keeps what it got
+    CHECK (FSfpreallocate (hog, (free0 + 100) * ClusterSize ()) != 0);
+    CHECK (FSerror () == CE_DISK_FULL);
+
+    CHECK (FSfclose (fo) == 0);
+    CHECK (TestFileMatches ("FULL.DAT", 300, got));
+
+    // closing the hog with nothing written gives all of it back
+    CHECK (FSfclose (hog) == 0);
+    CHECK (FreeClusters () == free0 - 1 - left);
+    CHECK (FSremove ("HOG.DAT") == 0);
+    CHECK (FSremove ("FULL.DAT") == 0);
+    CHECK (FreeClusters () == free0);
+
+    // and the space is there to use
+    CHECK (TestWriteFile ("AFTER.DAT", 301, 1000000, 30000));
+    CHECK (TestFileMatches ("AFTER.DAT", 301, 1000000));
+}
+
+static void Bench (DWORD sectors)
+{
+    MDD_FILEIMG_STATS stats;
+    FSFILE * fo;
+    char name[13];
+    char dir[8];
+    unsigned pass;
+    unsigned i;
+    double t0, t;
+
+    CHECK (TestImageFormat (IMAGE, sectors));
+    for (i = 0; i < 6; i++)
+    {
+        sprintf (dir, "FILL%u", i);
+        MakeHoles (dir, 250);
+    }
+
+    printf ("%lu byte clusters, FAT%d, %lu clusters free, %u free runs kept\n",
+            (unsigned long) ClusterSize (), TestDiskType () == FAT32 ? 32 : 16,
+            (unsigned long) FreeClusters (), (unsigned) FS_FREE_RUNS);
+    printf ("%-14s %6s %8s %8s %9s %6s\n", "300 x 48000", "files", "reads", "writes", "ms", "runs");
+
+    TestFill (buffer, 400, 0, 48000);
+    for (pass = 0; pass < 2; pass++)
+    {
+        sprintf (dir, "SEG%u", pass);
+        CHECK (FSmkdir (dir) == 0);
+        CHECK (FSchdir (dir) == 0);
+
+        CHECK (TestImageMount (NULL));
+        CHECK (FSchdir (dir) == 0);
+        MDD_FILEIMG_ClearStats ();
+        t0 = TestSeconds ();
+        for (i = 0; i < 300; i++)
+        {
+            sprintf (name, "S%04u.DAT", i);
+            fo = FSfopen (name, FS_WRITE);
+            CHECK (fo != NULL);
+            if (fo == NULL)
+                break;
+            if (pass == 1)
+                CHECK (FSfpreallocate (fo, 48000) == 0);
+            CHECK (FSfwrite (buffer, 1, 48000, fo) == 48000);
+            CHECK (FSfclose (fo) == 0);
+        }
+        t = TestSeconds () - t0;
+        MDD_FILEIMG_GetStats (&stats);
+
+        allCount = 0;
+        for (i = 0; i < 300; i += 50)
+        {
+            sprintf (name, "S%04u.DAT", i);
+            allCount += Runs (clusters, FileClusters (name, clusters));
+        }
+        printf ("%-14s %6u %8lu %8lu %9.2f %6.1f\n", pass ? "preallocated" : "FSfwrite", i,
+                (unsigned long) stats.reads, (unsigned long) stats.writes, t * 1e3, allCount / 6.0);
+        allCount = 0;
+        CHECK (FSchdir ((char *) "\\") == 0);
+    }
+}
+
+int main (int argc, char ** argv)
+{
+    srand (1);
+
+    if (argc > 1 && !strcmp (argv[1], "bench"))
+    {
+        Bench (TEST_FAT16_SECTORS);
+        Bench (TEST_FAT32_SECTORS);
+    }
+    else
+    {
+        CHECK (TestImageFormat (IMAGE, TEST_FAT32_SECTORS));
+        CHECK (TestDiskType () == FAT32);
+        TestHoles ();
+        TestPreallocate ();
+        TestDiskFull ();
+    }
+
+    MDD_FILEIMG_Close ();
+    unlink (IMAGE);
+#if FS_FREE_RUNS > 0
+    return TestResult ("AllocTest");
+#else
+    return TestResult ("AllocTest0");
+#endif
+}
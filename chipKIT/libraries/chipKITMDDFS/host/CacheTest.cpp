@@ -0,0 +1,220 @@
+/******************************************************************************
+ *
+ *               Microchip Memory Disk Drive File System
+ *
+ ******************************************************************************
+ * FileName:        CacheTest.cpp
+ * Dependencies:    TestImage.cpp, libmddfs.a
+ * Processor:       Host (Linux)
+ * Compiler:        gcc
+ *
+ * Checks the sector cache against the writes that reach the image:
+ * FSfwrite's sectors are held until FSCacheFlush or FSfclose, the file's
+ * data is on the image before the FAT that links it in, the second FAT
+ * copy is written once with the first rather than on every FAT update,
+ * and the image holds the file after FSfclose.  The makefile builds it a
+ * second time as CacheTest0, against an FSIO.cpp with both pools at 0,
+ * where every write has to go straight through and nothing is a hit.
+ *
+*****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "TestImage.h"
+
+#define CACHED      (FS_DATA_CACHE_SECTORS > 0 && FS_FAT_CACHE_SECTORS > 0)
+
+#define IMAGE       "CacheTest.img"
+#define FILE_SIZE   (20ul * 1024ul + 100ul)
+
+static DWORD writeLog[20000];
+static DWORD writeCount;
+
+static BYTE buffer[FILE_SIZE];
+
+static void LogWrite (DWORD sector, DWORD count)
+{
+    while (count-- && writeCount < sizeof (writeLog) / sizeof (writeLog[0]))
+        writeLog[writeCount++] = sector++;
+}
+
+// 1 for a sector of the first FAT, 2 and up for the copies, else 0
+static unsigned FATCopy (DWORD sector)
+{
+    if (sector < gDiskData.fat || sector >= gDiskData.fat + gDiskData.fatsize * gDiskData.fatcopy)
+        return 0;
+    return 1 + (sector - gDiskData.fat) / gDiskData.fatsize;
+}
+
+static DWORD FirstSector (DWORD cluster)
+{
+    return gDiskData.data + (cluster - 2) * gDiskData.SecPerClus;
+}
+
+// Whether the image holds the pattern in count sectors from the file's start
+static int ImageMatches (DWORD first, DWORD seed, DWORD count)
+{
+    BYTE sector[MEDIA_SECTOR_SIZE];
+    DWORD i;
+
+    for (i = 0; i < count; i++)
+    {
+        if (!MDD_FILEIMG_SectorRead (first + i, sector)
+                || !TestMatches (sector, seed, i * MEDIA_SECTOR_SIZE, MEDIA_SECTOR_SIZE))
+            return 0;
+    }
+    return 1;
+}
+
+static void TestWrites (void)
+{
+    FS_CACHE_STATS fat0, data0, fat, data;
+    FSFILE * fo;
+    DWORD first;
+    DWORD i;
+    DWORD lastData;
+    DWORD firstFAT;
+    DWORD copies[4];
+    BYTE a[MEDIA_SECTOR_SIZE], b[MEDIA_SECTOR_SIZE];
+
+    fo = FSfopen ("CACHE.DAT", FS_WRITE);
+    CHECK (fo != NULL);
+    if (fo == NULL)
+        return;
+    FSGetCacheStats (&fat0, &data0);
+    TestFill (buffer, 5, 0, FILE_SIZE);
+    writeCount = 0;
+
+    // three sectors: the first two are handed to the cache, the third
+    // waits in the file's sector buffer
+    CHECK (FSfwrite (buffer, 1, 3 * MEDIA_SECTOR_SIZE, fo) == 3 * MEDIA_SECTOR_SIZE);
+    first = FirstSector (fo->cluster);
+    FSGetCacheStats (&fat, &data);
+#if CACHED
+    CHECK (writeCount == 0);
+    CHECK (!ImageMatches (first, 5, 1));
+#else
+    CHECK (writeCount >= 2);
+    CHECK (ImageMatches (first, 5, 2));
+#endif
+
+    // a flush puts them on the image with the file still open
+    CHECK (FSCacheFlush () == 0);
+    FSGetCacheStats (&fat, &data);
+    CHECK (ImageMatches (first, 5, 2));
+#if CACHED
+    CHECK (data.writeBacks - data0.writeBacks == 2);
+#else
+    CHECK (data.writeBacks == 0 && fat.writeBacks == 0);
+#endif
+
+    // the rest, more than the data pool holds, then close
+    writeCount = 0;
+    CHECK (FSfwrite (buffer + 3 * MEDIA_SECTOR_SIZE, 1, FILE_SIZE - 3 * MEDIA_SECTOR_SIZE, fo)
+            == FILE_SIZE - 3 * MEDIA_SECTOR_SIZE);
+    CHECK (FSfclose (fo) == 0);
+
+    // the file was made on an empty image, so it is in one run
+    CHECK (ImageMatches (first, 5, FILE_SIZE / MEDIA_SECTOR_SIZE));
+
+    // every sector of the file reached the image before the FAT did
+    lastData = 0;
+    firstFAT = writeCount;
+    memset (copies, 0, sizeof (copies));
+    for (i = 0; i < writeCount; i++)
+    {
+        if (writeLog[i] >= first && writeLog[i] < first + (FILE_SIZE + MEDIA_SECTOR_SIZE - 1) / MEDIA_SECTOR_SIZE)
+            lastData = i;
+        if (FATCopy (writeLog[i]) != 0 && i < firstFAT)
+            firstFAT = i;
+        if (FATCopy (writeLog[i]) <= 4 && FATCopy (writeLog[i]) > 0)
+            copies[FATCopy (writeLog[i]) - 1]++;
+    }
+    CHECK (firstFAT < writeCount && lastData < firstFAT);
+
+    // each copy of the FAT was written as often as the first, no more:
+    // the file system writes the copies itself, and the cache absorbs
+    // those while the first copy's line is waiting to be written back
+    CHECK (gDiskData.fatcopy == 2);
+    CHECK (copies[0] > 0 && copies[1] == copies[0]);
+#if CACHED
+    // all the FAT updates for the file fit one sector, written back once
+    CHECK (copies[0] == 1);
+#endif
+
+    // and the copies agree
+    for (i = 0; i < gDiskData.fatsize; i++)
+    {
+        CHECK (MDD_FILEIMG_SectorRead (gDiskData.fat + i, a));
+        CHECK (MDD_FILEIMG_SectorRead (gDiskData.fat + gDiskData.fatsize + i, b));
+        CHECK (memcmp (a, b, sizeof (a)) == 0);
+    }
+
+    // all of it reads back from a fresh mount, with nothing in the cache
+    CHECK (TestImageMount (NULL));
+    CHECK (TestFileMatches ("CACHE.DAT", 5, FILE_SIZE));
+}
+
+static void TestReads (void)
+{
+    FS_CACHE_STATS fat0, data0, fat, data;
+    MDD_FILEIMG_STATS first, again;
+    FSFILE * fo;
+    unsigned n;
+
+    CHECK (TestImageMount (NULL));
+    FSGetCacheStats (&fat0, &data0);
+
+    // the first open reads the directory and the FAT from the image
+    MDD_FILEIMG_ClearStats ();
+    fo = FSfopen ("CACHE.DAT", FS_READ);
+    CHECK (fo != NULL);
+    if (fo == NULL)
+        return;
+    CHECK (FSfseek (fo, 0, SEEK_END) == 0);
+    FSfclose (fo);
+    MDD_FILEIMG_GetStats (&first);
+
+    // opening it again finds them in the cache
+    MDD_FILEIMG_ClearStats ();
+    for (n = 0; n < 10; n++)
+    {
+        fo = FSfopen ("CACHE.DAT", FS_READ);
+        CHECK (fo != NULL);
+        if (fo == NULL)
+            return;
+        CHECK (FSfseek (fo, 0, SEEK_END) == 0);
+        FSfclose (fo);
+    }
+    MDD_FILEIMG_GetStats (&again);
+    FSGetCacheStats (&fat, &data);
+    CHECK (first.reads > 0);
+#if CACHED
+    CHECK (again.reads == 0);
+    CHECK (data.hits > data0.hits);
+#else
+    CHECK (again.reads >= 10);
+    CHECK (data.hits == 0 && fat.hits == 0);
+    CHECK (data.misses > data0.misses && fat.misses > fat0.misses);
+#endif
+}
+
+int main (void)
+{
+    CHECK (TestImageFormat (IMAGE, TEST_FAT16_SECTORS));
+    MDD_FILEIMG_SetWriteHook (LogWrite);
+
+    TestWrites ();
+    TestReads ();
+
+    MDD_FILEIMG_SetWriteHook (NULL);
+    MDD_FILEIMG_Close ();
+    unlink (IMAGE);
+
+#if CACHED
+    return TestResult ("CacheTest");
+#else
+    return TestResult ("CacheTest0");
+#endif
+}
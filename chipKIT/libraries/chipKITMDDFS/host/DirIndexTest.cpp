@@ -0,0 +1,344 @@
+/******************************************************************************
+ *
+ *               Microchip Memory Disk Drive File System
+ *
+ ******************************************************************************
+ * FileName:        DirIndexTest.cpp
+ * Dependencies:    TestImage.cpp, libmddfs.a
+ * Processor:       Host (Linux)
+ * Compiler:        gcc
+ *
+ * Opens files by name in synthetic folders: 380 clips in one folder,
+ * names that aren't there, a folder too big for the directory index, and
+ * two folders that don't fit in it together, checking each open finds the
+ * right file, and that creating, renaming or removing a file drops the
+ * index so it never answers from an old copy of the folder.  The makefile
+ * builds it a second time as DirIndexTest0, with the index turned off.
+ *
+ *   DirIndexTest            run the checks
+ *   DirIndexTest bench      count the media reads for the lookups
+ *
+*****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "TestImage.h"
+
+#define IMAGE       "DirIndexTest.img"
+
+#if FS_DIR_INDEX_SIZE > 0
+// The index, in FSIO.cpp
+extern DWORD gDirIndexCluster[];
+extern BYTE gDirIndexDirs;
+extern WORD gDirIndexNames;
+extern DWORD gDirIndexTooBig[];
+extern DWORD gDirIndexPassed;
+
+static BOOL Indexed (DWORD dirclus)
+{
+    BYTE d;
+
+    for (d = 0; d < gDirIndexDirs; d++)
+    {
+        if (gDirIndexCluster[d] == dirclus)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+static BOOL TooBig (DWORD dirclus)
+{
+    BYTE d;
+
+    for (d = 0; d < 4; d++)
+    {
+        if (gDirIndexTooBig[d] == dirclus)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+#define INDEXED(c)          CHECK (Indexed (c))
+#define NOT_INDEXED(c)      CHECK (!Indexed (c))
+#define DROPPED()           CHECK (gDirIndexDirs == 0)
+#else
+#define INDEXED(c)
+#define NOT_INDEXED(c)
+#define DROPPED()
+#endif
+
+static void Name (char * name, char prefix, unsigned i)
+{
+    sprintf (name, "%c%04u.ECA", prefix, i);
+}
+
+// A folder of n small files, each holding its own number
+static void MakeFolder (const char * dir, char prefix, unsigned n)
+{
+    char name[13];
+    unsigned i;
+
+    CHECK (FSmkdir ((char *) dir) == 0);
+    CHECK (FSchdir ((char *) dir) == 0);
+    for (i = 0; i < n; i++)
+    {
+        Name (name, prefix, i);
+        CHECK (TestWriteFile (name, i, 16, 16));
+    }
+    CHECK (FSchdir ((char *) "\\") == 0);
+}
+
+// Open a file by name, check it is the one asked for, and return the
+// first cluster of its folder (0 if it isn't there)
+static DWORD Open (char prefix, unsigned i)
+{
+    BYTE data[16];
+    char name[13];
+    FSFILE * fo;
+    DWORD dirclus;
+
+    Name (name, prefix, i);
+    fo = FSfopen (name, FS_READ);
+    if (fo == NULL)
+        return 0;
+    CHECK (FSfread (data, 1, sizeof (data), fo) == sizeof (data));
+    CHECK (TestMatches (data, i, 0, sizeof (data)));
+    dirclus = fo->dirclus;
+    FSfclose (fo);
+    return dirclus;
+}
+
+static void TestClips (void)
+{
+    char name[13];
+    FSFILE * fo;
+    DWORD clips;
+    unsigned n;
+
+    MakeFolder ("CLIPS", 'C', 380);
+    CHECK (FSchdir ((char *) "CLIPS") == 0);
+
+    // the first lookup indexes the folder, the 380 clips and . and ..,
+    // next to the root with CLIPS in it (FSchdir matches on the
+    // attributes, it doesn't use the index)
+    clips = Open ('C', 0);
+    CHECK (clips != 0);
+    INDEXED (clips);
+#if FS_DIR_INDEX_SIZE > 0
+    CHECK (gDirIndexDirs == 2 && gDirIndexNames == 383);
+#endif
+
+    for (n = 0; n < 3000; n++)
+        CHECK (Open ('C', rand () % 380) == clips);
+    for (n = 0; n < 500; n++)
+        CHECK (Open ('C', 380 + rand () % 9000) == 0);
+    CHECK (Open ('X', 1) == 0);
+    INDEXED (clips);
+
+    // a name that wasn't there is found once it is made
+    CHECK (Open ('C', 380) == 0);
+    CHECK (TestWriteFile ("C0380.ECA", 380, 16, 16));
+    DROPPED ();
+    CHECK (Open ('C', 380) == clips);
+    INDEXED (clips);
+    CHECK (Open ('C', 17) == clips);
+
+    // renamed: the old name is gone, the new one found
+    fo = FSfopen ("C0017.ECA", FS_READ);
+    CHECK (fo != NULL);
+    if (fo == NULL)
+        return;
+    CHECK (FSrename ("C0999.ECA", fo) == 0);
+    FSfclose (fo);
+    DROPPED ();
+    CHECK (Open ('C', 17) == 0);
+    fo = FSfopen ("C0999.ECA", FS_READ);
+    CHECK (fo != NULL);
+    if (fo != NULL)
+        FSfclose (fo);
+
+    // removed: not found, and the folder's other names still are
+    CHECK (Open ('C', 100) == clips);
+    CHECK (FSremove ("C0100.ECA") == 0);
+    DROPPED ();
+    CHECK (Open ('C', 100) == 0);
+    CHECK (Open ('C', 101) == clips);
+    CHECK (Open ('C', 99) == clips);
+
+    // and made again in the entry that was freed
+    CHECK (TestWriteFile ("C0100.ECA", 100, 16, 16));
+    CHECK (Open ('C', 100) == clips);
+
+    for (n = 0; n < 380; n++)
+    {
+        Name (name, 'C', n);
+        if (n != 17)
+            CHECK (Open ('C', n) == clips);
+    }
+    CHECK (FSchdir ((char *) "\\") == 0);
+}
+
+static void TestTooBig (void)
+{
+    DWORD big;
+    unsigned n;
+
+    // more names than fit in the whole index: searched entry by entry,
+    // and not indexed again on every lookup
+    MakeFolder ("BIG", 'B', 400);
+    CHECK (TestImageMount (NULL));
+    CHECK (FSchdir ((char *) "BIG") == 0);
+    big = Open ('B', 399);
+    CHECK (big != 0);
+    for (n = 1; n < 4; n++)
+        CHECK (Open ('B', n) == big);
+    NOT_INDEXED (big);
+#if FS_DIR_INDEX_SIZE > 0
+    CHECK (TooBig (big));
+#endif
+    for (n = 0; n < 200; n++)
+        CHECK (Open ('B', rand () % 400) == big);
+    CHECK (Open ('B', 400) == 0);
+    NOT_INDEXED (big);
+    CHECK (FSchdir ((char *) "\\") == 0);
+}
+
+static void TestTakeover (void)
+{
+    DWORD one, two, three;
+    unsigned n;
+
+    MakeFolder ("ONE", 'O', 200);
+    MakeFolder ("TWO", 'T', 200);
+    MakeFolder ("THREE", 'H', 50);
+    CHECK (TestImageMount (NULL));
+
+    CHECK (FSchdir ((char *) "ONE") == 0);
+    one = Open ('O', 0);
+    INDEXED (one);
+
+    // TWO doesn't fit next to ONE: it is searched entry by entry, until
+    // the fourth lookup in a row in it takes the index over
+    CHECK (FSchdir ((char *) "\\TWO") == 0);
+    two = Open ('T', 0);
+    CHECK (two != 0 && two != one);
+#if FS_DIR_INDEX_SIZE > 0
+    CHECK (gDirIndexPassed == two);
+#endif
+    INDEXED (one);
+    NOT_INDEXED (two);
+    CHECK (Open ('T', 1) == two);
+    CHECK (Open ('T', 2) == two);
+    INDEXED (one);
+    NOT_INDEXED (two);
+    CHECK (Open ('T', 3) == two);
+    INDEXED (two);
+    NOT_INDEXED (one);
+
+    // and back the same way
+    CHECK (FSchdir ((char *) "\\ONE") == 0);
+    for (n = 0; n < 3; n++)
+        CHECK (Open ('O', n) == one);
+    INDEXED (two);
+    NOT_INDEXED (one);
+    CHECK (Open ('O', 3) == one);
+    INDEXED (one);
+    NOT_INDEXED (two);
+
+    // a small folder fits next to either
+    CHECK (FSchdir ((char *) "\\THREE") == 0);
+    three = Open ('H', 7);
+    CHECK (three != 0);
+    INDEXED (three);
+    INDEXED (one);
+
+    // going back and forth finds the right files all along
+    for (n = 0; n < 1000; n++)
+    {
+        if (rand () & 1)
+        {
+            CHECK (FSchdir ((char *) "\\ONE") == 0);
+            CHECK (Open ('O', rand () % 200) == one);
+        }
+        else
+        {
+            CHECK (FSchdir ((char *) "\\TWO") == 0);
+            CHECK (Open ('T', rand () % 200) == two);
+        }
+        CHECK (Open ('H', 1) == 0);
+    }
+    CHECK (FSchdir ((char *) "\\") == 0);
+}
+
+static void Bench (void)
+{
+    MDD_FILEIMG_STATS stats;
+    unsigned n;
+
+    MakeFolder ("CLIPS", 'C', 380);
+    MakeFolder ("ONE", 'O', 200);
+    MakeFolder ("TWO", 'T', 200);
+
+    printf ("directory index of %d slots\n", FS_DIR_INDEX_SIZE);
+    printf ("%-38s %8s\n", "lookups", "reads");
+
+    CHECK (TestImageMount (NULL));
+    CHECK (FSchdir ((char *) "CLIPS") == 0);
+    MDD_FILEIMG_ClearStats ();
+    for (n = 0; n < 3000; n++)
+        CHECK (Open ('C', rand () % 380) != 0);
+    MDD_FILEIMG_GetStats (&stats);
+    printf ("%-38s %8lu\n", "380 clips, 3000 opens", (unsigned long) stats.reads);
+
+    MDD_FILEIMG_ClearStats ();
+    for (n = 0; n < 500; n++)
+        CHECK (Open ('C', 380 + rand () % 9000) == 0);
+    MDD_FILEIMG_GetStats (&stats);
+    printf ("%-38s %8lu\n", "380 clips, 500 names not there", (unsigned long) stats.reads);
+
+    CHECK (TestImageMount (NULL));
+    MDD_FILEIMG_ClearStats ();
+    for (n = 0; n < 3000; n++)
+    {
+        if (rand () & 1)
+        {
+            CHECK (FSchdir ((char *) "\\ONE") == 0);
+            CHECK (Open ('O', rand () % 200) != 0);
+        }
+        else
+        {
+            CHECK (FSchdir ((char *) "\\TWO") == 0);
+            CHECK (Open ('T', rand () % 200) != 0);
+        }
+    }
+    MDD_FILEIMG_GetStats (&stats);
+    printf ("%-38s %8lu\n", "2 x 200 files, 3000 opens alternating", (unsigned long) stats.reads);
+}
+
+int main (int argc, char ** argv)
+{
+    srand (1);
+    CHECK (TestImageFormat (IMAGE, TEST_FAT16_SECTORS));
+
+    if (argc > 1 && !strcmp (argv[1], "bench"))
+    {
+        Bench ();
+    }
+    else
+    {
+        TestClips ();
+        TestTooBig ();
+        TestTakeover ();
+    }
+
+    MDD_FILEIMG_Close ();
+    unlink (IMAGE);
+
+#if FS_DIR_INDEX_SIZE > 0
+    return TestResult ("DirIndexTest");
+#else
+    return TestResult ("DirIndexTest0");
+#endif
+}
@@ -0,0 +1,307 @@
+/******************************************************************************
+ *
+ *               Microchip Memory Disk Drive File System
+ *
+ ******************************************************************************
+ * FileName:        FSTest.cpp
+ * Dependencies:    TestImage.cpp, libmddfs.a
+ * Processor:       Host (Linux)
+ * Compiler:        gcc
+ *
+ * Formats a FAT16 and a FAT32 image and round trips files through each:
+ * write and read back in odd sized pieces, random seeks, read-ahead,
+ * append, rename, remove and reuse of the space, and all of it again
+ * after mounting the image afresh.
+ *
+*****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "TestImage.h"
+
+typedef struct
+{
+    const char *    name;
+    DWORD           seed;
+    DWORD           size;
+} TEST_FILE;
+
+// sizes either side of a sector, a 1 KB cluster (FAT16) and a 512 byte
+// cluster (FAT32), and a few big enough to go through the FAT many times
+static TEST_FILE files[] =
+{
+    { "EMPTY.BIN",      1,  0 },
+    { "ONE.BIN",        2,  1 },
+    { "S511.BIN",       3,  511 },
+    { "S512.BIN",       4,  512 },
+    { "S513.BIN",       5,  513 },
+    { "C1024.BIN",      6,  1024 },
+    { "C1025.BIN",      7,  1025 },
+    { "MID.DAT",        8,  100003 },
+    { "BIG.DAT",        9,  1048576 + 777 },
+};
+
+#define FILE_COUNT      (sizeof (files) / sizeof (files[0]))
+
+static BYTE buffer[65536];
+
+static void TestWriteRead (void)
+{
+    unsigned i;
+
+    // written in pieces that don't line up with sectors
+    for (i = 0; i < FILE_COUNT; i++)
+        CHECK (TestWriteFile (files[i].name, files[i].seed, files[i].size, 700 + 1000 * i));
+    for (i = 0; i < FILE_COUNT; i++)
+        CHECK (TestFileMatches (files[i].name, files[i].seed, files[i].size));
+
+    // read in random sized pieces, small ones through the sector buffer
+    // and large ones straight into the caller's buffer
+    for (i = 0; i < FILE_COUNT; i++)
+    {
+        FSFILE * fo = FSfopen (files[i].name, FS_READ);
+        DWORD pos = 0;
+        size_t want;
+        size_t got;
+
+        CHECK (fo != NULL);
+        if (fo == NULL)
+            continue;
+        do
+        {
+            want = (rand () & 1) ? rand () % 64 : rand () % sizeof (buffer);
+            got = FSfread (buffer, 1, want, fo);
+            CHECK (got == ((files[i].size - pos < want) ? files[i].size - pos : want));
+            CHECK (TestMatches (buffer, files[i].seed, pos, got));
+            pos += got;
+        } while (got != 0 || (want == 0 && pos < files[i].size));
+        CHECK (pos == files[i].size);
+        CHECK (FSfeof (fo));
+        FSfclose (fo);
+    }
+}
+
+static void TestSeek (void)
+{
+    TEST_FILE * f = &files[FILE_COUNT - 1];
+    FSFILE * fo = FSfopen (f->name, FS_READ);
+    long pos;
+    long to;
+    unsigned n;
+    size_t got;
+    int whence;
+
+    CHECK (fo != NULL);
+    if (fo == NULL)
+        return;
+
+    for (n = 0; n < 2000; n++)
+    {
+        to = rand () % (f->size + 1);
+        whence = rand () % 3;
+        pos = FSftell (fo);
+        if (whence == SEEK_SET)
+            CHECK (FSfseek (fo, to, SEEK_SET) == 0);
+        else if (whence == SEEK_CUR)
+            CHECK (FSfseek (fo, to - pos, SEEK_CUR) == 0);
+        else
+            CHECK (FSfseek (fo, (long) f->size - to, SEEK_END) == 0);
+        CHECK (FSftell (fo) == to);
+
+        got = FSfread (buffer, 1, rand () % 3000, fo);
+        CHECK (TestMatches (buffer, f->seed, to, got));
+        CHECK (FSftell (fo) == (long) (to + got));
+    }
+
+    // past the end is an error and leaves the position alone
+    pos = FSftell (fo);
+    CHECK (FSfseek (fo, f->size + 1, SEEK_SET) != 0);
+    CHECK (FSftell (fo) == pos);
+
+    FSfclose (fo);
+}
+
+static void TestReadAhead (void)
+{
+    static BYTE ring[8 * MEDIA_SECTOR_SIZE];
+    TEST_FILE * f = &files[FILE_COUNT - 1];
+    FS_READAHEAD ra;
+    FSFILE * fo;
+    DWORD pos;
+    DWORD stop;
+    size_t got;
+    unsigned idle;
+
+    // reads complete a few polls after they start, as on the USB drive
+    MDD_FILEIMG_SetReadLatency (3);
+
+    // all of the file, from an odd place
+    fo = FSfopen (f->name, FS_READ);
+    CHECK (fo != NULL);
+    if (fo == NULL)
+        return;
+    pos = 1234;
+    CHECK (FSfseek (fo, pos, SEEK_SET) == 0);
+    CHECK (FSReadAheadBegin (&ra, fo, ring, 8) == 0);
+    for (idle = 0; pos < f->size && idle < 1000; )
+    {
+        got = FSReadAheadRead (&ra, buffer, 1 + rand () % 5000);
+        if (got == 0)
+        {
+            FSReadAheadTasks (&ra);
+            idle++;
+            continue;
+        }
+        CHECK (TestMatches (buffer, f->seed, pos, got));
+        pos += got;
+        idle = 0;
+    }
+    CHECK (pos == f->size);
+    CHECK (FSReadAheadRead (&ra, buffer, 1) == 0);
+    CHECK (FSerror () == CE_EOF);
+    CHECK (FSReadAheadEnd (&ra) == 0);
+    CHECK (FSReadAheadEnd (&ra) == 0);
+    FSfclose (fo);
+
+    // stopped part way, FSfread carries on after the last byte handed out
+    fo = FSfopen (f->name, FS_READ);
+    CHECK (fo != NULL);
+    if (fo == NULL)
+        return;
+    CHECK (FSReadAheadBegin (&ra, fo, ring, 8) == 0);
+    stop = 300000;
+    for (pos = 0, idle = 0; pos < stop && idle < 1000; )
+    {
+        got = FSReadAheadRead (&ra, buffer, (stop - pos < 3333) ? stop - pos : 3333);
+        if (got == 0)
+            idle++;
+        pos += got;
+    }
+    CHECK (pos == stop);
+    CHECK (FSReadAheadEnd (&ra) == 0);
+    CHECK (FSftell (fo) == (long) stop);
+    got = FSfread (buffer, 1, 5000, fo);
+    CHECK (got == 5000 && TestMatches (buffer, f->seed, stop, got));
+    FSfclose (fo);
+
+    MDD_FILEIMG_SetReadLatency (0);
+}
+
+static void TestAppend (void)
+{
+    FSFILE * fo;
+    DWORD size = 5000;
+    DWORD add;
+
+    CHECK (TestWriteFile ("APPEND.TXT", 42, size, 4096));
+    for (add = 1; add < 4000; add = add * 3 + 1)
+    {
+        fo = FSfopen ("APPEND.TXT", FS_APPEND);
+        CHECK (fo != NULL);
+        if (fo == NULL)
+            return;
+        CHECK (FSftell (fo) == (long) size);
+        TestFill (buffer, 42, size, add);
+        CHECK (FSfwrite (buffer, 1, add, fo) == add);
+        CHECK (FSfclose (fo) == 0);
+        size += add;
+    }
+    CHECK (TestFileMatches ("APPEND.TXT", 42, size));
+
+    // READ+ overwrites in the middle without changing the size
+    fo = FSfopen ("APPEND.TXT", FS_READPLUS);
+    CHECK (fo != NULL);
+    if (fo == NULL)
+        return;
+    CHECK (FSfseek (fo, 1000, SEEK_SET) == 0);
+    TestFill (buffer, 43, 0, 2000);
+    CHECK (FSfwrite (buffer, 1, 2000, fo) == 2000);
+    CHECK (FSfclose (fo) == 0);
+
+    fo = FSfopen ("APPEND.TXT", FS_READ);
+    CHECK (fo != NULL && fo->size == size);
+    if (fo == NULL)
+        return;
+    CHECK (FSfread (buffer, 1, size, fo) == size);
+    CHECK (TestMatches (buffer, 42, 0, 1000));
+    CHECK (TestMatches (buffer + 1000, 43, 0, 2000));
+    CHECK (TestMatches (buffer + 3000, 42, 3000, size - 3000));
+    FSfclose (fo);
+}
+
+static void TestRenameRemove (void)
+{
+    FSFILE * fo;
+    unsigned i;
+
+    // rename an open file, the old name is gone and the data moved with it
+    fo = FSfopen ("MID.DAT", FS_READ);
+    CHECK (fo != NULL);
+    if (fo == NULL)
+        return;
+    CHECK (FSrename ("RENAMED.DAT", fo) == 0);
+    FSfclose (fo);
+    CHECK (FSfopen ("MID.DAT", FS_READ) == NULL);
+    CHECK (TestFileMatches ("RENAMED.DAT", 8, 100003));
+    files[7].name = "RENAMED.DAT";
+
+    // a name that's taken can't be renamed to
+    fo = FSfopen ("ONE.BIN", FS_READ);
+    CHECK (fo != NULL);
+    if (fo == NULL)
+        return;
+    CHECK (FSrename ("S511.BIN", fo) != 0);
+    FSfclose (fo);
+    CHECK (TestFileMatches ("ONE.BIN", 2, 1));
+
+    // remove the big one and fill its space with a new file
+    CHECK (FSremove ("BIG.DAT") == 0);
+    CHECK (FSfopen ("BIG.DAT", FS_READ) == NULL);
+    CHECK (FSremove ("BIG.DAT") != 0);
+    CHECK (TestWriteFile ("REUSE.DAT", 77, 1048576 + 777, 8192));
+    files[8].name = "REUSE.DAT";
+    files[8].seed = 77;
+
+    // and the rest are untouched
+    for (i = 0; i < FILE_COUNT; i++)
+        CHECK (TestFileMatches (files[i].name, files[i].seed, files[i].size));
+}
+
+static void TestImage (const char * path, DWORD sectors, BYTE type)
+{
+    unsigned i;
+
+    CHECK (TestImageFormat (path, sectors));
+    CHECK (TestDiskType () == type);
+
+    TestWriteRead ();
+    TestSeek ();
+    TestReadAhead ();
+    TestAppend ();
+    TestRenameRemove ();
+
+    // everything again from a fresh mount
+    CHECK (TestImageMount (path));
+    for (i = 0; i < FILE_COUNT; i++)
+        CHECK (TestFileMatches (files[i].name, files[i].seed, files[i].size));
+    TestSeek ();
+
+    MDD_FILEIMG_Close ();
+    unlink (path);
+
+    files[7].name = "MID.DAT";
+    files[8].name = "BIG.DAT";
+    files[8].seed = 9;
+}
+
+int main (void)
+{
+    srand (1);
+
+    TestImage ("FSTest16.img", TEST_FAT16_SECTORS, FAT16);
+    TestImage ("FSTest32.img", TEST_FAT32_SECTORS, FAT32);
+
+    return TestResult ("FSTest");
+}
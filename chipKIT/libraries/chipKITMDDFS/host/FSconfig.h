@@ -0,0 +1,68 @@
+/******************************************************************************
+ *
+ *                Microchip Memory Disk Drive File System
+ *
+ ******************************************************************************
+ * FileName:        FSconfig.h
+ * Dependencies:    None
+ * Processor:       Host (Linux)
+ * Compiler:        gcc
+ *
+ * Configuration for building FSIO.cpp on a PC against the file image
+ * driver (FileImage.cpp).  The features and cache sizes follow the
+ * sketch's FSconfig.h, so counts measured here are the ones kelp sees;
+ * keep the two in step.  Any of the sizes can be overridden from the
+ * make command line, e.g. make CONFIG=-DFS_DATA_CACHE_SECTORS=8
+ *
+*****************************************************************************/
+
+
+#ifndef _FS_DEF_
+
+#define USE_FILE_IMAGE_INTERFACE
+
+#ifndef FS_MAX_FILES_OPEN
+#define FS_MAX_FILES_OPEN 		2
+#endif
+
+#ifndef MEDIA_SECTOR_SIZE
+#define MEDIA_SECTOR_SIZE 		512
+#endif
+
+#ifndef FS_DIR_INDEX_SIZE
+#define FS_DIR_INDEX_SIZE 		512
+#endif
+
+#define ALLOW_FILESEARCH
+#define ALLOW_WRITES
+#define ALLOW_FORMATS
+#define ALLOW_DIRS
+#define ALLOW_FSFPRINTF
+#define SUPPORT_FAT32
+#define ALLOW_GET_DISK_PROPERTIES
+
+// Timestamps come from SetClockVars, as on the PIC32
+#define USERDEFINEDCLOCK
+
+
+// Associate the physical layer functions with the file image driver
+#define MDD_MediaInitialize     MDD_FILEIMG_MediaInitialize
+#define MDD_MediaDetect         MDD_FILEIMG_MediaDetect
+#define MDD_SectorRead          MDD_FILEIMG_SectorRead
+#define MDD_SectorWrite         MDD_FILEIMG_SectorWrite
+#define MDD_InitIO              MDD_FILEIMG_InitIO
+#define MDD_ShutdownMedia       MDD_FILEIMG_ShutdownMedia
+#define MDD_WriteProtectState   MDD_FILEIMG_WriteProtectState
+
+// The USB MSD driver has these, build with NO_MULTI=1 or NO_SPLIT=1 to
+// measure the file system without them
+#ifndef FILEIMG_NO_MULTI
+    #define MDD_SectorReadMulti     MDD_FILEIMG_SectorReadMulti
+    #define MDD_SectorWriteMulti    MDD_FILEIMG_SectorWriteMulti
+#endif
+#ifndef FILEIMG_NO_SPLIT
+    #define MDD_SectorReadStart     MDD_FILEIMG_SectorReadStart
+    #define MDD_SectorReadIsComplete    MDD_FILEIMG_SectorReadIsComplete
+#endif
+
+#endif
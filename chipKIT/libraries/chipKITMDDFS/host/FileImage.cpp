@@ -0,0 +1,358 @@
+/******************************************************************************
+ *
+ *               Microchip Memory Disk Drive File System
+ *
+ ******************************************************************************
+ * FileName:        FileImage.cpp
+ * Dependencies:    File Image.h
+ * Processor:       Host (Linux)
+ * Compiler:        gcc
+ *
+ * Physical layer backed by a disk image file.  Sector n of the media is
+ * bytes n*MEDIA_SECTOR_SIZE.. of the file, so the image is a whole disk
+ * (MBR first) that can be loop mounted or written to a thumb drive.
+ *
+*****************************************************************************/
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "MDD File System/File Image.h"
+
+static int imageFd = -1;
+static BYTE imageReadOnly;
+static MEDIA_INFORMATION mediaInformation;
+static MDD_FILEIMG_STATS imageStats;
+
+// split-phase read in flight
+static BYTE readPending;
+static DWORD readSector;
+static WORD readCount;
+static BYTE * readBuffer;
+static WORD readPolls;
+static WORD readLatency;
+static BYTE readSuccess;
+
+static void (*writeHook) (DWORD sector_addr, DWORD sectorCount);
+
+
+/*****************************************************************************
+  Function:
+    BYTE MDD_FILEIMG_Open (const char * path, DWORD sectors, BYTE readOnly)
+  Summary:
+    Attach a disk image file as the media
+  Conditions:
+    None
+  Input:
+    path -      Name of the image file
+    sectors -   0 to open an existing image, else the size of a new image
+    readOnly -  TRUE to refuse writes, as if the write protect tab were set
+  Return Values:
+    TRUE -  The image is attached
+    FALSE - The file couldn't be opened or created
+  Side Effects:
+    Any image attached before is closed.  A new image is sparse, it reads
+    as zeros until written.
+  Description:
+    The file system reads and writes the image through the MDD functions
+    below once FSconfig.h maps them (see host/FSconfig.h).  Call this before
+    FSInit, or FSCreateMBR and FSformat for a new image.
+  Remarks:
+    None
+  *****************************************************************************/
+
+BYTE MDD_FILEIMG_Open (const char * path, DWORD sectors, BYTE readOnly)
+{
+    int fd;
+
+    MDD_FILEIMG_Close();
+
+    if (sectors != 0)
+    {
+        if (readOnly)
+            return FALSE;
+        fd = open (path, O_RDWR | O_CREAT | O_TRUNC, 0666);
+        if (fd < 0)
+            return FALSE;
+        if (ftruncate (fd, (off_t)sectors * MEDIA_SECTOR_SIZE) != 0)
+        {
+            close (fd);
+            return FALSE;
+        }
+    }
+    else
+    {
+        fd = open (path, readOnly ? O_RDONLY : O_RDWR);
+        if (fd < 0)
+            return FALSE;
+    }
+
+    imageFd = fd;
+    imageReadOnly = readOnly;
+    return TRUE;
+}
+
+
+/*****************************************************************************
+  Function:
+    void MDD_FILEIMG_Close (void)
+  Summary:
+    Detach the image file
+  Conditions:
+    None
+  Input:
+    None
+  Return Values:
+    None
+  Side Effects:
+    The media reads as removed until another image is opened.
+  Description:
+    Closes the image.  Writes go straight to the file, so there is
+    nothing to flush here; FSfclose the open files first.
+  Remarks:
+    None
+  *****************************************************************************/
+
+void MDD_FILEIMG_Close (void)
+{
+    if (imageFd >= 0)
+        close (imageFd);
+    imageFd = -1;
+    readPending = FALSE;
+}
+
+
+void MDD_FILEIMG_InitIO (void)
+{
+}
+
+
+BYTE MDD_FILEIMG_MediaDetect (void)
+{
+    return (imageFd >= 0);
+}
+
+
+MEDIA_INFORMATION * MDD_FILEIMG_MediaInitialize (void)
+{
+    memset (&mediaInformation, 0, sizeof (mediaInformation));
+
+    if (imageFd < 0)
+    {
+        mediaInformation.errorCode = MEDIA_DEVICE_NOT_PRESENT;
+        return &mediaInformation;
+    }
+
+    mediaInformation.errorCode = MEDIA_NO_ERROR;
+    mediaInformation.validityFlags.bits.sectorSize = TRUE;
+    mediaInformation.sectorSize = MEDIA_SECTOR_SIZE;
+    return &mediaInformation;
+}
+
+
+BYTE MDD_FILEIMG_ShutdownMedia (void)
+{
+    readPending = FALSE;
+    return TRUE;
+}
+
+
+BYTE MDD_FILEIMG_WriteProtectState (void)
+{
+    return imageReadOnly;
+}
+
+
+DWORD MDD_FILEIMG_ReadCapacity (void)
+{
+    struct stat st;
+
+    if (imageFd < 0 || fstat (imageFd, &st) != 0)
+        return 0;
+    return (DWORD)(st.st_size / MEDIA_SECTOR_SIZE);
+}
+
+
+/*****************************************************************************
+  Function:
+    BYTE MDD_FILEIMG_SectorReadMulti (DWORD sector_addr, DWORD sectorCount, BYTE * buffer)
+  Summary:
+    Read consecutive sectors from the image
+  Conditions:
+    An image is open and no split-phase read is in flight
+  Input:
+    sector_addr -   First sector to read
+    sectorCount -   Number of sectors
+    buffer -        sectorCount * MEDIA_SECTOR_SIZE bytes for the data
+  Return Values:
+    TRUE -  The sectors were read
+    FALSE - A sector is past the end of the image, or the read failed
+  Side Effects:
+    None
+  Description:
+    Reads the sectors with one pread.  A part sector at the end of an
+    image whose size isn't a whole number of sectors reads as zeros.
+  Remarks:
+    Like a real drive, this fails while a split-phase read is pending.
+  *****************************************************************************/
+
+BYTE MDD_FILEIMG_SectorReadMulti (DWORD sector_addr, DWORD sectorCount, BYTE * buffer)
+{
+    size_t cb = (size_t)sectorCount * MEDIA_SECTOR_SIZE;
+    ssize_t got;
+
+    if (imageFd < 0 || readPending)
+        return FALSE;
+
+    imageStats.reads++;
+    imageStats.sectorsRead += sectorCount;
+
+    got = pread (imageFd, buffer, cb, (off_t)sector_addr * MEDIA_SECTOR_SIZE);
+    if (got < 0)
+        return FALSE;
+    if ((size_t)got < cb)
+    {
+        // only the last, partial sector may come up short
+        if ((cb - got) >= MEDIA_SECTOR_SIZE)
+            return FALSE;
+        memset (buffer + got, 0, cb - got);
+    }
+    return TRUE;
+}
+
+
+BYTE MDD_FILEIMG_SectorRead (DWORD sector_addr, BYTE * buffer)
+{
+    return MDD_FILEIMG_SectorReadMulti (sector_addr, 1, buffer);
+}
+
+
+/*****************************************************************************
+  Function:
+    BYTE MDD_FILEIMG_SectorWriteMulti (DWORD sector_addr, DWORD sectorCount,
+                                       BYTE * buffer, BYTE allowWriteToZero)
+  Summary:
+    Write consecutive sectors to the image
+  Conditions:
+    An image is open and no split-phase read is in flight
+  Input:
+    sector_addr -       First sector to write
+    sectorCount -       Number of sectors
+    buffer -            sectorCount * MEDIA_SECTOR_SIZE bytes of data
+    allowWriteToZero -  FALSE to refuse a write that includes the MBR
+  Return Values:
+    TRUE -  The sectors were written
+    FALSE - The image is read only, the write touches sector 0 without
+            allowWriteToZero, or the write failed
+  Side Effects:
+    Writing past the end makes the image bigger.
+  Description:
+    Writes the sectors with one pwrite.
+  Remarks:
+    None
+  *****************************************************************************/
+
+BYTE MDD_FILEIMG_SectorWriteMulti (DWORD sector_addr, DWORD sectorCount, BYTE * buffer, BYTE allowWriteToZero)
+{
+    size_t cb = (size_t)sectorCount * MEDIA_SECTOR_SIZE;
+
+    if (imageFd < 0 || readPending || imageReadOnly)
+        return FALSE;
+    if ((sector_addr == 0) && (allowWriteToZero == FALSE))
+        return FALSE;
+
+    imageStats.writes++;
+    imageStats.sectorsWritten += sectorCount;
+    if (writeHook)
+        writeHook (sector_addr, sectorCount);
+
+    return (pwrite (imageFd, buffer, cb, (off_t)sector_addr * MEDIA_SECTOR_SIZE) == (ssize_t)cb);
+}
+
+
+BYTE MDD_FILEIMG_SectorWrite (DWORD sector_addr, BYTE * buffer, BYTE allowWriteToZero)
+{
+    return MDD_FILEIMG_SectorWriteMulti (sector_addr, 1, buffer, allowWriteToZero);
+}
+
+
+/*****************************************************************************
+  Function:
+    BYTE MDD_FILEIMG_SectorReadStart (DWORD sector_addr, WORD sectorCount, BYTE * buffer)
+  Summary:
+    Start a split-phase read
+  Conditions:
+    An image is open and no other split-phase read is in flight
+  Input:
+    sector_addr -   First sector to read
+    sectorCount -   Number of sectors
+    buffer -        sectorCount * MEDIA_SECTOR_SIZE bytes for the data
+  Return Values:
+    TRUE -  The read was queued
+    FALSE - No image, or a read is already in flight
+  Side Effects:
+    None
+  Description:
+    The data lands in buffer when MDD_FILEIMG_SectorReadIsComplete has
+    been polled MDD_FILEIMG_SetReadLatency times, not before, so a caller
+    that uses the buffer early reads stale data just as it would on a
+    USB drive.
+  Remarks:
+    None
+  *****************************************************************************/
+
+BYTE MDD_FILEIMG_SectorReadStart (DWORD sector_addr, WORD sectorCount, BYTE * buffer)
+{
+    if (imageFd < 0 || readPending)
+        return FALSE;
+
+    readSector = sector_addr;
+    readCount = sectorCount;
+    readBuffer = buffer;
+    readPolls = 0;
+    readPending = TRUE;
+    return TRUE;
+}
+
+
+BYTE MDD_FILEIMG_SectorReadIsComplete (BYTE * success)
+{
+    imageStats.polls++;
+
+    if (readPending)
+    {
+        if (readPolls++ < readLatency)
+            return FALSE;
+        readPending = FALSE;
+        readSuccess = MDD_FILEIMG_SectorReadMulti (readSector, readCount, readBuffer);
+    }
+
+    *success = readSuccess;
+    return TRUE;
+}
+
+
+void MDD_FILEIMG_SetReadLatency (WORD polls)
+{
+    readLatency = polls;
+}
+
+
+void MDD_FILEIMG_SetWriteHook (void (*hook) (DWORD sector_addr, DWORD sectorCount))
+{
+    writeHook = hook;
+}
+
+
+void MDD_FILEIMG_GetStats (MDD_FILEIMG_STATS * stats)
+{
+    *stats = imageStats;
+}
+
+
+void MDD_FILEIMG_ClearStats (void)
+{
+    memset (&imageStats, 0, sizeof (imageStats));
+}
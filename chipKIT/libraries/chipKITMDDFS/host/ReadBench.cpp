@@ -0,0 +1,114 @@
+/******************************************************************************
+ *
+ *               Microchip Memory Disk Drive File System
+ *
+ ******************************************************************************
+ * FileName:        ReadBench.cpp
+ * Dependencies:    TestImage.cpp, libmddfs.a
+ * Processor:       Host (Linux)
+ * Compiler:        gcc
+ *
+ * Times FSfread over a 3 MB contiguous file and a 3 MB file whose clusters
+ * alternate with another file's, read in several chunk sizes, and prints
+ * the media calls each took (MDD_FILEIMG_GetStats).  Whole sectors go
+ * straight into the caller's buffer, one media call per run of
+ * consecutive clusters when the driver has MDD_SectorReadMulti; build
+ * with NO_MULTI=1 to see it a sector at a time.  Each read starts from a
+ * fresh mount, so the counts include the FAT sectors.
+ *
+*****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "TestImage.h"
+
+#define IMAGE       "ReadBench.img"
+#define FILE_SIZE   (3ul * 1024ul * 1024ul)
+
+static BYTE buffer[FILE_SIZE];
+
+// the two files written a cluster's worth at a time, turn about, so
+// FRAG.DAT's clusters are every other one
+static void MakeFragmented (void)
+{
+    FSFILE * a = FSfopen ("FRAG.DAT", FS_WRITE);
+    FSFILE * b = FSfopen ("GAPS.DAT", FS_WRITE);
+    DWORD cluster = gDiskData.SecPerClus * MEDIA_SECTOR_SIZE;
+    DWORD pos;
+
+    CHECK (a != NULL && b != NULL);
+    if (a == NULL || b == NULL)
+        return;
+    for (pos = 0; pos < FILE_SIZE; pos += cluster)
+    {
+        TestFill (buffer, 2, pos, cluster);
+        CHECK (FSfwrite (buffer, 1, cluster, a) == cluster);
+        TestFill (buffer, 3, pos, cluster);
+        CHECK (FSfwrite (buffer, 1, cluster, b) == cluster);
+    }
+    FSfclose (a);
+    FSfclose (b);
+}
+
+static void Bench (const char * name, DWORD seed, DWORD start, DWORD chunk)
+{
+    MDD_FILEIMG_STATS stats;
+    FSFILE * fo;
+    DWORD pos;
+    size_t got;
+    double t0, t;
+
+    // from a fresh mount, so nothing is left in the caches
+    CHECK (TestImageMount (NULL));
+    fo = FSfopen (name, FS_READ);
+    CHECK (fo != NULL);
+    if (fo == NULL)
+        return;
+    CHECK (FSfseek (fo, start, SEEK_SET) == 0);
+
+    MDD_FILEIMG_ClearStats ();
+    t0 = TestSeconds ();
+    for (pos = start; pos < FILE_SIZE; pos += got)
+    {
+        got = FSfread (buffer + pos, 1, chunk, fo);
+        if (got == 0)
+            break;
+    }
+    t = TestSeconds () - t0;
+    MDD_FILEIMG_GetStats (&stats);
+    FSfclose (fo);
+
+    CHECK (pos == FILE_SIZE);
+    CHECK (TestMatches (buffer + start, seed, start, FILE_SIZE - start));
+
+    printf ("%-10s %6lu %8lu %8lu %8lu %9.2f\n", name, (unsigned long) start,
+            (unsigned long) chunk, (unsigned long) stats.reads,
+            (unsigned long) stats.sectorsRead, t * 1e3);
+}
+
+int main (void)
+{
+    static const DWORD chunks[] = { FILE_SIZE, 65536, 2048, 512, 100 };
+    unsigned i;
+
+    CHECK (TestImageFormat (IMAGE, TEST_FAT16_SECTORS));
+    CHECK (TestWriteFile ("CONTIG.DAT", 1, FILE_SIZE, 65536));
+    MakeFragmented ();
+
+    printf ("%lu byte clusters, FAT%d\n",
+            (unsigned long) gDiskData.SecPerClus * MEDIA_SECTOR_SIZE,
+            TestDiskType () == FAT32 ? 32 : 16);
+    printf ("%-10s %6s %8s %8s %8s %9s\n",
+            "file", "start", "chunk", "reads", "sectors", "ms");
+    for (i = 0; i < sizeof (chunks) / sizeof (chunks[0]); i++)
+        Bench ("CONTIG.DAT", 1, 0, chunks[i]);
+    Bench ("CONTIG.DAT", 1, 7, 2048);
+    for (i = 0; i < sizeof (chunks) / sizeof (chunks[0]); i++)
+        Bench ("FRAG.DAT", 2, 0, chunks[i]);
+
+    MDD_FILEIMG_Close ();
+    if (testFailures == 0)
+        unlink (IMAGE);
+    return TestResult ("ReadBench");
+}
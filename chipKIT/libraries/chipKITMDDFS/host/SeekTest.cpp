@@ -0,0 +1,248 @@
+/******************************************************************************
+ *
+ *               Microchip Memory Disk Drive File System
+ *
+ ******************************************************************************
+ * FileName:        SeekTest.cpp
+ * Dependencies:    TestImage.cpp, libmddfs.a
+ * Processor:       Host (Linux)
+ * Compiler:        gcc
+ *
+ * Random FSfseek and FSfread over a contiguous file, a file in 6 runs and
+ * one in more runs than FS_EXTENT_MAP_SIZE, read only (through the extent
+ * map) and READ+ (walking the FAT), plus seeks to the end of files a whole
+ * number of clusters long.  The makefile builds it a second time as
+ * SeekTest0, with the extent map turned off.
+ *
+ *   SeekTest            run the checks
+ *   SeekTest bench      count the media reads for 3000 random seeks
+ *
+*****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "TestImage.h"
+
+#define IMAGE       "SeekTest.img"
+
+typedef struct
+{
+    const char *    name;
+    DWORD           seed;
+    DWORD           size;
+    WORD            runs;
+} SEEK_FILE;
+
+static SEEK_FILE files[] =
+{
+    { "CONTIG.DAT",     1,  3ul * 1024ul * 1024ul,  1 },
+    { "RUNS6.DAT",      2,  1024ul * 1024ul,        6 },
+    { "RUNS40.DAT",     3,  1024ul * 1024ul + 300,  40 },
+};
+
+#define FILE_COUNT      (sizeof (files) / sizeof (files[0]))
+
+static BYTE buffer[3ul * 1024ul * 1024ul];
+
+// Write the file in f->runs runs, with a cluster of another file after
+// each run but the last to break the chain
+static void MakeFile (SEEK_FILE * f)
+{
+    DWORD cluster = gDiskData.SecPerClus * MEDIA_SECTOR_SIZE;
+    DWORD run = (f->size / f->runs + cluster - 1) / cluster * cluster;
+    DWORD pos;
+    DWORD len;
+    FSFILE * fo;
+    FSFILE * gap = NULL;
+
+    // the gap file has a cluster before this file starts, so each
+    // cluster it takes later lands after the run just written
+    if (f->runs > 1)
+    {
+        gap = FSfopen ("GAPS.DAT", FS_APPEND);
+        CHECK (gap != NULL);
+        if (gap == NULL)
+            return;
+        if (gap->size == 0)
+            CHECK (FSfwrite (buffer, 1, cluster, gap) == cluster);
+    }
+    fo = FSfopen (f->name, FS_WRITE);
+    CHECK (fo != NULL);
+    if (fo == NULL)
+        return;
+
+    for (pos = 0; pos < f->size; pos += len)
+    {
+        len = (f->size - pos < run) ? f->size - pos : run;
+        TestFill (buffer, f->seed, pos, len);
+        CHECK (FSfwrite (buffer, 1, len, fo) == len);
+        if (pos + len < f->size)
+            CHECK (FSfwrite (buffer, 1, cluster, gap) == cluster);
+    }
+
+    FSfclose (fo);
+    if (gap != NULL)
+        FSfclose (gap);
+}
+
+// n random seeks, each followed by a short read, checking both
+static void Seeks (FSFILE * fo, SEEK_FILE * f, unsigned n)
+{
+    DWORD to;
+    size_t want;
+    size_t got;
+
+    while (n--)
+    {
+        to = ((DWORD) rand () * 32768u + rand ()) % (f->size + 1);
+        CHECK (FSfseek (fo, to, SEEK_SET) == 0);
+        CHECK (FSftell (fo) == (long) to);
+        want = 1 + rand () % 100;
+        got = FSfread (buffer, 1, want, fo);
+        CHECK (got == ((f->size - to < want) ? f->size - to : want));
+        CHECK (TestMatches (buffer, f->seed, to, got));
+    }
+}
+
+static void TestSeeks (void)
+{
+    FSFILE * fo;
+    unsigned i;
+
+    for (i = 0; i < FILE_COUNT; i++)
+    {
+        fo = FSfopen (files[i].name, FS_READ);
+        CHECK (fo != NULL);
+        if (fo == NULL)
+            continue;
+        Seeks (fo, &files[i], 3000);
+
+        // the end, then back to the start through the map (MDD's
+        // SEEK_END counts back from the end)
+        CHECK (FSfseek (fo, 0, SEEK_END) == 0);
+        CHECK (FSfread (buffer, 1, 10, fo) == 0 && FSfeof (fo));
+        CHECK (FSfseek (fo, 1, SEEK_END) == 0);
+        CHECK (FSfread (buffer, 1, 10, fo) == 1);
+        CHECK (TestMatches (buffer, files[i].seed, files[i].size - 1, 1));
+        CHECK (FSfseek (fo, 0, SEEK_SET) == 0);
+        CHECK (FSfread (buffer, 1, 10, fo) == 10 && TestMatches (buffer, files[i].seed, 0, 10));
+
+#if FS_EXTENT_MAP_SIZE > 0
+        // each run took one place in the map, as many as fit
+        CHECK (fo->extents == ((files[i].runs < FS_EXTENT_MAP_SIZE) ? files[i].runs : FS_EXTENT_MAP_SIZE));
+#endif
+        FSfclose (fo);
+
+        // a file that can be written walks the FAT instead
+        fo = FSfopen (files[i].name, FS_READPLUS);
+        CHECK (fo != NULL);
+        if (fo == NULL)
+            continue;
+        Seeks (fo, &files[i], 300);
+        FSfclose (fo);
+        CHECK (TestFileMatches (files[i].name, files[i].seed, files[i].size));
+    }
+}
+
+// The end of a file that fills its last cluster is the end of that
+// cluster, not the start of one after it
+static void TestClusterEnds (void)
+{
+    static const char * names[] = { "CLUS1.DAT", "CLUS2.DAT", "CLUS3.DAT" };
+    DWORD cluster = gDiskData.SecPerClus * MEDIA_SECTOR_SIZE;
+    FSFILE * fo;
+    DWORD size;
+    unsigned i;
+
+    for (i = 0; i < 3; i++)
+    {
+        size = (i + 1) * cluster;
+        CHECK (TestWriteFile (names[i], 10 + i, size, 700));
+
+        fo = FSfopen (names[i], FS_READ);
+        CHECK (fo != NULL);
+        if (fo == NULL)
+            continue;
+        CHECK (FSfseek (fo, 0, SEEK_END) == 0);
+        CHECK (FSftell (fo) == (long) size);
+        CHECK (FSfread (buffer, 1, 1, fo) == 0 && FSfeof (fo));
+        CHECK (FSfseek (fo, size - 1, SEEK_SET) == 0);
+        CHECK (FSfread (buffer, 1, 2, fo) == 1 && TestMatches (buffer, 10 + i, size - 1, 1));
+        CHECK (FSfseek (fo, size, SEEK_SET) == 0);
+        CHECK (FSfseek (fo, 0, SEEK_SET) == 0);
+        CHECK (FSfread (buffer, 1, size, fo) == size && TestMatches (buffer, 10 + i, 0, size));
+        FSfclose (fo);
+
+        // and appending carries on from there
+        fo = FSfopen (names[i], FS_APPEND);
+        CHECK (fo != NULL);
+        if (fo == NULL)
+            continue;
+        TestFill (buffer, 10 + i, size, 100);
+        CHECK (FSfwrite (buffer, 1, 100, fo) == 100);
+        FSfclose (fo);
+        CHECK (TestFileMatches (names[i], 10 + i, size + 100));
+    }
+}
+
+static void Bench (void)
+{
+    MDD_FILEIMG_STATS stats;
+    FSFILE * fo;
+    unsigned i;
+    double t0, t;
+
+    printf ("extent map of %d runs, %lu byte clusters\n", FS_EXTENT_MAP_SIZE,
+            (unsigned long) gDiskData.SecPerClus * MEDIA_SECTOR_SIZE);
+    printf ("%-11s %8s %5s %8s %9s\n", "file", "size", "runs", "reads", "ms");
+    for (i = 0; i < FILE_COUNT; i++)
+    {
+        CHECK (TestImageMount (NULL));
+        srand (i + 1);
+        fo = FSfopen (files[i].name, FS_READ);
+        CHECK (fo != NULL);
+        if (fo == NULL)
+            continue;
+
+        MDD_FILEIMG_ClearStats ();
+        t0 = TestSeconds ();
+        Seeks (fo, &files[i], 3000);
+        t = TestSeconds () - t0;
+        MDD_FILEIMG_GetStats (&stats);
+        FSfclose (fo);
+
+        printf ("%-11s %8lu %5u %8lu %9.2f\n", files[i].name, (unsigned long) files[i].size,
+                files[i].runs, (unsigned long) stats.reads, t * 1e3);
+    }
+}
+
+int main (int argc, char ** argv)
+{
+    unsigned i;
+
+    srand (1);
+    CHECK (TestImageFormat (IMAGE, TEST_FAT16_SECTORS));
+    for (i = 0; i < FILE_COUNT; i++)
+        MakeFile (&files[i]);
+
+    if (argc > 1 && !strcmp (argv[1], "bench"))
+    {
+        Bench ();
+    }
+    else
+    {
+        TestSeeks ();
+        TestClusterEnds ();
+    }
+
+    MDD_FILEIMG_Close ();
+    unlink (IMAGE);
+
+#if FS_EXTENT_MAP_SIZE > 0
+    return TestResult ("SeekTest");
+#else
+    return TestResult ("SeekTest0");
+#endif
+}
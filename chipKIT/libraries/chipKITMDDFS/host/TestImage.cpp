@@ -0,0 +1,208 @@
+/******************************************************************************
+ *
+ *               Microchip Memory Disk Drive File System
+ *
+ ******************************************************************************
+ * FileName:        TestImage.cpp
+ * Dependencies:    TestImage.h, FSIO.cpp, FileImage.cpp
+ * Processor:       Host (Linux)
+ * Compiler:        gcc
+ *
+ * Helpers for the host tests and benchmarks.
+ *
+*****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "TestImage.h"
+
+unsigned long testFailures;
+
+void TestCheck (int ok, const char * what, const char * file, int line)
+{
+    if (!ok && testFailures++ < 20)
+        printf ("FAIL %s:%d: %s (FSerror %d)\n", file, line, what, FSerror ());
+}
+
+int TestResult (const char * name)
+{
+    if (testFailures)
+    {
+        printf ("%s: %lu failures\n", name, testFailures);
+        return 1;
+    }
+    printf ("%s: ok\n", name);
+    return 0;
+}
+
+
+/*****************************************************************************
+  Function:
+    BYTE TestImageFormat (const char * path, DWORD sectors)
+  Summary:
+    Make a new, formatted image and mount it
+  Input:
+    path -      Image file to create (replaced if it exists)
+    sectors -   Size of the image, MBR included
+  Return Values:
+    TRUE -  The image is formatted and FSInit has mounted it
+    FALSE - It couldn't be made
+  Description:
+    Writes an MBR with one partition from sector 63 to the end, then
+    formats it with FSformat, FAT16 or FAT32 by its size (see
+    TEST_FAT32_SECTORS).  FSCreateMBR isn't used because it refuses the
+    sizes that make FAT32.
+  *****************************************************************************/
+
+BYTE TestImageFormat (const char * path, DWORD sectors)
+{
+    static char volumeID[] = "TEST";
+    BYTE mbr[MEDIA_SECTOR_SIZE];
+    DWORD first = 63;
+    DWORD count = sectors - first;
+
+    if (!MDD_FILEIMG_Open (path, sectors, FALSE))
+        return FALSE;
+
+    memset (mbr, 0, sizeof (mbr));
+    mbr[446 + 4] = (count > 0x3FFD5Ful) ? 0x0B : 0x06;
+    mbr[446 + 8] = (BYTE) first;
+    mbr[446 + 9] = (BYTE) (first >> 8);
+    mbr[446 + 10] = (BYTE) (first >> 16);
+    mbr[446 + 11] = (BYTE) (first >> 24);
+    mbr[446 + 12] = (BYTE) count;
+    mbr[446 + 13] = (BYTE) (count >> 8);
+    mbr[446 + 14] = (BYTE) (count >> 16);
+    mbr[446 + 15] = (BYTE) (count >> 24);
+    mbr[510] = 0x55;
+    mbr[511] = 0xAA;
+    if (!MDD_FILEIMG_SectorWrite (0, mbr, TRUE))
+        return FALSE;
+
+    if (FSformat (1, 0x12345678, volumeID) != 0)
+        return FALSE;
+
+    return TestImageMount (NULL);
+}
+
+
+/*****************************************************************************
+  Function:
+    BYTE TestImageMount (const char * path)
+  Summary:
+    Mount an image with FSInit
+  Input:
+    path -  Existing image to open, or NULL to mount the one already open
+  Return Values:
+    TRUE -  Mounted
+    FALSE - The image couldn't be opened or FSInit failed
+  Description:
+    Sets the clock first, the file system stamps files with it.  Mounting
+    again after all files are closed reads everything back from the image,
+    nothing is left in the caches.
+  *****************************************************************************/
+
+BYTE TestImageMount (const char * path)
+{
+    if ((path != NULL) && !MDD_FILEIMG_Open (path, 0, FALSE))
+        return FALSE;
+
+    SetClockVars (2012, 6, 1, 12, 0, 0);
+    return FSInit () ? TRUE : FALSE;
+}
+
+BYTE TestDiskType (void)
+{
+    return gDiskData.type;
+}
+
+
+// The byte at pos in a file made with seed: no two files or positions
+// in a file line up, so a sector read from the wrong place shows
+BYTE TestPattern (DWORD seed, DWORD pos)
+{
+    DWORD x = (pos + 1) * 0x9E3779B1ul + seed * 0x85EBCA77ul;
+
+    return (BYTE) ((x ^ (x >> 15) ^ (pos >> 9)) >> 3);
+}
+
+void TestFill (BYTE * buffer, DWORD seed, DWORD pos, DWORD len)
+{
+    DWORD i;
+
+    for (i = 0; i < len; i++)
+        buffer[i] = TestPattern (seed, pos + i);
+}
+
+int TestMatches (const BYTE * buffer, DWORD seed, DWORD pos, DWORD len)
+{
+    DWORD i;
+
+    for (i = 0; i < len; i++)
+        if (buffer[i] != TestPattern (seed, pos + i))
+            return 0;
+    return 1;
+}
+
+
+// Write size bytes of the seed's pattern to a new file, chunk at a time
+int TestWriteFile (const char * name, DWORD seed, DWORD size, DWORD chunk)
+{
+    static BYTE buffer[65536];
+    FSFILE * fo;
+    DWORD pos;
+    DWORD len;
+    int ok;
+
+    if (chunk > sizeof (buffer))
+        chunk = sizeof (buffer);
+
+    fo = FSfopen (name, FS_WRITE);
+    if (fo == NULL)
+        return 0;
+
+    ok = 1;
+    for (pos = 0; ok && pos < size; pos += len)
+    {
+        len = (size - pos < chunk) ? size - pos : chunk;
+        TestFill (buffer, seed, pos, len);
+        ok = (FSfwrite (buffer, 1, len, fo) == len);
+    }
+
+    return (FSfclose (fo) == 0) && ok;
+}
+
+// Read a whole file back and check it is size bytes of the seed's pattern
+int TestFileMatches (const char * name, DWORD seed, DWORD size)
+{
+    static BYTE buffer[4096];
+    FSFILE * fo;
+    DWORD pos;
+    size_t got;
+    int ok;
+
+    fo = FSfopen (name, FS_READ);
+    if (fo == NULL)
+        return 0;
+
+    ok = (fo->size == size);
+    for (pos = 0; ok; pos += got)
+    {
+        got = FSfread (buffer, 1, sizeof (buffer), fo);
+        if (got == 0)
+            break;
+        ok = TestMatches (buffer, seed, pos, got);
+    }
+
+    FSfclose (fo);
+    return ok && (pos == size);
+}
+
+double TestSeconds (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
@@ -0,0 +1,56 @@
+/******************************************************************************
+ *
+ *               Microchip Memory Disk Drive File System
+ *
+ ******************************************************************************
+ * FileName:        TestImage.h
+ * Dependencies:    FSIO.h
+ * Processor:       Host (Linux)
+ * Compiler:        gcc
+ *
+ * What the host tests and benchmarks share: making and mounting disk
+ * images, file contents that can be checked without keeping a copy, and
+ * counting failures.
+ *
+*****************************************************************************/
+
+#ifndef _TEST_IMAGE_H_
+#define _TEST_IMAGE_H_
+
+#include "MDD File System/FSIO.h"
+
+// FSformat picks FAT16 up to 0x3FFD5F sectors and FAT32 above, so the
+// smallest FAT32 image is a little over 2 GB (sparse, so it only takes
+// the space that gets written)
+#define TEST_FAT16_SECTORS      (64ul * 2048ul)
+#define TEST_FAT32_SECTORS      (0x3FFD5Ful + 8192ul)
+
+// FSerror() at the end of a file; FSIO.cpp defines it for itself only
+#ifndef CE_EOF
+#define CE_EOF                  61
+#endif
+
+#define CHECK(cond)     TestCheck ((cond), #cond, __FILE__, __LINE__)
+
+extern unsigned long testFailures;
+
+// The mounted volume, in FSIO.cpp
+extern DISK gDiskData;
+
+void TestCheck (int ok, const char * what, const char * file, int line);
+int TestResult (const char * name);
+
+BYTE TestImageFormat (const char * path, DWORD sectors);
+BYTE TestImageMount (const char * path);
+BYTE TestDiskType (void);
+
+BYTE TestPattern (DWORD seed, DWORD pos);
+void TestFill (BYTE * buffer, DWORD seed, DWORD pos, DWORD len);
+int TestMatches (const BYTE * buffer, DWORD seed, DWORD pos, DWORD len);
+
+int TestWriteFile (const char * name, DWORD seed, DWORD size, DWORD chunk);
+int TestFileMatches (const char * name, DWORD seed, DWORD size);
+
+double TestSeconds (void);
+
+#endif
@@ -59,8 +59,13 @@
 
 
 //#include "Compiler.h"
+#include "FSconfig.h"
+
+// the USB classes are only there in the MPIDE build (see host/Makefile)
+#ifdef USE_USB_INTERFACE
 #include "chipKITUSBHost.h"
 #include "chipKITUSBMSDHost.h"
+#endif
 
 // this is because Arduino defines BYTE as 0, and we don't want that.
 #undef BYTE
@@ -165,6 +170,397 @@ FSFILE  gFileTemp;                  // Global variable used for file operations.
 
 DISK gDiskData;         // Global structure containing device information.
 
+#ifdef ALLOW_WRITES
+// A run of free clusters found by FATscanFreeRuns
+typedef struct
+{
+    DWORD   start;      // First free cluster of the run
+    DWORD   count;      // Number of free clusters in the run
+} FS_FREE_RUN;
+
+#if FS_FREE_RUNS > 0
+FS_FREE_RUN gFreeRun[FS_FREE_RUNS];     // Global list of free clusters that haven't been handed out
+#endif
+WORD        gFreeRuns = 0;              // Number of runs in gFreeRun
+DWORD       gFreeScan = 0;              // Global variable indicating where the next scan for free clusters starts
+
+#if FS_FREE_RUNS > 0
+static BYTE FATscanFreeRuns (DISK * disk);
+#endif
+static DWORD FATtakeFreeCluster (DISK * disk, DWORD after, DWORD want);
+#endif
+
+
+/************************************************************************/
+/*                             Sector cache                             */
+/************************************************************************/
+
+// Every sector read and write in this file goes through a small LRU cache
+// with separate pools for the FAT and for everything else, so a FAT walk
+// doesn't push the directory sectors out and vice versa.  Sectors written
+// by FSfwrite are held (write-back) until they are evicted, FSfclose runs
+// or FSCacheFlush is called; every other write goes straight through to
+// the media.  FAT lines stand for the sector in the first FAT and are
+// written to every copy of the FAT when they are written back.
+
+typedef struct
+{
+    BYTE    buffer[MEDIA_SECTOR_SIZE];  // Sector contents (first, to keep it aligned)
+    DWORD   sector;                     // Sector held by this line
+    DWORD   lastUse;                    // gCacheClock when last used
+    BYTE    valid;                      // buffer holds sector
+    BYTE    dirty;                      // buffer has not been written to the media yet
+} FS_CACHE_LINE;
+
+typedef struct
+{
+    FS_CACHE_LINE *     line;
+    BYTE                count;
+    BYTE                isFAT;
+    FS_CACHE_STATS      stats;
+} FS_CACHE_POOL;
+
+FS_CACHE_LINE gFATCacheLines[FS_FAT_CACHE_SECTORS ? FS_FAT_CACHE_SECTORS : 1];
+FS_CACHE_LINE gDataCacheLines[FS_DATA_CACHE_SECTORS ? FS_DATA_CACHE_SECTORS : 1];
+
+FS_CACHE_POOL gFATCache = { gFATCacheLines, FS_FAT_CACHE_SECTORS, TRUE };
+FS_CACHE_POOL gDataCache = { gDataCacheLines, FS_DATA_CACHE_SECTORS, FALSE };
+
+DWORD   gCacheClock = 0;            // Global counter used to find the least recently used line
+BYTE    gCacheWriteBack = FALSE;    // Global variable indicating that writes may be held in the cache (set by FSfwrite)
+
+FS_READAHEAD *  gReadAheadOwner = NULL;     // Global variable indicating which read-ahead has a read in flight
+BYTE            gReadAheadSuccess;          // Result of a read-ahead read when the driver can't split them
+
+static void FSReadAheadCollect (FS_READAHEAD * ra, BYTE wait);
+
+// A read-ahead read in flight has to finish before anything else can use the media
+#define FSReadAheadSync()   { if (gReadAheadOwner) FSReadAheadCollect (gReadAheadOwner, TRUE); }
+
+// The media driver functions selected in FSconfig.h
+static BYTE FSMediaSectorRead (DWORD sector, BYTE * buffer)
+{
+    FSReadAheadSync();
+    return MDD_SectorRead (sector, buffer);
+}
+
+static BYTE FSMediaSectorWrite (DWORD sector, BYTE * buffer, BYTE allowWriteToZero)
+{
+    FSReadAheadSync();
+    return MDD_SectorWrite (sector, buffer, allowWriteToZero);
+}
+
+// FSconfig.h may map MDD_SectorReadMulti to a driver function that reads a
+// run of consecutive sectors in one transfer
+static BYTE FSMediaSectorReadMulti (DWORD sector, DWORD count, BYTE * buffer)
+{
+    FSReadAheadSync();
+#ifdef MDD_SectorReadMulti
+    return MDD_SectorReadMulti (sector, count, buffer);
+#else
+    for ( ; count; count--, sector++, buffer += MEDIA_SECTOR_SIZE)
+    {
+        if (!MDD_SectorRead (sector, buffer))
+            return FALSE;
+    }
+    return TRUE;
+#endif
+}
+
+// ... and MDD_SectorReadStart/MDD_SectorReadIsComplete to a split-phase read.
+// Without them the read is done when it is started.
+static BYTE FSMediaSectorReadStart (DWORD sector, WORD count, BYTE * buffer)
+{
+#ifdef MDD_SectorReadStart
+    return MDD_SectorReadStart (sector, count, buffer);
+#else
+    gReadAheadSuccess = FSMediaSectorReadMulti (sector, count, buffer);
+    return TRUE;
+#endif
+}
+
+static BYTE FSMediaSectorReadIsComplete (BYTE * success)
+{
+#ifdef MDD_SectorReadIsComplete
+    return MDD_SectorReadIsComplete (success);
+#else
+    *success = gReadAheadSuccess;
+    return TRUE;
+#endif
+}
+
+// The rest of the file reads and writes sectors through the cache
+#undef MDD_SectorRead
+#undef MDD_SectorWrite
+#define MDD_SectorRead      FSCacheSectorRead
+#define MDD_SectorWrite     FSCacheSectorWrite
+
+// Returns the pool for a sector, or NULL for the second and later copies
+// of the FAT, which are only written (with the first copy).
+static FS_CACHE_POOL * FSCachePool (DWORD sector)
+{
+    if (gDiskData.mount && sector >= gDiskData.fat)
+    {
+        if (sector < gDiskData.fat + gDiskData.fatsize)
+            return &gFATCache;
+        if (sector < gDiskData.fat + gDiskData.fatsize * gDiskData.fatcopy)
+            return NULL;
+    }
+    return &gDataCache;
+}
+
+static FS_CACHE_LINE * FSCacheFind (FS_CACHE_POOL * pool, DWORD sector)
+{
+    BYTE i;
+
+    for (i = 0; i < pool->count; i++)
+    {
+        if (pool->line[i].valid && pool->line[i].sector == sector)
+            return &pool->line[i];
+    }
+    return NULL;
+}
+
+static BYTE FSCacheWriteLine (FS_CACHE_POOL * pool, FS_CACHE_LINE * line)
+{
+    BYTE i, copies = pool->isFAT ? gDiskData.fatcopy : 1;
+
+    for (i = 0; i < copies; i++)
+    {
+        if (!FSMediaSectorWrite (line->sector + i * gDiskData.fatsize, line->buffer, FALSE))
+            return FALSE;
+    }
+    line->dirty = FALSE;
+    pool->stats.writeBacks++;
+    return TRUE;
+}
+
+// Free up the least recently used line, writing it back if it is dirty
+static FS_CACHE_LINE * FSCacheEvict (FS_CACHE_POOL * pool)
+{
+    FS_CACHE_LINE * line = &pool->line[0];
+    BYTE i;
+
+    for (i = 0; i < pool->count; i++)
+    {
+        if (!pool->line[i].valid)
+        {
+            line = &pool->line[i];
+            break;
+        }
+        if ((DWORD)(gCacheClock - pool->line[i].lastUse) > (DWORD)(gCacheClock - line->lastUse))
+            line = &pool->line[i];
+    }
+
+    if (line->valid && line->dirty && !FSCacheWriteLine (pool, line))
+        return NULL;
+
+    line->valid = FALSE;
+    return line;
+}
+
+static BYTE FSCacheSectorRead (DWORD sector, BYTE * buffer)
+{
+    FS_CACHE_POOL * pool = FSCachePool (sector);
+    FS_CACHE_LINE * line;
+
+    if (pool == NULL || pool->count == 0)
+    {
+        if (pool)
+            pool->stats.misses++;
+        return FSMediaSectorRead (sector, buffer);
+    }
+
+    if ((line = FSCacheFind (pool, sector)) != NULL)
+    {
+        pool->stats.hits++;
+    }
+    else
+    {
+        pool->stats.misses++;
+        if ((line = FSCacheEvict (pool)) == NULL)
+            return FALSE;
+        if (!FSMediaSectorRead (sector, line->buffer))
+            return FALSE;
+        line->sector = sector;
+        line->valid = TRUE;
+        line->dirty = FALSE;
+    }
+
+    line->lastUse = ++gCacheClock;
+    memcpy (buffer, line->buffer, MEDIA_SECTOR_SIZE);
+    return TRUE;
+}
+
+// Data pool lines may be newer than the media, so copy any that fall in a
+// run of sectors read around the cache over the top of it
+static void FSCacheOverlay (DWORD sector, DWORD count, BYTE * buffer)
+{
+    BYTE i;
+    FS_CACHE_LINE * line;
+
+    gDataCache.stats.misses += count;
+    for (i = 0; i < gDataCache.count; i++)
+    {
+        line = &gDataCache.line[i];
+        if (line->valid && line->sector >= sector && line->sector - sector < count)
+        {
+            memcpy (buffer + (line->sector - sector) * MEDIA_SECTOR_SIZE, line->buffer, MEDIA_SECTOR_SIZE);
+            gDataCache.stats.misses--;
+            gDataCache.stats.hits++;
+        }
+    }
+}
+
+// Read a run of file data sectors straight into the caller's buffer.  The
+// run is not cached, it would only push out the directory sectors.
+static BYTE FSCacheSectorReadMulti (DWORD sector, DWORD count, BYTE * buffer)
+{
+    if (!FSMediaSectorReadMulti (sector, count, buffer))
+        return FALSE;
+
+    FSCacheOverlay (sector, count, buffer);
+    return TRUE;
+}
+
+static BYTE FSCacheSectorWrite (DWORD sector, BYTE * buffer, BYTE allowWriteToZero)
+{
+    FS_CACHE_POOL * pool = FSCachePool (sector);
+    FS_CACHE_LINE * line = NULL;
+
+    if (pool == NULL)
+    {
+        // A FAT copy: if the first copy is waiting in the cache with the same
+        // contents this write will happen when that line is written back
+        if (gCacheWriteBack)
+        {
+            line = FSCacheFind (&gFATCache, gDiskData.fat + (sector - gDiskData.fat) % gDiskData.fatsize);
+            if (line && line->dirty && memcmp (line->buffer, buffer, MEDIA_SECTOR_SIZE) == 0)
+                return TRUE;
+        }
+        return FSMediaSectorWrite (sector, buffer, allowWriteToZero);
+    }
+
+    if (pool->count)
+        line = FSCacheFind (pool, sector);
+
+    if (gCacheWriteBack && sector != 0 && pool->count)
+    {
+        if (line)
+            pool->stats.hits++;
+        else if ((line = FSCacheEvict (pool)) == NULL)
+            return FALSE;
+
+        memcpy (line->buffer, buffer, MEDIA_SECTOR_SIZE);
+        line->sector = sector;
+        line->valid = TRUE;
+        line->dirty = TRUE;
+        line->lastUse = ++gCacheClock;
+        return TRUE;
+    }
+
+    if (!FSMediaSectorWrite (sector, buffer, allowWriteToZero))
+    {
+        if (line)
+            line->valid = FALSE;
+        return FALSE;
+    }
+
+    if (line)
+    {
+        memcpy (line->buffer, buffer, MEDIA_SECTOR_SIZE);
+        line->dirty = FALSE;
+        line->lastUse = ++gCacheClock;
+    }
+    return TRUE;
+}
+
+// Drop everything, including dirty lines (the media may have changed)
+static void FSCacheInvalidate (void)
+{
+    BYTE i;
+
+    for (i = 0; i < gFATCache.count; i++)
+        gFATCache.line[i].valid = FALSE;
+    for (i = 0; i < gDataCache.count; i++)
+        gDataCache.line[i].valid = FALSE;
+}
+
+static BYTE FSCacheFlushPool (FS_CACHE_POOL * pool)
+{
+    BYTE i;
+
+    for (i = 0; i < pool->count; i++)
+    {
+        if (pool->line[i].valid && pool->line[i].dirty && !FSCacheWriteLine (pool, &pool->line[i]))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+
+/*************************************************************************
+  Function:
+    int FSCacheFlush (void)
+  Summary:
+    Write every dirty sector in the sector cache to the media
+  Conditions:
+    FSInit performed
+  Input:
+    None
+  Return Values:
+    0 -   All dirty sectors were written
+    EOF - A sector could not be written
+  Side Effects:
+    The FSerrno variable will be changed.
+  Description:
+    Writes back the data pool first and then the FAT, so a file's clusters
+    are never linked in before their contents are on the media.
+  Remarks:
+    None
+  *************************************************************************/
+
+int FSCacheFlush (void)
+{
+    FSerrno = CE_GOOD;
+
+    if (!FSCacheFlushPool (&gDataCache) || !FSCacheFlushPool (&gFATCache))
+    {
+        FSerrno = CE_WRITE_ERROR;
+        return EOF;
+    }
+    return 0;
+}
+
+
+/*************************************************************************
+  Function:
+    void FSGetCacheStats (FS_CACHE_STATS * fatStats, FS_CACHE_STATS * dataStats)
+  Summary:
+    Get the sector cache hit/miss counters
+  Conditions:
+    None
+  Input:
+    fatStats -   Loaded with the counters for the FAT sector pool
+    dataStats -  Loaded with the counters for the data/directory sector pool
+  Return Values:
+    None
+  Side Effects:
+    None
+  Description:
+    Copies out the counters kept since the last FSInit.
+  Remarks:
+    Either pointer may be NULL.
+  *************************************************************************/
+
+void FSGetCacheStats (FS_CACHE_STATS * fatStats, FS_CACHE_STATS * dataStats)
+{
+    if (fatStats)
+        *fatStats = gFATCache.stats;
+    if (dataStats)
+        *dataStats = gDataCache.stats;
+}
+
 
 
 /************************************************************************/
@@ -256,6 +652,7 @@ BYTE ValidateChars (char * FileName, BYTE mode);
 BYTE FormatFileName( const char* fileName, char* fN2, BYTE mode);
 CETYPE FILEfind( FILEOBJ foDest, FILEOBJ foCompareTo, BYTE cmd, BYTE mode);
 BYTE FILEget_next_cluster(FILEOBJ fo, DWORD n);
+BYTE FILEseek_cluster(FILEOBJ fo, DWORD n);
 CETYPE FILEopen (FILEOBJ fo, WORD *fHandle, char type);
 
 // Write functions
@@ -264,6 +661,7 @@ CETYPE FILEopen (FILEOBJ fo, WORD *fHandle, char type);
     BYTE flushData (void);
     CETYPE FILEerase( FILEOBJ fo, WORD *fHandle, BYTE EraseClusters);
     BYTE FILEallocate_new_cluster( FILEOBJ fo, BYTE mode);
+    BYTE FILEfree_preallocated (FILEOBJ fo);
     BYTE FAT_erase_cluster_chain (DWORD cluster, DISK * dsk);
     DWORD FATfindEmptyCluster(FILEOBJ fo);
     BYTE FindEmptyEntries(FILEOBJ fo, WORD *fHandle);
@@ -313,6 +711,55 @@ BYTE LoadBootSector(DISK *dsk);
 DWORD GetFullClusterNumber(DIRENTRY entry);
 
 
+/************************************************************************/
+/*                        Directory name index                          */
+/************************************************************************/
+
+// FILEfind looks a name up by reading every entry of the directory in
+// turn.  The index holds a hash of each 8.3 name in the last few
+// directories searched and the entry it is in, so an exact match only
+// has to read that entry (and a miss reads nothing).  The directories
+// share the slots; the top bits of a slot's tag say which directory it
+// belongs to.  Slots are filled by linear probing in entry order, so the
+// first entry that matches is found first, as in FILEfind.
+
+#if FS_DIR_INDEX_SIZE > 0
+typedef struct
+{
+    WORD    tag;        // Directory number in the top 3 bits, FSDirIndexHash of the name below
+    WORD    entry;      // Entry number + 1, 0 for an empty slot
+} FS_DIR_INDEX_SLOT;
+
+#define FS_DIR_INDEX_DIRS       4           // Directories in the index at once, at most 8
+#define FS_DIR_INDEX_NAMES      (FS_DIR_INDEX_SIZE / 4 * 3)     // Names in the index at most
+#define FS_DIR_INDEX_HASH       0x1FFF      // Tag bits that hold the hash
+#define FS_DIR_INDEX_FAILED     0xFF        // FSDirIndexBuild couldn't index the directory
+#define FS_DIR_INDEX_TAKEOVER   4           // Lookups in a row that give a directory that didn't fit the index
+
+FS_DIR_INDEX_SLOT   gDirIndex[FS_DIR_INDEX_SIZE];
+DWORD   gDirIndexCluster[FS_DIR_INDEX_DIRS];    // First cluster of each indexed directory
+BYTE    gDirIndexDirs = 0;                      // Number of directories in the index
+WORD    gDirIndexNames = 0;                     // Number of slots in use
+DWORD   gDirIndexTooBig[FS_DIR_INDEX_DIRS];     // First clusters of directories with too many names to index
+BYTE    gDirIndexTooBigNext = 0;                // Next gDirIndexTooBig to replace
+DWORD   gDirIndexPassed = 0xFFFFFFFF;           // First cluster of a directory that didn't fit next to the others
+DWORD   gDirIndexLast = 0xFFFFFFFF;             // First cluster of the directory of the last lookup
+BYTE    gDirIndexRun = 0;                       // Number of lookups in a row in gDirIndexLast
+
+static WORD FSDirIndexHash (const char * name);
+static BYTE FSDirIndexBuild (FILEOBJ fo);
+static BYTE FSDirIndexFind (FILEOBJ foDest, FILEOBJ foCompareTo, CETYPE * status);
+
+// Anything that changes a name in a directory has to drop the index.  A
+// directory that was too big to index stays too big until a name is removed.
+#define FSDirIndexInvalidate()  { gDirIndexDirs = 0; gDirIndexNames = 0; gDirIndexPassed = 0xFFFFFFFF; }
+#define FSDirIndexReset()       { FSDirIndexInvalidate(); memset (gDirIndexTooBig, 0xFF, sizeof (gDirIndexTooBig)); }
+#else
+#define FSDirIndexInvalidate()
+#define FSDirIndexReset()
+#endif
+
+
 /*************************************************************************
   Function:
     int FSInit(void)
@@ -354,6 +801,17 @@ int FSInit(void)
     gLastFATSectorRead = 0xFFFFFFFF;       
     gLastDataSectorRead = 0xFFFFFFFF;  
 
+    // The media may have been swapped, nothing in the cache is any good
+    FSCacheInvalidate();
+    gReadAheadOwner = NULL;
+#ifdef ALLOW_WRITES
+    gFreeRuns = 0;
+    gFreeScan = 0;
+#endif
+    FSDirIndexReset();
+    memset (&gFATCache.stats, 0, sizeof (FS_CACHE_STATS));
+    memset (&gDataCache.stats, 0, sizeof (FS_CACHE_STATS));
+
     MDD_InitIO();
 
     if(DISKmount(&gDiskData) == CE_GOOD)
@@ -385,6 +843,242 @@ int FSInit(void)
 }
 
 
+#if FS_DIR_INDEX_SIZE > 0
+/********************************************************************************
+  Function:
+    static WORD FSDirIndexHash (const char * name)
+  Summary:
+    Hash an 8.3 name for the directory index
+  Conditions:
+    This function should not be called by the user.
+  Input:
+    name -  The 11 characters of a formatted name (no dot)
+  Return:
+    WORD - The hash, the same for names that differ only in case
+  Side Effects:
+    None.
+  Description:
+    FNV-1a over the upper case name, folded to 16 bits.  FILEfind compares
+    names without regard to case, so the hash can't depend on it either.
+  Remarks:
+    None
+  ********************************************************************************/
+
+static WORD FSDirIndexHash (const char * name)
+{
+    DWORD   h = 2166136261UL;
+    BYTE    index;
+
+    for (index = 0; index < DIR_NAMECOMP; index++)
+    {
+        h ^= (BYTE)toupper ((BYTE)name[index]);
+        h *= 16777619UL;
+    }
+
+    return (WORD)(h ^ (h >> 16));
+}
+
+
+/********************************************************************************
+  Function:
+    static BYTE FSDirIndexBuild (FILEOBJ fo)
+  Summary:
+    Index every name in a directory
+  Conditions:
+    This function should not be called by the user.
+  Input:
+    fo -  FSFILE object whose dirclus is the directory to index
+  Return Values:
+    BYTE -                 The directory's number in the index
+    FS_DIR_INDEX_FAILED -  The directory has too many names, or a sector
+                           could not be read
+  Side Effects:
+    Changes fo->dirccls, and the data buffer holds a sector of the directory.
+  Description:
+    Reads the directory one sector after another, the same way
+    FindEmptyEntries does, and puts each entry FILEfind could match (anything
+    but a deleted entry or the volume label) in gDirIndex.  If the names don't
+    fit next to the directories already in the index, its slots are cleared
+    again and it is remembered in gDirIndexPassed.  If it doesn't fit on its
+    own either, it is remembered in gDirIndexTooBig.  Either way it isn't read
+    again for nothing.
+  Remarks:
+    None
+  ********************************************************************************/
+
+static BYTE FSDirIndexBuild (FILEOBJ fo)
+{
+    DIRENTRY    dir;
+    WORD        fHandle, slot, tag, names;
+    BYTE        d;
+
+    if (gDirIndexDirs == FS_DIR_INDEX_DIRS)
+        FSDirIndexInvalidate();
+    if (gDirIndexDirs == 0)
+        memset (gDirIndex, 0, sizeof (gDirIndex));
+    d = gDirIndexDirs;
+    names = gDirIndexNames;
+
+    fo->dirccls = fo->dirclus;
+    nextClusterIsLast = FALSE;
+
+    for (fHandle = 0; ; fHandle++)
+    {
+        dir = Cache_File_Entry (fo, &fHandle, (fHandle == 0));
+
+        if (dir == (DIRENTRY)NULL)
+        {
+            // The end of the cluster chain or of the FAT12/16 root, or a bad read
+            if (nextClusterIsLast || ((fo->dirclus == 0) && (fo->dsk->type != FAT32) && (fHandle >= fo->dsk->maxroot)))
+                break;
+            FSDirIndexInvalidate();
+            return FS_DIR_INDEX_FAILED;
+        }
+
+        if (dir->DIR_Name[0] == DIR_EMPTY)
+            break;
+        if (dir->DIR_Name[0] == DIR_DEL || (dir->DIR_Attr & ATTR_MASK) == ATTR_VOLUME)
+            continue;
+
+        if (++gDirIndexNames > FS_DIR_INDEX_NAMES)
+        {
+            if (d == 0)
+            {
+                FSDirIndexInvalidate();
+                gDirIndexTooBig[gDirIndexTooBigNext] = fo->dirclus;
+                gDirIndexTooBigNext = (gDirIndexTooBigNext + 1) % FS_DIR_INDEX_DIRS;
+                return FS_DIR_INDEX_FAILED;
+            }
+
+            // The slots of the other directories were all taken before this
+            // one's, so clearing this one's leaves their probe chains intact
+            for (slot = 0; slot < FS_DIR_INDEX_SIZE; slot++)
+            {
+                if ((gDirIndex[slot].entry != 0) && ((gDirIndex[slot].tag >> 13) == d))
+                    gDirIndex[slot].entry = 0;
+            }
+            gDirIndexNames = names;
+            gDirIndexPassed = fo->dirclus;
+            return FS_DIR_INDEX_FAILED;
+        }
+
+        // DIR_Extension follows DIR_Name, the 11 characters are together
+        tag = ((WORD)d << 13) | (FSDirIndexHash (dir->DIR_Name) & FS_DIR_INDEX_HASH);
+        for (slot = tag % FS_DIR_INDEX_SIZE; gDirIndex[slot].entry != 0; slot = (slot + 1) % FS_DIR_INDEX_SIZE)
+            ;
+        gDirIndex[slot].tag = tag;
+        gDirIndex[slot].entry = fHandle + 1;
+    }
+
+    gDirIndexCluster[d] = fo->dirclus;
+    gDirIndexDirs++;
+    return d;
+}
+
+
+/********************************************************************************
+  Function:
+    static BYTE FSDirIndexFind (FILEOBJ foDest, FILEOBJ foCompareTo, CETYPE * status)
+  Summary:
+    Look a name up in the directory index
+  Conditions:
+    This function should not be called by the user.
+  Input:
+    foDest -       FSFILE object for the directory, filled in with the file found
+    foCompareTo -  FSFILE object containing the name of the file to be found
+    status -       Set to CE_GOOD or CE_FILE_NOT_FOUND when TRUE is returned
+  Return Values:
+    TRUE -   The index answered the lookup
+    FALSE -  The directory can't be indexed, search it entry by entry
+  Side Effects:
+    None.
+  Description:
+    Indexes foDest's directory if it isn't already, then loads each entry
+    whose name has the same tag into foDest until one matches as it would in
+    FILEfind with mode 0.  The index is dropped if an entry it points to
+    doesn't hold a name any more.  A directory that didn't fit next to the
+    others is searched entry by entry until FS_DIR_INDEX_TAKEOVER lookups in a
+    row are in it, then it gets the index to itself, so going back and forth
+    between directories doesn't read them all again each time.
+  Remarks:
+    None
+  ********************************************************************************/
+
+static BYTE FSDirIndexFind (FILEOBJ foDest, FILEOBJ foCompareTo, CETYPE * status)
+{
+    WORD    fHandle, slot, tag;
+    BYTE    d, index;
+    DWORD   evicted = 0xFFFFFFFF;
+
+    if (foDest->dirclus != gDirIndexLast)
+    {
+        gDirIndexLast = foDest->dirclus;
+        gDirIndexRun = 0;
+    }
+    if (gDirIndexRun < FS_DIR_INDEX_TAKEOVER)
+        gDirIndexRun++;
+
+    for (d = 0; d < gDirIndexDirs; d++)
+    {
+        if (gDirIndexCluster[d] == foDest->dirclus)
+            break;
+    }
+
+    if (d == gDirIndexDirs)
+    {
+        for (d = 0; d < FS_DIR_INDEX_DIRS; d++)
+        {
+            if (gDirIndexTooBig[d] == foDest->dirclus)
+                return FALSE;
+        }
+        if (foDest->dirclus == gDirIndexPassed)
+        {
+            if (gDirIndexRun < FS_DIR_INDEX_TAKEOVER)
+                return FALSE;
+
+            // Take the index over, a directory pushed out on its own won't fit back either
+            if (gDirIndexDirs == 1)
+                evicted = gDirIndexCluster[0];
+            FSDirIndexInvalidate();
+        }
+
+        if ((d = FSDirIndexBuild (foDest)) == FS_DIR_INDEX_FAILED)
+            return FALSE;
+        gDirIndexPassed = evicted;
+    }
+
+    tag = ((WORD)d << 13) | (FSDirIndexHash (foCompareTo->name) & FS_DIR_INDEX_HASH);
+    for (slot = tag % FS_DIR_INDEX_SIZE; gDirIndex[slot].entry != 0; slot = (slot + 1) % FS_DIR_INDEX_SIZE)
+    {
+        if (gDirIndex[slot].tag != tag)
+            continue;
+
+        fHandle = gDirIndex[slot].entry - 1;
+        foDest->dirccls = foDest->dirclus;
+        if ((Cache_File_Entry (foDest, &fHandle, TRUE) == NULL) || (Fill_File_Object (foDest, &fHandle) != FOUND))
+        {
+            FSDirIndexInvalidate();
+            return FALSE;
+        }
+
+        for (index = 0; index < DIR_NAMECOMP; index++)
+        {
+            if (tolower (foDest->name[index]) != tolower (foCompareTo->name[index]))
+                break;
+        }
+        if (index == DIR_NAMECOMP)
+        {
+            *status = CE_GOOD;
+            return TRUE;
+        }
+    }
+
+    *status = CE_FILE_NOT_FOUND;
+    return TRUE;
+}
+#endif
+
+
 /********************************************************************************
   Function:
     CETYPE FILEfind (FILEOBJ foDest, FILEOBJ foCompareTo, BYTE cmd, BYTE mode)
@@ -418,6 +1112,8 @@ int FSInit(void)
     entries are irrelevant. If the mode is specified as '1' the attributes of the
     foDest entry must match the attributes specified in the foCompareTo file and
     partial string search characters may bypass portions of the comparison.
+    An exact match (mode 0) from the start of the directory is looked up in
+    the directory name index instead, if FS_DIR_INDEX_SIZE is not 0.
   Remarks:
     None
   ********************************************************************************/
@@ -430,6 +1126,15 @@ CETYPE FILEfind( FILEOBJ foDest, FILEOBJ foCompareTo, BYTE cmd, BYTE mode)
     CETYPE   statusB = CE_FILE_NOT_FOUND;
     BYTE   character,test;
 
+#if FS_DIR_INDEX_SIZE > 0
+    if ((cmd == LOOK_FOR_MATCHING_ENTRY) && (mode == 0) && (fHandle == 0))
+    {
+        if (FSDirIndexFind (foDest, foCompareTo, &statusB))
+            return statusB;
+        statusB = CE_FILE_NOT_FOUND;
+    }
+#endif
+
     // reset the cluster
     foDest->dirccls = foDest->dirclus;
     compareAttrib = 0xFFFF ^ foCompareTo->attributes;                // Attribute to be compared as per application layer request
@@ -680,6 +1385,7 @@ CETYPE FILEopen (FILEOBJ fo, WORD *fHandle, char type)
             } // -- found
 
             fo->flags.FileWriteEOF = FALSE;
+            fo->flags.preallocated = FALSE;
             // Set flag for operation type
 #ifdef ALLOW_WRITES
             if (type == 'w' || type == 'a')
@@ -714,7 +1420,7 @@ CETYPE FILEopen (FILEOBJ fo, WORD *fHandle, char type)
   Return Values:
     CE_GOOD - Operation successful
     CE_BAD_SECTOR_READ - A bad read occured of a sector
-    CE_INVALID_CLUSTER - Invalid cluster value \> maxcls
+    CE_INVALID_CLUSTER - Invalid cluster value \> maxcls + 1
     CE_FAT_EOF - Fat attempt to read beyond EOF
   Side Effects:
     None
@@ -765,8 +1471,8 @@ BYTE FILEget_next_cluster(FILEOBJ fo, DWORD n)
             error = CE_BAD_SECTOR_READ;
         else
         {
-            // check if cluster value is valid
-            if ( c >= disk->maxcls)
+            // check if cluster value is valid (clusters run from 2 to maxcls + 1)
+            if ( c >= disk->maxcls + 2)
             {
                 error = CE_INVALID_CLUSTER;
             }
@@ -788,6 +1494,138 @@ BYTE FILEget_next_cluster(FILEOBJ fo, DWORD n)
 } // get next cluster
 
 
+/*************************************************************************
+  Function:
+    BYTE FILEseek_cluster(FILEOBJ fo, DWORD n)
+  Summary:
+    Find a cluster of a file by its position in the cluster chain
+  Conditions:
+    This function should not be called by the user.
+  Input:
+    fo - The file to get the cluster of
+    n -  Position of the cluster in the chain, 0 for the first cluster
+  Return Values:
+    CE_GOOD - Operation successful
+    CE_BAD_SECTOR_READ - A bad read occured of a sector
+    CE_INVALID_CLUSTER - Invalid cluster value \> maxcls + 1
+    CE_FAT_EOF - The chain ends before cluster n
+  Side Effects:
+    None
+  Description:
+    This function sets fo->ccls to the cluster FILEget_next_cluster would
+    reach in n links from the first cluster of the file.  For a file that
+    is open read only, the runs of contiguous clusters found on the way
+    are kept in the file's extent map.  A cluster that has been mapped is
+    found with a binary search of the map, and only the links past the
+    end of the map are read from the FAT.  Once the map is full the chain
+    is followed from the end of the last run.
+  Remarks:
+    Files that can be written don't use the map, since writes can change
+    the chain.  The link out of the last mapped cluster is always read
+    from the FAT again, so the map never remembers the end of the file.
+  *************************************************************************/
+
+BYTE FILEseek_cluster(FILEOBJ fo, DWORD n)
+{
+#if FS_EXTENT_MAP_SIZE > 0
+    DWORD       c, c2, ClusterFailValue, LastClustervalue, index;
+    FS_EXTENT * run;
+    WORD        lo, hi, mid;
+    DISK *      disk = fo->dsk;
+#endif
+
+    fo->ccls = fo->cluster;
+    if (n == 0)
+        return CE_GOOD;
+
+#if FS_EXTENT_MAP_SIZE == 0
+    return FILEget_next_cluster (fo, n);
+#else
+    if (fo->flags.write)
+        return FILEget_next_cluster (fo, n);
+
+    if (fo->extents == 0)
+    {
+        fo->extent[0].cluster = fo->cluster;
+        fo->extent[0].index = 0;
+        fo->extents = 1;
+        fo->mapped = 1;
+    }
+
+    if (n < fo->mapped)
+    {
+        // Find the last run that starts at or before cluster n
+        lo = 0;
+        hi = fo->extents - 1;
+        while (lo < hi)
+        {
+            mid = (lo + hi + 1) / 2;
+            if (fo->extent[mid].index <= n)
+                lo = mid;
+            else
+                hi = mid - 1;
+        }
+        fo->ccls = fo->extent[lo].cluster + (n - fo->extent[lo].index);
+        return CE_GOOD;
+    }
+
+    /* Settings based on FAT type */
+    switch (disk->type)
+    {
+#ifdef SUPPORT_FAT32 // If FAT32 supported.
+        case FAT32:
+            LastClustervalue = LAST_CLUSTER_FAT32;
+            ClusterFailValue  = CLUSTER_FAIL_FAT32;
+            break;
+#endif
+        case FAT12:
+            LastClustervalue = LAST_CLUSTER_FAT12;
+            ClusterFailValue  = CLUSTER_FAIL_FAT16;
+            break;
+        case FAT16:
+        default:
+            LastClustervalue = LAST_CLUSTER_FAT16;
+            ClusterFailValue  = CLUSTER_FAIL_FAT16;
+            break;
+    }
+
+    // Follow the chain on from the last mapped cluster
+    run = &fo->extent[fo->extents - 1];
+    c2 = run->cluster + (fo->mapped - 1 - run->index);
+    for (index = fo->mapped; index <= n; index++)
+    {
+        if ((c = ReadFAT (disk, c2)) == ClusterFailValue)
+            return CE_BAD_SECTOR_READ;
+
+        fo->ccls = c;
+        if (c >= LastClustervalue)
+            return CE_FAT_EOF;
+        if (c >= disk->maxcls + 2)
+            return CE_INVALID_CLUSTER;
+
+        // Map the cluster, until a new run doesn't fit
+        if (index == fo->mapped)
+        {
+            if (c == c2 + 1)
+            {
+                fo->mapped++;
+            }
+            else if (fo->extents < FS_EXTENT_MAP_SIZE)
+            {
+                run = &fo->extent[fo->extents++];
+                run->cluster = c;
+                run->index = index;
+                fo->mapped++;
+            }
+        }
+        c2 = c;
+    }
+
+    return CE_GOOD;
+#endif
+}
+
+
 /**************************************************************************
   Function:
     BYTE DISKmount ( DISK *dsk)
@@ -1512,8 +2350,14 @@ int FSformat (char mode, long int serialNumber, char * volumeID)
     gNeedFATWrite = FALSE;             
     gLastFATSectorRead = 0xFFFFFFFF;       
     gLastDataSectorRead = 0xFFFFFFFF;  
+    gFreeRuns = 0;
+    gFreeScan = 0;
+    FSDirIndexReset();
 
     disk->buffer = gDataBuffer;
+    // the boot sector written below says 512 byte sectors; the root
+    // directory is sized from this, which was left uninitialized
+    disk->sectorSize = 0x200;
 
     MDD_InitIO();
 
@@ -2717,6 +3561,8 @@ CETYPE PopulateEntries(FILEOBJ fo, char *name , WORD *fHandle, BYTE mode)
     if (dir == NULL)
         return CE_BADCACHEREAD;
 
+    FSDirIndexInvalidate();
+
     // copy the contents over
     strncpy(dir->DIR_Name,name,DIR_NAMECOMP);
 
@@ -3009,6 +3855,19 @@ BYTE FILEallocate_new_cluster( FILEOBJ fo, BYTE mode)
     dsk = fo->dsk;
     c = fo->ccls;
 
+    // Carry on into a cluster FSfpreallocate already linked to this one
+    if (fo->flags.preallocated)
+    {
+        c = ReadFAT (dsk, fo->ccls);
+        if (c >= 2 && c < dsk->maxcls + 2)
+        {
+            fo->ccls = c;
+            if (mode == 1)
+                return (EraseCluster(dsk, c));
+            return CE_GOOD;
+        }
+    }
+
     // find the next empty cluster
     c = FATfindEmptyCluster(fo);
     if (c == 0)      // "0" is just an indication as Disk full in the fn "FATfindEmptyCluster()"
@@ -3022,118 +3881,268 @@ BYTE FILEallocate_new_cluster( FILEOBJ fo, BYTE mode)
         WriteFAT( dsk, c, LAST_CLUSTER_FAT16, FALSE);
 
 #ifdef SUPPORT_FAT32 // If FAT32 supported.
-    else
-        WriteFAT( dsk, c, LAST_CLUSTER_FAT32, FALSE);
+    else
+        WriteFAT( dsk, c, LAST_CLUSTER_FAT32, FALSE);
+#endif
+
+    // link current cluster to the new one
+    curcls = fo->ccls;
+
+    WriteFAT( dsk, curcls, c, FALSE);
+
+    // update the FILE structure
+    fo->ccls = c;
+
+    // IF this is a dir, we need to erase the cluster
+    // If it's a file, we can leave it- the file size
+    // will limit the data we see to the data that's been
+    // written
+    if (mode == 1)
+        return (EraseCluster(dsk, c));
+    else
+        return CE_GOOD;
+
+} // allocate new cluster
+#endif
+
+/***********************************************
+  Function:
+    DWORD FATfindEmptyCluster(FILEOBJ fo)
+  Summary:
+    Find the next available cluster on the device
+  Conditions:
+    This function should not be called by the
+    user.
+  Input:
+    fo -  Pointer to file structure
+  Return Values:
+    DWORD - Address of empty cluster
+    0 -     Could not find empty cluster
+  Side Effects:
+    None
+  Description:
+    This function will find the next available
+    cluster on the device, preferably the one after
+    the file's current cluster.  The clusters come
+    from a list of free runs that is refilled by
+    scanning on through the FAT, see
+    FATtakeFreeCluster.
+  Remarks:
+    Should not be called by user
+  ***********************************************/
+
+#ifdef ALLOW_WRITES
+DWORD FATfindEmptyCluster(FILEOBJ fo)
+{
+    return FATtakeFreeCluster (fo->dsk, fo->ccls, 1);
+}
+
+
+/***********************************************
+  Function:
+    static BYTE FATscanFreeRuns (DISK * disk)
+  Summary:
+    Refill the list of free cluster runs
+  Conditions:
+    This function should not be called by the
+    user.
+  Input:
+    disk -  The disk to scan
+  Return Values:
+    TRUE -  The scan ran, gFreeRuns is 0 if the
+            disk is full
+    FALSE - The FAT could not be read
+  Side Effects:
+    None
+  Description:
+    This function reads the FAT from gFreeScan on,
+    wrapping around at the end, and adds each run
+    of free clusters to gFreeRun until the list is
+    full or every cluster has been looked at once.
+    The next scan carries on where this one
+    stopped, so each FAT entry is read once for
+    every pass through the disk rather than once
+    per cluster allocated.
+  Remarks:
+    Only called when gFreeRun is empty.
+  ***********************************************/
+
+#if FS_FREE_RUNS > 0
+static BYTE FATscanFreeRuns (DISK * disk)
+{
+    DWORD   c, value, left, ClusterFailValue;
+    FS_FREE_RUN * run = NULL;
+
+    /* Settings based on FAT type */
+    switch (disk->type)
+    {
+#ifdef SUPPORT_FAT32 // If FAT32 supported.
+        case FAT32:
+            ClusterFailValue = CLUSTER_FAIL_FAT32;
+            break;
 #endif
+        case FAT12:
+        case FAT16:
+        default:
+            ClusterFailValue = CLUSTER_FAIL_FAT16;
+            break;
+    }
 
-    // link current cluster to the new one
-    curcls = fo->ccls;
+    c = gFreeScan;
+    if (c < 2 || c >= disk->maxcls + 2)
+        c = 2;
 
-    WriteFAT( dsk, curcls, c, FALSE);
+    for (left = disk->maxcls; left != 0; left--)
+    {
+        if ((value = ReadFAT (disk, c)) == ClusterFailValue)
+            return FALSE;
 
-    // update the FILE structure
-    fo->ccls = c;
+        if (value == CLUSTER_EMPTY)
+        {
+            if (run != NULL && c == run->start + run->count)
+            {
+                run->count++;
+            }
+            else
+            {
+                // Stop at the first free cluster that doesn't fit
+                if (gFreeRuns == FS_FREE_RUNS)
+                    break;
+                run = &gFreeRun[gFreeRuns++];
+                run->start = c;
+                run->count = 1;
+            }
+        }
 
-    // IF this is a dir, we need to erase the cluster
-    // If it's a file, we can leave it- the file size
-    // will limit the data we see to the data that's been
-    // written
-    if (mode == 1)
-        return (EraseCluster(dsk, c));
-    else
-        return CE_GOOD;
+        // check if reached last cluster in FAT, re-start from top
+        if (++c >= disk->maxcls + 2)
+            c = 2;
+    }
 
-} // allocate new cluster
+    gFreeScan = c;
+    return TRUE;
+}
 #endif
 
+
 /***********************************************
   Function:
-    DWORD FATfindEmptyCluster(FILEOBJ fo)
+    static DWORD FATtakeFreeCluster (DISK * disk, DWORD after, DWORD want)
   Summary:
-    Find the next available cluster on the device
+    Hand out a free cluster
   Conditions:
     This function should not be called by the
     user.
   Input:
-    fo -  Pointer to file structure
+    disk -  The disk to allocate on
+    after - The cluster the new one will be linked
+            to, or 0
+    want -  Number of clusters the caller is going
+            to take in a row
   Return Values:
-    DWORD - Address of empty cluster
+    DWORD - A free cluster, now out of the list
     0 -     Could not find empty cluster
   Side Effects:
     None
   Description:
-    This function will search through the FAT to
-    find the next available cluster on the device.
+    This function takes the first cluster of a run
+    from gFreeRun.  It picks the run that starts
+    right after 'after' if there is one, so a file
+    stays contiguous, or else the first run with
+    'want' clusters, or else the longest run.  When
+    the list is empty it is refilled with
+    FATscanFreeRuns.  The cluster is checked in the
+    FAT before it is handed out, in case it was
+    taken since the scan.
+
+    With FS_FREE_RUNS 0 there is no list: the FAT
+    is read entry by entry from 'after' on to the
+    first free cluster, wrapping around at the end,
+    every time.
   Remarks:
-    Should not be called by user
+    The caller has to mark the cluster as used.
   ***********************************************/
 
-#ifdef ALLOW_WRITES
-DWORD FATfindEmptyCluster(FILEOBJ fo)
+#if FS_FREE_RUNS == 0
+static DWORD FATtakeFreeCluster (DISK * disk, DWORD after, DWORD want)
 {
-    DISK *   disk;
-    DWORD    value = 0x0;
-    DWORD    c,curcls, EndClusterLimit, ClusterFailValue;
-
-    disk = fo->dsk;
-    c = fo->ccls;
+    DWORD   c, value, left, ClusterFailValue;
 
     /* Settings based on FAT type */
     switch (disk->type)
     {
 #ifdef SUPPORT_FAT32 // If FAT32 supported.
         case FAT32:
-            EndClusterLimit = END_CLUSTER_FAT32;
             ClusterFailValue = CLUSTER_FAIL_FAT32;
             break;
 #endif
         case FAT12:
-            EndClusterLimit = END_CLUSTER_FAT12;
-            ClusterFailValue = CLUSTER_FAIL_FAT16;
-            break;
         case FAT16:
         default:
-            EndClusterLimit = END_CLUSTER_FAT16;
             ClusterFailValue = CLUSTER_FAIL_FAT16;
             break;
     }
 
-    // just in case
-    if(c < 2)
+    c = after;
+    if (c < 2 || c >= disk->maxcls + 2)
         c = 2;
 
-    curcls = c;
-    ReadFAT(disk, c);
-
     // sequentially scan through the FAT looking for an empty cluster
-    while(c)
+    for (left = disk->maxcls; left != 0; left--)
     {
-        // look at its value
-        if ( (value = ReadFAT(disk, c)) == ClusterFailValue)
-        {
-            c = 0;
-            break;
-        }
-
-        // check if empty cluster found
+        if ((value = ReadFAT (disk, c)) == ClusterFailValue)
+            return 0;
         if (value == CLUSTER_EMPTY)
-            break;
+            return c;
 
-        c++;    // check next cluster in FAT
         // check if reached last cluster in FAT, re-start from top
-        if (value == EndClusterLimit || c >= (disk->maxcls+2))
+        if (++c >= disk->maxcls + 2)
             c = 2;
+    }
+    return 0;
+}
+#else
+static DWORD FATtakeFreeCluster (DISK * disk, DWORD after, DWORD want)
+{
+    DWORD   c, value;
+    WORD    i, pick;
 
-        // check if full circle done, disk full
-        if ( c == curcls)
+    while (1)
+    {
+        if (gFreeRuns == 0)
         {
-            c = 0;
-            break;
+            if (!FATscanFreeRuns (disk) || gFreeRuns == 0)
+                return 0;
         }
-    }  // scanning for an empty cluster
 
-    return(c);
+        pick = 0;
+        for (i = 0; i < gFreeRuns; i++)
+        {
+            if (gFreeRun[i].start == after + 1)
+            {
+                pick = i;
+                break;
+            }
+            if (gFreeRun[pick].count < want && gFreeRun[i].count > gFreeRun[pick].count)
+                pick = i;
+        }
+
+        c = gFreeRun[pick].start++;
+        if (--gFreeRun[pick].count == 0)
+            gFreeRun[pick] = gFreeRun[--gFreeRuns];
+
+        value = ReadFAT (disk, c);
+        if (value == CLUSTER_EMPTY)
+            return c;
+#ifdef SUPPORT_FAT32 // If FAT32 supported.
+        if (value == CLUSTER_FAIL_FAT32 && disk->type == FAT32)
+            return 0;
+#endif
+        if (value == CLUSTER_FAIL_FAT16 && disk->type != FAT32)
+            return 0;
+    }
 }
+#endif  // FS_FREE_RUNS
 #endif
 
 
@@ -3389,6 +4398,21 @@ int FSfclose(FSFILE   *fo)
             }
         }
 
+        // Write back whatever FSfwrite left in the sector cache, before
+        // the FAT sector below links the last of those clusters in
+        if (FSCacheFlush())
+            return EOF;
+
+        // Give back the reserved clusters that weren't written to
+        if (fo->flags.preallocated)
+        {
+            if (FILEfree_preallocated (fo) != CE_GOOD)
+            {
+                FSerrno = CE_ERASE_FAIL;
+                return EOF;
+            }
+        }
+
         // Write the current FAT sector to the disk
         WriteFAT (fo->dsk, 0, 0, TRUE);
 
@@ -3843,6 +4867,7 @@ CETYPE FILEerase( FILEOBJ fo, WORD *fHandle, BYTE EraseClusters)
 
             /* 8.3 File Name - entry*/
             dir->DIR_Name[0] = DIR_DEL; // mark as deleted
+            FSDirIndexReset();
 
             // Get the starting cluster
             clus = GetFullClusterNumber(dir); // Get Complete Cluster number.
@@ -4003,6 +5028,7 @@ int FSrename (const char * fileName, FSFILE * fo)
         {
             dir->DIR_Name[j] = fo->name[j];
         }
+        FSDirIndexInvalidate();
 
         // just write the last entry in
         if(!Write_File_Entry(fo,&fHandle))
@@ -4305,6 +5331,11 @@ FSFILE * FSfopen( const char * fileName, const char *mode )
 #endif
     else
     {
+#if FS_EXTENT_MAP_SIZE > 0
+        // The map is built by FSfseek as it's needed
+        filePtr->extents = 0;
+        filePtr->mapped = 0;
+#endif
         FSerrno = CE_GOOD;
     }
 
@@ -5097,7 +6128,7 @@ int FSattrib (FSFILE * file, unsigned char attributes)
   *********************************************************************************/
 
 #ifdef ALLOW_WRITES
-size_t FSfwrite(const void *ptr, size_t size, size_t n, FSFILE *stream)
+static size_t FILEwrite(const void *ptr, size_t size, size_t n, FSFILE *stream)
 {
     DWORD       count = size * n;
     BYTE   *    src = (BYTE *) ptr;
@@ -5106,7 +6137,7 @@ size_t FSfwrite(const void *ptr, size_t size, size_t n, FSFILE *stream)
     WORD        pos;
     DWORD       l;                     // absolute lba of sector to load
     DWORD       seek, filesize;
-    WORD        writeCount = 0;
+    DWORD       writeCount = 0;
 
     // see if the file was opened in a write mode
     if(!(stream->flags.write))
@@ -5189,85 +6220,276 @@ size_t FSfwrite(const void *ptr, size_t size, size_t n, FSFILE *stream)
                     return 0;
                 }
 
-            // reset position
-            pos = 0;
+            // reset position
+            pos = 0;
+
+            // point to the next sector
+            stream->sec++;
+
+            // get a new cluster if necessary
+            if (stream->sec == dsk->SecPerClus)
+            {
+                stream->sec = 0;
+
+                if(stream->flags.FileWriteEOF)
+                {
+                    error = (CETYPE) FILEallocate_new_cluster(stream, 0);    // add new cluster to the file
+                    needRead = FALSE;
+                }
+                else
+                    error = (CETYPE) FILEget_next_cluster( stream, 1);
+            }
+
+            if (error == CE_DISK_FULL)
+            {
+                // Stay at the end of the last cluster and keep what was written
+                stream->sec = dsk->SecPerClus - 1;
+                pos = dsk->sectorSize;
+                FSerrno = CE_DISK_FULL;
+                break;
+            }
+
+            if(error == CE_GOOD)
+            {
+                l = Cluster2Sector(dsk,stream->ccls);
+                l += (WORD)stream->sec;      // add the sector number to it
+                gBufferOwner = stream;
+                // If we just allocated a new cluster, then the cluster will
+                // contain garbage data, so it doesn't matter what we write to it
+                // Whatever is in the buffer will work fine
+                if (needRead)
+                {
+                    if( !MDD_SectorRead( l, dsk->buffer) )
+                    {
+                        FSerrno = CE_BADCACHEREAD;
+                        error = CE_BAD_SECTOR_READ;
+                        gLastDataSectorRead = 0xFFFFFFFF;
+                        return 0;
+                    }
+                    else
+                    {
+                        gLastDataSectorRead = l;
+                    }
+                }
+                else
+                    gLastDataSectorRead = l;
+            }
+        } //  load new sector
+
+        if(error == CE_GOOD)
+        {
+            // Write one byte at a time
+            RAMwrite(dsk->buffer, pos++, *(char *)src);
+            src = src + 1; // compiler bug
+            seek++;
+            count--;
+            writeCount++;
+            // now increment the size of the part
+            if(stream->flags.FileWriteEOF)
+                filesize++;
+            gNeedDataWrite = TRUE;
+        }
+    } // while count
+
+    // save off the positon
+    stream->pos = pos;
+
+    // save off the seek
+    stream->seek = seek;
+
+    // now the new size
+    stream->size = filesize;
+
+    return(writeCount / size);
+} // FILEwrite
+
+size_t FSfwrite(const void *ptr, size_t size, size_t n, FSFILE *stream)
+{
+    size_t  written;
+
+    // Let the sector cache hold this file's data and FAT sectors until
+    // they are evicted or the file is closed
+    gCacheWriteBack = TRUE;
+    written = FILEwrite (ptr, size, n, stream);
+    gCacheWriteBack = FALSE;
+
+    return written;
+} // fwrite
+#endif
+
+
+/*********************************************************************************
+  Function:
+    int FSfpreallocate (FSFILE * stream, DWORD size)
+  Summary:
+    Reserve clusters for a file that is going to be written
+  Conditions:
+    File opened in WRITE, APPEND, WRITE+, APPEND+, READ+ mode
+  Input:
+    stream -  Pointer to file structure
+    size -    Number of bytes the file is expected to grow to
+  Return Values:
+    0 -   The file's cluster chain covers size bytes
+    EOF - The clusters could not be reserved
+  Side Effects:
+    The FSerrno variable will be changed.
+  Description:
+    Links enough free clusters onto the end of the file's cluster chain to hold
+    size bytes, as contiguous as the free space allows, without changing the
+    file size or position.  FSfwrite then writes into these clusters instead of
+    allocating one at a time, and FSfclose frees any that weren't written to.
+    If the disk fills up, the clusters that were reserved are kept and FSerrno
+    is set to CE_DISK_FULL.
+  Remarks:
+    None.
+  *********************************************************************************/
+
+#ifdef ALLOW_WRITES
+int FSfpreallocate (FSFILE * stream, DWORD size)
+{
+    DISK *  dsk = stream->dsk;
+    DWORD   c, next, have, need, clusterSize, ClusterFailValue, LastClusterValue;
+
+    FSerrno = CE_GOOD;
+
+    if (!stream->flags.write)
+    {
+        FSerrno = CE_READONLY;
+        return EOF;
+    }
+
+    if (MDD_WriteProtectState())
+    {
+        FSerrno = CE_WRITE_PROTECTED;
+        return EOF;
+    }
+
+    if (stream->cluster < 2)
+    {
+        FSerrno = CE_INVALID_CLUSTER;
+        return EOF;
+    }
+
+    /* Settings based on FAT type */
+    switch (dsk->type)
+    {
+#ifdef SUPPORT_FAT32 // If FAT32 supported.
+        case FAT32:
+            LastClusterValue = LAST_CLUSTER_FAT32;
+            ClusterFailValue = CLUSTER_FAIL_FAT32;
+            break;
+#endif
+        case FAT12:
+            LastClusterValue = LAST_CLUSTER_FAT12;
+            ClusterFailValue = CLUSTER_FAIL_FAT16;
+            break;
+        case FAT16:
+        default:
+            LastClusterValue = LAST_CLUSTER_FAT16;
+            ClusterFailValue = CLUSTER_FAIL_FAT16;
+            break;
+    }
+
+    clusterSize = (DWORD)dsk->sectorSize * dsk->SecPerClus;
+    need = (size + clusterSize - 1) / clusterSize;
+
+    // Find the end of the chain
+    c = stream->cluster;
+    have = 1;
+    while ((next = ReadFAT (dsk, c)) != LastClusterValue)
+    {
+        if (next == ClusterFailValue || next < 2 || next >= dsk->maxcls + 2)
+        {
+            FSerrno = CE_BAD_SECTOR_READ;
+            return EOF;
+        }
+        c = next;
+        have++;
+    }
+
+    for (; have < need; have++)
+    {
+        next = FATtakeFreeCluster (dsk, c, need - have);
+        if (next == 0)
+        {
+            FSerrno = CE_DISK_FULL;
+            break;
+        }
+
+        // mark the cluster as taken, and last in chain, then link it in
+        if ((WriteFAT (dsk, next, LastClusterValue, FALSE) == ClusterFailValue) ||
+            (WriteFAT (dsk, c, next, FALSE) == ClusterFailValue))
+        {
+            FSerrno = CE_WRITE_ERROR;
+            break;
+        }
+        c = next;
+        stream->flags.preallocated = TRUE;
+    }
+
+    if (WriteFAT (dsk, 0, 0, TRUE) && FSerrno == CE_GOOD)
+        FSerrno = CE_WRITE_ERROR;
 
-            // point to the next sector
-            stream->sec++;
+    return (FSerrno == CE_GOOD) ? 0 : EOF;
+}
 
-            // get a new cluster if necessary
-            if (stream->sec == dsk->SecPerClus)
-            {
-                stream->sec = 0;
 
-                if(stream->flags.FileWriteEOF)
-                {
-                    error = (CETYPE) FILEallocate_new_cluster(stream, 0);    // add new cluster to the file
-                    needRead = FALSE;
-                }
-                else
-                    error = (CETYPE) FILEget_next_cluster( stream, 1);
-            }
+/*********************************************************************************
+  Function:
+    BYTE FILEfree_preallocated (FILEOBJ fo)
+  Summary:
+    Free the clusters past the end of a file
+  Conditions:
+    This function should not be called by the user.
+  Input:
+    fo -  The file being closed
+  Return Values:
+    CE_GOOD -       The chain ends at the cluster holding the last byte
+    CE_ERASE_FAIL - The rest of the chain could not be freed
+  Side Effects:
+    None
+  Description:
+    Ends the file's cluster chain at the cluster holding its last byte and
+    frees the clusters after it, which FSfpreallocate reserved but FSfwrite
+    never reached.  The next free cluster scan starts at the first one freed,
+    so the space is used again right away.
+  Remarks:
+    Changes fo->ccls.
+  *********************************************************************************/
 
-            if (error == CE_DISK_FULL)
-            {
-                FSerrno = CE_DISK_FULL;
-                return 0;
-            }
+BYTE FILEfree_preallocated (FILEOBJ fo)
+{
+    DISK *  dsk = fo->dsk;
+    DWORD   c, n, clusterSize;
 
-            if(error == CE_GOOD)
-            {
-                l = Cluster2Sector(dsk,stream->ccls);
-                l += (WORD)stream->sec;      // add the sector number to it
-                gBufferOwner = stream;
-                // If we just allocated a new cluster, then the cluster will
-                // contain garbage data, so it doesn't matter what we write to it
-                // Whatever is in the buffer will work fine
-                if (needRead)
-                {
-                    if( !MDD_SectorRead( l, dsk->buffer) )
-                    {
-                        FSerrno = CE_BADCACHEREAD;
-                        error = CE_BAD_SECTOR_READ;
-                        gLastDataSectorRead = 0xFFFFFFFF;
-                        return 0;
-                    }
-                    else
-                    {
-                        gLastDataSectorRead = l;
-                    }
-                }
-                else
-                    gLastDataSectorRead = l;
-            }
-        } //  load new sector
+    clusterSize = (DWORD)dsk->sectorSize * dsk->SecPerClus;
+    n = (fo->size == 0) ? 0 : (fo->size - 1) / clusterSize;
 
-        if(error == CE_GOOD)
-        {
-            // Write one byte at a time
-            RAMwrite(dsk->buffer, pos++, *(char *)src);
-            src = src + 1; // compiler bug
-            seek++;
-            count--;
-            writeCount++;
-            // now increment the size of the part
-            if(stream->flags.FileWriteEOF)
-                filesize++;
-            gNeedDataWrite = TRUE;
-        }
-    } // while count
+    fo->flags.preallocated = FALSE;
+    if (FILEseek_cluster (fo, n) != CE_GOOD)
+        return CE_GOOD;     // nothing past the end
 
-    // save off the positon
-    stream->pos = pos;
+    c = ReadFAT (dsk, fo->ccls);
+    if (c < 2 || c >= dsk->maxcls + 2)
+        return CE_GOOD;
 
-    // save off the seek
-    stream->seek = seek;
+#ifdef SUPPORT_FAT32 // If FAT32 supported.
+    if (dsk->type == FAT32)
+        WriteFAT (dsk, fo->ccls, LAST_CLUSTER_FAT32, FALSE);
+    else
+#endif
+    if (dsk->type == FAT16)
+        WriteFAT (dsk, fo->ccls, LAST_CLUSTER_FAT16, FALSE);
+    else
+        WriteFAT (dsk, fo->ccls, LAST_CLUSTER_FAT12, FALSE);
 
-    // now the new size
-    stream->size = filesize;
+    if (!FAT_erase_cluster_chain (c, dsk))
+        return CE_ERASE_FAIL;
 
-    return(writeCount / size);
-} // fwrite
+    gFreeRuns = 0;
+    gFreeScan = c;
+    return CE_GOOD;
+}
 #endif
 
 
@@ -5378,7 +6600,9 @@ int FSfeof( FSFILE * stream )
     to 'n' unless an error occured or the user tried to read beyond the end
     of the file.
   Remarks:
-    None.
+    Whole sectors are read straight into the buffer, with one media read
+    for each run of contiguous clusters, so large reads that start on a
+    sector boundary of the file are much faster than small ones.
   **************************************************************************/
 
 size_t FSfread (void *ptr, size_t size, size_t n, FSFILE *stream)
@@ -5389,7 +6613,8 @@ size_t FSfread (void *ptr, size_t size, size_t n, FSFILE *stream)
     DWORD    seek, sec_sel;
     WORD    pos;       //position within sector
     CETYPE   error = CE_GOOD;
-    WORD    readCount = 0;
+    DWORD   readCount = 0;
+    DWORD   count, run, next;
 
     FSerrno = CE_GOOD;
 
@@ -5461,6 +6686,50 @@ size_t FSfread (void *ptr, size_t size, size_t n, FSFILE *stream)
             sec_sel = Cluster2Sector(dsk,stream->ccls);
             sec_sel += (WORD)stream->sec;      // add the sector number to it
 
+            // The number of whole sectors left to read
+            count = stream->size - seek;
+            if (count > len)
+                count = len;
+            count /= dsk->sectorSize;
+
+            if (count)
+            {
+                // Extend the run through the following clusters for as long
+                // as the chain is contiguous, leaving ccls/sec on its last sector
+                run = 0;
+                for (;;)
+                {
+                    next = dsk->SecPerClus - stream->sec;
+                    if (next > count - run)
+                        next = count - run;
+                    run += next;
+                    stream->sec += next;
+                    if (run == count)
+                        break;
+                    next = ReadFAT (dsk, stream->ccls);
+                    if (next != stream->ccls + 1 || next >= dsk->maxcls + 2)
+                        break;
+                    stream->ccls = next;
+                    stream->sec = 0;
+                }
+                stream->sec--;
+
+                // the data buffer is left alone, gLastDataSectorRead still describes it
+                if( !FSCacheSectorReadMulti( sec_sel, run, pointer) )
+                {
+                    FSerrno = CE_BAD_SECTOR_READ;
+                    error = CE_BAD_SECTOR_READ;
+                    break;
+                }
+
+                count = run * dsk->sectorSize;
+                pos = dsk->sectorSize;
+                pointer += count;
+                seek += count;
+                readCount += count;
+                len -= count;
+                continue;
+            }
 
             gBufferOwner = stream;
             gBufferZeroed = FALSE;
@@ -5473,12 +6742,18 @@ size_t FSfread (void *ptr, size_t size, size_t n, FSFILE *stream)
             gLastDataSectorRead = sec_sel;
         }
 
-        // copy one byte at a time
-        *pointer = RAMread( dsk->buffer, pos++ );
-        pointer++;
-        seek++;
-        readCount++;
-        len--;
+        // copy the rest of the sector, up to the end of the request or file
+        count = dsk->sectorSize - pos;
+        if (count > len)
+            count = len;
+        if (count > stream->size - seek)
+            count = stream->size - seek;
+        memcpy (pointer, dsk->buffer + pos, count);
+        pos += count;
+        pointer += count;
+        seek += count;
+        readCount += count;
+        len -= count;
     }
 
     // save off the positon
@@ -5490,6 +6765,309 @@ size_t FSfread (void *ptr, size_t size, size_t n, FSFILE *stream)
 } // fread
 
 
+/************************************************************************/
+/*                              Read-ahead                              */
+/************************************************************************/
+
+// Wait for (or just check on) a read in flight and add it to the ring
+static void FSReadAheadCollect (FS_READAHEAD * ra, BYTE wait)
+{
+    BYTE success;
+    WORD slot;
+
+    if (ra->inFlight == 0)
+        return;
+
+    while (!FSMediaSectorReadIsComplete (&success))
+    {
+        if (!wait)
+            return;
+    }
+    gReadAheadOwner = NULL;
+
+    if (!success)
+    {
+        ra->error = CE_BAD_SECTOR_READ;
+        ra->inFlight = 0;
+        return;
+    }
+
+    slot = (ra->head + ra->filled) % ra->ringSectors;
+    FSCacheOverlay (ra->sector, ra->inFlight, ra->ring + (DWORD)slot * MEDIA_SECTOR_SIZE);
+    ra->filled += ra->inFlight;
+    ra->inFlight = 0;
+}
+
+// Start reading into the free slots after the filled ones, up to the end
+// of the ring and for as long as the clusters are contiguous
+static void FSReadAheadIssue (FS_READAHEAD * ra)
+{
+    DISK *  dsk = ra->file->dsk;
+    WORD    slot, count, run, take;
+    DWORD   next;
+
+    if (ra->inFlight || ra->error != CE_GOOD || ra->toRequest == 0 ||
+        ra->filled == ra->ringSectors || gReadAheadOwner != NULL)
+        return;
+
+    slot = (ra->head + ra->filled) % ra->ringSectors;
+    count = ra->ringSectors - ra->filled;
+    if (count > ra->ringSectors - slot)
+        count = ra->ringSectors - slot;
+    if (count > ra->toRequest)
+        count = (WORD)ra->toRequest;
+
+    if (ra->sec == dsk->SecPerClus)
+    {
+        next = ReadFAT (dsk, ra->ccls);
+        if (next < 2 || next >= dsk->maxcls + 2)
+        {
+            ra->error = CE_COULD_NOT_GET_CLUSTER;
+            return;
+        }
+        ra->ccls = next;
+        ra->sec = 0;
+    }
+
+    ra->sector = Cluster2Sector (dsk, ra->ccls) + ra->sec;
+    run = 0;
+    for (;;)
+    {
+        take = dsk->SecPerClus - ra->sec;
+        if (take > count - run)
+            take = count - run;
+        run += take;
+        ra->sec += take;
+        if (run == count)
+            break;
+        next = ReadFAT (dsk, ra->ccls);
+        if (next != ra->ccls + 1 || next >= dsk->maxcls + 2)
+            break;
+        ra->ccls = next;
+        ra->sec = 0;
+    }
+
+    if (!FSMediaSectorReadStart (ra->sector, run, ra->ring + (DWORD)slot * MEDIA_SECTOR_SIZE))
+    {
+        ra->error = CE_BAD_SECTOR_READ;
+        return;
+    }
+    ra->inFlight = run;
+    ra->toRequest -= run;
+    gReadAheadOwner = ra;
+}
+
+/*************************************************************************
+  Function:
+    int FSReadAheadBegin (FS_READAHEAD * ra, FSFILE * stream, BYTE * ring, WORD ringSectors)
+  Summary:
+    Start reading a file sequentially in the background
+  Conditions:
+    File opened in a read mode
+  Input:
+    ra -           Read-ahead state, set up by this function
+    stream -       The file to read, from its current position
+    ring -         Buffer of ringSectors * MEDIA_SECTOR_SIZE bytes
+    ringSectors -  Number of sectors to keep in flight or waiting
+  Return Values:
+    0 -   The read-ahead was started
+    EOF - The file can't be read
+  Side Effects:
+    The FSerrno variable will be changed.
+  Description:
+    Starts reading the file into the ring, as many consecutive sectors per
+    media read as the ring and the cluster chain allow.  With a media
+    driver that has split-phase reads (MDD_SectorReadStart and
+    MDD_SectorReadIsComplete in FSconfig.h) the reads run while the
+    application does other work; FSReadAheadRead and FSReadAheadTasks
+    collect them and start the next one without waiting.  Other drivers
+    read each run when it is started.
+  Remarks:
+    Only one read-ahead can have a read in flight at a time.  Any other
+    file system call waits for that read to finish first.  Don't use the
+    file with FSfread or FSfseek until FSReadAheadEnd is called.
+  *************************************************************************/
+
+int FSReadAheadBegin (FS_READAHEAD * ra, FSFILE * stream, BYTE * ring, WORD ringSectors)
+{
+    DISK * dsk = stream->dsk;
+
+    FSerrno = CE_GOOD;
+
+    if (!stream->flags.read)
+    {
+        FSerrno = CE_WRITEONLY;
+        return EOF;
+    }
+    if (ringSectors == 0)
+    {
+        FSerrno = CE_INVALID_ARGUMENT;
+        return EOF;
+    }
+
+#ifdef ALLOW_WRITES
+    if (gNeedDataWrite)
+        if (flushData())
+        {
+            FSerrno = CE_WRITE_ERROR;
+            return EOF;
+        }
+#endif
+
+    memset (ra, 0, sizeof (FS_READAHEAD));
+    ra->file = stream;
+    ra->ring = ring;
+    ra->ringSectors = ringSectors;
+    ra->seek = stream->seek;
+    ra->offset = stream->seek % dsk->sectorSize;
+    ra->ccls = stream->ccls;
+    ra->sec = stream->sec;
+    ra->error = CE_GOOD;
+
+    // pos == sectorSize means the current sector has been used up
+    if (stream->pos == dsk->sectorSize)
+        ra->sec++;
+
+    ra->toRequest = (stream->size + dsk->sectorSize - 1) / dsk->sectorSize - stream->seek / dsk->sectorSize;
+
+    FSReadAheadIssue (ra);
+    return 0;
+}
+
+/*************************************************************************
+  Function:
+    size_t FSReadAheadRead (FS_READAHEAD * ra, void * ptr, size_t len)
+  Summary:
+    Take data that has already been read ahead
+  Conditions:
+    FSReadAheadBegin performed
+  Input:
+    ra -   Read-ahead state
+    ptr -  Destination buffer
+    len -  Most bytes to copy
+  Return:
+    size_t - number of bytes copied, which may be 0 if nothing has arrived yet
+  Side Effects:
+    The FSerrno variable will be changed.
+  Description:
+    Copies up to len bytes that are already in the ring and starts the
+    next read into the space that frees up.  Never waits for the media.
+    FSerrno is CE_EOF at the end of the file, or an error code once the
+    read-ahead has stopped and everything read before the error has been
+    handed out.
+  Remarks:
+    None
+  *************************************************************************/
+
+size_t FSReadAheadRead (FS_READAHEAD * ra, void * ptr, size_t len)
+{
+    DISK *  dsk = ra->file->dsk;
+    BYTE *  dest = (BYTE *) ptr;
+    DWORD   count;
+    size_t  done = 0;
+
+    FSerrno = CE_GOOD;
+
+    FSReadAheadCollect (ra, FALSE);
+
+    while (len && ra->filled && ra->seek < ra->file->size)
+    {
+        count = dsk->sectorSize - ra->offset;
+        if (count > len)
+            count = len;
+        if (count > ra->file->size - ra->seek)
+            count = ra->file->size - ra->seek;
+
+        memcpy (dest, ra->ring + (DWORD)ra->head * MEDIA_SECTOR_SIZE + ra->offset, count);
+        dest += count;
+        done += count;
+        len -= count;
+        ra->seek += count;
+        ra->offset += count;
+
+        if (ra->offset == dsk->sectorSize)
+        {
+            ra->offset = 0;
+            ra->head = (ra->head + 1) % ra->ringSectors;
+            ra->filled--;
+        }
+    }
+
+    FSReadAheadIssue (ra);
+
+    if (ra->seek == ra->file->size)
+        FSerrno = CE_EOF;
+    else if (ra->error != CE_GOOD && ra->filled == 0)
+        FSerrno = ra->error;
+
+    return done;
+}
+
+/*************************************************************************
+  Function:
+    void FSReadAheadTasks (FS_READAHEAD * ra)
+  Summary:
+    Keep a read-ahead going
+  Conditions:
+    FSReadAheadBegin performed
+  Input:
+    ra -  Read-ahead state
+  Return Values:
+    None
+  Side Effects:
+    None
+  Description:
+    Collects a finished read and starts the next one if there is room in
+    the ring.  Call it from the main loop when FSReadAheadRead isn't being
+    called, so the ring fills while the data isn't needed yet.
+  Remarks:
+    None
+  *************************************************************************/
+
+void FSReadAheadTasks (FS_READAHEAD * ra)
+{
+    FSReadAheadCollect (ra, FALSE);
+    FSReadAheadIssue (ra);
+}
+
+/*************************************************************************
+  Function:
+    int FSReadAheadEnd (FS_READAHEAD * ra)
+  Summary:
+    Stop a read-ahead
+  Conditions:
+    FSReadAheadBegin performed
+  Input:
+    ra -  Read-ahead state
+  Return Values:
+    0 -   The file was positioned after the last byte handed out
+    EOF - The file could not be positioned
+  Side Effects:
+    The FSerrno variable will be changed.
+  Description:
+    Waits for a read in flight to finish, then seeks the file to the
+    position after the last byte FSReadAheadRead handed out, so FSfread
+    carries on from there.  The read-ahead is stopped after that; ending
+    it again, or ending one that was never begun (ra zero filled), does
+    nothing and returns 0.
+  Remarks:
+    None
+  *************************************************************************/
+
+int FSReadAheadEnd (FS_READAHEAD * ra)
+{
+    FSFILE * stream = ra->file;
+
+    FSerrno = CE_GOOD;
+    if (stream == NULL)
+        return 0;
+
+    FSReadAheadCollect (ra, TRUE);
+    ra->file = NULL;
+    return FSfseek (stream, ra->seek, SEEK_SET);
+}
+
+
 /***************************************************************************
   Function:
     BYTE FormatFileName( const char* fileName, char* fN2, BYTE mode )
@@ -5750,7 +7328,9 @@ BYTE ValidateChars( char * FileName , BYTE mode)
     to the file and the position will be set to the first byte of that
     cluster.
   Remarks:
-    None
+    In a file opened read only the cluster is found with the file's
+    extent map (see FS_EXTENT_MAP_SIZE), so the FAT is only read for the
+    part of the file that hasn't been seeked into before.
   **********************************************************************/
 
 int FSfseek(FSFILE *stream, long offset, int whence)
@@ -5823,7 +7403,7 @@ int FSfseek(FSFILE *stream, long offset, int whence)
         // if we are in the current cluster stay there
         if (temp > 0)
         {
-            test = FILEget_next_cluster(stream, temp);
+            test = FILEseek_cluster(stream, temp);
             if (test != CE_GOOD)
             {
                 if (test == CE_FAT_EOF)
@@ -5846,8 +7426,7 @@ int FSfseek(FSFILE *stream, long offset, int whence)
                     else
                     {
 #endif
-                        stream->ccls = stream->cluster;
-                        test = FILEget_next_cluster(stream, temp - 1);
+                        test = FILEseek_cluster(stream, temp - 1);
                         if (test != CE_GOOD)
                         {
                             FSerrno = CE_COULD_NOT_GET_CLUSTER;
@@ -84,6 +84,11 @@ Change History:
 // *****************************************************************************
 // *****************************************************************************
 
+// The most sectors moved by one READ10/WRITE10 command.  Longer multi-sector
+// requests are split into several commands.
+#ifndef USB_MSD_SCSI_MAX_SECTORS
+    #define USB_MSD_SCSI_MAX_SECTORS    64
+#endif
 
 // *****************************************************************************
 // *****************************************************************************
@@ -297,6 +302,141 @@ BYTE    USBHostMSDSCSISectorRead( DWORD sectorAddress, BYTE *dataBuffer );
 BYTE    USBHostMSDSCSISectorWrite( DWORD sectorAddress, BYTE *dataBuffer, BYTE allowWriteToZero);
 
 
+/****************************************************************************
+  Function:
+    BYTE USBHostMSDSCSISectorReadMulti( DWORD sectorAddress, DWORD sectorCount,
+                BYTE *dataBuffer )
+
+  Summary:
+    This function reads a run of consecutive sectors.
+
+  Description:
+    This function uses the SCSI command READ10 to read sectorCount sectors
+    starting at sectorAddress, with up to USB_MSD_SCSI_MAX_SECTORS sectors
+    per command.  The data is stored in the application buffer.
+
+  Precondition:
+    None
+
+  Parameters:
+    DWORD   sectorAddress   - address of the first sector to read
+    DWORD   sectorCount     - number of sectors to read
+    BYTE    *dataBuffer     - buffer to store data, sectorCount sectors long
+
+  Return Values:
+    TRUE    - read performed successfully
+    FALSE   - read was not successful
+
+  Remarks:
+    None
+  ***************************************************************************/
+
+BYTE    USBHostMSDSCSISectorReadMulti( DWORD sectorAddress, DWORD sectorCount, BYTE *dataBuffer );
+
+
+/****************************************************************************
+  Function:
+    BYTE USBHostMSDSCSISectorWriteMulti( DWORD sectorAddress, DWORD sectorCount,
+                BYTE *dataBuffer, BYTE allowWriteToZero )
+
+  Summary:
+    This function writes a run of consecutive sectors.
+
+  Description:
+    This function uses the SCSI command WRITE10 to write sectorCount
+    sectors starting at sectorAddress, with up to USB_MSD_SCSI_MAX_SECTORS
+    sectors per command.  The data is read from the application buffer.
+
+  Precondition:
+    None
+
+  Parameters:
+    DWORD   sectorAddress   - address of the first sector to write
+    DWORD   sectorCount     - number of sectors to write
+    BYTE    *dataBuffer     - buffer with application data, sectorCount
+                                sectors long
+    BYTE    allowWriteToZero- If a write to sector 0 is allowed.
+
+  Return Values:
+    TRUE    - write performed successfully
+    FALSE   - write was not successful
+
+  Remarks:
+    This function blocks until the write is complete.
+  ***************************************************************************/
+
+BYTE    USBHostMSDSCSISectorWriteMulti( DWORD sectorAddress, DWORD sectorCount, BYTE *dataBuffer, BYTE allowWriteToZero );
+
+
+/****************************************************************************
+  Function:
+    BYTE USBHostMSDSCSISectorReadStart( DWORD sectorAddress, WORD sectorCount,
+                BYTE *dataBuffer )
+
+  Summary:
+    This function starts reading a run of consecutive sectors and returns
+    without waiting for the data.
+
+  Description:
+    This function issues one READ10 command for sectorCount sectors
+    starting at sectorAddress and returns as soon as the command is on its
+    way.  Use USBHostMSDSCSISectorReadIsComplete() to find out when the
+    data is all there.  Only one split-phase read can be outstanding at a
+    time.
+
+  Precondition:
+    None
+
+  Parameters:
+    DWORD   sectorAddress   - address of the first sector to read
+    WORD    sectorCount     - number of sectors to read
+    BYTE    *dataBuffer     - buffer to store data, sectorCount sectors long.
+                                It must stay valid until the read completes.
+
+  Return Values:
+    TRUE    - read started
+    FALSE   - no device, a read is already outstanding, or the transfer
+                could not be started
+
+  Remarks:
+    The blocking sector functions first wait for an outstanding split-phase
+    read to finish.
+  ***************************************************************************/
+
+BYTE    USBHostMSDSCSISectorReadStart( DWORD sectorAddress, WORD sectorCount, BYTE *dataBuffer );
+
+
+/****************************************************************************
+  Function:
+    BYTE USBHostMSDSCSISectorReadIsComplete( BYTE *success )
+
+  Summary:
+    This function checks whether a split-phase read has finished.
+
+  Description:
+    This function runs the USB tasks once and checks whether the read
+    started by USBHostMSDSCSISectorReadStart() has finished.  It never
+    waits.
+
+  Precondition:
+    None
+
+  Parameters:
+    BYTE    *success        - set to TRUE if the read finished without
+                                error, FALSE otherwise.  Only set when the
+                                function returns TRUE.
+
+  Return Values:
+    TRUE    - no read is outstanding (the last one has finished)
+    FALSE   - the read is still in progress
+
+  Remarks:
+    None
+  ***************************************************************************/
+
+BYTE    USBHostMSDSCSISectorReadIsComplete( BYTE *success );
+
+
 /****************************************************************************
   Function:
     BYTE USBHostMSDSCSIWriteProtectState( void )
@@ -82,6 +82,26 @@ uint8_t ChipKITUSBMSDHost::SCSISectorWrite(DWORD sectorAddress, uint8_t * dataBu
     return(USBHostMSDSCSISectorWrite(sectorAddress,dataBuffer, allowWriteToZero));
 }
 
+uint8_t ChipKITUSBMSDHost::SCSISectorReadMulti(DWORD sectorAddress, DWORD sectorCount, uint8_t * dataBuffer)
+{
+    return(USBHostMSDSCSISectorReadMulti(sectorAddress, sectorCount, dataBuffer));
+}
+
+uint8_t ChipKITUSBMSDHost::SCSISectorWriteMulti(DWORD sectorAddress, DWORD sectorCount, uint8_t * dataBuffer, uint8_t allowWriteToZero)
+{
+    return(USBHostMSDSCSISectorWriteMulti(sectorAddress, sectorCount, dataBuffer, allowWriteToZero));
+}
+
+uint8_t ChipKITUSBMSDHost::SCSISectorReadStart(DWORD sectorAddress, WORD sectorCount, uint8_t * dataBuffer)
+{
+    return(USBHostMSDSCSISectorReadStart(sectorAddress, sectorCount, dataBuffer));
+}
+
+uint8_t ChipKITUSBMSDHost::SCSISectorReadIsComplete(uint8_t * success)
+{
+    return(USBHostMSDSCSISectorReadIsComplete(success));
+}
+
 void ChipKITUSBMSDHost::TerminateTransfer(uint8_t deviceAddress)
 {
     USBHostMSDTerminateTransfer(deviceAddress);
@@ -69,6 +69,10 @@
         BOOL SCSIInitialize(uint8_t address, DWORD flags, uint8_t clientDriverID);
         uint8_t SCSISectorRead(DWORD sectorAddress, uint8_t * dataBuffer);
         uint8_t SCSISectorWrite(DWORD sectorAddress, uint8_t * dataBuffer, uint8_t allowWriteToZero);
+        uint8_t SCSISectorReadMulti(DWORD sectorAddress, DWORD sectorCount, uint8_t * dataBuffer);
+        uint8_t SCSISectorWriteMulti(DWORD sectorAddress, DWORD sectorCount, uint8_t * dataBuffer, uint8_t allowWriteToZero);
+        uint8_t SCSISectorReadStart(DWORD sectorAddress, WORD sectorCount, uint8_t * dataBuffer);
+        uint8_t SCSISectorReadIsComplete(uint8_t * success);
         void TerminateTransfer(uint8_t deviceAddress);
         BOOL TransferIsComplete(uint8_t deviceAddress, uint8_t * errorCode, DWORD * byteCount);
         uint8_t Transfer(uint8_t deviceAddress, uint8_t deviceLUN, uint8_t direction, uint8_t * commandBlock, uint8_t commandBlockLength, uint8_t * data, DWORD dataLength);
@@ -209,6 +209,10 @@
         #define MDD_MediaDetect         USBMSDHost.SCSIMediaDetect
         #define MDD_SectorRead          USBMSDHost.SCSISectorRead
         #define MDD_SectorWrite         USBMSDHost.SCSISectorWrite
+        #define MDD_SectorReadMulti     USBMSDHost.SCSISectorReadMulti
+        #define MDD_SectorWriteMulti    USBMSDHost.SCSISectorWriteMulti
+        #define MDD_SectorReadStart     USBMSDHost.SCSISectorReadStart
+        #define MDD_SectorReadIsComplete    USBMSDHost.SCSISectorReadIsComplete
         #define MDD_InitIO();              
         #define MDD_ShutdownMedia       USBMSDHost.SCSIMediaReset
         #define MDD_WriteProtectState   USBMSDHost.SCSIWriteProtectState
@@ -217,6 +221,10 @@
         #define MDD_MediaDetect         USBHostMSDSCSIMediaDetect
         #define MDD_SectorRead          USBHostMSDSCSISectorRead
         #define MDD_SectorWrite         USBHostMSDSCSISectorWrite
+        #define MDD_SectorReadMulti     USBHostMSDSCSISectorReadMulti
+        #define MDD_SectorWriteMulti    USBHostMSDSCSISectorWriteMulti
+        #define MDD_SectorReadStart     USBHostMSDSCSISectorReadStart
+        #define MDD_SectorReadIsComplete    USBHostMSDSCSISectorReadIsComplete
         #define MDD_InitIO();              
         #define MDD_ShutdownMedia       USBHostMSDSCSIMediaReset
         #define MDD_WriteProtectState   USBHostMSDSCSIWriteProtectState
@@ -0,0 +1,346 @@
+/******************************************************************************
+ *
+ * FileName:        BulkOnlyDevice.c
+ * Dependencies:    usb_host_msd_scsi.c
+ * Processor:       Host (Linux)
+ * Compiler:        gcc
+ *
+ * The simulated bulk-only device, see BulkOnlyDevice.h.  It takes the place
+ * of the MSD class driver's transfer functions and of USBHostTasks(), and
+ * answers READ CAPACITY (10), REQUEST SENSE, READ (10) and WRITE (10).  A
+ * READ10 or WRITE10 is checked the way a strict device would: the
+ * direction has to match the operation code, the CBW's data length has to
+ * be the transfer length in sectors, and the reserved bytes have to be 0,
+ * or the CSW reports a phase error.
+ *
+*****************************************************************************/
+
+#include <string.h>
+#include "GenericTypeDefs.h"
+#include "FSconfig.h"
+#include "MDD File System/FSDefs.h"
+#include "USB/usb.h"
+#include "USB/usb_host_msd.h"
+#include "USB/usb_host_msd_scsi.h"
+#include "BulkOnlyDevice.h"
+
+#define WRITTEN_SECTORS     4096
+
+static BYTE         address;            // 0 while detached
+static unsigned     latency = 3;
+static unsigned     failAfter;          // commands to go before one fails
+static BOT_COMMAND  commandLog[BOT_LOG_SIZE];
+static unsigned     commands;
+static unsigned     busyRefusals;
+static DWORD        nextTag = 1;
+
+// The transfer in progress
+static BOOL         pending;
+static unsigned     pollsLeft;
+static BYTE         cbw[BOT_CBW_SIZE];
+static BYTE *       userData;
+static BYTE         errorCode;
+static DWORD        byteCount;
+
+// Sectors that have been written, the rest read back as BOTPattern()
+static struct
+{
+    DWORD   lba;
+    BYTE    data[BOT_SECTOR_SIZE];
+}                   written[WRITTEN_SECTORS];
+static unsigned     writtenCount;
+
+
+DWORD BOTGetLE32( const BYTE * p )
+{
+    return (DWORD) p[0] | ((DWORD) p[1] << 8) | ((DWORD) p[2] << 16) | ((DWORD) p[3] << 24);
+}
+
+DWORD BOTGetBE32( const BYTE * p )
+{
+    return ((DWORD) p[0] << 24) | ((DWORD) p[1] << 16) | ((DWORD) p[2] << 8) | (DWORD) p[3];
+}
+
+WORD BOTGetBE16( const BYTE * p )
+{
+    return (WORD) ((p[0] << 8) | p[1]);
+}
+
+static void PutLE32( BYTE * p, DWORD value )
+{
+    p[0] = (BYTE) value;
+    p[1] = (BYTE) (value >> 8);
+    p[2] = (BYTE) (value >> 16);
+    p[3] = (BYTE) (value >> 24);
+}
+
+static void PutBE32( BYTE * p, DWORD value )
+{
+    p[0] = (BYTE) (value >> 24);
+    p[1] = (BYTE) (value >> 16);
+    p[2] = (BYTE) (value >> 8);
+    p[3] = (BYTE) value;
+}
+
+void BOTPattern( DWORD lba, BYTE * data )
+{
+    DWORD   seed = lba * 2654435761ul;
+    unsigned i;
+
+    for (i = 0; i < BOT_SECTOR_SIZE; i++)
+        data[i] = (BYTE) ((seed >> 24) + (seed >> 13) + i * 7);
+}
+
+static int FindWritten( DWORD lba )
+{
+    unsigned i;
+
+    for (i = 0; i < writtenCount; i++)
+    {
+        if (written[i].lba == lba)
+            return (int) i;
+    }
+    return -1;
+}
+
+void BOTSector( DWORD lba, BYTE * data )
+{
+    int i = FindWritten( lba );
+
+    if (i < 0)
+        BOTPattern( lba, data );
+    else
+        memcpy( data, written[i].data, BOT_SECTOR_SIZE );
+}
+
+static BOOL WriteSector( DWORD lba, const BYTE * data )
+{
+    int i = FindWritten( lba );
+
+    if (i < 0)
+    {
+        if (writtenCount == WRITTEN_SECTORS)
+            return FALSE;
+        i = (int) writtenCount++;
+        written[i].lba = lba;
+    }
+    memcpy( written[i].data, data, BOT_SECTOR_SIZE );
+    return TRUE;
+}
+
+// The data stage and the CSW: returns the CSW status
+static BYTE Execute( void )
+{
+    const BYTE *    cb = &cbw[BOT_CBW_CB];
+    DWORD           dataLength = BOTGetLE32( &cbw[BOT_CBW_DATA_LENGTH] );
+    BOOL            in = (cbw[BOT_CBW_FLAGS] & 0x80) != 0;
+    DWORD           lba, count, i;
+
+    if ((BOTGetLE32( &cbw[BOT_CBW_SIGNATURE] ) != 0x43425355ul) || (cbw[BOT_CBW_LUN] != 0) ||
+        (cbw[BOT_CBW_CB_LENGTH] < 6) || (cbw[BOT_CBW_CB_LENGTH] > 16))
+    {
+        return BOT_CSW_PHASE_ERROR;
+    }
+
+    switch (cb[0])
+    {
+        case 0x25:      // READ CAPACITY (10)
+            if (!in || (cbw[BOT_CBW_CB_LENGTH] != 10) || (dataLength != 8))
+                return BOT_CSW_PHASE_ERROR;
+            PutBE32( userData, BOT_SECTORS - 1 );
+            PutBE32( userData + 4, BOT_SECTOR_SIZE );
+            byteCount = 8;
+            return BOT_CSW_PASSED;
+
+        case 0x03:      // REQUEST SENSE
+            if (!in || (dataLength != 18))
+                return BOT_CSW_PHASE_ERROR;
+            memset( userData, 0, 18 );
+            userData[0] = 0x70;
+            userData[7] = 10;
+            byteCount = 18;
+            return BOT_CSW_PASSED;
+
+        case 0x28:      // READ (10)
+        case 0x2A:      // WRITE (10)
+            lba = BOTGetBE32( &cb[2] );
+            count = BOTGetBE16( &cb[7] );
+            if ((in != (cb[0] == 0x28)) || (cbw[BOT_CBW_CB_LENGTH] != 10) ||
+                (cb[1] != 0) || (cb[6] != 0) || (cb[9] != 0) ||
+                (dataLength != count * BOT_SECTOR_SIZE))
+            {
+                return BOT_CSW_PHASE_ERROR;
+            }
+            if ((count == 0) || (lba >= BOT_SECTORS) || (count > BOT_SECTORS - lba))
+                return BOT_CSW_FAILED;
+            for (i = 0; i < count; i++)
+            {
+                if (in)
+                    BOTSector( lba + i, userData + i * BOT_SECTOR_SIZE );
+                else if (!WriteSector( lba + i, userData + i * BOT_SECTOR_SIZE ))
+                    return BOT_CSW_FAILED;
+            }
+            byteCount = dataLength;
+            return BOT_CSW_PASSED;
+
+        default:
+            return BOT_CSW_FAILED;
+    }
+}
+
+static void Complete( void )
+{
+    BYTE status;
+
+    byteCount = 0;
+    if (failAfter && (--failAfter == 0))
+        status = BOT_CSW_FAILED;
+    else
+        status = Execute();
+
+    if (commands <= BOT_LOG_SIZE)
+        commandLog[commands - 1].status = status;
+
+    switch (status)
+    {
+        case BOT_CSW_PASSED:        errorCode = USB_SUCCESS;                break;
+        case BOT_CSW_FAILED:        errorCode = USB_MSD_COMMAND_FAILED;     break;
+        default:                    errorCode = USB_MSD_PHASE_ERROR;        break;
+    }
+    pending = FALSE;
+}
+
+
+void BOTAttach( BYTE newAddress )
+{
+    BYTE maxLUN = 0;
+
+    address = newAddress;
+    pending = FALSE;
+    USBHostMSDSCSIInitialize( address, 0, 0 );
+    USBHostMSDSCSIEventHandler( address, EVENT_MSD_MAX_LUN, &maxLUN, 1 );
+}
+
+void BOTDetach( void )
+{
+    BYTE oldAddress = address;
+
+    address = 0;
+    pending = FALSE;
+    USBHostMSDSCSIEventHandler( oldAddress, EVENT_DETACH, &oldAddress, 1 );
+}
+
+void BOTSetLatency( unsigned polls )
+{
+    latency = polls;
+}
+
+void BOTFailCommand( unsigned n )
+{
+    failAfter = n;
+}
+
+void BOTClearLog( void )
+{
+    commands = 0;
+    busyRefusals = 0;
+}
+
+unsigned BOTCommands( void )
+{
+    return commands;
+}
+
+const BOT_COMMAND * BOTCommand( unsigned i )
+{
+    return &commandLog[i];
+}
+
+unsigned BOTBusyRefusals( void )
+{
+    return busyRefusals;
+}
+
+
+// *****************************************************************************
+// The class driver and host stack functions the SCSI layer calls
+// *****************************************************************************
+
+BYTE USBHostMSDTransfer( BYTE deviceAddress, BYTE deviceLUN, BYTE direction, BYTE *commandBlock,
+                         BYTE commandBlockLength, BYTE *data, DWORD dataLength )
+{
+    if ((deviceAddress == 0) || (deviceAddress != address))
+        return USB_MSD_DEVICE_NOT_FOUND;
+    if (pending)
+    {
+        busyRefusals++;
+        return USB_MSD_DEVICE_BUSY;
+    }
+    if (deviceLUN != 0)
+        return USB_MSD_INVALID_LUN;
+
+    // The CBW, as usb_host_msd.c fills in USB_MSD_CBW
+    memset( cbw, 0, sizeof (cbw) );
+    PutLE32( &cbw[BOT_CBW_SIGNATURE], 0x43425355ul );
+    PutLE32( &cbw[BOT_CBW_TAG], nextTag++ );
+    PutLE32( &cbw[BOT_CBW_DATA_LENGTH], dataLength );
+    cbw[BOT_CBW_FLAGS] = direction ? 0x80 : 0x00;
+    cbw[BOT_CBW_LUN] = deviceLUN;
+    cbw[BOT_CBW_CB_LENGTH] = commandBlockLength;
+    memcpy( &cbw[BOT_CBW_CB], commandBlock, commandBlockLength > 16 ? 16 : commandBlockLength );
+
+    if (commands < BOT_LOG_SIZE)
+    {
+        memcpy( commandLog[commands].cbw, cbw, sizeof (cbw) );
+        commandLog[commands].status = 0xFF;
+    }
+    commands++;
+
+    userData = data;
+    pending = TRUE;
+    pollsLeft = latency;
+    if (pollsLeft == 0)
+        Complete();
+    return USB_SUCCESS;
+}
+
+BOOL USBHostMSDTransferIsComplete( BYTE deviceAddress, BYTE *errorCodeOut, DWORD *byteCountOut )
+{
+    if ((deviceAddress == 0) || (deviceAddress != address))
+    {
+        *errorCodeOut = USB_MSD_DEVICE_NOT_FOUND;
+        *byteCountOut = 0;
+        return TRUE;
+    }
+    if (pending)
+        return FALSE;
+    *errorCodeOut = errorCode;
+    *byteCountOut = byteCount;
+    return TRUE;
+}
+
+BYTE USBHostMSDDeviceStatus( BYTE deviceAddress )
+{
+    if ((deviceAddress == 0) || (deviceAddress != address))
+        return USB_MSD_DEVICE_NOT_FOUND;
+    return USB_MSD_NORMAL_RUNNING;
+}
+
+BYTE USBHostMSDResetDevice( BYTE deviceAddress )
+{
+    if ((deviceAddress == 0) || (deviceAddress != address))
+        return USB_MSD_DEVICE_NOT_FOUND;
+    pending = FALSE;
+    errorCode = USB_SUCCESS;
+    byteCount = 0;
+    return USB_SUCCESS;
+}
+
+// USBTasks() is USBHostTasks() alone once usb_common.h has defined it for
+// a host-only stack, which moves the class driver on through its transfer
+// events, so the device answers from here
+void USBHostTasks( void )
+{
+    if (pending && (--pollsLeft == 0))
+        Complete();
+}
@@ -0,0 +1,75 @@
+/******************************************************************************
+ *
+ * FileName:        BulkOnlyDevice.h
+ * Processor:       Host (Linux)
+ * Compiler:        gcc
+ *
+ * A simulated bulk-only mass storage device, standing in for the MSD class
+ * driver (usb_host_msd.c) and the stick behind it.  Each transfer the SCSI
+ * layer starts becomes a CBW laid out the way usb_host_msd.c sends it; the
+ * device checks it, answers after a few polls of the USB tasks, and keeps
+ * a log of the CBWs for the test to look at.
+ *
+*****************************************************************************/
+
+#ifndef _BULK_ONLY_DEVICE_H_
+#define _BULK_ONLY_DEVICE_H_
+
+#include "GenericTypeDefs.h"
+
+#define BOT_SECTOR_SIZE         512
+#define BOT_SECTORS             0x40000000ul    // what READ CAPACITY reports
+#define BOT_CBW_SIZE            31
+#define BOT_LOG_SIZE            1024
+
+// CBW fields, by byte offset (the DWORDs are little endian)
+#define BOT_CBW_SIGNATURE       0
+#define BOT_CBW_TAG             4
+#define BOT_CBW_DATA_LENGTH     8
+#define BOT_CBW_FLAGS           12
+#define BOT_CBW_LUN             13
+#define BOT_CBW_CB_LENGTH       14
+#define BOT_CBW_CB              15
+
+// CSW status
+#define BOT_CSW_PASSED          0
+#define BOT_CSW_FAILED          1
+#define BOT_CSW_PHASE_ERROR     2
+
+typedef struct
+{
+    BYTE    cbw[BOT_CBW_SIZE];  // as the class driver sent it
+    BYTE    status;             // the CSW status the device answered with
+} BOT_COMMAND;
+
+// Plug the device in at address (the SCSI layer's Initialize and the max
+// LUN event, as the class driver gives them), or pull it out
+void    BOTAttach( BYTE address );
+void    BOTDetach( void );
+
+// Polls of the USB tasks before a command's data and CSW come back
+void    BOTSetLatency( unsigned polls );
+
+// The nth command from now (1 is the next) fails with a CSW status of
+// BOT_CSW_FAILED and moves no data; 0 for none
+void    BOTFailCommand( unsigned n );
+
+// The commands since BOTClearLog(), the first BOT_LOG_SIZE of them
+void    BOTClearLog( void );
+unsigned BOTCommands( void );
+const BOT_COMMAND * BOTCommand( unsigned i );
+
+// Transfers started while one was still in progress, which the class
+// driver refuses with USB_MSD_DEVICE_BUSY
+unsigned BOTBusyRefusals( void );
+
+// What the device holds: a pattern, except where it has been written
+void    BOTPattern( DWORD lba, BYTE * data );
+void    BOTSector( DWORD lba, BYTE * data );
+
+// Little and big endian fields of a CBW
+DWORD   BOTGetLE32( const BYTE * p );
+DWORD   BOTGetBE32( const BYTE * p );
+WORD    BOTGetBE16( const BYTE * p );
+
+#endif
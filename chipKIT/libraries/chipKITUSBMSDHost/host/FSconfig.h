@@ -0,0 +1,30 @@
+/******************************************************************************
+ *
+ * FileName:        FSconfig.h
+ * Processor:       Host (Linux)
+ * Compiler:        gcc
+ *
+ * The USB interface part of the sketch's FSconfig.h, for building the SCSI
+ * layer on a PC against the simulated device in BulkOnlyDevice.c.
+ *
+*****************************************************************************/
+
+#ifndef _FS_DEF_
+
+#define USE_USB_INTERFACE
+
+#ifndef MEDIA_SECTOR_SIZE
+#define MEDIA_SECTOR_SIZE       512
+#endif
+
+#define MDD_MediaInitialize     USBHostMSDSCSIMediaInitialize
+#define MDD_MediaDetect         USBHostMSDSCSIMediaDetect
+#define MDD_SectorRead          USBHostMSDSCSISectorRead
+#define MDD_SectorWrite         USBHostMSDSCSISectorWrite
+#define MDD_SectorReadMulti     USBHostMSDSCSISectorReadMulti
+#define MDD_SectorWriteMulti    USBHostMSDSCSISectorWriteMulti
+#define MDD_InitIO();
+#define MDD_ShutdownMedia       USBHostMSDSCSIMediaReset
+#define MDD_WriteProtectState   USBHostMSDSCSIWriteProtectState
+
+#endif
@@ -0,0 +1,32 @@
+/******************************************************************************
+ *
+ * FileName:        GenericTypeDefs.h
+ * Processor:       Host (Linux)
+ * Compiler:        gcc
+ *
+ * The few Microchip types the file system and the USB stack's headers
+ * use, for the host build.  On the PIC32 this header comes with the
+ * compiler; the sizes here match it.
+ *
+*****************************************************************************/
+
+#ifndef __GENERIC_TYPE_DEFS_H_
+#define __GENERIC_TYPE_DEFS_H_
+
+#include <stdint.h>
+
+typedef uint8_t         BYTE;       // 8-bit unsigned
+typedef uint16_t        WORD;       // 16-bit unsigned
+typedef uint32_t        DWORD;      // 32-bit unsigned
+typedef uint32_t        UINT32;     // 32-bit unsigned
+
+typedef unsigned char   BOOL;
+
+#ifndef FALSE
+    #define FALSE   0
+#endif
+#ifndef TRUE
+    #define TRUE    1
+#endif
+
+#endif
@@ -0,0 +1,15 @@
+/******************************************************************************
+ *
+ * FileName:        HardwareProfile.h
+ * Processor:       Host (Linux)
+ * Compiler:        gcc
+ *
+ * The SCSI layer includes the board's hardware profile but uses nothing
+ * from it; this stands in for it in the host build.
+ *
+*****************************************************************************/
+
+#ifndef _HARDWARE_PROFILE_H_
+#define _HARDWARE_PROFILE_H_
+
+#endif
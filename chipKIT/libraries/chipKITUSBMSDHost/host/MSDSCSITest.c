@@ -0,0 +1,351 @@
+/******************************************************************************
+ *
+ * FileName:        MSDSCSITest.c
+ * Dependencies:    usb_host_msd_scsi.c, BulkOnlyDevice.c
+ * Processor:       Host (Linux)
+ * Compiler:        gcc
+ *
+ * Runs the SCSI layer's sector functions against the simulated bulk-only
+ * device and checks the CBW of every READ10 and WRITE10 they send: the
+ * operation code, the big endian address and transfer length, the data
+ * length and direction; that the multi-sector calls split runs into
+ * commands of USB_MSD_SCSI_MAX_SECTORS; that sector 0 is only written when
+ * allowed; that a failing command stops a run; and that the split-phase
+ * read and the blocking calls don't trip over each other.
+ *
+*****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "GenericTypeDefs.h"
+#include "FSconfig.h"
+#include "MDD File System/FSDefs.h"
+#include "USB/usb.h"
+#include "USB/usb_host_msd.h"
+#include "USB/usb_host_msd_scsi.h"
+#include "BulkOnlyDevice.h"
+
+#define DEVICE          1
+#define MAX_RUN         300
+
+static unsigned long failures;
+
+#define CHECK(cond)     Check ((cond), #cond, __LINE__)
+
+static void Check (BOOL ok, const char * what, int line)
+{
+    if (!ok && failures++ < 20)
+        printf ("FAIL line %d: %s\n", line, what);
+}
+
+static BYTE buffer[MAX_RUN * BOT_SECTOR_SIZE];
+static BYTE other[MAX_RUN * BOT_SECTOR_SIZE];
+
+// The device holds what the buffer has, sector by sector
+static BOOL Holds (DWORD lba, DWORD count, const BYTE * data)
+{
+    BYTE sector[BOT_SECTOR_SIZE];
+    DWORD i;
+
+    for (i = 0; i < count; i++)
+    {
+        BOTSector (lba + i, sector);
+        if (memcmp (sector, data + i * BOT_SECTOR_SIZE, BOT_SECTOR_SIZE))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static void Fill (BYTE * data, DWORD count, BYTE seed)
+{
+    DWORD i;
+
+    for (i = 0; i < count * BOT_SECTOR_SIZE; i++)
+        data[i] = (BYTE) (seed + i * 13 + (i >> 9));
+}
+
+// Command i of the log is a READ10 (0x28) or WRITE10 (0x2A) of count
+// sectors at lba, and the device passed it
+static void CheckCommand (unsigned i, BYTE operationCode, DWORD lba, WORD count, int line)
+{
+    const BOT_COMMAND * c = BOTCommand (i);
+    const BYTE * cb = &c->cbw[BOT_CBW_CB];
+    BOOL ok;
+
+    ok = BOTGetLE32 (&c->cbw[BOT_CBW_SIGNATURE]) == 0x43425355ul
+        && BOTGetLE32 (&c->cbw[BOT_CBW_DATA_LENGTH]) == (DWORD) count * BOT_SECTOR_SIZE
+        && c->cbw[BOT_CBW_FLAGS] == (operationCode == 0x28 ? 0x80 : 0x00)
+        && c->cbw[BOT_CBW_LUN] == 0
+        && c->cbw[BOT_CBW_CB_LENGTH] == 10
+        && cb[0] == operationCode && cb[1] == 0
+        && cb[2] == (BYTE) (lba >> 24) && cb[3] == (BYTE) (lba >> 16)
+        && cb[4] == (BYTE) (lba >> 8) && cb[5] == (BYTE) lba
+        && cb[6] == 0
+        && cb[7] == (BYTE) (count >> 8) && cb[8] == (BYTE) count
+        && cb[9] == 0
+        && c->status == BOT_CSW_PASSED;
+
+    if (!ok && failures++ < 20)
+        printf ("FAIL line %d: command %u is not 0x%02X of %u at 0x%08lX: "
+                "%02X %02X %02X %02X %02X %02X %02X %02X %02X %02X, length %lu, flags %02X, status %u\n",
+                line, i, operationCode, count, (unsigned long) lba,
+                cb[0], cb[1], cb[2], cb[3], cb[4], cb[5], cb[6], cb[7], cb[8], cb[9],
+                (unsigned long) BOTGetLE32 (&c->cbw[BOT_CBW_DATA_LENGTH]), c->cbw[BOT_CBW_FLAGS], c->status);
+}
+
+// The log holds one command per USB_MSD_SCSI_MAX_SECTORS of the run
+static void CheckRun (unsigned first, BYTE operationCode, DWORD lba, DWORD count, int line)
+{
+    WORD n;
+
+    while (count)
+    {
+        n = count > USB_MSD_SCSI_MAX_SECTORS ? USB_MSD_SCSI_MAX_SECTORS : (WORD) count;
+        CheckCommand (first++, operationCode, lba, n, line);
+        lba += n;
+        count -= n;
+    }
+    if (BOTCommands () != first && failures++ < 20)
+        printf ("FAIL line %d: %u commands, want %u\n", line, BOTCommands (), first);
+}
+
+static unsigned Commands (DWORD count)
+{
+    return (count + USB_MSD_SCSI_MAX_SECTORS - 1) / USB_MSD_SCSI_MAX_SECTORS;
+}
+
+static void TestMedia (void)
+{
+    MEDIA_INFORMATION * media;
+
+    BOTClearLog ();
+    media = USBHostMSDSCSIMediaInitialize ();
+    CHECK (media->errorCode == MEDIA_NO_ERROR);
+    CHECK (media->validityFlags.bits.sectorSize && media->sectorSize == BOT_SECTOR_SIZE);
+    CHECK (BOTCommands () == 1 && BOTCommand (0)->cbw[BOT_CBW_CB] == 0x25);
+    CHECK (USBHostMSDSCSIMediaDetect ());
+}
+
+static void TestRead (void)
+{
+    static const DWORD addresses[] = { 0x00000001ul, 0x00001234ul, 0x00ABCDEFul, 0x12345678ul,
+                                       BOT_SECTORS - MAX_RUN };
+    static const DWORD counts[] = { 1, 2, USB_MSD_SCSI_MAX_SECTORS - 1, USB_MSD_SCSI_MAX_SECTORS,
+                                    USB_MSD_SCSI_MAX_SECTORS + 1, 2 * USB_MSD_SCSI_MAX_SECTORS, MAX_RUN };
+    unsigned a, n;
+
+    // one sector
+    BOTClearLog ();
+    memset (buffer, 0, BOT_SECTOR_SIZE);
+    CHECK (USBHostMSDSCSISectorRead (0x00102030ul, buffer));
+    CheckRun (0, 0x28, 0x00102030ul, 1, __LINE__);
+    CHECK (Holds (0x00102030ul, 1, buffer));
+
+    // runs, split into USB_MSD_SCSI_MAX_SECTORS at a time
+    for (a = 0; a < sizeof (addresses) / sizeof (addresses[0]); a++)
+    {
+        for (n = 0; n < sizeof (counts) / sizeof (counts[0]); n++)
+        {
+            BOTClearLog ();
+            memset (buffer, 0, counts[n] * BOT_SECTOR_SIZE);
+            CHECK (USBHostMSDSCSISectorReadMulti (addresses[a], counts[n], buffer));
+            CheckRun (0, 0x28, addresses[a], counts[n], __LINE__);
+            CHECK (Holds (addresses[a], counts[n], buffer));
+        }
+    }
+
+    // nothing to read is no command at all
+    BOTClearLog ();
+    CHECK (USBHostMSDSCSISectorReadMulti (100, 0, buffer));
+    CHECK (BOTCommands () == 0);
+
+    printf ("%u sectors read with %u commands\n", MAX_RUN, Commands (MAX_RUN));
+}
+
+static void TestWrite (void)
+{
+    BYTE saved[BOT_SECTOR_SIZE];
+
+    // one sector
+    BOTClearLog ();
+    Fill (buffer, 1, 1);
+    CHECK (USBHostMSDSCSISectorWrite (77, buffer, FALSE));
+    CheckRun (0, 0x2A, 77, 1, __LINE__);
+    CHECK (Holds (77, 1, buffer));
+
+    // a run, and read back with a run that starts part way into it
+    BOTClearLog ();
+    Fill (buffer, 200, 2);
+    CHECK (USBHostMSDSCSISectorWriteMulti (0x00ABCD00ul, 200, buffer, FALSE));
+    CheckRun (0, 0x2A, 0x00ABCD00ul, 200, __LINE__);
+    CHECK (Holds (0x00ABCD00ul, 200, buffer));
+    CHECK (USBHostMSDSCSISectorReadMulti (0x00ABCD00ul + 10, 190, other));
+    CHECK (!memcmp (other, buffer + 10 * BOT_SECTOR_SIZE, 190 * BOT_SECTOR_SIZE));
+
+    // sector 0 only when it is allowed, and nothing is sent when it isn't
+    BOTSector (0, saved);
+    Fill (buffer, 3, 3);
+    BOTClearLog ();
+    CHECK (!USBHostMSDSCSISectorWrite (0, buffer, FALSE));
+    CHECK (!USBHostMSDSCSISectorWriteMulti (0, 3, buffer, FALSE));
+    CHECK (BOTCommands () == 0);
+    CHECK (Holds (0, 1, saved));
+
+    // a run from sector 1 isn't guarded
+    CHECK (USBHostMSDSCSISectorWriteMulti (1, 2, buffer, FALSE));
+    CheckRun (0, 0x2A, 1, 2, __LINE__);
+    CHECK (Holds (1, 2, buffer));
+
+    BOTClearLog ();
+    CHECK (USBHostMSDSCSISectorWrite (0, buffer, TRUE));
+    CheckRun (0, 0x2A, 0, 1, __LINE__);
+    CHECK (Holds (0, 1, buffer));
+    BOTClearLog ();
+    CHECK (USBHostMSDSCSISectorWriteMulti (0, 3, buffer, TRUE));
+    CheckRun (0, 0x2A, 0, 3, __LINE__);
+    CHECK (Holds (0, 3, buffer));
+
+    // nothing to write is no command at all
+    BOTClearLog ();
+    CHECK (USBHostMSDSCSISectorWriteMulti (100, 0, buffer, FALSE));
+    CHECK (BOTCommands () == 0);
+}
+
+static void TestErrors (void)
+{
+    DWORD lba = 0x00200000ul;
+    unsigned fail;
+
+    // a read run stops at the command that fails
+    for (fail = 1; fail <= Commands (MAX_RUN); fail++)
+    {
+        BOTClearLog ();
+        BOTFailCommand (fail);
+        CHECK (!USBHostMSDSCSISectorReadMulti (lba, MAX_RUN, buffer));
+        CHECK (BOTCommands () == fail);
+        CHECK (BOTCommand (fail - 1)->status == BOT_CSW_FAILED);
+    }
+
+    // and so does a write run, with the commands before it on the device
+    // and none of the sectors after it
+    Fill (buffer, MAX_RUN, 4);
+    for (fail = 1; fail <= Commands (MAX_RUN); fail++)
+    {
+        BOTClearLog ();
+        BOTFailCommand (fail);
+        CHECK (!USBHostMSDSCSISectorWriteMulti (lba, MAX_RUN, buffer, FALSE));
+        CHECK (BOTCommands () == fail);
+        CHECK (Holds (lba, (fail - 1) * USB_MSD_SCSI_MAX_SECTORS, buffer));
+        if (fail < Commands (MAX_RUN))
+            CHECK (!Holds (lba + fail * USB_MSD_SCSI_MAX_SECTORS, 1, buffer + fail * USB_MSD_SCSI_MAX_SECTORS * BOT_SECTOR_SIZE));
+        lba += MAX_RUN;
+    }
+
+    // the single sector calls say so too
+    BOTFailCommand (1);
+    CHECK (!USBHostMSDSCSISectorRead (5, buffer));
+    BOTFailCommand (1);
+    CHECK (!USBHostMSDSCSISectorWrite (5, buffer, FALSE));
+
+    // past the end of the device
+    BOTClearLog ();
+    CHECK (!USBHostMSDSCSISectorReadMulti (BOT_SECTORS - 10, 20, buffer));
+    CHECK (BOTCommands () == 1 && BOTCommand (0)->status == BOT_CSW_FAILED);
+
+    // and the next run after an error goes through
+    BOTClearLog ();
+    CHECK (USBHostMSDSCSISectorReadMulti (lba, MAX_RUN, buffer));
+    CheckRun (0, 0x28, lba, MAX_RUN, __LINE__);
+}
+
+static void TestSplitPhase (void)
+{
+    DWORD lba = 0x01020304ul;
+    BYTE success;
+    unsigned polls;
+
+    // one READ10 for the whole run, however long
+    BOTClearLog ();
+    BOTSetLatency (10);
+    memset (buffer, 0, MAX_RUN * BOT_SECTOR_SIZE);
+    CHECK (USBHostMSDSCSISectorReadStart (lba, MAX_RUN, buffer));
+    CHECK (!USBHostMSDSCSISectorReadStart (lba, 1, other));
+    for (polls = 0; !USBHostMSDSCSISectorReadIsComplete (&success); polls++)
+        ;
+    CHECK (polls > 0 && success);
+    CheckCommand (0, 0x28, lba, MAX_RUN, __LINE__);
+    CHECK (BOTCommands () == 1);
+    CHECK (Holds (lba, MAX_RUN, buffer));
+    CHECK (USBHostMSDSCSISectorReadIsComplete (&success) && success);
+
+    // a blocking read while one is outstanding waits for it, and the
+    // result is still there for ReadIsComplete
+    BOTClearLog ();
+    memset (buffer, 0, 8 * BOT_SECTOR_SIZE);
+    CHECK (USBHostMSDSCSISectorReadStart (lba + 1000, 8, buffer));
+    CHECK (USBHostMSDSCSISectorReadMulti (lba + 2000, 70, other));
+    CHECK (BOTBusyRefusals () == 0);
+    CheckCommand (0, 0x28, lba + 1000, 8, __LINE__);
+    CheckRun (1, 0x28, lba + 2000, 70, __LINE__);
+    CHECK (Holds (lba + 1000, 8, buffer));
+    CHECK (Holds (lba + 2000, 70, other));
+    CHECK (USBHostMSDSCSISectorReadIsComplete (&success) && success);
+
+    // and so does a write
+    BOTClearLog ();
+    Fill (other, 4, 5);
+    CHECK (USBHostMSDSCSISectorReadStart (lba, 4, buffer));
+    CHECK (USBHostMSDSCSISectorWriteMulti (lba + 4, 4, other, FALSE));
+    CHECK (BOTBusyRefusals () == 0 && BOTCommands () == 2);
+    CHECK (Holds (lba + 4, 4, other));
+
+    // a failed split-phase read
+    BOTClearLog ();
+    BOTFailCommand (1);
+    CHECK (USBHostMSDSCSISectorReadStart (lba, 4, buffer));
+    while (!USBHostMSDSCSISectorReadIsComplete (&success))
+        ;
+    CHECK (!success);
+    CHECK (!USBHostMSDSCSISectorReadStart (lba, 0, buffer));
+    BOTSetLatency (3);
+}
+
+static void TestDetached (void)
+{
+    BYTE success;
+
+    // an outstanding read ends with the device
+    CHECK (USBHostMSDSCSISectorReadStart (1, 4, buffer));
+    BOTDetach ();
+    CHECK (USBHostMSDSCSISectorReadIsComplete (&success) && !success);
+
+    // and nothing more is sent to it
+    BOTClearLog ();
+    CHECK (!USBHostMSDSCSIMediaDetect ());
+    CHECK (!USBHostMSDSCSISectorRead (1, buffer));
+    CHECK (!USBHostMSDSCSISectorReadMulti (1, 10, buffer));
+    CHECK (!USBHostMSDSCSISectorWrite (1, buffer, TRUE));
+    CHECK (!USBHostMSDSCSISectorWriteMulti (1, 10, buffer, TRUE));
+    CHECK (!USBHostMSDSCSISectorReadStart (1, 4, buffer));
+    CHECK (BOTCommands () == 0);
+}
+
+int main (void)
+{
+    BOTAttach (DEVICE);
+
+    TestMedia ();
+    TestRead ();
+    TestWrite ();
+    TestErrors ();
+    TestSplitPhase ();
+    TestDetached ();
+
+    if (failures)
+    {
+        printf ("MSDSCSITest: %lu failures\n", failures);
+        return 1;
+    }
+    printf ("MSDSCSITest: ok\n");
+    return 0;
+}
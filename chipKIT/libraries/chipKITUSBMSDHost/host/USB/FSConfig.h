@@ -0,0 +1,14 @@
+/******************************************************************************
+ *
+ * FileName:        FSConfig.h
+ * Processor:       Host (Linux)
+ * Compiler:        gcc
+ *
+ * usb_host_msd_scsi.h spells it this way, which only works where file
+ * names don't care about case.  It lives in USB/, on the include path
+ * after this folder, so it doesn't sit next to FSconfig.h on a checkout
+ * where they would be the same file.
+ *
+*****************************************************************************/
+
+#include "FSconfig.h"
@@ -0,0 +1,25 @@
+/******************************************************************************
+ *
+ * FileName:        usb.h
+ * Processor:       Host (Linux)
+ * Compiler:        gcc
+ *
+ * Takes the place of the USB stack's usb.h, which pulls in the host
+ * controller driver and the HAL for the chip.  The SCSI layer only needs
+ * the common codes and events, and USBHostTasks() for USBTasks() to run;
+ * BulkOnlyDevice.c has that.
+ *
+*****************************************************************************/
+
+#ifndef _USB_H_
+#define _USB_H_
+
+// The part of usb_config.h that usb_common.h checks
+#define USB_SUPPORT_HOST
+
+#include "GenericTypeDefs.h"
+#include "USB/usb_common.h"
+
+void    USBHostTasks( void );
+
+#endif
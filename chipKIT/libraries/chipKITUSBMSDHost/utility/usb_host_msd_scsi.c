@@ -104,6 +104,10 @@ Change History:
     BOOL    _USBHostMSDSCSI_TestUnitReady( void );
 #endif
 
+BYTE    _USBHostMSDSCSI_Start10( BYTE operationCode, DWORD sectorAddress, WORD sectorCount, BYTE *dataBuffer );
+BYTE    _USBHostMSDSCSI_ReadWrite10( BYTE operationCode, DWORD sectorAddress, WORD sectorCount, BYTE *dataBuffer );
+BOOL    _USBHostMSDSCSI_ReadDone( void );
+
 
 //******************************************************************************
 //******************************************************************************
@@ -116,6 +120,8 @@ Change History:
 //******************************************************************************
 
 static BYTE                deviceAddress = 0;  // USB address of the attached device.
+static BYTE                readPending = FALSE;    // A split-phase read has been started and not collected.
+static BYTE                readSuccess = FALSE;    // Result of the last split-phase read.
 static MEDIA_INFORMATION   mediaInformation;   // Information about the attached media.
 
 // *****************************************************************************
@@ -541,10 +547,6 @@ BYTE USBHostMSDSCSIMediaReset( void  )
 
 BYTE USBHostMSDSCSISectorRead( DWORD sectorAddress, BYTE *dataBuffer )
 {
-    DWORD   byteCount;
-    BYTE    commandBlock[10];
-    BYTE    errorCode;
-
     #ifdef DEBUG_MODE
         UART2PrintString( "SCSI: Reading sector " );
         UART2PutHex(sectorAddress >> 24);
@@ -561,49 +563,61 @@ BYTE USBHostMSDSCSISectorRead( DWORD sectorAddress, BYTE *dataBuffer )
         return FALSE;       // USB_MSD_DEVICE_NOT_FOUND;
     }
 
-    // Fill in the command block with the READ10 parameters.
-    commandBlock[0] = 0x28;     // Operation code
-    commandBlock[1] = RDPROTECT_NORMAL | FUA_ALLOW_CACHE;
-    commandBlock[2] = (BYTE) (sectorAddress >> 24);     // Big endian!
-    commandBlock[3] = (BYTE) (sectorAddress >> 16);
-    commandBlock[4] = (BYTE) (sectorAddress >> 8);
-    commandBlock[5] = (BYTE) (sectorAddress);
-    commandBlock[6] = 0x00;     // Group Number
-    commandBlock[7] = 0x00;     // Number of blocks - Big endian!
-    commandBlock[8] = 0x01;
-    commandBlock[9] = 0x00;     // Control
+    return _USBHostMSDSCSI_ReadWrite10( 0x28, sectorAddress, 1, dataBuffer );
+}
 
-    // Currently using LUN=0.  When the File System supports multiple LUN's, this will change.
-    errorCode = USBHostMSDRead( deviceAddress, 0, commandBlock, 10, dataBuffer, mediaInformation.sectorSize );
-    #ifdef DEBUG_MODE
-        UART2PrintString( "SCSI: Read sector init error " );
-        UART2PutHex( errorCode );
-        UART2PrintString( "\r\n" );
-    #endif
+/****************************************************************************
+  Function:
+    BYTE USBHostMSDSCSISectorReadMulti( DWORD sectorAddress, DWORD sectorCount,
+                BYTE *dataBuffer )
 
-    if (!errorCode)
-    {
-        while (!USBHostMSDTransferIsComplete( deviceAddress, &errorCode, &byteCount ))
-        {
-            USBTasks();
-        }
-    }
+  Summary:
+    This function reads a run of consecutive sectors.
 
-    #ifdef DEBUG_MODE
-        UART2PrintString( "SCSI: Read sector error " );
-        UART2PutHex( errorCode );
-        UART2PrintString( "\r\n" );
-    #endif
+  Description:
+    This function uses the SCSI command READ10 to read sectorCount sectors
+    starting at sectorAddress, with up to USB_MSD_SCSI_MAX_SECTORS sectors
+    per command, so a long read costs one CBW/data/CSW round trip per
+    USB_MSD_SCSI_MAX_SECTORS sectors instead of one per sector.  The data
+    is stored in the application buffer.
 
-    if (!errorCode)
+  Precondition:
+    None
+
+  Parameters:
+    DWORD   sectorAddress   - address of the first sector to read
+    DWORD   sectorCount     - number of sectors to read
+    BYTE    *dataBuffer     - buffer to store data, sectorCount sectors long
+
+  Return Values:
+    TRUE    - read performed successfully
+    FALSE   - read was not successful
+
+  Remarks:
+    See USBHostMSDSCSISectorRead() for the READ10 command block.
+  ***************************************************************************/
+
+BYTE USBHostMSDSCSISectorReadMulti( DWORD sectorAddress, DWORD sectorCount, BYTE *dataBuffer )
+{
+    WORD    count;
+
+    if (deviceAddress == 0)
     {
-        return TRUE;
+        return FALSE;       // USB_MSD_DEVICE_NOT_FOUND;
     }
-    else
+
+    while (sectorCount)
     {
-//        USBHostMSDSCSIMediaReset();
-        return FALSE;
+        count = (sectorCount > USB_MSD_SCSI_MAX_SECTORS) ? USB_MSD_SCSI_MAX_SECTORS : (WORD)sectorCount;
+        if (!_USBHostMSDSCSI_ReadWrite10( 0x28, sectorAddress, count, dataBuffer ))
+        {
+            return FALSE;
+        }
+        sectorAddress += count;
+        sectorCount   -= count;
+        dataBuffer    += (DWORD)count * mediaInformation.sectorSize;
     }
+    return TRUE;
 }
 
 /****************************************************************************
@@ -652,10 +666,6 @@ BYTE USBHostMSDSCSISectorRead( DWORD sectorAddress, BYTE *dataBuffer )
 
 BYTE USBHostMSDSCSISectorWrite( DWORD sectorAddress, BYTE *dataBuffer, BYTE allowWriteToZero )
 {
-    DWORD   byteCount;
-    BYTE    commandBlock[10];
-    BYTE    errorCode;
-
     #ifdef DEBUG_MODE
         UART2PrintString( "SCSI: Writing sector " );
         UART2PutHex(sectorAddress >> 24);
@@ -677,22 +687,292 @@ BYTE USBHostMSDSCSISectorWrite( DWORD sectorAddress, BYTE *dataBuffer, BYTE allo
         return FALSE;
     }
 
-    // Fill in the command block with the WRITE 10 parameters.
-    commandBlock[0] = 0x2A;     // Operation code
-    commandBlock[1] = WRPROTECT_NORMAL | FUA_ALLOW_CACHE;
+    return _USBHostMSDSCSI_ReadWrite10( 0x2A, sectorAddress, 1, dataBuffer );
+}
+
+/****************************************************************************
+  Function:
+    BYTE USBHostMSDSCSISectorWriteMulti( DWORD sectorAddress, DWORD sectorCount,
+                BYTE *dataBuffer, BYTE allowWriteToZero )
+
+  Summary:
+    This function writes a run of consecutive sectors.
+
+  Description:
+    This function uses the SCSI command WRITE10 to write sectorCount
+    sectors starting at sectorAddress, with up to USB_MSD_SCSI_MAX_SECTORS
+    sectors per command.  The data is read from the application buffer.
+
+  Precondition:
+    None
+
+  Parameters:
+    DWORD   sectorAddress   - address of the first sector to write
+    DWORD   sectorCount     - number of sectors to write
+    BYTE    *dataBuffer     - buffer with application data, sectorCount
+                                sectors long
+    BYTE    allowWriteToZero- If a write to sector 0 is allowed.
+
+  Return Values:
+    TRUE    - write performed successfully
+    FALSE   - write was not successful
+
+  Remarks:
+    This function blocks until the write is complete.  See
+    USBHostMSDSCSISectorWrite() for the WRITE10 command block.
+  ***************************************************************************/
+
+BYTE USBHostMSDSCSISectorWriteMulti( DWORD sectorAddress, DWORD sectorCount, BYTE *dataBuffer, BYTE allowWriteToZero )
+{
+    WORD    count;
+
+    if (deviceAddress == 0)
+    {
+        return FALSE;   //USB_MSD_DEVICE_NOT_FOUND;
+    }
+
+    if ((sectorAddress == 0) && (allowWriteToZero == FALSE))
+    {
+        return FALSE;
+    }
+
+    while (sectorCount)
+    {
+        count = (sectorCount > USB_MSD_SCSI_MAX_SECTORS) ? USB_MSD_SCSI_MAX_SECTORS : (WORD)sectorCount;
+        if (!_USBHostMSDSCSI_ReadWrite10( 0x2A, sectorAddress, count, dataBuffer ))
+        {
+            return FALSE;
+        }
+        sectorAddress += count;
+        sectorCount   -= count;
+        dataBuffer    += (DWORD)count * mediaInformation.sectorSize;
+    }
+    return TRUE;
+}
+
+
+/****************************************************************************
+  Function:
+    BYTE USBHostMSDSCSISectorReadStart( DWORD sectorAddress, WORD sectorCount,
+                BYTE *dataBuffer )
+
+  Summary:
+    This function starts reading a run of consecutive sectors and returns
+    without waiting for the data.
+
+  Description:
+    This function issues one READ10 command for sectorCount sectors
+    starting at sectorAddress and returns as soon as the command is on its
+    way.  The data lands in dataBuffer as the USB tasks run; use
+    USBHostMSDSCSISectorReadIsComplete() to find out when it is all there.
+    Only one split-phase read can be outstanding at a time.
+
+  Precondition:
+    None
+
+  Parameters:
+    DWORD   sectorAddress   - address of the first sector to read
+    WORD    sectorCount     - number of sectors to read
+    BYTE    *dataBuffer     - buffer to store data, sectorCount sectors long.
+                                It must stay valid until the read completes.
+
+  Return Values:
+    TRUE    - read started
+    FALSE   - no device, a read is already outstanding, or the transfer
+                could not be started
+
+  Remarks:
+    The blocking sector functions first wait for an outstanding split-phase
+    read to finish.  Its result is still returned by the next call to
+    USBHostMSDSCSISectorReadIsComplete().
+  ***************************************************************************/
+
+BYTE USBHostMSDSCSISectorReadStart( DWORD sectorAddress, WORD sectorCount, BYTE *dataBuffer )
+{
+    if ((deviceAddress == 0) || readPending || (sectorCount == 0))
+    {
+        return FALSE;
+    }
+
+    if (_USBHostMSDSCSI_Start10( 0x28, sectorAddress, sectorCount, dataBuffer ))
+    {
+        return FALSE;
+    }
+
+    readPending = TRUE;
+    readSuccess = FALSE;
+    return TRUE;
+}
+
+/****************************************************************************
+  Function:
+    BYTE USBHostMSDSCSISectorReadIsComplete( BYTE *success )
+
+  Summary:
+    This function checks whether a split-phase read has finished.
+
+  Description:
+    This function runs the USB tasks once and checks whether the read
+    started by USBHostMSDSCSISectorReadStart() has finished.  It never
+    waits, so it can be called from the main loop between other work.
+
+  Precondition:
+    None
+
+  Parameters:
+    BYTE    *success        - set to TRUE if the read finished without
+                                error, FALSE otherwise.  Only set when the
+                                function returns TRUE.
+
+  Return Values:
+    TRUE    - no read is outstanding (the last one has finished)
+    FALSE   - the read is still in progress
+
+  Remarks:
+    If the device is detached the read finishes with *success == FALSE.
+  ***************************************************************************/
+
+BYTE USBHostMSDSCSISectorReadIsComplete( BYTE *success )
+{
+    if (!_USBHostMSDSCSI_ReadDone())
+    {
+        return FALSE;
+    }
+
+    *success = readSuccess;
+    return TRUE;
+}
+
+
+/****************************************************************************
+  Function:
+    BYTE USBHostMSDSCSIWriteProtectState( void )
+
+  Description:
+    This function returns the write protect status of the device.
+
+  Precondition:
+    None
+
+  Parameters:
+    None - None
+
+  Return Values:
+    0 - not write protected
+
+
+  Remarks:
+    None
+  ***************************************************************************/
+
+BYTE    USBHostMSDSCSIWriteProtectState( void )
+{
+    return 0;
+}
+
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Internal Functions
+// *****************************************************************************
+// *****************************************************************************
+
+/*******************************************************************************
+  Function:
+    BYTE _USBHostMSDSCSI_Start10( BYTE operationCode, DWORD sectorAddress,
+                WORD sectorCount, BYTE *dataBuffer )
+
+  Precondition:
+    A device is attached (deviceAddress != 0) and no transfer is in progress
+
+  Overview:
+    This function starts one READ10 (0x28) or WRITE10 (0x2A) command for
+    sectorCount sectors.
+
+  Parameters:
+    BYTE    operationCode   - 0x28 to read, 0x2A to write
+    DWORD   sectorAddress   - address of the first sector
+    WORD    sectorCount     - number of sectors, the Transfer Length field
+    BYTE    *dataBuffer     - sectorCount sectors of application data
+
+  Return Values:
+    USB_SUCCESS - The transfer was started
+    Others      - See USBHostMSDTransfer()
+
+  Remarks:
+    The command blocks are shown with USBHostMSDSCSISectorRead() and
+    USBHostMSDSCSISectorWrite().
+  ***************************************************************************/
+
+BYTE _USBHostMSDSCSI_Start10( BYTE operationCode, DWORD sectorAddress, WORD sectorCount, BYTE *dataBuffer )
+{
+    DWORD   dataLength;
+    BYTE    commandBlock[10];
+
+    // Fill in the command block with the READ10/WRITE10 parameters.
+    commandBlock[0] = operationCode;    // Operation code
+    commandBlock[1] = ((operationCode == 0x28) ? RDPROTECT_NORMAL : WRPROTECT_NORMAL) | FUA_ALLOW_CACHE;
     commandBlock[2] = (BYTE) (sectorAddress >> 24);     // Big endian!
     commandBlock[3] = (BYTE) (sectorAddress >> 16);
     commandBlock[4] = (BYTE) (sectorAddress >> 8);
     commandBlock[5] = (BYTE) (sectorAddress);
     commandBlock[6] = 0x00;     // Group Number
-    commandBlock[7] = 0x00;     // Number of blocks - Big endian!
-    commandBlock[8] = 0x01;
+    commandBlock[7] = (BYTE) (sectorCount >> 8);        // Number of blocks - Big endian!
+    commandBlock[8] = (BYTE) (sectorCount);
     commandBlock[9] = 0x00;     // Control
 
+    dataLength = (DWORD)sectorCount * mediaInformation.sectorSize;
+
     // Currently using LUN=0.  When the File System supports multiple LUN's, this will change.
-    errorCode = USBHostMSDWrite( deviceAddress, 0, commandBlock, 10, dataBuffer, mediaInformation.sectorSize );
+    if (operationCode == 0x28)
+    {
+        return USBHostMSDRead( deviceAddress, 0, commandBlock, 10, dataBuffer, dataLength );
+    }
+    else
+    {
+        return USBHostMSDWrite( deviceAddress, 0, commandBlock, 10, dataBuffer, dataLength );
+    }
+}
+
+/*******************************************************************************
+  Function:
+    BYTE _USBHostMSDSCSI_ReadWrite10( BYTE operationCode, DWORD sectorAddress,
+                WORD sectorCount, BYTE *dataBuffer )
+
+  Precondition:
+    A device is attached (deviceAddress != 0)
+
+  Overview:
+    This function sends one READ10 (0x28) or WRITE10 (0x2A) command for
+    sectorCount sectors and waits for the data and status stages to finish.
+    An outstanding split-phase read is allowed to finish first.
+
+  Parameters:
+    BYTE    operationCode   - 0x28 to read, 0x2A to write
+    DWORD   sectorAddress   - address of the first sector
+    WORD    sectorCount     - number of sectors, the Transfer Length field
+    BYTE    *dataBuffer     - sectorCount sectors of application data
+
+  Return Values:
+    TRUE    - Command completed without error
+    FALSE   - Error while performing command
+
+  Remarks:
+    The command blocks are shown with USBHostMSDSCSISectorRead() and
+    USBHostMSDSCSISectorWrite().
+  ***************************************************************************/
+
+BYTE _USBHostMSDSCSI_ReadWrite10( BYTE operationCode, DWORD sectorAddress, WORD sectorCount, BYTE *dataBuffer )
+{
+    DWORD   byteCount;
+    BYTE    errorCode;
+
+    while (!_USBHostMSDSCSI_ReadDone())
+        ;
+
+    errorCode = _USBHostMSDSCSI_Start10( operationCode, sectorAddress, sectorCount, dataBuffer );
     #ifdef DEBUG_MODE
-        UART2PrintString( "SCSI: Write sector init error " );
+        UART2PrintString( "SCSI: Read/write sector init error " );
         UART2PutHex( errorCode );
         UART2PrintString( "\r\n" );
     #endif
@@ -706,7 +986,7 @@ BYTE USBHostMSDSCSISectorWrite( DWORD sectorAddress, BYTE *dataBuffer, BYTE allo
     }
 
     #ifdef DEBUG_MODE
-        UART2PrintString( "SCSI: Write sector error " );
+        UART2PrintString( "SCSI: Read/write sector error " );
         UART2PutHex( errorCode );
         UART2PrintString( "\r\n" );
     #endif
@@ -722,39 +1002,49 @@ BYTE USBHostMSDSCSISectorWrite( DWORD sectorAddress, BYTE *dataBuffer, BYTE allo
     }
 }
 
-
-/****************************************************************************
+/*******************************************************************************
   Function:
-    BYTE USBHostMSDSCSIWriteProtectState( void )
-
-  Description:
-    This function returns the write protect status of the device.
+    BOOL _USBHostMSDSCSI_ReadDone( void )
 
   Precondition:
     None
 
+  Overview:
+    This function runs the USB tasks once and collects the result of an
+    outstanding split-phase read if it has finished.
+
   Parameters:
     None - None
 
   Return Values:
-    0 - not write protected
-
+    TRUE    - No split-phase read is outstanding
+    FALSE   - The split-phase read is still in progress
 
   Remarks:
     None
   ***************************************************************************/
 
-BYTE    USBHostMSDSCSIWriteProtectState( void )
+BOOL _USBHostMSDSCSI_ReadDone( void )
 {
-    return 0;
-}
+    DWORD   byteCount;
+    BYTE    errorCode;
 
+    if (!readPending)
+    {
+        return TRUE;
+    }
+
+    USBTasks();
+    if (!USBHostMSDTransferIsComplete( deviceAddress, &errorCode, &byteCount ))
+    {
+        return FALSE;
+    }
+
+    readPending = FALSE;
+    readSuccess = (errorCode == 0);
+    return TRUE;
+}
 
-// *****************************************************************************
-// *****************************************************************************
-// Section: Internal Functions
-// *****************************************************************************
-// *****************************************************************************
 
 
 /*******************************************************************************
@@ -33,7 +33,13 @@
 #ifdef __PIC32MX__ // chipKIT32
 
 #include <DNETcK.h>
-#include <chipKITOSC.h>
+#include "OSCPool.h"	// no heap on the OSC path
+
+// clip playback from a USB thumb drive, osc("/clip","drape.eca")
+#include <chipKITUSBHost.h>
+#include <chipKITUSBMSDHost.h>
+#include <chipKITMDDFS.h>
+#include "ClipPlayer.h"
 #define strncasecmp strncmp
 
 #endif
@@ -41,6 +47,9 @@
 #include "RGBConverter.h"
 RGBConverter converter;
 
+// per stage timing, reported by osc("/stats")
+#include "Profiler.h"
+
 // debug 
 #define DBG	// conditional DBG code compiled in - small speed penalty
 #define DEBUG_TIMING	// may cause significant serial traffic
@@ -70,7 +79,17 @@ byte myIp[]  = { 192, 168, 69, 69 };
 IPv4 myIp = { 192, 168, 1, 99 };	// side 
 #endif
 
+// Listen on the Communicore default group and port, 239.192.192.192:9192,
+// what kelper's emulator and KelpViewer use. This moves the one server off
+// 9999 to 9192, unicast included, so kelper.py's kelp and side targets
+// (osc-udp://...:9999) have to change to :9192 to keep reaching it.
+// #define MULTICAST_OSC
+#ifdef MULTICAST_OSC
+IPv4 oscGroup = { 239, 192, 192, 192 };
+int  serverPort  = 9192;
+#else
 int  serverPort  = 9999;
+#endif
 
 // FRAME BUFFER
 rgb img[IMG_HEIGHT][IMG_WIDTH]={128,0,255};		// source image from controller
@@ -148,7 +167,21 @@ void setup() {
     ge35.init();
 
 #ifdef __PIC32MX__
+    // kelper.py sends a frame as two /screenxy datagrams with a 1024 byte
+    // blob, 1064 bytes of OSC and about 1110 on the wire with the headers
+    // and CRC. 1120 byte receive buffers take one each in place, without
+    // the gather copy, and the pool fits 9 of them beside the full size
+    // frame buffer, one more than the default 8 x 1536.
+    if(!DNETcK::setMACBuffers(2, 9, 1120))
+        Serial.println("MAC buffer config rejected");
+    // keep each readOSC() short so it doesn't add jitter between frames
+    DNETcK::setPeriodicTasksBudget(500);
     DNETcK::begin(myIp);
+#ifdef MULTICAST_OSC
+    if(!DNETcK::joinMulticastGroup(oscGroup))
+        Serial.println("multicast join failed");
+#endif
+    clipBegin();
 #endif
 
 #ifdef __AVR__
@@ -201,16 +234,27 @@ typedef enum
 
 STATE state = LISTEN;
 
+// OSC message with one int argument, sent as pieces straight into the MAC
+// buffer: address, its NUL padding, the fixed ",i" type tags, then the
+// big-endian argument. Only the argument bytes change between sends.
+static const byte oscPad[4] = { 0, 0, 0, 0 };
+static const byte oscTagsInt[4] = { ',', 'i', 0, 0 };
+
 void writeOSC_i(char *path, int32_t val){
-	OSCMessage msg;
-	msg.beginMessage(path);
-	msg.addArgInt32(val);
-
-	byte *sendData=(uint8_t*)calloc( msg.getMessageSize() ,1 );
-	OSCEncoder encoder;
-	OSCEncoder::encode(&msg,sendData);
-	udpClient.writeDatagram(sendData,msg.getMessageSize());
-	free(sendData);
+	byte arg[4];
+	unsigned int cbPath = strlen(path);
+	DatagramPiece msg[4] = {
+		{ (const byte *) path, cbPath },
+		{ oscPad, 4 - (cbPath & 3) },	// at least one NUL, padded to 4 bytes
+		{ oscTagsInt, sizeof(oscTagsInt) },
+		{ arg, sizeof(arg) },
+	};
+
+	arg[0] = (byte) (val >> 24);
+	arg[1] = (byte) (val >> 16);
+	arg[2] = (byte) (val >> 8);
+	arg[3] = (byte) val;
+	udpClient.writeDatagram(msg, 4);
 }
 
 int buttonState;             // the current reading from the input pin
@@ -243,8 +287,8 @@ int readOSC(){
     int count = 0;
     int retVal = 0;
 
-    byte rgbRead[kMaxRecieveData];		// from OSC library
-    OSCMessage msg;
+    byte *rgbRead;
+    OSCInMessage *msg;
 
     // manage connection
     switch(state)
@@ -293,16 +337,36 @@ int readOSC(){
         // otherwise will just go back to "listening"
 
         if((cbRead = udpClient.available()) > 0) {
-            cbRead = cbRead < sizeof(rgbRead) ? cbRead : sizeof(rgbRead);
+            // decoded in place, so the message lives as long as the buffer
+            rgbRead = OSCPool::allocBuffer();
+            msg = OSCPool::allocMessage();
+            if(!rgbRead || !msg){
+                OSCPool::freeBuffer(rgbRead);
+                OSCPool::freeMessage(msg);
+                retVal = -1;	// leave the datagram queued for next time
+                break;
+            }
+            cbRead = cbRead < OSC_POOL_BUFFER_SIZE ? cbRead : OSC_POOL_BUFFER_SIZE;
+            PROF_BEGIN(tRead);
             cbRead = udpClient.readDatagram(rgbRead, cbRead);
+            PROF_END(PROF_NET, tRead);
             tStart = (unsigned) millis();
 
             // OSC decode and dispatch
             retVal = 1;
-            if( OSCDecoder::decode( &msg ,rgbRead ) < 0 )
+            PROF_BEGIN(tDecode);
+            int decoded = msg->decode( rgbRead, cbRead );
+            PROF_END(PROF_DECODE, tDecode);
+            if( decoded < 0 )
                 retVal = -1;
-            else
-                oscDispatch(&msg);
+            else {
+                PROF_BEGIN(tDispatch);
+                oscDispatch(msg);
+                PROF_END(PROF_DISPATCH, tDispatch);
+            }
+
+            OSCPool::freeMessage(msg);
+            OSCPool::freeBuffer(rgbRead);
         } else if( tWait && (((unsigned) millis()) - tStart) > tWait ) {
             state = CLOSE;
         }
@@ -332,7 +396,9 @@ int readOSC(){
     }
 
     // Make sure that the Ethernet stack runs
+    PROF_BEGIN(tNet);
     DNETcK::periodicTasks();
+    PROF_END(PROF_NET, tNet);
 
     return retVal;
 }
@@ -363,9 +429,23 @@ void loop(){
         static int dirty=0;
         static int loopcnt=0;
         int ret = 0;
+        bool mappedClip = false;	// a .kmc clip has the LEDs, img waits
 
 		doTerry();
 
+#ifdef __PIC32MX__
+        if(clipTask((byte*) img))	// next clip frame, if one is playing and due
+            dirty=1;
+        if(clipIsMapped()){
+            const byte *frame = clipMappedFrame();
+            if(frame){
+                ge35.sendMapped(frame);	// already in LED order, no prepOutBuffer()
+                profFrame();
+            }
+            mappedClip = true;
+        }
+#endif
+
         while((ret=readOSC())>0){	// process all queued messages
             dirty=1;
             if(noOSC){
@@ -381,10 +461,13 @@ void loop(){
             dirty=1;
         }
         
-        if(!noUpdate &&
+        if(!noUpdate && !mappedClip &&
            (dirty || hueScrollRate || vScrollRate || hScrollRate || displayCurrentColor )){
+            PROF_BEGIN(tPrep);
             prepOutBuffer();	// copies image buffer to OUT (may process)
+            PROF_END(PROF_PREP, tPrep);
             ge35.sendImage();	// copy output buffer to LEDS
+            profFrame();		// one sample per stage per frame sent
             // Serial.print(".");
             dirty = 0;
         }
@@ -409,14 +492,14 @@ void loop(){
 // OSC "handlers"
 ///////////////////////////////////////////////////////////////////////////////
 
-void oscDispatch(OSCMessage *oscmsg){
+void oscDispatch(OSCInMessage *oscmsg){
     static int resetcount=0;
 
     char *p = oscmsg->getOSCAddress();
 
     if(*p != '/'){
         Serial.println("M");
-        if(debugLevel) dumpHex(oscmsg, "oscmsg", 4);
+        if(debugLevel) dumpHex(p, "oscmsg", 4);
         return;
     }
 
@@ -514,6 +597,46 @@ void oscDispatch(OSCMessage *oscmsg){
         Serial.println(y);
     } else if(!strncasecmp(p,"debug",5)){
         debugLevel=oscmsg->getArgInt32(0);	// set debug level
+    } else if(!strncasecmp(p,"clip",4)){
+        // osc("/clip", "name.eca" [, fps [, orientation [, start frame]]]) plays from the
+        // USB drive, osc("/clip") stops. orientation 0 is as stored, 1 (default) matches
+        // kelper.py, a .kmc from tools/mapclip or .kdc from tools/packclip has it baked in,
+        // a .ecb from tools/ecsc is a script rendered as it plays
+        if(oscmsg->getArgsNum() > 0 && oscmsg->getTypeTag(0) == 's'){
+            float fps = (oscmsg->getArgsNum() > 1) ? oscmsg->getArgFloat(1) : CLIP_DEFAULT_FPS;
+            int orient = (oscmsg->getArgsNum() > 2) ? oscmsg->getArgInt32(2) : CLIP_ORIENT_KELPER;
+            unsigned long start = (oscmsg->getArgsNum() > 3) ? oscmsg->getArgInt32(3) : 0;
+            if(!clipPlay((char *) oscmsg->getArgData(0), fps, orient, start))
+                Serial.println("err: /clip couldn't open clip");
+        } else {
+            ClipStats s;
+            clipStop();
+            clipGetStats(&s);
+            DUMPVAR("clip frames ",s.framesShown);
+            DUMPVAR("clip underruns ",s.underruns);
+            DUMPVAR("clip read errors ",s.readErrors);
+        }
+    } else if(!strncasecmp(p,"stats",5)){
+        // reply with a bundle of /stats/<stage> messages, see Profiler.h
+        // osc("/stats",1) also resets min/max and the histograms
+        byte *buf = OSCPool::allocBuffer();
+        if(buf){
+            int cb = profEncodeStats(buf, OSC_POOL_BUFFER_SIZE);
+            if(cb > 0)
+                udpClient.writeDatagram(buf, cb);
+            OSCPool::freeBuffer(buf);
+        }
+        if(oscmsg->getArgsNum() > 0 && oscmsg->getArgInt32(0))
+            profReset();
+    } else if(!strncasecmp(p,"pool",4)){
+        // OSC pool usage, to check the pool sizes in OSCPool.h
+        OSCPoolStats s;
+        OSCPool::getStats(&s);
+        DUMPVAR("messages in use ",s.messagesInUse);
+        DUMPVAR("messages high water ",s.messagesHighWater);
+        DUMPVAR("buffers in use ",s.buffersInUse);
+        DUMPVAR("buffers high water ",s.buffersHighWater);
+        DUMPVAR("alloc failed ",s.allocFailed);
     } else {
         Serial.print("Unrecognized Msg: ");
         Serial.println(p);
@@ -522,7 +645,7 @@ void oscDispatch(OSCMessage *oscmsg){
 
 
 // Legacy Image mode for RV support
-void copyImage(OSCMessage *oscmsg){
+void copyImage(OSCInMessage *oscmsg){
 	//
     // copy image data from OSC to framebuffer
     // 
@@ -535,7 +658,13 @@ void copyImage(OSCMessage *oscmsg){
         return;
     }
 
-    byte *data = (byte*) oscmsg->getArg(2)->_argData;
+    byte *data = oscmsg->getArgData(2);
+
+    // blob must hold w*h pixels, w and h can be anything so not in int
+    if(!data || (uint64_t) oscmsg->getArgSize(2) < ((uint64_t) w * h) << 2){
+        Serial.println("err: /screen blob too small");
+        return;
+    }
 
 #ifdef DBG
     if(debugLevel==101){
@@ -559,7 +688,7 @@ void copyImage(OSCMessage *oscmsg){
     }
 }
 
-void copyImageXY(OSCMessage *oscmsg){
+void copyImageXY(OSCInMessage *oscmsg){
 	//
     // copy image data from OSC to framebuffer with OFFSET
     // 
@@ -568,7 +697,19 @@ void copyImageXY(OSCMessage *oscmsg){
     int baseX = oscmsg->getArgInt32(2);
     int baseY = oscmsg->getArgInt32(3);
 
-    byte *data = (byte*) oscmsg->getArg(4)->_argData;
+    // the rectangle must be inside img
+    if(w < 1 || h < 1 || baseX < 0 || baseY < 0 ||
+       w > IMG_WIDTH - baseX || h > IMG_HEIGHT - baseY){
+        Serial.println("err: /screenxy outside the frame buffer");
+        return;
+    }
+
+    byte *data = oscmsg->getArgData(4);
+
+    if(!data || (unsigned long) oscmsg->getArgSize(4) < ((unsigned long) w * h) << 2){
+        Serial.println("err: /screenxy blob too small");
+        return;
+    }
 
 #ifdef DBG
     if(debugLevel==101){
@@ -0,0 +1,163 @@
+// clipcheck.cpp - check Clip.cpp's unpacking against kelper.py
+//
+// Usage: clipcheck in.eca|in.raw ...
+//
+// Reads each clip the way kelper.py's playMovie() does (a CubeSense
+// header if the file starts with "Ls", frames from 0x100, as many as the
+// file holds) and builds every frame with a port of its composeFrame(),
+// both straight and through defaultXfm. Then it checks that
+// clipParseHeader() finds the same frames and clipDeinterleave() makes
+// the same r,g,b of them with CLIP_ORIENT_NONE and CLIP_ORIENT_KELPER,
+// so the drive plays a clip the way the laptop did. Like kelper.py it
+// only knows the 8x8x8 cube.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Clip.h"
+
+#define CUBE		(8)
+#define VOXELS		(CUBE*CUBE*CUBE)
+#define FRAME_SIZE	(3*VOXELS)
+
+// kelper.py's defaultXfm
+static const int defaultXfm[3][3] = {
+    { -1, 0, 0 },
+    {  0, 0, 1 },
+    {  0,-1, 0 },
+};
+
+// transformPoint(): the matrix times the point, and 7 added to each axis
+// the matrix flips
+static void transformPoint(const int xfm[3][3], const int pt[3], int out[3]){
+    for(int i=0; i<3; i++){
+        int flip = xfm[i][0] + xfm[i][1] + xfm[i][2];
+        out[i] = xfm[i][0]*pt[0] + xfm[i][1]*pt[1] + xfm[i][2]*pt[2];
+        if(flip < 0)
+            out[i] += CUBE-1;
+    }
+}
+
+// composeFrame() less the alpha: voxel i = (z*8+y)*8+x of the output
+// takes getPixel() of the point transformList() has for it, red, green
+// and blue 0x200 apart
+static void composeFrame(const byte *mov, unsigned long frameOffset, const int xfm[3][3], byte *rgb){
+    int i = 0;
+    for(int z=0; z<CUBE; z++){
+        for(int y=0; y<CUBE; y++){
+            for(int x=0; x<CUBE; x++){
+                int pt[3] = { x, y, z }, src[3];
+                if(xfm)
+                    transformPoint(xfm, pt, src);
+                else
+                    memcpy(src, pt, sizeof(src));
+                unsigned long pixOff = frameOffset + (src[2]*CUBE*CUBE) + (src[1]*CUBE) + src[0];
+                rgb[3*i] = mov[pixOff];
+                rgb[3*i+1] = mov[pixOff+0x200];
+                rgb[3*i+2] = mov[pixOff+0x400];
+                i++;
+            }
+        }
+    }
+}
+
+static bool checkClip(const char *name){
+    FILE *in = fopen(name, "rb");
+    if(!in){
+        perror(name);
+        return false;
+    }
+    fseek(in, 0, SEEK_END);
+    long cbFile = ftell(in);
+    rewind(in);
+    byte *movie = (byte *) malloc(cbFile + CLIP_HEADER_SIZE);
+    memset(movie, 0, cbFile + CLIP_HEADER_SIZE);
+    size_t got = fread(movie, 1, cbFile, in);
+    fclose(in);
+    if(got != (size_t) cbFile){
+        fprintf(stderr, "%s: short read\n", name);
+        free(movie);
+        return false;
+    }
+
+    // playMovie()
+    bool csflag = cbFile >= 2 && movie[0] == 'L' && movie[1] == 's';
+    unsigned long base = csflag ? 0x100 : 0;
+    unsigned long frames = cbFile > (long) base ? (cbFile - base) / FRAME_SIZE : 0;
+
+    ClipInfo info;
+    bool ok = true;
+    if(clipParseHeader(movie, cbFile, CUBE, CUBE, CUBE, &info) < 0){
+        fprintf(stderr, "%s: clipParseHeader() refuses it\n", name);
+        free(movie);
+        return false;
+    }
+    if(info.mapped || info.packed || info.script ||
+       info.sizeX != CUBE || info.sizeY != CUBE || info.sizeZ != CUBE){
+        fprintf(stderr, "%s: not an %dx%dx%d clip, kelper.py can't play it\n", name, CUBE, CUBE, CUBE);
+        free(movie);
+        return false;
+    }
+    if(info.base != base || info.frameSize != FRAME_SIZE){
+        fprintf(stderr, "%s: frames at 0x%lx, %lu bytes each, kelper.py has 0x%lx, %d\n",
+                name, info.base, info.frameSize, base, FRAME_SIZE);
+        ok = false;
+    }
+
+    // kelper.py ignores the header's count, the player stops at it
+    unsigned long counted = csflag ? clipGet32(movie + 5) : 0;
+    unsigned long want = (counted && counted < frames) ? counted : frames;
+    if(info.frames != want){
+        fprintf(stderr, "%s: %lu frames, want %lu (%lu in the file, %lu in the header)\n",
+                name, info.frames, want, frames, counted);
+        ok = false;
+    }
+    if(csflag && strncmp(info.title, (const char *) movie + 0x0C, CLIP_TITLE_LEN) != 0){
+        fprintf(stderr, "%s: title \"%s\"\n", name, info.title);
+        ok = false;
+    }
+
+    byte want0[FRAME_SIZE], want1[FRAME_SIZE], got0[FRAME_SIZE], got1[FRAME_SIZE];
+    unsigned long bad = 0;
+    for(unsigned long f=0; f<info.frames && ok; f++){
+        unsigned long frameOffset = f*FRAME_SIZE + base;
+        composeFrame(movie, frameOffset, NULL, want0);
+        composeFrame(movie, frameOffset, defaultXfm, want1);
+        clipDeinterleave(movie + frameOffset, &info, CLIP_ORIENT_NONE, got0);
+        clipDeinterleave(movie + frameOffset, &info, CLIP_ORIENT_KELPER, got1);
+        if(memcmp(got0, want0, FRAME_SIZE) || memcmp(got1, want1, FRAME_SIZE)){
+            if(bad++ == 0)
+                fprintf(stderr, "%s: frame %lu differs from composeFrame()\n", name, f);
+        }
+    }
+    if(bad){
+        fprintf(stderr, "%s: %lu frames differ\n", name, bad);
+        ok = false;
+    }
+
+    if(ok)
+        printf("%s: %lu frames %dx%dx%d from 0x%lx, both orientations as kelper.py\n",
+               name, info.frames, info.sizeX, info.sizeY, info.sizeZ, info.base);
+    free(movie);
+    return ok;
+}
+
+int main(int argc, char **argv){
+    if(argc < 2){
+        fprintf(stderr, "usage: clipcheck in.eca|in.raw ...\n");
+        return 2;
+    }
+
+    int failed = 0;
+    for(int i=1; i<argc; i++){
+        if(!checkClip(argv[i]))
+            failed++;
+    }
+    if(failed){
+        fprintf(stderr, "clipcheck: %d of %d clips failed\n", failed, argc - 1);
+        return 1;
+    }
+    return 0;
+}
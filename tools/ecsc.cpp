@@ -0,0 +1,631 @@
+// ecsc.cpp - compile CubeSense .ecs animation scripts to .ecb clips
+//
+// Usage: ecsc [-n frames] [-t title] [-c check.eca] [-r render.eca] in.ecs out.ecb
+//
+// The language is what the CubeSense scripts in media/cs use:
+//
+//   for(init; condition; step) statement
+//   { statements }
+//   name = expression   (and +=, -=, *=, /=, ++, --)
+//   drawpoint(frame, x, y, z, r, g, b)
+//   drawbox(frame, x1, y1, z1, x2, y2, z2, r, g, b, style)
+//
+// with + - * / %, comparisons, parentheses, mathsin() and mathcos() in
+// expressions, and // or /* */ comments. Semicolons after statements are
+// optional. Every box is drawn solid, style is evaluated and ignored.
+//
+// The frame count comes from the loop over the frame variable (the one
+// draws take as their frame) if its bounds are numbers, else from the
+// largest constant frame a draw uses, else it has to be given with -n.
+//
+// -c renders every frame with ecsRender(), as the player will, and
+// compares it with the frames of a .eca rendered by CubeSense or by
+// ecsref (make check does that for the bundled scripts); -r writes the
+// frames out as a .eca.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <math.h>
+#include <unistd.h>
+#include <time.h>
+#include <string>
+#include <vector>
+
+#include "Clip.h"
+#include "Ecs.h"
+#define GE35_NO_DATA	// just IMG_*
+#include "GE35mapping.h"
+
+// the cube the display is, as the player checks
+#define SIZE_X		(IMG_WIDTH)
+#define SIZE_Y		(IMG_WIDTH)
+#define SIZE_Z		(IMG_HEIGHT/IMG_WIDTH)
+#define FRAME_SIZE	(3*SIZE_X*SIZE_Y*SIZE_Z)
+
+enum { T_END, T_NUM, T_ID, T_OP };
+
+struct Token {
+    int kind;
+    std::string text;		// T_ID, T_OP
+    double value;			// T_NUM
+    int line;
+};
+
+static const char *srcName;
+static std::vector<Token> toks;
+static size_t t;					// next token
+static std::vector<byte> code;
+static int depth, maxDepth;			// expression stack in use, and the most
+static std::vector<std::string> vars;
+static std::vector<std::string> frameVars;	// used as a draw's frame
+static std::vector<std::string> frameLoops;	// frame loops we're inside
+static long constFrames;			// 1 + the largest constant frame drawn
+static long loopFrames;				// end of the frame loops
+static bool unknownFrames;			// a draw whose frame is neither
+
+static void error(const char *msg, const char *what = ""){
+    int line = toks.empty() ? 0 : toks[t < toks.size() ? t : toks.size()-1].line;
+    fprintf(stderr, "%s:%d: %s%s\n", srcName, line, msg, what);
+    exit(1);
+}
+
+//
+// tokens
+//
+
+static void lex(const char *s){
+    int line = 1;
+
+    while(*s){
+        Token tk;
+        tk.line = line;
+        tk.value = 0;
+        if(*s == '\n'){
+            line++;
+            s++;
+        } else if(isspace((byte) *s)){
+            s++;
+        } else if(s[0] == '/' && s[1] == '/'){
+            while(*s && *s != '\n')
+                s++;
+        } else if(s[0] == '/' && s[1] == '*'){
+            for(s += 2; *s && !(s[0] == '*' && s[1] == '/'); s++)
+                if(*s == '\n')
+                    line++;
+            if(*s)
+                s += 2;
+        } else if(isdigit((byte) *s) || (*s == '.' && isdigit((byte) s[1]))){
+            char *e;
+            tk.kind = T_NUM;
+            tk.value = strtod(s, &e);
+            s = e;
+            toks.push_back(tk);
+        } else if(isalpha((byte) *s) || *s == '_'){
+            const char *b = s;
+            while(isalnum((byte) *s) || *s == '_')
+                s++;
+            tk.kind = T_ID;
+            tk.text.assign(b, s - b);
+            toks.push_back(tk);
+        } else {
+            static const char *two[] = { "++", "--", "+=", "-=", "*=", "/=", "<=", ">=", "==", "!=" };
+            tk.kind = T_OP;
+            tk.text.assign(s, 1);
+            for(unsigned i=0; i<sizeof(two)/sizeof(two[0]); i++)
+                if(!strncmp(s, two[i], 2))
+                    tk.text = two[i];
+            if(!strchr("+-*/%<>=!(){},;", *s))
+                error("unexpected character ", tk.text.c_str());
+            s += tk.text.size();
+            toks.push_back(tk);
+        }
+    }
+    Token end;
+    end.kind = T_END;
+    end.value = 0;
+    end.line = line;
+    toks.push_back(end);
+}
+
+static bool isOp(size_t i, const char *op){
+    return toks[i].kind == T_OP && toks[i].text == op;
+}
+
+static bool isId(size_t i, const char *name){
+    return toks[i].kind == T_ID && !strcasecmp(toks[i].text.c_str(), name);
+}
+
+static bool isInt(size_t i){
+    return toks[i].kind == T_NUM && toks[i].value == floor(toks[i].value);
+}
+
+static void expect(const char *op){
+    if(!isOp(t, op))
+        error("expected ", op);
+    t++;
+}
+
+static bool has(const std::vector<std::string> &v, const std::string &s){
+    for(size_t i=0; i<v.size(); i++)
+        if(v[i] == s)
+            return true;
+    return false;
+}
+
+//
+// code
+//
+
+static void emit(byte op, int stack){
+    code.push_back(op);
+    depth += stack;
+    if(depth > maxDepth)
+        maxDepth = depth;
+    if(maxDepth > ECS_STACK)
+        error("expression too deep");
+}
+
+static void emitByte(byte b){
+    code.push_back(b);
+}
+
+static size_t emitJump(byte op, int stack){
+    emit(op, stack);
+    code.push_back(0);
+    code.push_back(0);
+    return code.size();
+}
+
+static void patch(size_t from, size_t to){
+    long rel = (long) to - (long) from;
+    if(rel < -32768 || rel > 32767)
+        error("script too long");
+    code[from-2] = (byte) rel;
+    code[from-1] = (byte) (rel >> 8);
+}
+
+static void emitNumber(double v){
+    if(v < -32768 || v >= 32768)
+        error("number out of range");
+    if(v >= 0 && v <= 255 && v == floor(v)){
+        emit(ECS_PUSHI, 1);
+        emitByte((byte) v);
+        return;
+    }
+    int32_t f = (int32_t) lround(v * ECS_ONE);
+    emit(ECS_PUSH, 1);
+    for(int i=0; i<4; i++)
+        emitByte((byte) (f >> (8*i)));
+}
+
+static byte var(const std::string &name){
+    for(size_t i=0; i<vars.size(); i++)
+        if(vars[i] == name)
+            return (byte) i;
+    if(vars.size() == ECS_VARS)
+        error("too many variables at ", name.c_str());
+    vars.push_back(name);
+    return (byte) (vars.size() - 1);
+}
+
+//
+// expressions
+//
+
+static void expression();
+
+static void primary(){
+    if(toks[t].kind == T_NUM){
+        emitNumber(toks[t++].value);
+    } else if(isId(t, "mathsin") || isId(t, "mathcos")){
+        byte op = isId(t, "mathsin") ? ECS_SIN : ECS_COS;
+        t++;
+        expect("(");
+        expression();
+        expect(")");
+        emit(op, 0);
+    } else if(toks[t].kind == T_ID){
+        emit(ECS_LOAD, 1);
+        emitByte(var(toks[t++].text));
+    } else if(isOp(t, "(")){
+        t++;
+        expression();
+        expect(")");
+    } else {
+        error("expected a value");
+    }
+}
+
+static void unary(){
+    if(isOp(t, "-")){
+        t++;
+        unary();
+        emit(ECS_NEG, 0);
+    } else if(isOp(t, "+")){
+        t++;
+        unary();
+    } else {
+        primary();
+    }
+}
+
+static void term(){
+    unary();
+    for(;;){
+        byte op;
+        if(isOp(t, "*")) op = ECS_MUL;
+        else if(isOp(t, "/")) op = ECS_DIV;
+        else if(isOp(t, "%")) op = ECS_MOD;
+        else return;
+        t++;
+        unary();
+        emit(op, -1);
+    }
+}
+
+static void sum(){
+    term();
+    for(;;){
+        byte op;
+        if(isOp(t, "+")) op = ECS_ADD;
+        else if(isOp(t, "-")) op = ECS_SUB;
+        else return;
+        t++;
+        term();
+        emit(op, -1);
+    }
+}
+
+static void expression(){
+    static const struct { const char *text; byte op; } cmp[] = {
+        { "<", ECS_LT }, { "<=", ECS_LE }, { ">", ECS_GT },
+        { ">=", ECS_GE }, { "==", ECS_EQ }, { "!=", ECS_NE },
+    };
+    sum();
+    for(unsigned i=0; i<sizeof(cmp)/sizeof(cmp[0]); i++){
+        if(isOp(t, cmp[i].text)){
+            t++;
+            sum();
+            emit(cmp[i].op, -1);
+            return;
+        }
+    }
+}
+
+//
+// statements
+//
+
+static void assignment(){
+    if(toks[t].kind != T_ID)
+        error("expected a statement");
+    byte v = var(toks[t++].text);
+
+    if(isOp(t, "=")){
+        t++;
+        expression();
+    } else if(isOp(t, "++") || isOp(t, "--")){
+        emit(ECS_LOAD, 1);
+        emitByte(v);
+        emitNumber(1);
+        emit(isOp(t, "++") ? ECS_ADD : ECS_SUB, -1);
+        t++;
+    } else {
+        byte op;
+        if(isOp(t, "+=")) op = ECS_ADD;
+        else if(isOp(t, "-=")) op = ECS_SUB;
+        else if(isOp(t, "*=")) op = ECS_MUL;
+        else if(isOp(t, "/=")) op = ECS_DIV;
+        else error("expected an assignment");
+        t++;
+        emit(ECS_LOAD, 1);
+        emitByte(v);
+        expression();
+        emit(op, -1);
+    }
+    emit(ECS_STORE, -1);
+    emitByte(v);
+}
+
+static void draw(){
+    bool box = isId(t, "drawbox");
+    int args = box ? 11 : 7;
+
+    t++;
+    expect("(");
+    // what frames it can draw in
+    if(isInt(t) && isOp(t+1, ","))
+        constFrames = (toks[t].value + 1 > constFrames) ? (long) toks[t].value + 1 : constFrames;
+    else if(!(toks[t].kind == T_ID && isOp(t+1, ",") && has(frameLoops, toks[t].text)))
+        unknownFrames = true;
+    for(int i=0; i<args; i++){
+        if(i)
+            expect(",");
+        expression();
+    }
+    expect(")");
+    emit(box ? ECS_BOX : ECS_POINT, -args);
+}
+
+static void statement();
+
+// assignments of name anywhere in the script
+static int assignments(const std::string &name){
+    int n = 0;
+    for(size_t i=0; i+1<toks.size(); i++)
+        if(toks[i].kind == T_ID && toks[i].text == name &&
+           (isOp(i+1, "=") || isOp(i+1, "+=") || isOp(i+1, "-=") || isOp(i+1, "*=") ||
+            isOp(i+1, "/=") || isOp(i+1, "++") || isOp(i+1, "--")))
+            n++;
+    return n;
+}
+
+static bool frameLoop(){
+    // for(f=A; f<B; f++) or f<=B, or f+=1, with f a frame variable
+    // nothing else assigns
+    size_t i = t;
+    if(toks[i].kind != T_ID || !has(frameVars, toks[i].text))
+        return false;
+    const std::string &f = toks[i].text;
+    if(!(isOp(i+1, "=") && isInt(i+2) && isOp(i+3, ";") &&
+         toks[i+4].kind == T_ID && toks[i+4].text == f &&
+         (isOp(i+5, "<") || isOp(i+5, "<=")) && isInt(i+6) && isOp(i+7, ";") &&
+         toks[i+8].kind == T_ID && toks[i+8].text == f))
+        return false;
+    if(isOp(i+9, "++") && isOp(i+10, ")"))
+        t = i + 11;
+    else if(isOp(i+9, "+=") && isInt(i+10) && toks[i+10].value == 1 && isOp(i+11, ")"))
+        t = i + 12;
+    else
+        return false;
+    if(assignments(f) != 2){
+        t = i;
+        return false;
+    }
+
+    double first = toks[i+2].value, end = toks[i+6].value + (isOp(i+5, "<=") ? 1 : 0);
+    if(end > loopFrames)
+        loopFrames = (long) end;
+    emitNumber(first);
+    emitNumber(end);
+    emit(ECS_FRAME, -2);
+    emitByte(var(f));
+    emitByte(0);
+    emitByte(0);
+    size_t skip = code.size();
+    frameLoops.push_back(f);
+    statement();
+    frameLoops.pop_back();
+    patch(skip, code.size());
+    return true;
+}
+
+static void forLoop(){
+    t++;
+    expect("(");
+    if(frameLoop())
+        return;
+
+    if(!isOp(t, ";"))
+        assignment();
+    expect(";");
+    size_t top = code.size(), exit = 0;
+    if(!isOp(t, ";")){
+        expression();
+        exit = emitJump(ECS_JZ, -1);
+    }
+    expect(";");
+
+    // the step goes after the body
+    size_t step = t;
+    for(int parens = 0; !(parens == 0 && isOp(t, ")")); t++){
+        if(toks[t].kind == T_END)
+            error("expected )");
+        if(isOp(t, "(")) parens++;
+        if(isOp(t, ")")) parens--;
+    }
+    t++;
+    statement();
+    size_t after = t;
+    t = step;
+    if(!isOp(t, ")"))
+        assignment();
+    t = after;
+
+    patch(emitJump(ECS_JMP, 0), top);
+    if(exit)
+        patch(exit, code.size());
+}
+
+static void statement(){
+    if(isId(t, "for")){
+        forLoop();
+    } else if(isOp(t, "{")){
+        t++;
+        while(!isOp(t, "}")){
+            if(toks[t].kind == T_END)
+                error("expected }");
+            statement();
+        }
+        t++;
+    } else if(isOp(t, ";")){
+        t++;
+    } else if(isId(t, "drawpoint") || isId(t, "drawbox")){
+        draw();
+        if(isOp(t, ";"))
+            t++;
+    } else {
+        assignment();
+        if(isOp(t, ";"))
+            t++;
+    }
+}
+
+//
+// checking
+//
+
+static double now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char *load(const char *name, long *cb){
+    FILE *f = fopen(name, "rb");
+    if(!f){
+        perror(name);
+        exit(1);
+    }
+    fseek(f, 0, SEEK_END);
+    *cb = ftell(f);
+    rewind(f);
+    char *b = (char *) malloc(*cb + 1);
+    if(fread(b, 1, *cb, f) != (size_t) *cb){
+        perror(name);
+        exit(1);
+    }
+    b[*cb] = 0;
+    fclose(f);
+    return b;
+}
+
+int main(int argc, char **argv){
+    long frames = 0;
+    const char *title = NULL, *checkName = NULL, *renderName = NULL;
+    int c;
+
+    while((c = getopt(argc, argv, "n:t:c:r:")) != -1){
+        switch(c){
+        case 'n': frames = atol(optarg); break;
+        case 't': title = optarg; break;
+        case 'c': checkName = optarg; break;
+        case 'r': renderName = optarg; break;
+        default:
+            fprintf(stderr, "usage: ecsc [-n frames] [-t title] [-c check.eca] [-r render.eca] in.ecs out.ecb\n");
+            return 2;
+        }
+    }
+    if(argc - optind != 2){
+        fprintf(stderr, "usage: ecsc [-n frames] [-t title] [-c check.eca] [-r render.eca] in.ecs out.ecb\n");
+        return 2;
+    }
+    srcName = argv[optind];
+    const char *outName = argv[optind+1];
+
+    long cbSrc;
+    char *src = load(srcName, &cbSrc);
+    lex(src);
+
+    for(size_t i=0; i+3<toks.size(); i++)
+        if((isId(i, "drawpoint") || isId(i, "drawbox")) && isOp(i+1, "(") &&
+           toks[i+2].kind == T_ID && isOp(i+3, ",") && !has(frameVars, toks[i+2].text))
+            frameVars.push_back(toks[i+2].text);
+
+    while(toks[t].kind != T_END)
+        statement();
+    emit(ECS_END, 0);
+
+    if(frames == 0){
+        if(unknownFrames)
+            error("can't tell how many frames, give -n");
+        frames = (loopFrames > constFrames) ? loopFrames : constFrames;
+        if(frames == 0)
+            error("nothing is drawn");
+    }
+    if(code.size() > ECS_MAX_PROGRAM)
+        error("too long for the player");
+
+    // title from the file name
+    std::string name = srcName;
+    if(name.rfind('/') != std::string::npos)
+        name = name.substr(name.rfind('/') + 1);
+    if(name.rfind('.') != std::string::npos)
+        name = name.substr(0, name.rfind('.'));
+
+    byte hdr[CLIP_SCRIPT_BASE];
+    clipMakeScriptHeader(hdr, frames, code.size(), SIZE_X, SIZE_Y, SIZE_Z,
+                         title ? title : name.c_str());
+    FILE *out = fopen(outName, "wb");
+    if(!out){
+        perror(outName);
+        return 1;
+    }
+    fwrite(hdr, 1, sizeof(hdr), out);
+    fwrite(&code[0], 1, code.size(), out);
+    if(fclose(out) != 0){
+        perror(outName);
+        return 1;
+    }
+
+    // every frame as the player renders it
+    std::vector<byte> rendered(frames * FRAME_SIZE);
+    double t0 = now();
+    for(long f=0; f<frames; f++){
+        if(ecsRender(&code[0], code.size(), f, SIZE_X, SIZE_Y, SIZE_Z, &rendered[f * FRAME_SIZE]) < 0){
+            fprintf(stderr, "%s: frame %ld doesn't render\n", srcName, f);
+            return 1;
+        }
+    }
+    double t1 = now() - t0;
+
+    printf("%s: %ld bytes -> %lu bytes of bytecode, %d variables, stack %d, %ld frames, %.0f frames/s -> %s\n",
+           srcName, cbSrc, (unsigned long) code.size(), (int) vars.size(), maxDepth, frames,
+           frames / (t1 > 0 ? t1 : 1e-9), outName);
+
+    int ret = 0;
+    if(checkName){
+        long cbEca;
+        byte *eca = (byte *) load(checkName, &cbEca);
+        ClipInfo info;
+        if(clipParseHeader(eca, cbEca, SIZE_X, SIZE_Y, SIZE_Z, &info) < 0 || info.mapped ||
+           info.packed || info.script || info.frameSize != FRAME_SIZE){
+            fprintf(stderr, "%s: not a clip for this cube\n", checkName);
+            return 1;
+        }
+        long n = (info.frames < (unsigned long) frames) ? info.frames : frames;
+        long badFrames = 0, badVoxels = 0;
+        for(long f=0; f<n; f++){
+            const byte *a = &rendered[f * FRAME_SIZE], *b = eca + info.base + f * FRAME_SIZE;
+            long bad = 0;
+            for(int i=0; i<FRAME_SIZE/3; i++)
+                if(a[i] != b[i] || a[i+FRAME_SIZE/3] != b[i+FRAME_SIZE/3] ||
+                   a[i+2*FRAME_SIZE/3] != b[i+2*FRAME_SIZE/3])
+                    bad++;
+            if(bad && !badFrames)
+                printf("%s: frame %ld is first to differ, %ld voxels\n", checkName, f, bad);
+            badFrames += bad != 0;
+            badVoxels += bad;
+        }
+        printf("%s: %ld of %ld frames match%s", checkName, n - badFrames, n,
+               (info.frames != (unsigned long) frames) ? "" : "\n");
+        if(info.frames != (unsigned long) frames)
+            printf(", it has %lu frames, the script %ld\n", info.frames, frames);
+        if(badFrames || info.frames != (unsigned long) frames)
+            ret = 1;
+        free(eca);
+    }
+
+    if(renderName){
+        byte eca[CLIP_ECA_BASE] = { 0 };
+        clipMakeEcaHeader(eca, frames, SIZE_X, SIZE_Y, SIZE_Z, title ? title : name.c_str());
+        FILE *r = fopen(renderName, "wb");
+        if(!r){
+            perror(renderName);
+            return 1;
+        }
+        fwrite(eca, 1, sizeof(eca), r);
+        fwrite(&rendered[0], 1, rendered.size(), r);
+        if(fclose(r) != 0){
+            perror(renderName);
+            return 1;
+        }
+    }
+
+    free(src);
+    return ret;
+}
@@ -0,0 +1,432 @@
+// ecsref.cpp - render CubeSense .ecs scripts the slow, obvious way
+//
+// Usage: ecsref in.ecs out.eca
+//
+// The reference ecsc -c checks the player against. It shares nothing
+// with ecsc and Ecs.cpp but the language: the script is parsed into a
+// tree and run once from the top in double precision, the way CubeSense
+// runs it, with every draw landing in the frame it names, and the frames
+// come out as a .eca. There is no frame loop analysis, no bytecode and no
+// fixed point. The clip has as many frames as the largest frame drawn.
+//
+// mathsin() and mathcos() are 1000*sin and cos of degrees, coordinates
+// and colors are cut toward zero and colors clamped to 0..255, as
+// CubeSense does. A value within 1e-9 of an integer is taken as that
+// integer first: a wave that is exactly at 4 on paper lands at 4, not at
+// 3 because sin(360) came out as -2.4e-16.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+
+#include "Clip.h"
+
+#define SIZE		(8)
+#define PLANE		(SIZE*SIZE*SIZE)
+#define FRAME_SIZE	(3*PLANE)
+
+enum { N_NUM, N_VAR, N_UNARY, N_BINARY, N_CALL, N_ASSIGN, N_FOR, N_BLOCK, N_DRAW };
+
+struct Node {
+    int kind;
+    double value;				// N_NUM
+    std::string name;			// N_VAR, N_ASSIGN, N_CALL, N_DRAW
+    std::string op;				// N_UNARY, N_BINARY, N_ASSIGN
+    std::vector<Node *> kids;
+};
+
+static std::deque<Node> nodes;
+
+static Node *node(int kind){
+    nodes.push_back(Node());
+    nodes.back().kind = kind;
+    nodes.back().value = 0;
+    return &nodes.back();
+}
+
+static const char *srcName;
+static const char *s;				// next character
+static int line = 1;
+
+static void error(const char *msg){
+    fprintf(stderr, "%s:%d: %s\n", srcName, line, msg);
+    exit(1);
+}
+
+static void skip(){
+    for(;;){
+        while(isspace((unsigned char) *s))
+            if(*s++ == '\n')
+                line++;
+        if(s[0] == '/' && s[1] == '/'){
+            while(*s && *s != '\n')
+                s++;
+        } else if(s[0] == '/' && s[1] == '*'){
+            const char *e = strstr(s + 2, "*/");
+            if(!e)
+                error("comment doesn't end");
+            for(; s < e; s++)
+                if(*s == '\n')
+                    line++;
+            s += 2;
+        } else
+            return;
+    }
+}
+
+static bool accept(const char *op){
+    skip();
+    size_t n = strlen(op);
+    if(strncmp(s, op, n) != 0)
+        return false;
+    s += n;
+    return true;
+}
+
+static void expect(const char *op){
+    if(!accept(op))
+        error((std::string("expected ") + op).c_str());
+}
+
+static std::string name(){
+    skip();
+    std::string n;
+    while(isalnum((unsigned char) *s) || *s == '_')
+        n += *s++;
+    if(n.empty() || isdigit((unsigned char) n[0]))
+        error("expected a name");
+    return n;
+}
+
+//
+// parsing, lowest precedence last
+//
+
+static Node *expression();
+
+static Node *primary(){
+    skip();
+    if(accept("(")){
+        Node *n = expression();
+        expect(")");
+        return n;
+    }
+    if(accept("-")){
+        Node *n = node(N_UNARY);
+        n->op = "-";
+        n->kids.push_back(primary());
+        return n;
+    }
+    if(accept("+"))
+        return primary();
+    if(isdigit((unsigned char) *s) || *s == '.'){
+        Node *n = node(N_NUM);
+        char *e;
+        n->value = strtod(s, &e);
+        s = e;
+        return n;
+    }
+    std::string id = name();
+    if(id == "mathsin" || id == "mathcos"){
+        Node *n = node(N_CALL);
+        n->name = id;
+        expect("(");
+        n->kids.push_back(expression());
+        expect(")");
+        return n;
+    }
+    Node *n = node(N_VAR);
+    n->name = id;
+    return n;
+}
+
+static Node *binary(Node *a, const char *op, Node *b){
+    Node *n = node(N_BINARY);
+    n->op = op;
+    n->kids.push_back(a);
+    n->kids.push_back(b);
+    return n;
+}
+
+static Node *term(){
+    Node *n = primary();
+    for(;;){
+        if(accept("*"))
+            n = binary(n, "*", primary());
+        else if(accept("/"))
+            n = binary(n, "/", primary());
+        else if(accept("%"))
+            n = binary(n, "%", primary());
+        else
+            return n;
+    }
+}
+
+static Node *sum(){
+    Node *n = term();
+    for(;;){
+        skip();
+        // not the first half of ++, --, += or -=
+        if(s[0] == '+' && s[1] != '+' && s[1] != '=' && accept("+"))
+            n = binary(n, "+", term());
+        else if(s[0] == '-' && s[1] != '-' && s[1] != '=' && accept("-"))
+            n = binary(n, "-", term());
+        else
+            return n;
+    }
+}
+
+static Node *expression(){
+    static const char *ops[] = { "<=", ">=", "==", "!=", "<", ">" };
+    Node *n = sum();
+    for(size_t i=0; i<sizeof(ops)/sizeof(ops[0]); i++)
+        if(accept(ops[i]))
+            return binary(n, ops[i], sum());
+    return n;
+}
+
+static Node *assignment(){
+    static const char *ops[] = { "++", "--", "+=", "-=", "*=", "/=", "=" };
+    Node *n = node(N_ASSIGN);
+    n->name = name();
+    for(size_t i=0; i<sizeof(ops)/sizeof(ops[0]); i++){
+        if(accept(ops[i])){
+            n->op = ops[i];
+            if(n->op != "++" && n->op != "--")
+                n->kids.push_back(expression());
+            return n;
+        }
+    }
+    error("expected an assignment");
+    return NULL;
+}
+
+static Node *statement(){
+    skip();
+    if(accept("{")){
+        Node *n = node(N_BLOCK);
+        while(!accept("}")){
+            if(!*s)
+                error("block doesn't end");
+            n->kids.push_back(statement());
+        }
+        return n;
+    }
+    if(accept(";"))
+        return node(N_BLOCK);
+
+    const char *at = s;
+    int atLine = line;
+    std::string id = name();
+    if(id == "for" && accept("(")){
+        Node *n = node(N_FOR);
+        n->kids.push_back(assignment());
+        expect(";");
+        n->kids.push_back(expression());
+        expect(";");
+        n->kids.push_back(assignment());
+        expect(")");
+        n->kids.push_back(statement());
+        return n;
+    }
+    if((id == "drawpoint" || id == "drawbox") && accept("(")){
+        Node *n = node(N_DRAW);
+        n->name = id;
+        do
+            n->kids.push_back(expression());
+        while(accept(","));
+        expect(")");
+        if(n->kids.size() != (id == "drawpoint" ? 7u : 11u))
+            error("wrong number of arguments");
+        accept(";");
+        return n;
+    }
+    s = at;
+    line = atLine;
+    Node *n = assignment();
+    accept(";");
+    return n;
+}
+
+//
+// running
+//
+
+static std::map<std::string, double> vars;
+static std::vector<byte> frames;		// FRAME_SIZE each, grown as drawn
+static long drawnFrames;
+
+static double eval(const Node *n){
+    switch(n->kind){
+    case N_NUM:
+        return n->value;
+    case N_VAR:
+        return vars[n->name];
+    case N_UNARY:
+        return -eval(n->kids[0]);
+    case N_CALL: {
+        double rad = eval(n->kids[0]) * M_PI / 180;
+        return 1000 * (n->name == "mathsin" ? sin(rad) : cos(rad));
+    }
+    case N_BINARY: {
+        double a = eval(n->kids[0]), b = eval(n->kids[1]);
+        const std::string &op = n->op;
+        if(op == "+") return a + b;
+        if(op == "-") return a - b;
+        if(op == "*") return a * b;
+        if(op == "/") return b ? a / b : 0;
+        if(op == "%") return b ? fmod(a, b) : 0;
+        if(op == "<") return a < b;
+        if(op == "<=") return a <= b;
+        if(op == ">") return a > b;
+        if(op == ">=") return a >= b;
+        if(op == "==") return a == b;
+        return a != b;
+    }
+    }
+    error("not an expression");
+    return 0;
+}
+
+// cut toward zero, after snapping to an integer that's within rounding
+static long toInt(double v){
+    double r = floor(v + 0.5);
+    if(fabs(v - r) < 1e-9)
+        return (long) r;
+    return (long) trunc(v);
+}
+
+static byte toColor(double v){
+    long c = toInt(v);
+    return (c < 0) ? 0 : (c > 255) ? 255 : (byte) c;
+}
+
+static void draw(const Node *n){
+    double a[11];
+    for(size_t i=0; i<n->kids.size(); i++)
+        a[i] = eval(n->kids[i]);
+
+    if(a[0] < 0 || toInt(a[0]) != a[0])
+        return;
+    long f = toInt(a[0]);
+    if(f >= drawnFrames){
+        drawnFrames = f + 1;
+        frames.resize(drawnFrames * FRAME_SIZE);
+    }
+    byte *out = &frames[f * FRAME_SIZE];
+
+    long lo[3], hi[3];
+    const double *rgb;
+    if(n->name == "drawpoint"){
+        for(int k=0; k<3; k++)
+            lo[k] = hi[k] = toInt(a[1+k]);
+        rgb = a + 4;
+    } else {
+        for(int k=0; k<3; k++){
+            long c1 = toInt(a[1+k]), c2 = toInt(a[4+k]);
+            lo[k] = (c1 < c2) ? c1 : c2;
+            hi[k] = (c1 < c2) ? c2 : c1;
+        }
+        rgb = a + 7;
+    }
+    for(long z=lo[2]; z<=hi[2]; z++)
+        for(long y=lo[1]; y<=hi[1]; y++)
+            for(long x=lo[0]; x<=hi[0]; x++)
+                if(x >= 0 && x < SIZE && y >= 0 && y < SIZE && z >= 0 && z < SIZE){
+                    long i = (z*SIZE + y)*SIZE + x;
+                    out[i] = toColor(rgb[0]);
+                    out[PLANE + i] = toColor(rgb[1]);
+                    out[2*PLANE + i] = toColor(rgb[2]);
+                }
+}
+
+static void run(const Node *n){
+    switch(n->kind){
+    case N_BLOCK:
+        for(size_t i=0; i<n->kids.size(); i++)
+            run(n->kids[i]);
+        break;
+    case N_FOR:
+        for(run(n->kids[0]); eval(n->kids[1]); run(n->kids[2]))
+            run(n->kids[3]);
+        break;
+    case N_DRAW:
+        draw(n);
+        break;
+    case N_ASSIGN: {
+        double &v = vars[n->name];
+        const std::string &op = n->op;
+        if(op == "++") v += 1;
+        else if(op == "--") v -= 1;
+        else {
+            double e = eval(n->kids[0]);
+            if(op == "=") v = e;
+            else if(op == "+=") v += e;
+            else if(op == "-=") v -= e;
+            else if(op == "*=") v *= e;
+            else v = e ? v / e : 0;
+        }
+        break;
+    }
+    default:
+        error("not a statement");
+    }
+}
+
+int main(int argc, char **argv){
+    if(argc != 3){
+        fprintf(stderr, "usage: ecsref in.ecs out.eca\n");
+        return 2;
+    }
+    srcName = argv[1];
+
+    FILE *in = fopen(srcName, "rb");
+    if(!in){
+        perror(srcName);
+        return 1;
+    }
+    std::string src;
+    char buf[4096];
+    size_t got;
+    while((got = fread(buf, 1, sizeof(buf), in)) > 0)
+        src.append(buf, got);
+    fclose(in);
+
+    s = src.c_str();
+    Node *script = node(N_BLOCK);
+    for(skip(); *s; skip())
+        script->kids.push_back(statement());
+    run(script);
+    if(drawnFrames == 0)
+        error("nothing is drawn");
+
+    // title from the file name, as ecsc gives it
+    std::string title = srcName;
+    if(title.rfind('/') != std::string::npos)
+        title = title.substr(title.rfind('/') + 1);
+    if(title.rfind('.') != std::string::npos)
+        title = title.substr(0, title.rfind('.'));
+
+    byte hdr[CLIP_ECA_BASE] = { 0 };
+    clipMakeEcaHeader(hdr, drawnFrames, SIZE, SIZE, SIZE, title.c_str());
+    FILE *out = fopen(argv[2], "wb");
+    if(!out){
+        perror(argv[2]);
+        return 1;
+    }
+    fwrite(hdr, 1, sizeof(hdr), out);
+    fwrite(&frames[0], 1, frames.size(), out);
+    if(fclose(out) != 0){
+        perror(argv[2]);
+        return 1;
+    }
+    printf("%s: %ld frames -> %s\n", srcName, drawnFrames, argv[2]);
+    return 0;
+}
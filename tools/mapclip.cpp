@@ -0,0 +1,103 @@
+// mapclip.cpp - convert .eca and raw888 clips to pre-mapped .kmc clips
+//
+// Usage: mapclip [-o orientation] [-t title] in.eca|in.raw out.kmc
+//
+// Each frame is unpacked as ClipPlayer would (orientation 1, kelper.py's,
+// unless -o 0), then picked out in LED order through the strands[] in
+// GE35mapping.h and cut to the 4 bits per color GE35 sends. The result
+// only plays on a display built with the same mapping, the header holds
+// its hash and ClipPlayer refuses the clip otherwise.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "Clip.h"
+#include "GE35mapping.h"	// strands[], STRAND_COUNT, MAX_STRAND_LEN, IMG_*
+
+#define MAPPED_FRAME_SIZE	(MAX_STRAND_LEN*CLIP_MAPPED_ROW(STRAND_COUNT))
+
+static void usage(){
+    fprintf(stderr, "usage: mapclip [-o orientation] [-t title] in.eca|in.raw out.kmc\n");
+    exit(2);
+}
+
+int main(int argc, char **argv){
+    int orient = CLIP_ORIENT_KELPER;
+    const char *title = NULL;
+    int c;
+
+    while((c = getopt(argc, argv, "o:t:")) != -1){
+        switch(c){
+        case 'o': orient = atoi(optarg); break;
+        case 't': title = optarg; break;
+        default: usage();
+        }
+    }
+    if(argc - optind != 2)
+        usage();
+    const char *inName = argv[optind], *outName = argv[optind+1];
+
+    FILE *in = fopen(inName, "rb");
+    if(!in){
+        perror(inName);
+        return 1;
+    }
+    fseek(in, 0, SEEK_END);
+    long cbFile = ftell(in);
+    rewind(in);
+
+    byte hdr[CLIP_HEADER_SIZE] = { 0 };
+    ClipInfo info;
+    size_t cbHdr = fread(hdr, 1, sizeof(hdr), in);
+    (void) cbHdr;
+
+    // the same checks clipPlay() makes
+    if(clipParseHeader(hdr, cbFile, IMG_WIDTH, IMG_WIDTH, IMG_HEIGHT/IMG_WIDTH, &info) < 0 ||
+       info.mapped || info.packed || info.sizeX != IMG_WIDTH || info.sizeY * info.sizeZ != IMG_HEIGHT ||
+       (orient == CLIP_ORIENT_KELPER && info.sizeY != info.sizeZ)){
+        fprintf(stderr, "%s: not a clip that fits the display\n", inName);
+        return 1;
+    }
+
+    FILE *out = fopen(outName, "wb");
+    if(!out){
+        perror(outName);
+        return 1;
+    }
+
+    unsigned long hash = clipMapHash(strands, STRAND_COUNT);
+    byte base[CLIP_MAPPED_BASE] = { 0 };
+    clipMakeMappedHeader(base, info.frames, hash, STRAND_COUNT, MAX_STRAND_LEN,
+                         title ? title : info.title);
+    fwrite(base, 1, sizeof(base), out);
+
+    byte *frame = (byte *) malloc(info.frameSize);
+    byte rgb[3*IMG_WIDTH*IMG_HEIGHT];
+    byte mapped[MAPPED_FRAME_SIZE];
+
+    fseek(in, info.base, SEEK_SET);
+    for(unsigned long f=0; f<info.frames; f++){
+        if(fread(frame, 1, info.frameSize, in) != info.frameSize){
+            fprintf(stderr, "%s: short read in frame %lu\n", inName, f);
+            return 1;
+        }
+        clipDeinterleave(frame, &info, orient, rgb);
+        clipMapFrame(rgb, IMG_WIDTH, strands, STRAND_COUNT, MAX_STRAND_LEN, mapped);
+        fwrite(mapped, 1, sizeof(mapped), out);
+    }
+
+    if(fclose(out) != 0){
+        perror(outName);
+        return 1;
+    }
+    fclose(in);
+    free(frame);
+
+    printf("%s: %lu frames %dx%dx%d -> %s, %d bytes a frame, mapping %08lx\n",
+           inName, info.frames, info.sizeX, info.sizeY, info.sizeZ, outName,
+           MAPPED_FRAME_SIZE, hash);
+    return 0;
+}
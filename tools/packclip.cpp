@@ -0,0 +1,158 @@
+// packclip.cpp - pack .eca and raw888 clips into keyframe + delta .kdc clips
+//
+// Usage: packclip [-o orientation] [-k interval] [-t title] in.eca|in.raw out.kdc
+//
+// Each frame is unpacked as ClipPlayer would (orientation 1, kelper.py's,
+// unless -o 0) and packed with clipPackFrame() against the one before it,
+// with a keyframe every -k frames (40, a second at the default rate).
+// The result is then unpacked again, from the keyframe index, and checked
+// against the source, and the size and the decode speed are reported.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "Clip.h"
+#define GE35_NO_DATA	// just IMG_*
+#include "GE35mapping.h"
+
+#define VOXELS		(IMG_WIDTH*IMG_HEIGHT)
+#define IMAGE_SIZE	(3*VOXELS)
+
+static void usage(){
+    fprintf(stderr, "usage: packclip [-o orientation] [-k interval] [-t title] in.eca|in.raw out.kdc\n");
+    exit(2);
+}
+
+static double now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv){
+    int orient = CLIP_ORIENT_KELPER;
+    int keyInterval = 40;
+    const char *title = NULL;
+    int c;
+
+    while((c = getopt(argc, argv, "o:k:t:")) != -1){
+        switch(c){
+        case 'o': orient = atoi(optarg); break;
+        case 'k': keyInterval = atoi(optarg); break;
+        case 't': title = optarg; break;
+        default: usage();
+        }
+    }
+    if(argc - optind != 2 || keyInterval < 1 || keyInterval > 255)
+        usage();
+    const char *inName = argv[optind], *outName = argv[optind+1];
+
+    FILE *in = fopen(inName, "rb");
+    if(!in){
+        perror(inName);
+        return 1;
+    }
+    fseek(in, 0, SEEK_END);
+    long cbFile = ftell(in);
+    rewind(in);
+
+    byte hdr[CLIP_HEADER_SIZE] = { 0 };
+    ClipInfo info;
+    size_t cbHdr = fread(hdr, 1, sizeof(hdr), in);
+    (void) cbHdr;
+
+    // the same checks clipPlay() makes
+    if(clipParseHeader(hdr, cbFile, IMG_WIDTH, IMG_WIDTH, IMG_HEIGHT/IMG_WIDTH, &info) < 0 ||
+       info.mapped || info.packed || info.sizeX != IMG_WIDTH || info.sizeY * info.sizeZ != IMG_HEIGHT ||
+       (orient == CLIP_ORIENT_KELPER && info.sizeY != info.sizeZ)){
+        fprintf(stderr, "%s: not a clip that fits the display\n", inName);
+        return 1;
+    }
+
+    // the whole clip as images, then packed
+    unsigned long frames = info.frames;
+    unsigned long keys = (frames + keyInterval - 1) / keyInterval;
+    byte *images = (byte *) malloc(frames * IMAGE_SIZE);
+    byte *packed = (byte *) malloc(CLIP_PACKED_BASE + 4*keys + frames * CLIP_PACKED_MAX(VOXELS));
+    byte *frame = (byte *) malloc(info.frameSize);
+
+    fseek(in, info.base, SEEK_SET);
+    for(unsigned long f=0; f<frames; f++){
+        if(fread(frame, 1, info.frameSize, in) != info.frameSize){
+            fprintf(stderr, "%s: short read in frame %lu\n", inName, f);
+            return 1;
+        }
+        clipDeinterleave(frame, &info, orient, images + f*IMAGE_SIZE);
+    }
+    fclose(in);
+
+    memset(packed, 0, CLIP_PACKED_BASE);
+    clipMakePackedHeader(packed, frames, keyInterval, info.sizeX, info.sizeY, info.sizeZ,
+                         title ? title : info.title);
+    unsigned long cb = CLIP_PACKED_BASE + 4*keys;
+    for(unsigned long f=0; f<frames; f++){
+        bool key = (f % keyInterval) == 0;
+        if(key)
+            clipPut32(packed + CLIP_PACKED_BASE + 4*(f/keyInterval), cb);
+        cb += clipPackFrame(images + f*IMAGE_SIZE, key ? NULL : images + (f-1)*IMAGE_SIZE,
+                            VOXELS, packed + cb);
+    }
+
+    // play it back as ClipPlayer would, from each keyframe's index entry
+    ClipInfo check;
+    byte img[IMAGE_SIZE];
+    if(clipParseHeader(packed, cb, 0, 0, 0, &check) < 0 || !check.packed ||
+       check.frames != frames || check.base != CLIP_PACKED_BASE + 4*keys){
+        fprintf(stderr, "%s: packed header doesn't read back\n", outName);
+        return 1;
+    }
+    unsigned long pos = check.base;
+    for(unsigned long f=0; f<frames; f++){
+        if(f % keyInterval == 0 && clipGet32(packed + CLIP_PACKED_BASE + 4*(f/keyInterval)) != pos){
+            fprintf(stderr, "%s: index entry for frame %lu is wrong\n", outName, f);
+            return 1;
+        }
+        if(clipUnpackFrame(packed + pos, img, VOXELS) < 0 ||
+           memcmp(img, images + f*IMAGE_SIZE, IMAGE_SIZE) != 0){
+            fprintf(stderr, "%s: frame %lu doesn't unpack to the source\n", outName, f);
+            return 1;
+        }
+        pos += CLIP_PACKED_PREFIX + (packed[pos] | (packed[pos+1] << 8));
+    }
+
+    // decode speed, the whole clip over and over for a quarter second or so
+    unsigned long passes = 0;
+    double t0 = now(), t;
+    do {
+        pos = check.base;
+        for(unsigned long f=0; f<frames; f++){
+            clipUnpackFrame(packed + pos, img, VOXELS);
+            pos += CLIP_PACKED_PREFIX + (packed[pos] | (packed[pos+1] << 8));
+        }
+        passes++;
+    } while((t = now() - t0) < 0.25);
+
+    FILE *out = fopen(outName, "wb");
+    if(!out){
+        perror(outName);
+        return 1;
+    }
+    fwrite(packed, 1, cb, out);
+    if(fclose(out) != 0){
+        perror(outName);
+        return 1;
+    }
+
+    printf("%s: %lu frames, %ld -> %lu bytes (%.1f:1), %lu keyframes, decode %.0f MB/s -> %s\n",
+           inName, frames, cbFile, cb, (double) cbFile / cb, keys,
+           (double) passes * frames * IMAGE_SIZE / t / 1e6, outName);
+
+    free(frame);
+    free(packed);
+    free(images);
+    return 0;
+}
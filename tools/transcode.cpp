@@ -0,0 +1,584 @@
+// transcode.cpp - batch convert .eca and raw888 clips between layouts
+//
+// Usage: transcode [-f format] [-o orientation] [-j threads] [-k interval]
+//                  [-a alpha] [-s XxYxZ] [-d dir] [-c] in.eca|in.raw ...
+//
+// Each input is mapped into memory, its CubeSense header checked against
+// fileformats.txt (or, without one, taken as raw888 frames of the -s
+// lattice, the display's by default) and every frame converted into
+// dir/<name>.<format>, which is mapped too and filled in place:
+//
+//   eca    CubeSense header and planar frames
+//   raw    planar frames, no header (raw888)
+//   rgb    interleaved r,g,b frames, the 3dleds.com layout and the image
+//          ClipPlayer shows
+//   rgba   r,g,b,alpha (-a, 200 as kelper.py sends) frames, what
+//          kelper.py's composeFrame() makes of a frame
+//   kmc    pre-mapped for the GE35mapping.h this was built with, as mapclip
+//   kdc    keyframe + delta packed, a keyframe every -k frames, as packclip
+//
+// Orientation 1, kelper.py's defaultXfm, is applied unless -o 0, so
+// -o 0 -f eca just rewrites the header. Frames are planar to interleaved
+// a row at a time, with SSSE3 shuffles when the compiler has them, and
+// the frames are split across -j threads (one per core by default) in
+// ranges, whole keyframe intervals for kdc. -c checks every frame
+// against clipDeinterleave(), which the player uses.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+#include <thread>
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+
+#include "Clip.h"
+#include "GE35mapping.h"	// strands[], STRAND_COUNT, MAX_STRAND_LEN, IMG_*
+
+#define ECA_MAGIC		(0x734C)	// "Ls", as Clip.cpp
+#define ECA_TYPE		(0x02)
+#define ECA_FRAMES		(0x05)
+#define ECA_TITLE		(0x0C)
+
+#define MAPPED_FRAME_SIZE	(MAX_STRAND_LEN*CLIP_MAPPED_ROW(STRAND_COUNT))
+
+enum { F_ECA, F_RAW, F_RGB, F_RGBA, F_KMC, F_KDC };
+static const char *formats[] = { "eca", "raw", "rgb", "rgba", "kmc", "kdc" };
+
+static int format = F_RGB;
+static int orient = CLIP_ORIENT_KELPER;
+static int keyInterval = 40;
+static byte alpha = 200;
+static bool check;
+
+static void usage(){
+    fprintf(stderr, "usage: transcode [-f eca|raw|rgb|rgba|kmc|kdc] [-o orientation] [-j threads]\n"
+                    "                 [-k interval] [-a alpha] [-s XxYxZ] [-d dir] [-c] in.eca|in.raw ...\n");
+    exit(2);
+}
+
+static double now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+//
+// kernels
+//
+
+#ifdef __SSSE3__
+// pshufb controls, 0x80 gives a zero byte. ilv[n][rev][channel][out]
+// makes out vector 0..2 of an interleaved run of 16 or 8 voxels from one
+// channel, reversed or not; dil[n][channel][in] picks a channel out of
+// in vector 0..2 of an interleaved run.
+static __m128i ilv[2][2][3][3];
+static __m128i dil[2][3][3];
+static __m128i rgbaMask, alphaBytes;
+
+static void initKernels(){
+    for(int k=0; k<2; k++){
+        const int n = k ? 8 : 16;
+        for(int rev=0; rev<2; rev++){
+            byte m[3][48];
+            memset(m, 0x80, sizeof(m));
+            for(int i=0; i<3*n; i++)
+                m[i%3][i] = (byte)(rev ? n-1-i/3 : i/3);
+            for(int c=0; c<3; c++)
+                for(int v=0; v<3; v++)
+                    ilv[k][rev][c][v] = _mm_loadu_si128((const __m128i *)(m[c] + 16*v));
+        }
+        byte m[3][48];
+        memset(m, 0x80, sizeof(m));
+        for(int i=0; i<n; i++)
+            for(int c=0; c<3; c++)
+                m[c][16*((3*i+c)/16) + i] = (byte)((3*i+c) % 16);
+        for(int c=0; c<3; c++)
+            for(int v=0; v<3; v++)
+                dil[k][c][v] = _mm_loadu_si128((const __m128i *)(m[c] + 16*v));
+    }
+    byte m[16];
+    for(int i=0; i<16; i++)
+        m[i] = (i%4 == 3) ? 0x80 : (byte)(3*(i/4) + i%4);
+    rgbaMask = _mm_loadu_si128((const __m128i *) m);
+    alphaBytes = _mm_set1_epi32((int)((unsigned) alpha << 24));
+}
+
+// 16 voxels (k 0) or 8 (k 1) of r, g and b to 48 or 24 bytes of triples
+static inline void interleaveRun(const byte *r, const byte *g, const byte *b,
+                                 int k, int rev, byte *out){
+    __m128i R, G, B;
+    if(k == 0){
+        R = _mm_loadu_si128((const __m128i *) r);
+        G = _mm_loadu_si128((const __m128i *) g);
+        B = _mm_loadu_si128((const __m128i *) b);
+    } else {
+        R = _mm_loadl_epi64((const __m128i *) r);
+        G = _mm_loadl_epi64((const __m128i *) g);
+        B = _mm_loadl_epi64((const __m128i *) b);
+    }
+    const __m128i (*m)[3] = ilv[k][rev];
+    __m128i o0 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(R, m[0][0]), _mm_shuffle_epi8(G, m[1][0])),
+                              _mm_shuffle_epi8(B, m[2][0]));
+    __m128i o1 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(R, m[0][1]), _mm_shuffle_epi8(G, m[1][1])),
+                              _mm_shuffle_epi8(B, m[2][1]));
+    _mm_storeu_si128((__m128i *) out, o0);
+    if(k == 0){
+        __m128i o2 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(R, m[0][2]), _mm_shuffle_epi8(G, m[1][2])),
+                                  _mm_shuffle_epi8(B, m[2][2]));
+        _mm_storeu_si128((__m128i *)(out + 16), o1);
+        _mm_storeu_si128((__m128i *)(out + 32), o2);
+    } else {
+        _mm_storel_epi64((__m128i *)(out + 16), o1);
+    }
+}
+
+// the other way, 48 or 24 bytes of triples to 16 or 8 voxels of r, g and b
+static inline void deinterleaveRun(const byte *in, int k, byte *r, byte *g, byte *b){
+    __m128i v0 = _mm_loadu_si128((const __m128i *) in), v1, v2;
+    if(k == 0){
+        v1 = _mm_loadu_si128((const __m128i *)(in + 16));
+        v2 = _mm_loadu_si128((const __m128i *)(in + 32));
+    } else {
+        v1 = _mm_loadl_epi64((const __m128i *)(in + 16));
+        v2 = _mm_setzero_si128();
+    }
+    byte *out[3] = { r, g, b };
+    for(int c=0; c<3; c++){
+        const __m128i *m = dil[k][c];
+        __m128i o = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(v0, m[0]), _mm_shuffle_epi8(v1, m[1])),
+                                 _mm_shuffle_epi8(v2, m[2]));
+        if(k == 0)
+            _mm_storeu_si128((__m128i *) out[c], o);
+        else
+            _mm_storel_epi64((__m128i *) out[c], o);
+    }
+}
+#else
+static void initKernels(){
+}
+#endif
+
+// A row of n voxels from the planes to triples, mirrored in x if rev.
+// Runs of 16 and 8 go through the shuffles, the rest a voxel at a time.
+static void interleaveRow(const byte *r, const byte *g, const byte *b, int n, int rev, byte *out){
+    int p = 0;
+#ifdef __SSSE3__
+    for(; n - p >= 16; p += 16){
+        int s = rev ? n-p-16 : p;
+        interleaveRun(r + s, g + s, b + s, 0, rev, out + 3*p);
+    }
+    if(n - p >= 8){
+        int s = rev ? n-p-8 : p;
+        interleaveRun(r + s, g + s, b + s, 1, rev, out + 3*p);
+        p += 8;
+    }
+#endif
+    for(; p<n; p++){
+        int s = rev ? n-1-p : p;
+        out[3*p] = r[s];
+        out[3*p+1] = g[s];
+        out[3*p+2] = b[s];
+    }
+}
+
+// A planar frame to an image, oriented as clipDeinterleave() does: under
+// CLIP_ORIENT_KELPER row (y,z) is source row (z,sz-1-y) mirrored in x.
+static void planarToRgb(const byte *frame, int sx, int sy, int sz, int orient, byte *rgb){
+    const unsigned long plane = (unsigned long) sx * sy * sz;
+    const int rev = (orient == CLIP_ORIENT_KELPER);
+
+    for(int z=0; z<sz; z++){
+        for(int y=0; y<sy; y++){
+            unsigned long row = rev ? (unsigned long)(sz-1-y) * sy + z : (unsigned long) z * sy + y;
+            const byte *src = frame + row * sx;
+            interleaveRow(src, src + plane, src + 2*plane, sx, rev, rgb + 3ul * ((unsigned long) z * sy + y) * sx);
+        }
+    }
+}
+
+// An image back to planes, voxel for voxel
+static void rgbToPlanar(const byte *rgb, unsigned long voxels, byte *frame){
+    byte *r = frame, *g = frame + voxels, *b = frame + 2*voxels;
+    unsigned long i = 0;
+#ifdef __SSSE3__
+    for(; voxels - i >= 16; i += 16)
+        deinterleaveRun(rgb + 3*i, 0, r + i, g + i, b + i);
+    if(voxels - i >= 8){
+        deinterleaveRun(rgb + 3*i, 1, r + i, g + i, b + i);
+        i += 8;
+    }
+#endif
+    for(; i<voxels; i++){
+        r[i] = rgb[3*i];
+        g[i] = rgb[3*i+1];
+        b[i] = rgb[3*i+2];
+    }
+}
+
+// An image to r,g,b,alpha, 4 voxels a shuffle while a 16 byte load fits
+static void rgbToRgba(const byte *rgb, unsigned long voxels, byte *rgba){
+    unsigned long i = 0;
+#ifdef __SSSE3__
+    for(; 3*i + 16 <= 3*voxels; i += 4){
+        __m128i v = _mm_loadu_si128((const __m128i *)(rgb + 3*i));
+        _mm_storeu_si128((__m128i *)(rgba + 4*i), _mm_or_si128(_mm_shuffle_epi8(v, rgbaMask), alphaBytes));
+    }
+#endif
+    for(; i<voxels; i++){
+        rgba[4*i] = rgb[3*i];
+        rgba[4*i+1] = rgb[3*i+1];
+        rgba[4*i+2] = rgb[3*i+2];
+        rgba[4*i+3] = alpha;
+    }
+}
+
+//
+// files
+//
+
+// One thread's frames. Fixed size formats go straight into the output
+// mapping, kdc into packed and is copied there once the sizes are known.
+struct Range {
+    unsigned long first, last;		// frames first..last-1
+    std::vector<byte> packed;
+    std::vector<unsigned long> keys;	// offsets in packed of the keyframes
+    unsigned long bad;				// frames -c found wrong, +1
+};
+
+struct Job {
+    const byte *frames;				// frame 0 in the input
+    ClipInfo info;
+    byte *out;						// frame 0 in the output
+    unsigned long outFrameSize;
+};
+
+static void convert(const Job *job, Range *range){
+    const ClipInfo *info = &job->info;
+    const unsigned long voxels = info->frameSize / 3;
+    std::vector<byte> img(2 * 3 * voxels), ref(3 * voxels), planar(info->frameSize);
+    byte *cur = &img[0], *prev = &img[3 * voxels];
+
+    range->bad = 0;
+    for(unsigned long f=range->first; f<range->last; f++){
+        const byte *frame = job->frames + f * info->frameSize;
+        byte *out = job->out + f * job->outFrameSize;
+
+        if(format == F_RGB)
+            cur = out;
+        planarToRgb(frame, info->sizeX, info->sizeY, info->sizeZ, orient, cur);
+
+        switch(format){
+        case F_ECA:
+        case F_RAW:
+            rgbToPlanar(cur, voxels, out);
+            break;
+        case F_RGBA:
+            rgbToRgba(cur, voxels, out);
+            break;
+        case F_KMC:
+            clipMapFrame(cur, IMG_WIDTH, strands, STRAND_COUNT, MAX_STRAND_LEN, out);
+            break;
+        case F_KDC: {
+            bool key = (f - range->first) % keyInterval == 0;
+            size_t at = range->packed.size();
+            if(key)
+                range->keys.push_back(at);
+            range->packed.resize(at + CLIP_PACKED_MAX(voxels));
+            unsigned long cb = clipPackFrame(cur, key ? NULL : prev, voxels, &range->packed[at]);
+            range->packed.resize(at + cb);
+            byte *t = prev;
+            prev = cur;
+            cur = t;
+            break;
+        }
+        }
+
+        if(check && !range->bad){
+            const byte *shown = (format == F_KDC) ? prev : cur;
+            clipDeinterleave(frame, info, orient, &ref[0]);
+            bool ok = memcmp(shown, &ref[0], 3 * voxels) == 0;
+            if(ok && (format == F_ECA || format == F_RAW)){
+                ClipInfo flat = *info;
+                clipDeinterleave(out, &flat, CLIP_ORIENT_NONE, &planar[0]);
+                ok = memcmp(&planar[0], shown, 3 * voxels) == 0;
+            }
+            if(ok && format == F_RGBA)
+                for(unsigned long i=0; i<voxels && ok; i++)
+                    ok = !memcmp(out + 4*i, shown + 3*i, 3) && out[4*i+3] == alpha;
+            if(!ok)
+                range->bad = f + 1;
+        }
+    }
+}
+
+// The CubeSense header as fileformats.txt has it, or raw888. Problems the
+// player would live with are warnings, ones it wouldn't are errors.
+static bool validate(const char *name, const byte *map, unsigned long cb,
+                     byte rawX, byte rawY, byte rawZ, ClipInfo *info){
+    byte hdr[CLIP_HEADER_SIZE] = { 0 };
+    memcpy(hdr, map, cb < sizeof(hdr) ? cb : sizeof(hdr));
+    bool eca = cb >= 2 && (hdr[0] | (hdr[1] << 8)) == ECA_MAGIC;
+
+    if(eca && cb < CLIP_ECA_BASE){
+        fprintf(stderr, "%s: CubeSense header cut short\n", name);
+        return false;
+    }
+    if(clipParseHeader(hdr, cb, rawX, rawY, rawZ, info) < 0){
+        fprintf(stderr, "%s: no whole frames\n", name);
+        return false;
+    }
+    if(info->mapped || info->packed || info->script){
+        fprintf(stderr, "%s: already a .%s\n", name, info->mapped ? "kmc" : info->packed ? "kdc" : "ecb");
+        return false;
+    }
+
+    unsigned long whole = (cb - info->base) / info->frameSize;
+    if(eca){
+        unsigned long frames = clipGet32(hdr + ECA_FRAMES);
+        if(hdr[ECA_TYPE] != 1)
+            fprintf(stderr, "%s: warning: file type %d, CubeSense writes 1\n", name, hdr[ECA_TYPE]);
+        if(!memchr(hdr + ECA_TITLE, 0, CLIP_TITLE_LEN))
+            fprintf(stderr, "%s: warning: title isn't terminated\n", name);
+        if(frames == 0)
+            fprintf(stderr, "%s: warning: no frame count, %lu frames by the size\n", name, whole);
+        else if(frames > whole)
+            fprintf(stderr, "%s: warning: header says %lu frames, only %lu in the file\n", name, frames, whole);
+        else if(frames < whole)
+            fprintf(stderr, "%s: warning: %lu frames past the %lu the header says, left out\n",
+                    name, whole - frames, frames);
+    }
+    if((cb - info->base) % info->frameSize)
+        fprintf(stderr, "%s: warning: %lu bytes of a partial frame at the end, left out\n",
+                name, (cb - info->base) % info->frameSize);
+
+    if(orient == CLIP_ORIENT_KELPER && info->sizeY != info->sizeZ){
+        fprintf(stderr, "%s: %dx%dx%d can't take orientation 1, it needs y and z the same\n",
+                name, info->sizeX, info->sizeY, info->sizeZ);
+        return false;
+    }
+    if((format == F_KMC || format == F_KDC) &&
+       (info->sizeX != IMG_WIDTH || info->sizeY * info->sizeZ != IMG_HEIGHT)){
+        fprintf(stderr, "%s: not a clip that fits the display, .%s only plays there\n", name, formats[format]);
+        return false;
+    }
+    return true;
+}
+
+// A new file of cb bytes, mapped for writing
+static byte *create(const char *name, unsigned long cb, int *fd){
+    *fd = open(name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(*fd < 0 || ftruncate(*fd, cb) < 0){
+        perror(name);
+        return NULL;
+    }
+    void *p = mmap(NULL, cb, PROT_READ | PROT_WRITE, MAP_SHARED, *fd, 0);
+    if(p == MAP_FAILED){
+        perror(name);
+        return NULL;
+    }
+    return (byte *) p;
+}
+
+static bool finish(const char *name, byte *map, unsigned long cb, int fd){
+    if(munmap(map, cb) < 0 || close(fd) < 0){
+        perror(name);
+        return false;
+    }
+    return true;
+}
+
+static bool transcode(const char *inName, const char *dir, int threads,
+                      byte rawX, byte rawY, byte rawZ, unsigned long *cbIn, double *seconds){
+    double t0 = now();
+
+    int fd = open(inName, O_RDONLY);
+    struct stat st;
+    if(fd < 0 || fstat(fd, &st) < 0){
+        perror(inName);
+        return false;
+    }
+    if(st.st_size == 0){
+        fprintf(stderr, "%s: empty\n", inName);
+        return false;
+    }
+    unsigned long cb = st.st_size;
+    const byte *map = (const byte *) mmap(NULL, cb, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map == (const byte *) MAP_FAILED){
+        perror(inName);
+        return false;
+    }
+    madvise((void *) map, cb, MADV_SEQUENTIAL);
+
+    Job job;
+    if(!validate(inName, map, cb, rawX, rawY, rawZ, &job.info)){
+        munmap((void *) map, cb);
+        return false;
+    }
+    const ClipInfo *info = &job.info;
+    const unsigned long voxels = info->frameSize / 3;
+    const unsigned long frames = info->frames;
+    job.frames = map + info->base;
+
+    // dir/name.format, never over the input
+    std::string outName = inName;
+    size_t slash = outName.rfind('/');
+    if(slash != std::string::npos)
+        outName.erase(0, slash + 1);
+    size_t dot = outName.rfind('.');
+    if(dot != std::string::npos && dot > 0)
+        outName.erase(dot);
+    outName = std::string(dir) + "/" + outName + "." + formats[format];
+    struct stat ost;
+    if(stat(outName.c_str(), &ost) == 0 && ost.st_dev == st.st_dev && ost.st_ino == st.st_ino){
+        fprintf(stderr, "%s: would write over itself, use -d\n", inName);
+        munmap((void *) map, cb);
+        return false;
+    }
+
+    unsigned long base = 0;
+    switch(format){
+    case F_ECA: base = CLIP_ECA_BASE; job.outFrameSize = 3 * voxels; break;
+    case F_RAW: case F_RGB: job.outFrameSize = 3 * voxels; break;
+    case F_RGBA: job.outFrameSize = 4 * voxels; break;
+    case F_KMC: base = CLIP_MAPPED_BASE; job.outFrameSize = MAPPED_FRAME_SIZE; break;
+    case F_KDC: job.outFrameSize = 0; break;
+    }
+
+    // frame ranges, in whole keyframe intervals for kdc so each range
+    // packs on its own
+    unsigned long unit = (format == F_KDC) ? keyInterval : 1;
+    unsigned long units = (frames + unit - 1) / unit;
+    if((unsigned long) threads > units)
+        threads = units;
+    std::vector<Range> ranges(threads);
+    for(int i=0; i<threads; i++){
+        ranges[i].first = units * i / threads * unit;
+        ranges[i].last = units * (i+1) / threads * unit;
+        if(ranges[i].last > frames)
+            ranges[i].last = frames;
+    }
+
+    int outFd = -1;
+    unsigned long cbOut = base + frames * job.outFrameSize;
+    byte *out = NULL;
+    if(format != F_KDC){
+        if(!(out = create(outName.c_str(), cbOut, &outFd))){
+            munmap((void *) map, cb);
+            return false;
+        }
+        memset(out, 0, base);
+        if(format == F_ECA)
+            clipMakeEcaHeader(out, frames, info->sizeX, info->sizeY, info->sizeZ, info->title);
+        else if(format == F_KMC)
+            clipMakeMappedHeader(out, frames, clipMapHash(strands, STRAND_COUNT), STRAND_COUNT,
+                                 MAX_STRAND_LEN, info->title);
+    }
+    job.out = out + base;
+
+    std::vector<std::thread> workers;
+    for(int i=1; i<threads; i++)
+        workers.push_back(std::thread(convert, &job, &ranges[i]));
+    convert(&job, &ranges[0]);
+    for(size_t i=0; i<workers.size(); i++)
+        workers[i].join();
+
+    if(format == F_KDC){
+        // the ranges one after another behind the keyframe index
+        unsigned long keys = units;
+        cbOut = CLIP_PACKED_BASE + 4*keys;
+        for(int i=0; i<threads; i++)
+            cbOut += ranges[i].packed.size();
+        if(!(out = create(outName.c_str(), cbOut, &outFd))){
+            munmap((void *) map, cb);
+            return false;
+        }
+        memset(out, 0, CLIP_PACKED_BASE);
+        clipMakePackedHeader(out, frames, keyInterval, info->sizeX, info->sizeY, info->sizeZ, info->title);
+        unsigned long at = CLIP_PACKED_BASE + 4*keys, key = 0;
+        for(int i=0; i<threads; i++){
+            for(size_t k=0; k<ranges[i].keys.size(); k++)
+                clipPut32(out + CLIP_PACKED_BASE + 4*key++, at + ranges[i].keys[k]);
+            memcpy(out + at, &ranges[i].packed[0], ranges[i].packed.size());
+            at += ranges[i].packed.size();
+        }
+    }
+
+    bool ok = finish(outName.c_str(), out, cbOut, outFd);
+    munmap((void *) map, cb);
+    for(int i=0; i<threads; i++){
+        if(ranges[i].bad){
+            fprintf(stderr, "%s: frame %lu doesn't match clipDeinterleave()\n", inName, ranges[i].bad - 1);
+            ok = false;
+        }
+    }
+    if(!ok)
+        return false;
+
+    double t = now() - t0;
+    *cbIn += frames * info->frameSize;
+    *seconds += t;
+    printf("%s: %lu frames %dx%dx%d -> %s, %lu bytes in %.1f ms (%.0f MB/s), %d thread%s\n",
+           inName, frames, info->sizeX, info->sizeY, info->sizeZ, outName.c_str(), cbOut,
+           t * 1e3, frames * info->frameSize / t / 1e6, threads, threads == 1 ? "" : "s");
+    return true;
+}
+
+int main(int argc, char **argv){
+    int threads = std::thread::hardware_concurrency();
+    const char *dir = ".";
+    int rawX = IMG_WIDTH, rawY = IMG_WIDTH, rawZ = IMG_HEIGHT/IMG_WIDTH;
+    int c;
+
+    while((c = getopt(argc, argv, "f:o:j:k:a:s:d:c")) != -1){
+        switch(c){
+        case 'f':
+            for(format = 0; format < (int)(sizeof(formats)/sizeof(formats[0])); format++)
+                if(!strcmp(optarg, formats[format]))
+                    break;
+            if(format == (int)(sizeof(formats)/sizeof(formats[0])))
+                usage();
+            break;
+        case 'o': orient = atoi(optarg); break;
+        case 'j': threads = atoi(optarg); break;
+        case 'k': keyInterval = atoi(optarg); break;
+        case 'a': alpha = (byte) atoi(optarg); break;
+        case 's':
+            if(sscanf(optarg, "%dx%dx%d", &rawX, &rawY, &rawZ) != 3)
+                usage();
+            break;
+        case 'd': dir = optarg; break;
+        case 'c': check = true; break;
+        default: usage();
+        }
+    }
+    if(optind == argc || keyInterval < 1 || keyInterval > 255 ||
+       (orient != CLIP_ORIENT_NONE && orient != CLIP_ORIENT_KELPER) ||
+       rawX < 1 || rawX > 255 || rawY < 1 || rawY > 255 || rawZ < 1 || rawZ > 255)
+        usage();
+    if(threads < 1)
+        threads = 1;
+
+    initKernels();
+
+    unsigned long cbIn = 0;
+    double seconds = 0;
+    int failed = 0, files = argc - optind;
+    for(int i=optind; i<argc; i++)
+        if(!transcode(argv[i], dir, threads, rawX, rawY, rawZ, &cbIn, &seconds))
+            failed++;
+
+    if(files > 1)
+        printf("%d files, %d failed, %.1f MB of frames in %.1f ms (%.0f MB/s)\n",
+               files, failed, cbIn / 1e6, seconds * 1e3, seconds > 0 ? cbIn / seconds / 1e6 : 0.0);
+    return failed ? 1 : 0;
+}